@@ -0,0 +1,344 @@
+/**
+ * @file BenchRunner.cpp
+ * @brief BenchRunner类的实现
+ */
+#include "BenchRunner.h"
+#include "BenchServers.h"
+#include "ProcessStats.h"
+#include "Device.h"
+#include "JGQDevice.h"
+#include "JGTDevice.h"
+#include "LSJDevice.h"
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QJsonArray>
+#include <QThread>
+#include <QTimer>
+#include <algorithm>
+
+namespace {
+
+QJsonObject summaryToJson(const LatencyHistogram::Summary& s)
+{
+    QJsonObject obj;
+    obj["count"] = static_cast<double>(s.count);
+    obj["meanUs"] = s.meanUs;
+    obj["p50Us"] = static_cast<double>(s.p50Us);
+    obj["p90Us"] = static_cast<double>(s.p90Us);
+    obj["p99Us"] = static_cast<double>(s.p99Us);
+    obj["maxUs"] = static_cast<double>(s.maxUs);
+    return obj;
+}
+
+/**
+ * 各设备的直方图不能直接合并，这里取各设备中位数的中位数和最差设备的p99/max，
+ * 均值按事务数加权。
+ */
+LatencyHistogram::Summary combine(const QList<LatencyHistogram::Summary>& list)
+{
+    LatencyHistogram::Summary out;
+    if (list.isEmpty()) {
+        return out;
+    }
+    QVector<qint64> p50, p90;
+    double weighted = 0;
+    for (const auto& s : list) {
+        out.count += s.count;
+        weighted += s.meanUs * s.count;
+        p50.append(s.p50Us);
+        p90.append(s.p90Us);
+        out.p99Us = qMax(out.p99Us, s.p99Us);
+        out.maxUs = qMax(out.maxUs, s.maxUs);
+    }
+    std::sort(p50.begin(), p50.end());
+    std::sort(p90.begin(), p90.end());
+    out.p50Us = p50.at(p50.size() / 2);
+    out.p90Us = p90.at(p90.size() / 2);
+    out.meanUs = out.count ? weighted / out.count : 0;
+    return out;
+}
+
+}
+
+BenchRunner::BenchRunner(const QJsonObject& deviceConfigs, const BenchOptions& options, QObject *parent)
+    : QObject(parent)
+    , m_configs(deviceConfigs)
+    , m_options(options)
+    , m_nextPort(options.basePort)
+    , m_tags(0)
+    , m_connected(0)
+    , m_counting(false)
+    , m_jgtSeq(0)
+{
+}
+
+QJsonObject BenchRunner::run(const QString& kind, int count)
+{
+    QJsonObject result;
+    result["device"] = kind;
+    result["count"] = count;
+
+    m_tags.store(0);
+    m_connected.store(0);
+    m_counting.store(false);
+
+    const qint64 rssBefore = ProcessStats::residentBytes();
+    QList<Instance> instances;
+    QString error;
+    if (!createInstances(kind, count, instances, error)) {
+        teardown(instances);
+        result["error"] = error;
+        return result;
+    }
+    for (Instance& instance : instances) {
+        startDevice(instance);
+    }
+
+    if (!waitFor([&]() { return m_connected.load() >= count; }, m_options.connectTimeoutMs)) {
+        result["error"] = QString("only %1 of %2 devices connected").arg(m_connected.load()).arg(count);
+        teardown(instances);
+        return result;
+    }
+
+    // JGT 没有轮询，由驱动定时器模拟界面持续下发参数
+    QTimer writeDriver;
+    if (kind == "jgt") {
+        m_jgtKeys.clear();
+        for (const QJsonValue& val : m_configs["jgt"].toObject()["registers"].toArray()) {
+            m_jgtKeys.append(val.toObject()["key"].toString());
+        }
+        writeDriver.setInterval(m_options.jgtWriteIntervalMs);
+        connect(&writeDriver, &QTimer::timeout, this, [this, &instances]() { driveJgtWrites(instances); });
+        writeDriver.start();
+    }
+
+    spin(m_options.warmupMs);
+
+    // 预热结束：在设备线程中清零统计，之后开始计数
+    for (const Instance& instance : instances) {
+        QMetaObject::invokeMethod(instance.device, "resetMetrics", Qt::BlockingQueuedConnection);
+        if (auto sink = qobject_cast<JgtSinkServer*>(instance.server)) {
+            sink->resetCounters();
+        }
+    }
+    m_tags.store(0);
+    m_counting.store(true);
+    const qint64 cpuStart = ProcessStats::cpuTimeMs();
+    QElapsedTimer wall;
+    wall.start();
+
+    spin(m_options.durationMs);
+
+    m_counting.store(false);
+    const qint64 elapsedMs = wall.elapsed();
+    const qint64 cpuMs = ProcessStats::cpuTimeMs() - cpuStart;
+    const qint64 rssAfter = ProcessStats::residentBytes();
+    writeDriver.stop();
+
+    // 汇总各设备统计
+    quint64 tags = m_tags.load();
+    quint64 requests = 0;
+    quint64 replies = 0;
+    quint64 errors = 0;
+    quint64 bytesIn = 0;
+    quint64 bytesOut = 0;
+    QList<LatencyHistogram::Summary> latencies;
+    QList<LatencyHistogram::Summary> scanCycles;
+    QList<LatencyHistogram::Summary> ages;
+    for (const Instance& instance : instances) {
+        const DeviceMetrics::Snapshot s = instance.device->metrics().snapshot();
+        requests += s.requests;
+        replies += s.replies;
+        errors += s.errors();
+        bytesIn += s.bytesIn;
+        bytesOut += s.bytesOut;
+        latencies.append(s.latency);
+        if (s.scanCycle.count > 0) {
+            scanCycles.append(s.scanCycle);
+        }
+        if (s.tagAge.count > 0) {
+            ages.append(s.tagAge);
+        }
+        if (auto sink = qobject_cast<JgtSinkServer*>(instance.server)) {
+            tags += sink->commands();   // JGT 以服务端收到的命令数计
+        }
+    }
+
+    const double seconds = elapsedMs / 1000.0;
+    result["durationMs"] = static_cast<double>(elapsedMs);
+    result["tags"] = static_cast<double>(tags);
+    result["tagsPerSec"] = tags / seconds;
+    result["requests"] = static_cast<double>(requests);
+    result["requestsPerSec"] = requests / seconds;
+    result["replies"] = static_cast<double>(replies);
+    result["errors"] = static_cast<double>(errors);
+    result["bytesIn"] = static_cast<double>(bytesIn);
+    result["bytesOut"] = static_cast<double>(bytesOut);
+    result["latency"] = summaryToJson(combine(latencies));
+    if (!scanCycles.isEmpty()) {
+        result["scanCycle"] = summaryToJson(combine(scanCycles));
+    }
+    if (!ages.isEmpty()) {
+        result["tagAge"] = summaryToJson(combine(ages));
+    }
+    if (cpuStart >= 0) {
+        result["cpuMs"] = static_cast<double>(cpuMs);
+        result["cpuMsPer1kTags"] = tags ? cpuMs * 1000.0 / tags : 0.0;
+    }
+    if (rssBefore >= 0 && rssAfter >= 0) {
+        result["rssBytesPerDevice"] = static_cast<double>(rssAfter - rssBefore) / count;
+    }
+
+    teardown(instances);
+    return result;
+}
+
+bool BenchRunner::createInstances(const QString& kind, int count, QList<Instance>& instances, QString& error)
+{
+    const QJsonObject base = m_configs[kind].toObject();
+    if (base.isEmpty()) {
+        error = QString("no config for device type '%1'").arg(kind);
+        return false;
+    }
+    if (kind == "lsj" && m_options.lsjPorts.size() < count) {
+        error = QString("LSJ needs %1 serial port pairs, %2 given").arg(count).arg(m_options.lsjPorts.size());
+        return false;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        QJsonObject config = base;
+        const QString id = QString("%1_bench_%2").arg(kind).arg(i);
+        config["device_id"] = id;
+
+        // 基准测试只关心稳态，连接失败直接判定场景失败，不重连
+        QJsonObject reconnect = config["reconnect"].toObject();
+        reconnect["enabled"] = false;
+        config["reconnect"] = reconnect;
+
+        Instance instance;
+        if (kind == "lsj") {
+            QJsonObject rtuParams = config["rtu_params"].toObject();
+            rtuParams["port_name"] = m_options.lsjPorts.at(i).first;
+            config["rtu_params"] = rtuParams;
+            auto server = new ModbusLoopbackServer(config, this);
+            instance.server = server;
+            if (!server->openSerial(m_options.lsjPorts.at(i).second)) {
+                error = QString("slave port %1: %2").arg(m_options.lsjPorts.at(i).second).arg(server->errorString());
+                instances.append(instance);
+                return false;
+            }
+            instance.device = new LSJDevice(id, id, config);
+        } else {
+            const quint16 port = m_nextPort++;
+            QJsonObject tcpParams = config["tcp_params"].toObject();
+            tcpParams["ip_address"] = "127.0.0.1";
+            tcpParams["port"] = port;
+            config["tcp_params"] = tcpParams;
+
+            bool ok = false;
+            if (kind == "jgq") {
+                auto server = new ModbusLoopbackServer(config, this);
+                instance.server = server;
+                ok = server->listenTcp(port);
+                error = server->errorString();
+                instance.device = new JGQDevice(id, id, config);
+            } else if (kind == "jgt") {
+                auto server = new JgtSinkServer(this);
+                instance.server = server;
+                ok = server->listen(port);
+                error = server->errorString();
+                instance.device = new JGTDevice(id, id, config);
+            } else {
+                error = QString("unknown device type '%1'").arg(kind);
+            }
+            if (!ok) {
+                error = QString("port %1: %2").arg(port).arg(error);
+                instances.append(instance);
+                return false;
+            }
+        }
+        instances.append(instance);
+    }
+    error.clear();
+    return true;
+}
+
+void BenchRunner::startDevice(Instance& instance)
+{
+    Device* device = instance.device;
+    connect(device, &Device::dataUpdated, this, [this](const QString&, const QString&, const QVariant&) {
+        if (m_counting.load(std::memory_order_relaxed)) {
+            m_tags.fetch_add(1, std::memory_order_relaxed);
+        }
+    }, Qt::DirectConnection);
+    connect(device, &Device::connectedChanged, this, [this](const QString&, bool connected) {
+        m_connected.fetch_add(connected ? 1 : -1);
+    }, Qt::DirectConnection);
+
+    // 与 ThreadManager::startDeviceThread 相同的线程模型
+    instance.thread = new QThread;
+    device->moveToThread(instance.thread);
+    connect(instance.thread, &QThread::started, device, [device]() {
+        device->initInThread();
+        device->connectDevice();
+    });
+    instance.thread->start();
+}
+
+void BenchRunner::teardown(QList<Instance>& instances)
+{
+    for (Instance& instance : instances) {
+        if (instance.thread && instance.thread->isRunning()) {
+            QMetaObject::invokeMethod(instance.device, "setAutoReconnect", Qt::BlockingQueuedConnection, Q_ARG(bool, false));
+            QMetaObject::invokeMethod(instance.device, "stop", Qt::BlockingQueuedConnection);
+            instance.thread->quit();
+        }
+    }
+    for (Instance& instance : instances) {
+        if (instance.thread) {
+            instance.thread->wait();
+            delete instance.thread;
+        }
+        delete instance.device;
+        delete instance.server;
+    }
+    instances.clear();
+    // 处理服务端和设备删除后遗留的 deleteLater
+    QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+
+void BenchRunner::driveJgtWrites(const QList<Instance>& instances)
+{
+    if (m_jgtKeys.isEmpty()) {
+        return;
+    }
+    for (const Instance& instance : instances) {
+        for (int i = 0; i < m_options.jgtWritesPerTick; ++i) {
+            const QString& key = m_jgtKeys.at(static_cast<int>(m_jgtSeq % m_jgtKeys.size()));
+            QMetaObject::invokeMethod(instance.device, "writeData2Device", Qt::QueuedConnection,
+                                      Q_ARG(QString, key), Q_ARG(QString, QString::number(m_jgtSeq % 1000)));
+            ++m_jgtSeq;
+        }
+    }
+}
+
+bool BenchRunner::waitFor(const std::function<bool()>& condition, int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    while (!condition()) {
+        if (timer.elapsed() >= timeoutMs) {
+            return false;
+        }
+        spin(20);
+    }
+    return true;
+}
+
+void BenchRunner::spin(int ms)
+{
+    QEventLoop loop;
+    QTimer::singleShot(ms, &loop, &QEventLoop::quit);
+    loop.exec();
+}
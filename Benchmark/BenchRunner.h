@@ -0,0 +1,79 @@
+#ifndef BENCHRUNNER_H
+#define BENCHRUNNER_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <atomic>
+#include <functional>
+
+class Device;
+class QThread;
+
+/**
+ * @brief 基准测试参数
+ */
+struct BenchOptions
+{
+    int warmupMs = 2000;            ///< 连接后预热时间，预热结束时清零统计
+    int durationMs = 10000;         ///< 测量时间
+    int connectTimeoutMs = 5000;    ///< 等待全部设备连接的时间
+    quint16 basePort = 15020;       ///< 回环服务端起始端口，每个设备一个端口
+    int jgtWriteIntervalMs = 1;     ///< JGT 写入驱动间隔
+    int jgtWritesPerTick = 10;      ///< JGT 每个设备每次驱动写入的命令数
+    QList<QPair<QString, QString>> lsjPorts; ///< LSJ 串口对(主站, 从站)，为空时跳过LSJ
+};
+
+/**
+ * @brief 设备数据通路基准测试
+ *
+ * 每个场景创建N个设备和N个进程内回环服务端，设备各自运行在独立线程中(与主程序相同)，
+ * 预热后清零统计并测量固定时长，输出吞吐量、事务延迟、CPU和内存占用。
+ * 服务端运行在主线程，CPU时间为整个进程的占用，包含服务端。
+ */
+class BenchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    BenchRunner(const QJsonObject& deviceConfigs, const BenchOptions& options, QObject *parent = nullptr);
+
+    /**
+     * @brief 运行一个场景
+     * @param kind 设备类型: "jgq", "jgt", "lsj"
+     * @param count 设备数量
+     * @return 场景结果，失败时包含 "error"
+     */
+    QJsonObject run(const QString& kind, int count);
+
+private:
+    struct Instance {
+        Device* device = nullptr;
+        QThread* thread = nullptr;
+        QObject* server = nullptr;
+    };
+
+    bool createInstances(const QString& kind, int count, QList<Instance>& instances, QString& error);
+    void startDevice(Instance& instance);
+    void teardown(QList<Instance>& instances);
+    void driveJgtWrites(const QList<Instance>& instances);
+
+    /**
+     * @brief 运行事件循环直到条件满足或超时
+     */
+    static bool waitFor(const std::function<bool()>& condition, int timeoutMs);
+    static void spin(int ms);
+
+    QJsonObject m_configs;          // 类型 -> 设备配置模板
+    BenchOptions m_options;
+    quint16 m_nextPort;
+    std::atomic<quint64> m_tags;
+    std::atomic<int> m_connected;
+    std::atomic<bool> m_counting;
+    quint64 m_jgtSeq;
+    QStringList m_jgtKeys;          // JGT 驱动轮流写入的参数key
+};
+
+#endif // BENCHRUNNER_H
@@ -0,0 +1,133 @@
+/**
+ * @file BenchServers.cpp
+ * @brief 基准测试用回环服务端的实现
+ */
+#include "BenchServers.h"
+#include "ConfigImage.h"
+#include <QModbusTcpServer>
+#include <QModbusRtuSerialSlave>
+#include <QSerialPort>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QHash>
+#include <QVariant>
+#include <QDebug>
+
+ModbusLoopbackServer::ModbusLoopbackServer(const QJsonObject& deviceConfig, QObject *parent)
+    : QObject(parent)
+    , m_config(deviceConfig)
+    , m_server(nullptr)
+{
+}
+
+bool ModbusLoopbackServer::listenTcp(quint16 port)
+{
+    m_server = new QModbusTcpServer(this);
+    m_server->setConnectionParameter(QModbusDevice::NetworkAddressParameter, "127.0.0.1");
+    m_server->setConnectionParameter(QModbusDevice::NetworkPortParameter, port);
+    return start();
+}
+
+bool ModbusLoopbackServer::openSerial(const QString& portName)
+{
+    QJsonObject rtuParams = m_config["rtu_params"].toObject();
+    m_server = new QModbusRtuSerialSlave(this);
+    m_server->setConnectionParameter(QModbusDevice::SerialPortNameParameter, portName);
+    m_server->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, rtuParams["baud_rate"].toInt(9600));
+    m_server->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, rtuParams["data_bits"].toInt(8));
+    m_server->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, rtuParams["stop_bits"].toInt(1));
+    const QString parity = rtuParams["parity"].toString();
+    m_server->setConnectionParameter(QModbusDevice::SerialParityParameter,
+                                     parity == "even" ? QSerialPort::EvenParity
+                                     : parity == "odd" ? QSerialPort::OddParity : QSerialPort::NoParity);
+    return start();
+}
+
+QString ModbusLoopbackServer::errorString() const
+{
+    return m_server ? m_server->errorString() : QString("server not created");
+}
+
+bool ModbusLoopbackServer::start()
+{
+    // 与设备使用同一份编译结果：先按寄存器类型求出最大地址，每种类型建立一张从0开始的连续表
+    struct Reg { QModbusDataUnit::RegisterType type; int address; int count; };
+    QList<Reg> regs;
+    QHash<int, int> tableSize;
+    QStringList errors;
+    const QSharedPointer<const ConfigImage> image = ConfigImage::fromConfig(m_config, &errors);
+    if (!image) {
+        qWarning() << "ModbusLoopbackServer: invalid config:" << errors.join("; ");
+        return false;
+    }
+    for (int b = 0; b < image->blockCount(); ++b) {
+        const ConfigImage::Block& block = image->block(b);
+        Reg reg;
+        reg.type = static_cast<QModbusDataUnit::RegisterType>(block.regType);
+        reg.address = block.address;
+        reg.count = block.regCount;
+        regs.append(reg);
+        tableSize[reg.type] = qMax(tableSize.value(reg.type), reg.address + reg.count);
+    }
+
+    QModbusDataUnitMap map;
+    for (auto it = tableSize.constBegin(); it != tableSize.constEnd(); ++it) {
+        const auto type = static_cast<QModbusDataUnit::RegisterType>(it.key());
+        map.insert(type, QModbusDataUnit(type, 0, static_cast<quint16>(qMin(it.value(), 65535))));
+    }
+    m_server->setMap(map);
+    for (const Reg& reg : regs) {
+        for (int i = 0; i < reg.count; ++i) {
+            const quint16 value = (reg.type == QModbusDataUnit::Coils || reg.type == QModbusDataUnit::DiscreteInputs)
+                                      ? quint16(reg.address & 1) : quint16(reg.address + i);
+            m_server->setData(reg.type, static_cast<quint16>(reg.address + i), value);
+        }
+    }
+
+    m_server->setServerAddress(m_config["server_address"].toInt(1));
+    return m_server->connectDevice();
+}
+
+JgtSinkServer::JgtSinkServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+    , m_bytes(0)
+    , m_commands(0)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &JgtSinkServer::onNewConnection);
+}
+
+bool JgtSinkServer::listen(quint16 port)
+{
+    return m_server->listen(QHostAddress::LocalHost, port);
+}
+
+QString JgtSinkServer::errorString() const
+{
+    return m_server->errorString();
+}
+
+void JgtSinkServer::resetCounters()
+{
+    m_bytes.store(0, std::memory_order_relaxed);
+    m_commands.store(0, std::memory_order_relaxed);
+}
+
+void JgtSinkServer::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::readyRead, this, &JgtSinkServer::onReadyRead);
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+    }
+}
+
+void JgtSinkServer::onReadyRead()
+{
+    auto socket = qobject_cast<QTcpSocket*>(sender());
+    if (!socket) {
+        return;
+    }
+    const QByteArray data = socket->readAll();
+    m_bytes.fetch_add(data.size(), std::memory_order_relaxed);
+    m_commands.fetch_add(data.count('>'), std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#ifndef BENCHSERVERS_H
+#define BENCHSERVERS_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QList>
+#include <atomic>
+
+class QModbusServer;
+class QTcpServer;
+class QTcpSocket;
+
+/**
+ * @brief 进程内Modbus从站，按设备配置中的 registers 建立寄存器表
+ *
+ * 与设备使用同一份配置，保证每个轮询请求都能得到正常应答；
+ * 寄存器初值取地址的低16位，使位解析和多寄存器拼接都有非零数据。
+ */
+class ModbusLoopbackServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ModbusLoopbackServer(const QJsonObject& deviceConfig, QObject *parent = nullptr);
+
+    /**
+     * @brief 在 127.0.0.1:port 上以 Modbus TCP 监听
+     */
+    bool listenTcp(quint16 port);
+
+    /**
+     * @brief 在指定串口上以 Modbus RTU 从站运行，串口参数取设备配置的 rtu_params
+     */
+    bool openSerial(const QString& portName);
+
+    QString errorString() const;
+
+private:
+    bool start();
+
+    QJsonObject m_config;
+    QModbusServer* m_server;
+};
+
+/**
+ * @brief 激光头(JGT)协议的接收端，只统计收到的字节数和命令数
+ */
+class JgtSinkServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JgtSinkServer(QObject *parent = nullptr);
+
+    bool listen(quint16 port);
+    QString errorString() const;
+
+    quint64 bytes() const { return m_bytes.load(std::memory_order_relaxed); }
+    quint64 commands() const { return m_commands.load(std::memory_order_relaxed); }
+    void resetCounters();
+
+private slots:
+    void onNewConnection();
+    void onReadyRead();
+
+private:
+    QTcpServer* m_server;
+    std::atomic<quint64> m_bytes;
+    std::atomic<quint64> m_commands;   // 按命令结束符 '>' 计数
+};
+
+#endif // BENCHSERVERS_H
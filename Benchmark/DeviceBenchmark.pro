@@ -0,0 +1,52 @@
+QT       += core network serialport serialbus
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = DeviceBenchmark
+TEMPLATE = app
+DESTDIR = $$PWD/../SimulatorExe
+
+# 直接编译被测的设备类，与主程序使用同一份源码
+SRC_DIR = $$PWD/../src
+INCLUDEPATH += $$SRC_DIR \
+               $$SRC_DIR/core \
+               $$SRC_DIR/devices
+
+SOURCES += main.cpp \
+    BenchServers.cpp \
+    BenchRunner.cpp \
+    ProcessStats.cpp \
+    $$SRC_DIR/core/Device.cpp \
+    $$SRC_DIR/core/DeviceMetrics.cpp \
+    $$SRC_DIR/core/ConfigImage.cpp \
+    $$SRC_DIR/core/ModbusPlan.cpp \
+    $$SRC_DIR/core/DriverRegistry.cpp \
+    $$SRC_DIR/core/ModbusBus.cpp \
+    $$SRC_DIR/devices/JGQDevice.cpp \
+    $$SRC_DIR/devices/JGTDevice.cpp \
+    $$SRC_DIR/devices/LSJDevice.cpp
+
+HEADERS += \
+    BenchServers.h \
+    BenchRunner.h \
+    ProcessStats.h \
+    $$SRC_DIR/core/Device.h \
+    $$SRC_DIR/core/DeviceMetrics.h \
+    $$SRC_DIR/core/ConfigImage.h \
+    $$SRC_DIR/core/modbusdata.h \
+    $$SRC_DIR/core/ModbusPlan.h \
+    $$SRC_DIR/core/DriverRegistry.h \
+    $$SRC_DIR/core/ModbusBus.h \
+    $$SRC_DIR/devices/JGQDevice.h \
+    $$SRC_DIR/devices/JGTDevice.h \
+    $$SRC_DIR/devices/LSJDevice.h
+
+win32: LIBS += -lpsapi
+
+# 强制MSVC编译器使用UTF-8编码来解析源文件和执行字符集
+win32-msvc {
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
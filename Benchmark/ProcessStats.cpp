@@ -0,0 +1,66 @@
+/**
+ * @file ProcessStats.cpp
+ * @brief 进程CPU时间和常驻内存的平台实现
+ */
+#include "ProcessStats.h"
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#include <psapi.h>
+#elif defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <unistd.h>
+#include <QFile>
+#endif
+
+namespace ProcessStats
+{
+
+qint64 cpuTimeMs()
+{
+#if defined(Q_OS_WIN)
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return -1;
+    }
+    auto toMs = [](const FILETIME& ft) {
+        return ((static_cast<qint64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10000; // 100ns -> ms
+    };
+    return toMs(kernel) + toMs(user);
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000LL
+           + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+#else
+    return -1;
+#endif
+}
+
+qint64 residentBytes()
+{
+#if defined(Q_OS_WIN)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+    return static_cast<qint64>(counters.WorkingSetSize);
+#elif defined(Q_OS_LINUX)
+    // /proc/self/statm 第二列为常驻页数
+    QFile statm("/proc/self/statm");
+    if (!statm.open(QIODevice::ReadOnly)) {
+        return -1;
+    }
+    const QList<QByteArray> fields = statm.readAll().split(' ');
+    if (fields.size() < 2) {
+        return -1;
+    }
+    return fields.at(1).toLongLong() * sysconf(_SC_PAGESIZE);
+#else
+    return -1;
+#endif
+}
+
+}
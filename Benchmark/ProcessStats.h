@@ -0,0 +1,22 @@
+#ifndef PROCESSSTATS_H
+#define PROCESSSTATS_H
+
+#include <QtGlobal>
+
+/**
+ * @brief 当前进程的资源占用
+ */
+namespace ProcessStats
+{
+    /**
+     * @brief 进程累计CPU时间(用户态+内核态，ms)，不支持的平台返回-1
+     */
+    qint64 cpuTimeMs();
+
+    /**
+     * @brief 进程当前常驻内存(字节)，不支持的平台返回-1
+     */
+    qint64 residentBytes();
+}
+
+#endif // PROCESSSTATS_H
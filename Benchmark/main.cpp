@@ -0,0 +1,191 @@
+/**
+ * @file main.cpp
+ * @brief 设备数据通路基准测试入口
+ *
+ * 用法示例:
+ *   DeviceBenchmark --devices jgq,jgt --counts 1,10,100 --duration 10 --output result.json
+ *   DeviceBenchmark --baseline last.json --tolerance 0.2   (吞吐下降或p99上升超过20%时返回2)
+ */
+#include "BenchRunner.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+namespace {
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+const auto kSkipEmptyParts = Qt::SkipEmptyParts;
+#else
+const auto kSkipEmptyParts = QString::SkipEmptyParts;
+#endif
+
+QJsonObject loadConfig(const QString& path, QString& error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("cannot open %1").arg(path);
+        return QJsonObject();
+    }
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(file.readAll(), &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        error = QString("%1: %2").arg(path).arg(parseError.errorString());
+        return QJsonObject();
+    }
+    return doc.object();
+}
+
+/**
+ * @brief 与基准结果比较，返回发现的回退项
+ */
+QStringList compareWithBaseline(const QJsonArray& results, const QJsonArray& baseline, double tolerance)
+{
+    QStringList regressions;
+    for (const QJsonValue& val : results) {
+        const QJsonObject cur = val.toObject();
+        for (const QJsonValue& baseVal : baseline) {
+            const QJsonObject base = baseVal.toObject();
+            if (base["device"] != cur["device"] || base["count"] != cur["count"]
+                || base.contains("error") || cur.contains("error")) {
+                continue;
+            }
+            const QString name = QString("%1 x%2").arg(cur["device"].toString()).arg(cur["count"].toInt());
+            const double baseRate = base["tagsPerSec"].toDouble();
+            const double curRate = cur["tagsPerSec"].toDouble();
+            if (baseRate > 0 && curRate < baseRate * (1.0 - tolerance)) {
+                regressions << QString("%1: tagsPerSec %2 -> %3").arg(name).arg(baseRate, 0, 'f', 1).arg(curRate, 0, 'f', 1);
+            }
+            const double baseP99 = base["latency"].toObject()["p99Us"].toDouble();
+            const double curP99 = cur["latency"].toObject()["p99Us"].toDouble();
+            if (baseP99 > 0 && curP99 > baseP99 * (1.0 + tolerance)) {
+                regressions << QString("%1: latency p99 %2 us -> %3 us").arg(name).arg(baseP99).arg(curP99);
+            }
+        }
+    }
+    return regressions;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("DeviceBenchmark");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless benchmark of the device data path against in-process loopback servers.");
+    parser.addHelpOption();
+    QCommandLineOption devicesOption("devices", "Device types to run: jgq, jgt, lsj.", "list", "jgq,jgt,lsj");
+    QCommandLineOption countsOption("counts", "Device counts per scenario.", "list", "1,10,100");
+    QCommandLineOption durationOption("duration", "Measurement time per scenario (s).", "seconds", "10");
+    QCommandLineOption warmupOption("warmup", "Warm-up time before measuring (s).", "seconds", "2");
+    QCommandLineOption configOption("config", "Directory with jgq/jgt/lsj_device.json.", "dir",
+                                    QCoreApplication::applicationDirPath() + "/../config");
+    QCommandLineOption portOption("base-port", "First loopback port.", "port", "15020");
+    QCommandLineOption lsjPortsOption("lsj-ports", "Serial port pairs for LSJ, master:slave,... (e.g. a com0com/socat pair).", "pairs");
+    QCommandLineOption jgtRateOption("jgt-writes", "JGT commands per device per millisecond tick.", "n", "10");
+    QCommandLineOption outputOption("output", "Write JSON results to file instead of stdout.", "file");
+    QCommandLineOption baselineOption("baseline", "Compare with a previous result file; exit 2 on regression.", "file");
+    QCommandLineOption toleranceOption("tolerance", "Allowed relative regression against the baseline.", "ratio", "0.2");
+    parser.addOptions({devicesOption, countsOption, durationOption, warmupOption, configOption, portOption,
+                       lsjPortsOption, jgtRateOption, outputOption, baselineOption, toleranceOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+
+    BenchOptions options;
+    options.durationMs = qRound(parser.value(durationOption).toDouble() * 1000);
+    options.warmupMs = qRound(parser.value(warmupOption).toDouble() * 1000);
+    options.basePort = static_cast<quint16>(parser.value(portOption).toUInt());
+    options.jgtWritesPerTick = qMax(1, parser.value(jgtRateOption).toInt());
+    for (const QString& pair : parser.value(lsjPortsOption).split(',', kSkipEmptyParts)) {
+        const QStringList ports = pair.split(':');
+        if (ports.size() == 2) {
+            options.lsjPorts.append(qMakePair(ports.at(0), ports.at(1)));
+        }
+    }
+
+    // 每种设备读取一份配置模板，场景内按序号改写ID和端口
+    const QDir configDir(parser.value(configOption));
+    const QStringList kinds = parser.value(devicesOption).split(',', kSkipEmptyParts);
+    QJsonObject configs;
+    for (const QString& kind : kinds) {
+        QString error;
+        QJsonObject config = loadConfig(configDir.filePath(kind + "_device.json"), error);
+        if (config.isEmpty()) {
+            err << "warning: " << error << "\n";
+            continue;
+        }
+        configs[kind] = config;
+    }
+
+    QList<int> counts;
+    for (const QString& c : parser.value(countsOption).split(',', kSkipEmptyParts)) {
+        if (c.toInt() > 0) {
+            counts.append(c.toInt());
+        }
+    }
+
+    BenchRunner runner(configs, options);
+    QJsonArray results;
+    for (const QString& kind : kinds) {
+        for (int count : counts) {
+            err << "running " << kind << " x" << count << " ...\n";
+            err.flush();    // 每个场景要运行数秒，进度立即输出
+            QJsonObject result = runner.run(kind, count);
+            if (result.contains("error")) {
+                err << "  skipped: " << result["error"].toString() << "\n";
+            } else {
+                err << QString("  %1 tags/s, p99 %2 us").arg(result["tagsPerSec"].toDouble(), 0, 'f', 1)
+                           .arg(result["latency"].toObject()["p99Us"].toDouble()) << "\n";
+            }
+            err.flush();
+            results.append(result);
+        }
+    }
+
+    QJsonObject report;
+    report["tool"] = "DeviceBenchmark";
+    report["format"] = 1;
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qtVersion"] = QString(qVersion());
+    report["durationMs"] = options.durationMs;
+    report["warmupMs"] = options.warmupMs;
+    report["results"] = results;
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(outputOption)) {
+        QFile out(parser.value(outputOption));
+        if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot write " << out.fileName() << "\n";
+            return 1;
+        }
+        out.write(json);
+    } else {
+        QTextStream(stdout) << json;
+    }
+
+    if (parser.isSet(baselineOption)) {
+        QString error;
+        const QJsonObject baseline = loadConfig(parser.value(baselineOption), error);
+        if (baseline.isEmpty()) {
+            err << "baseline: " << error << "\n";
+            return 1;
+        }
+        const QStringList regressions = compareWithBaseline(results, baseline["results"].toArray(),
+                                                            parser.value(toleranceOption).toDouble());
+        for (const QString& line : regressions) {
+            err << "REGRESSION " << line << "\n";
+        }
+        if (!regressions.isEmpty()) {
+            return 2;
+        }
+    }
+    return 0;
+}
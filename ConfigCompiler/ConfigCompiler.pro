@@ -0,0 +1,25 @@
+QT       += core serialbus
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = DeviceConfigCompiler
+TEMPLATE = app
+DESTDIR = $$PWD/../SimulatorExe
+
+# 与主程序使用同一份编译器源码，生成的镜像格式保持一致
+SRC_DIR = $$PWD/../src
+INCLUDEPATH += $$SRC_DIR/core
+
+SOURCES += main.cpp \
+    $$SRC_DIR/core/ConfigImage.cpp
+
+HEADERS += \
+    $$SRC_DIR/core/ConfigImage.h
+
+# 强制MSVC编译器使用UTF-8编码来解析源文件和执行字符集
+win32-msvc {
+    QMAKE_CFLAGS += /utf-8
+    QMAKE_CXXFLAGS += /utf-8
+}
@@ -0,0 +1,130 @@
+/**
+ * @file main.cpp
+ * @brief 设备配置编译器入口
+ *
+ * 校验设备JSON并编译为服务启动时映射的二进制镜像(.dcimg)。
+ * 用法示例:
+ *   DeviceConfigCompiler config/                  (编译目录下全部 *.json)
+ *   DeviceConfigCompiler --check config/jgq_device.json config/lsj_device.json   (只校验，有错误时返回1)
+ *   DeviceConfigCompiler --dump config/jgq_device.json
+ */
+#include "ConfigImage.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTextStream>
+
+namespace {
+
+QStringList collectFiles(const QStringList& args)
+{
+    QStringList files;
+    for (const QString& arg : args) {
+        const QFileInfo info(arg);
+        if (info.isDir()) {
+            const QDir dir(arg);
+            for (const QString& name : dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name)) {
+                files << dir.filePath(name);
+            }
+        } else {
+            files << arg;
+        }
+    }
+    return files;
+}
+
+void dump(const ConfigImage& image, QTextStream& out)
+{
+    out << "  blocks: " << image.blockCount() << ", params: " << image.paramCount() << "\n";
+    for (int b = 0; b < image.blockCount(); ++b) {
+        const ConfigImage::Block& block = image.block(b);
+        out << QString("  [%1] %2 type %3 addr %4 x%5:").arg(b).arg(block.isRead ? "R" : "W")
+                   .arg(block.regType).arg(block.address).arg(block.regCount);
+        for (quint32 i = 0; i < block.paramCount; ++i) {
+            const ConfigImage::Param& param = image.param(static_cast<int>(block.firstParam + i));
+            out << QString(" %1(%2:%3)").arg(image.string(param.key)).arg(param.bitpos).arg(param.length);
+        }
+        out << "\n";
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("DeviceConfigCompiler");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Validate device JSON configs and compile them into binary runtime images.");
+    parser.addHelpOption();
+    QCommandLineOption checkOption("check", "Only validate, do not write images.");
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Write images to this directory instead of next to the sources.", "dir");
+    QCommandLineOption dumpOption("dump", "Print the compiled read plan.");
+    parser.addOptions({checkOption, outputOption, dumpOption});
+    parser.addPositionalArgument("configs", "Config files or directories.", "<file|dir>...");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QStringList files = collectFiles(parser.positionalArguments());
+    if (files.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    int failed = 0;
+    for (const QString& path : files) {
+        // 上一个文件的输出先写出，stdout 和 stderr 交错时保持按文件的顺序
+        out.flush();
+        err.flush();
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << path << ": cannot open" << "\n";
+            ++failed;
+            continue;
+        }
+        const QByteArray source = file.readAll();
+        QJsonParseError parseError;
+        const QJsonDocument doc = QJsonDocument::fromJson(source, &parseError);
+        if (parseError.error != QJsonParseError::NoError) {
+            err << path << ": " << parseError.errorString() << " at offset " << parseError.offset << "\n";
+            ++failed;
+            continue;
+        }
+
+        QStringList errors;
+        const QByteArray image = ConfigImage::compile(doc.object(), source, &errors);
+        if (image.isEmpty()) {
+            for (const QString& error : errors) {
+                err << path << ": " << error << "\n";
+            }
+            ++failed;
+            continue;
+        }
+
+        out << path << ": ok, " << image.size() << " bytes" << "\n";
+        if (parser.isSet(dumpOption)) {
+            dump(*ConfigImage::fromData(image), out);
+        }
+        if (parser.isSet(checkOption)) {
+            continue;
+        }
+
+        QString imagePath = ConfigImage::imagePath(path);
+        if (parser.isSet(outputOption)) {
+            imagePath = QDir(parser.value(outputOption)).filePath(QFileInfo(imagePath).fileName());
+        }
+        QSaveFile imageFile(imagePath);
+        if (!imageFile.open(QIODevice::WriteOnly) || imageFile.write(image) != image.size() || !imageFile.commit()) {
+            err << imagePath << ": " << imageFile.errorString() << "\n";
+            ++failed;
+        }
+    }
+    out.flush();
+    err.flush();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,376 @@
+/**
+ * @file HeadlessSimulator.cpp
+ * @brief HeadlessSimulator类的实现
+ */
+#include "HeadlessSimulator.h"
+#include "src/core/modbusdata.h"
+#include "src/core/ConfigImage.h"
+#include "SimulatorCommon/FaultProxy.h"
+#include <QModbusTcpServer>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTextStream>
+#include <QTimer>
+#include <QVariant>
+#include <cmath>
+
+namespace {
+
+const int kDefaultStatsIntervalMs = 5000;
+const int kDefaultInternalPortOffset = 10000;
+
+// 参数能表示的最大值，按位长度计算
+double tagMaxValue(int length)
+{
+    if (length <= 0) {
+        return 0;
+    }
+    return length >= 53 ? 9007199254740991.0 : double((quint64(1) << length) - 1);
+}
+
+}
+
+HeadlessSimulator::HeadlessSimulator(QObject *parent)
+    : QObject(parent)
+    , m_tickTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+    , m_random(QRandomGenerator::securelySeeded())
+    , m_generating(false)
+    , m_generatedWrites(0)
+    , m_masterWrites(0)
+    , m_slaveCount(0)
+{
+    m_tickTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_tickTimer, &QTimer::timeout, this, &HeadlessSimulator::onTick);
+    connect(m_statsTimer, &QTimer::timeout, this, &HeadlessSimulator::printStats);
+}
+
+HeadlessSimulator::~HeadlessSimulator()
+{
+    for (Group& group : m_groups) {
+        for (QModbusTcpServer* server : group.servers) {
+            server->disconnectDevice();
+        }
+    }
+}
+
+bool HeadlessSimulator::start(const QJsonObject& scenario, const QString& configDir, QString& error)
+{
+    const QJsonArray slaves = scenario["slaves"].toArray();
+    if (slaves.isEmpty()) {
+        error = "scenario has no slaves";
+        return false;
+    }
+    for (const QJsonValue& spec : slaves) {
+        if (!addGroup(spec.toObject(), configDir, error)) {
+            return false;
+        }
+    }
+
+    // 节拍取最短的生成器周期，所有从站共用
+    int tickMs = 0;
+    for (const Group& group : m_groups) {
+        for (const Generator& gen : group.generators) {
+            tickMs = tickMs ? qMin(tickMs, gen.periodMs) : gen.periodMs;
+        }
+    }
+    m_clock.start();
+    if (tickMs > 0) {
+        m_tickTimer->start(tickMs);
+    }
+    m_statsTimer->start(scenario["statsIntervalMs"].toInt(kDefaultStatsIntervalMs));
+
+    QTextStream(stdout) << QString("%1 slaves running, generator tick %2 ms").arg(m_slaveCount).arg(tickMs) << "\n";
+    return true;
+}
+
+bool HeadlessSimulator::addGroup(const QJsonObject& spec, const QString& configDir, QString& error)
+{
+    const QString configPath = QDir(configDir).filePath(spec["config"].toString());
+    QFile file(configPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = QString("cannot open %1").arg(configPath);
+        return false;
+    }
+    const QJsonObject config = QJsonDocument::fromJson(file.readAll()).object();
+
+    Group group;
+    if (!parseTags(config, group.tags, group.map, error)) {
+        error = QString("%1: %2").arg(configPath).arg(error);
+        return false;
+    }
+    if (group.tags.isEmpty()) {
+        error = QString("%1 has no Modbus registers").arg(configPath);
+        return false;
+    }
+    if (!parseGenerators(spec["generators"].toArray(), group, error)) {
+        error = QString("%1: %2").arg(configPath).arg(error);
+        return false;
+    }
+
+    const int count = qMax(1, spec["count"].toInt(1));
+    const int basePort = spec["basePort"].toInt(config["tcp_params"].toObject()["port"].toInt(502));
+    const QString bindAddress = spec["bindAddress"].toString("0.0.0.0");
+    const int unitId = spec["unitId"].toInt(config["server_address"].toInt(1));
+    const bool withFaults = spec.contains("faults");
+    const FaultConfig faults = FaultConfig::fromJson(spec["faults"].toObject());
+    const int internalOffset = spec["internalPortOffset"].toInt(kDefaultInternalPortOffset);
+
+    group.state.resize(count * group.generators.size());
+    for (int s = 0; s < count; ++s) {
+        const int port = basePort + s;
+        const int serverPort = withFaults ? port + internalOffset : port;
+        const QString serverAddress = withFaults ? QString("127.0.0.1") : bindAddress;
+        auto server = new QModbusTcpServer(this);
+        server->setConnectionParameter(QModbusDevice::NetworkAddressParameter, serverAddress);
+        server->setConnectionParameter(QModbusDevice::NetworkPortParameter, serverPort);
+        server->setServerAddress(unitId);
+        server->setMap(group.map);
+        connect(server, &QModbusServer::dataWritten, this, [this]() {
+            if (!m_generating) {
+                ++m_masterWrites;
+            }
+        });
+        if (!server->connectDevice()) {
+            error = QString("%1:%2: %3").arg(serverAddress).arg(serverPort).arg(server->errorString());
+            delete server;
+            return false;
+        }
+        group.servers.append(server);
+
+        if (withFaults) {
+            auto proxy = new FaultProxy(faults, s, this);
+            proxy->setTarget("127.0.0.1", static_cast<quint16>(serverPort));
+            if (!proxy->listen(QHostAddress(bindAddress), static_cast<quint16>(port))) {
+                error = QString("%1:%2: %3").arg(bindAddress).arg(port).arg(proxy->errorString());
+                delete proxy;
+                return false;
+            }
+            group.proxies.append(proxy);
+        }
+
+        // 各从站的初始相位错开，避免所有从站的数值同步变化
+        m_generating = true;
+        for (int g = 0; g < group.generators.size(); ++g) {
+            const Generator& gen = group.generators.at(g);
+            double& value = group.state[s * group.generators.size() + g];
+            switch (gen.type) {
+            case Ramp: {
+                const double span = gen.max - gen.min + gen.step;
+                value = gen.min + std::fmod(s * gen.step, span > 0 ? span : 1);
+                break;
+            }
+            case RandomWalk:
+                value = gen.min + m_random.generateDouble() * (gen.max - gen.min);
+                break;
+            case Toggle:
+                value = s % 2;
+                break;
+            case Sequence:
+                value = s % gen.values.size();
+                break;
+            case Constant:
+                value = gen.min;
+                break;
+            }
+            const double out = (gen.type == Sequence) ? gen.values.at(int(value)) : value;
+            writeTag(server, group.tags.at(gen.tag), static_cast<quint64>(qMax(0.0, out)));
+        }
+        m_generating = false;
+    }
+
+    m_slaveCount += count;
+    m_groups.append(group);
+    return true;
+}
+
+bool HeadlessSimulator::parseTags(const QJsonObject& config, QVector<Tag>& tags, QModbusDataUnitMap& map, QString& error)
+{
+    // 与主程序使用同一个配置编译器，仿真器和设备对配置的理解保持一致
+    QStringList errors;
+    const QSharedPointer<const ConfigImage> image = ConfigImage::fromConfig(config, &errors);
+    if (!image) {
+        error = errors.join("; ");
+        return false;
+    }
+    QMap<QModbusDataUnit::RegisterType, QPair<int, int>> ranges;
+    for (int i = 0; i < image->paramCount(); ++i) {
+        const ConfigImage::Param& param = image->param(i);
+        Tag tag;
+        tag.type = static_cast<QModbusDataUnit::RegisterType>(param.regType);
+        if (tag.type == QModbusDataUnit::Invalid) {
+            continue;
+        }
+        tag.key = image->string(param.key);
+        tag.address = param.address;
+        tag.length = param.length;
+        tag.bitpos = param.bitpos;
+        tag.regCount = (tag.length == 64) ? 4 : (tag.length == 32) ? 2 : 1;
+        tag.writable = param.flags & ConfigImage::Writable;
+        tags.append(tag);
+
+        const int last = tag.address + tag.regCount - 1;
+        if (!ranges.contains(tag.type)) {
+            ranges[tag.type] = qMakePair(int(tag.address), last);
+        } else {
+            ranges[tag.type].first = qMin(ranges[tag.type].first, int(tag.address));
+            ranges[tag.type].second = qMax(ranges[tag.type].second, last);
+        }
+    }
+
+    for (auto it = ranges.constBegin(); it != ranges.constEnd(); ++it) {
+        const quint16 count = static_cast<quint16>(it.value().second - it.value().first + 1);
+        map.insert(it.key(), QModbusDataUnit(it.key(), it.value().first, count));
+    }
+    return true;
+}
+
+bool HeadlessSimulator::parseGenerators(const QJsonArray& specs, Group& group, QString& error)
+{
+    for (const QJsonValue& val : specs) {
+        const QJsonObject spec = val.toObject();
+        const QString typeStr = spec["type"].toString();
+        Generator gen;
+        if (typeStr == "ramp") gen.type = Ramp;
+        else if (typeStr == "random_walk") gen.type = RandomWalk;
+        else if (typeStr == "toggle") gen.type = Toggle;
+        else if (typeStr == "sequence") gen.type = Sequence;
+        else if (typeStr == "constant") gen.type = Constant;
+        else {
+            error = QString("unknown generator type '%1'").arg(typeStr);
+            return false;
+        }
+        gen.periodMs = qMax(1, spec["periodMs"].toInt(1000));
+        gen.nextDueMs = gen.periodMs;
+        gen.step = spec["step"].toDouble(1);
+        for (const QJsonValue& v : spec["values"].toArray()) {
+            gen.values.append(v.toDouble());
+        }
+        if (gen.type == Sequence && gen.values.isEmpty()) {
+            error = "sequence generator needs 'values'";
+            return false;
+        }
+
+        // "*" 展开为全部只读参数，各自独立的生成器
+        const QString key = spec["key"].toString();
+        bool matched = false;
+        for (int t = 0; t < group.tags.size(); ++t) {
+            const Tag& tag = group.tags.at(t);
+            if ((key == "*" && tag.writable) || (key != "*" && tag.key != key)) {
+                continue;
+            }
+            const double tagMax = (tag.type == QModbusDataUnit::Coils || tag.type == QModbusDataUnit::DiscreteInputs)
+                                      ? 1.0 : tagMaxValue(tag.length);
+            gen.tag = t;
+            gen.min = qBound(0.0, spec["min"].toDouble(spec["value"].toDouble(0)), tagMax);
+            gen.max = qBound(gen.min, spec["max"].toDouble(tagMax), tagMax);
+            group.generators.append(gen);
+            matched = true;
+        }
+        if (!matched) {
+            error = QString("generator key '%1' matches no register").arg(key);
+            return false;
+        }
+    }
+    return true;
+}
+
+double HeadlessSimulator::nextValue(Generator& gen, double current)
+{
+    switch (gen.type) {
+    case Ramp:
+        return (current + gen.step > gen.max) ? gen.min : current + gen.step;
+    case RandomWalk:
+        return qBound(gen.min, current + (m_random.generateDouble() * 2 - 1) * gen.step, gen.max);
+    case Toggle:
+        return current > 0 ? 0 : 1;
+    case Sequence:
+        return (int(current) + 1) % gen.values.size();
+    case Constant:
+        return current;
+    }
+    return current;
+}
+
+void HeadlessSimulator::writeTag(QModbusTcpServer* server, const Tag& tag, quint64 value)
+{
+    if (tag.type == QModbusDataUnit::Coils || tag.type == QModbusDataUnit::DiscreteInputs) {
+        server->setData(tag.type, tag.address, value ? 1 : 0);
+        return;
+    }
+
+    if (tag.regCount == 1) {
+        // 同一寄存器中可能打包了多个位参数，只改写本参数所在的位
+        quint16 current = 0;
+        server->data(tag.type, tag.address, &current);
+        quint16 packed = current;
+        setParamValue16(current, tag.bitpos, tag.length, static_cast<quint16>(value), packed);
+        server->setData(tag.type, tag.address, packed);
+        return;
+    }
+
+    // 多寄存器参数高位在前，与设备端的拼接顺序一致
+    for (int i = 0; i < tag.regCount; ++i) {
+        const int shift = 16 * (tag.regCount - 1 - i);
+        server->setData(tag.type, static_cast<quint16>(tag.address + i), static_cast<quint16>(value >> shift));
+    }
+}
+
+void HeadlessSimulator::onTick()
+{
+    const qint64 now = m_clock.elapsed();
+    m_generating = true;
+    for (Group& group : m_groups) {
+        const int genCount = group.generators.size();
+        for (int g = 0; g < genCount; ++g) {
+            Generator& gen = group.generators[g];
+            if (now < gen.nextDueMs) {
+                continue;
+            }
+            // 处理不过来时跳过错过的周期，不补发
+            gen.nextDueMs += gen.periodMs;
+            if (gen.nextDueMs <= now) {
+                gen.nextDueMs = now + gen.periodMs;
+            }
+
+            const Tag& tag = group.tags.at(gen.tag);
+            for (int s = 0; s < group.servers.size(); ++s) {
+                double& value = group.state[s * genCount + g];
+                value = nextValue(gen, value);
+                const double out = (gen.type == Sequence) ? gen.values.at(int(value)) : value;
+                writeTag(group.servers.at(s), tag, static_cast<quint64>(qMax(0.0, out)));
+                ++m_generatedWrites;
+            }
+        }
+    }
+    m_generating = false;
+}
+
+void HeadlessSimulator::printStats()
+{
+    const double seconds = m_statsTimer->interval() / 1000.0;
+    QString line = QString("[%1 s] slaves %2, generated %3 tag updates/s, master writes %4/s")
+                       .arg(m_clock.elapsed() / 1000)
+                       .arg(m_slaveCount)
+                       .arg(m_generatedWrites / seconds, 0, 'f', 0)
+                       .arg(m_masterWrites / seconds, 0, 'f', 1);
+    quint64 dropped = 0;
+    quint64 exceptions = 0;
+    bool withFaults = false;
+    for (const Group& group : m_groups) {
+        for (const FaultProxy* proxy : group.proxies) {
+            dropped += proxy->droppedFrames();
+            exceptions += proxy->injectedExceptions();
+            withFaults = true;
+        }
+    }
+    if (withFaults) {
+        // 故障计数为启动以来的累计值
+        line += QString(", injected drops %1, exceptions %2").arg(dropped).arg(exceptions);
+    }
+    QTextStream(stdout) << line << "\n";
+    m_generatedWrites = 0;
+    m_masterWrites = 0;
+}
@@ -0,0 +1,117 @@
+#ifndef HEADLESSSIMULATOR_H
+#define HEADLESSSIMULATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
+#include <QModbusDataUnit>
+#include <QRandomGenerator>
+#include <QVector>
+
+class QModbusTcpServer;
+class QTimer;
+class FaultProxy;
+
+/**
+ * @brief 无界面多从站Modbus TCP仿真器
+ *
+ * 按场景文件(或命令行参数)从设备配置创建成百上千个从站，每个从站监听一个端口，
+ * 寄存器值由生成器按配置的周期变化。所有从站和生成器共用一个节拍定时器，
+ * 不更新任何界面，适合在一台Linux机器上对主站做压力测试。
+ *
+ * 场景文件格式:
+ * {
+ *   "statsIntervalMs": 5000,
+ *   "slaves": [
+ *     { "config": "jgq_device.json", "count": 200, "basePort": 20000, "bindAddress": "0.0.0.0",
+ *       "unitId": 127,
+ *       "generators": [
+ *         { "key": "JGQ_PumpTemp_Status", "type": "ramp", "min": 200, "max": 400, "step": 1, "periodMs": 100 },
+ *         { "key": "JGQ_GZ1Alarm0_Status", "type": "toggle", "periodMs": 5000 },
+ *         { "key": "*", "type": "random_walk", "step": 3, "periodMs": 200 },
+ *         { "key": "JGQ_Laser_Status", "type": "sequence", "values": [0, 1, 1, 0], "periodMs": 1000 }
+ *       ],
+ *       "faults": { "downstream": { "delay": { "dist": "normal", "meanMs": 20, "stddevMs": 5 }, "splitRate": 0.05 },
+ *                   "rules": [ { "slaves": [0, 9], "start": 32772, "end": 32778, "exceptionCode": 2, "exceptionRate": 0.01 } ] },
+ *       "internalPortOffset": 10000 }
+ *   ]
+ * }
+ * key 为 "*" 时作用于配置中全部只读参数；各从站的生成器状态相互独立(起始相位和随机序列不同)。
+ * 配置了 faults(格式见 FaultProxy.h)时，从站改为监听 127.0.0.1 上的 端口+internalPortOffset，
+ * 对外端口由故障注入代理监听，规则中的 slaves 为组内从站序号。
+ */
+class HeadlessSimulator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessSimulator(QObject *parent = nullptr);
+    ~HeadlessSimulator();
+
+    /**
+     * @brief 按场景创建并启动全部从站
+     * @param scenario 场景对象，格式见类说明
+     * @param configDir 场景中相对路径的设备配置所在目录
+     * @param error 失败原因
+     * @return 全部从站启动成功返回true
+     */
+    bool start(const QJsonObject& scenario, const QString& configDir, QString& error);
+
+private slots:
+    void onTick();
+    void printStats();
+
+private:
+    // 配置中的一个参数在寄存器表中的位置
+    struct Tag {
+        QString key;
+        QModbusDataUnit::RegisterType type;
+        quint16 address;
+        int regCount;
+        quint16 bitpos;
+        quint16 length;
+        bool writable;          // 主站可写的参数不由生成器改写
+    };
+
+    enum GeneratorType { Ramp, RandomWalk, Toggle, Sequence, Constant };
+
+    struct Generator {
+        GeneratorType type;
+        int tag;                // Tag 下标
+        double min;
+        double max;
+        double step;
+        QVector<double> values; // Sequence 使用
+        int periodMs;
+        qint64 nextDueMs;
+    };
+
+    // 一组使用同一配置文件的从站
+    struct Group {
+        QVector<Tag> tags;
+        QVector<Generator> generators;
+        QModbusDataUnitMap map;
+        QVector<QModbusTcpServer*> servers;
+        QVector<FaultProxy*> proxies;   // 未配置故障注入时为空
+        QVector<double> state;  // [从站][生成器] 当前值
+    };
+
+    bool addGroup(const QJsonObject& spec, const QString& configDir, QString& error);
+    static bool parseTags(const QJsonObject& config, QVector<Tag>& tags, QModbusDataUnitMap& map, QString& error);
+    bool parseGenerators(const QJsonArray& specs, Group& group, QString& error);
+    double nextValue(Generator& gen, double current);
+    void writeTag(QModbusTcpServer* server, const Tag& tag, quint64 value);
+
+    QVector<Group> m_groups;
+    QTimer* m_tickTimer;
+    QTimer* m_statsTimer;
+    QElapsedTimer m_clock;
+    QRandomGenerator m_random;
+    bool m_generating;          // 生成器写入期间为true，区分主站写入
+    quint64 m_generatedWrites;
+    quint64 m_masterWrites;
+    int m_slaveCount;
+};
+
+#endif // HEADLESSSIMULATOR_H
@@ -1,4 +1,4 @@
-QT       += core gui widgets serialbus serialport
+QT       += core gui widgets serialbus serialport network
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -7,10 +7,16 @@ TEMPLATE = app
 DESTDIR = $$PWD/../SimulatorExe
 
 SOURCES += main.cpp\
-        mainwindow.cpp
+        mainwindow.cpp \
+        HeadlessSimulator.cpp \
+        ../SimulatorCommon/FaultProxy.cpp \
+        ../src/core/ConfigImage.cpp
 
 HEADERS  += mainwindow.h \
-    src/core/modbusdata.h
+    HeadlessSimulator.h \
+    ../SimulatorCommon/FaultProxy.h \
+    src/core/modbusdata.h \
+    ../src/core/ConfigImage.h
 
 # PWD is the directory of the .pro file, so we go up one level to the project root
 INCLUDEPATH += $$PWD/../
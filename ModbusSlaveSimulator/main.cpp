@@ -1,11 +1,99 @@
 #include "mainwindow.h"
+#include "HeadlessSimulator.h"
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+/**
+ * @brief 无界面模式: 按场景文件或命令行参数启动多个从站
+ *
+ *   ModbusSlaveSimulator --headless --scenario load.json
+ *   ModbusSlaveSimulator --headless --config jgq_device.json --count 300 --base-port 20000 --period 100
+ *   ModbusSlaveSimulator --headless --config jgq_device.json --faults faults.json
+ *
+ * 从站数量较多时注意提高进程的文件描述符上限(ulimit -n)。
+ */
+static int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless multi-slave Modbus TCP simulator.");
+    parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", "Run without GUI.");
+    QCommandLineOption scenarioOption("scenario", "Scenario JSON file (see HeadlessSimulator.h).", "file");
+    QCommandLineOption configDirOption("config-dir", "Directory for device configs referenced by the scenario.", "dir",
+                                       QCoreApplication::applicationDirPath() + "/../config");
+    QCommandLineOption configOption("config", "Device config for a quick run without a scenario file.", "file");
+    QCommandLineOption countOption("count", "Number of slaves for a quick run.", "n", "1");
+    QCommandLineOption basePortOption("base-port", "First port for a quick run (default: port from config).", "port");
+    QCommandLineOption periodOption("period", "Random-walk period (ms) for all read-only tags in a quick run.", "ms", "1000");
+    QCommandLineOption faultsOption("faults", "Fault injection JSON (see FaultProxy.h) for a quick run.", "file");
+    parser.addOptions({headlessOption, scenarioOption, configDirOption, configOption, countOption, basePortOption, periodOption,
+                       faultsOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QJsonObject scenario;
+    if (parser.isSet(scenarioOption)) {
+        QFile file(parser.value(scenarioOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "cannot open " << file.fileName() << "\n";
+            return 1;
+        }
+        scenario = QJsonDocument::fromJson(file.readAll()).object();
+    } else if (parser.isSet(configOption)) {
+        // 快速模式: 单个配置，全部只读参数做随机游走
+        QJsonObject generator;
+        generator["key"] = "*";
+        generator["type"] = "random_walk";
+        generator["step"] = 5;
+        generator["periodMs"] = parser.value(periodOption).toInt();
+        QJsonObject group;
+        group["config"] = parser.value(configOption);
+        group["count"] = parser.value(countOption).toInt();
+        if (parser.isSet(basePortOption)) {
+            group["basePort"] = parser.value(basePortOption).toInt();
+        }
+        group["generators"] = QJsonArray{generator};
+        if (parser.isSet(faultsOption)) {
+            QFile faultsFile(parser.value(faultsOption));
+            if (!faultsFile.open(QIODevice::ReadOnly)) {
+                err << "cannot open " << faultsFile.fileName() << "\n";
+                return 1;
+            }
+            group["faults"] = QJsonDocument::fromJson(faultsFile.readAll()).object();
+        }
+        scenario["slaves"] = QJsonArray{group};
+    } else {
+        err << "--headless needs --scenario or --config" << "\n";
+        return 1;
+    }
+
+    HeadlessSimulator simulator;
+    QString error;
+    if (!simulator.start(scenario, parser.value(configDirOption), error)) {
+        err << error << "\n";
+        return 1;
+    }
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
 
     return a.exec();
-}
\ No newline at end of file
+}
@@ -0,0 +1,428 @@
+/**
+ * @file FaultProxy.cpp
+ * @brief 故障注入代理的实现
+ */
+#include "FaultProxy.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <cmath>
+
+namespace {
+
+const int kMbapHeaderSize = 7;      // 事务号2 + 协议号2 + 长度2 + 单元号1
+const int kMaxAduSize = 260;
+const double kPi = 3.14159265358979323846;
+
+double clamp01(double v)
+{
+    return qBound(0.0, v, 1.0);
+}
+
+/**
+ * @brief 从缓冲区取出一个完整的Modbus TCP帧，数据不足时返回空
+ *
+ * 长度字段明显非法时丢弃缓冲区，避免代理卡死在错误数据上。
+ */
+QByteArray takeAdu(QByteArray& buffer)
+{
+    if (buffer.size() < kMbapHeaderSize) {
+        return QByteArray();
+    }
+    const int length = (static_cast<quint8>(buffer.at(4)) << 8) | static_cast<quint8>(buffer.at(5));
+    const int total = 6 + length;
+    if (length < 2 || total > kMaxAduSize) {
+        qWarning() << "FaultProxy: invalid MBAP length" << length << ", discarding" << buffer.size() << "bytes";
+        buffer.clear();
+        return QByteArray();
+    }
+    if (buffer.size() < total) {
+        return QByteArray();
+    }
+    QByteArray adu = buffer.left(total);
+    buffer.remove(0, total);
+    return adu;
+}
+
+quint16 transactionId(const QByteArray& adu)
+{
+    return static_cast<quint16>((static_cast<quint8>(adu.at(0)) << 8) | static_cast<quint8>(adu.at(1)));
+}
+
+}
+
+DelayModel DelayModel::fromJson(const QJsonObject& obj)
+{
+    DelayModel model;
+    const QString dist = obj["dist"].toString();
+    if (dist == "fixed") {
+        model.dist = Fixed;
+        model.a = obj["ms"].toDouble();
+    } else if (dist == "uniform") {
+        model.dist = Uniform;
+        model.a = obj["minMs"].toDouble();
+        model.b = qMax(model.a, obj["maxMs"].toDouble());
+    } else if (dist == "normal") {
+        model.dist = Normal;
+        model.a = obj["meanMs"].toDouble();
+        model.b = obj["stddevMs"].toDouble();
+    } else if (dist == "exponential") {
+        model.dist = Exponential;
+        model.a = obj["meanMs"].toDouble();
+    } else if (!dist.isEmpty()) {
+        qWarning() << "FaultProxy: unknown delay distribution" << dist;
+    }
+    return model;
+}
+
+int DelayModel::sample(QRandomGenerator& random) const
+{
+    double ms = 0;
+    switch (dist) {
+    case None:
+        return 0;
+    case Fixed:
+        ms = a;
+        break;
+    case Uniform:
+        ms = a + random.generateDouble() * (b - a);
+        break;
+    case Normal: {
+        // Box-Muller
+        const double u1 = qMax(random.generateDouble(), 1e-12);
+        const double u2 = random.generateDouble();
+        ms = a + b * std::sqrt(-2.0 * std::log(u1)) * std::cos(2.0 * kPi * u2);
+        break;
+    }
+    case Exponential:
+        ms = -a * std::log(qMax(1.0 - random.generateDouble(), 1e-12));
+        break;
+    }
+    return qMax(0, qRound(ms));
+}
+
+StreamFaults StreamFaults::fromJson(const QJsonObject& obj)
+{
+    StreamFaults faults;
+    faults.delay = DelayModel::fromJson(obj["delay"].toObject());
+    faults.dropRate = clamp01(obj["dropRate"].toDouble());
+    faults.splitRate = clamp01(obj["splitRate"].toDouble());
+    faults.maxFragment = qMax(1, obj["maxFragment"].toInt(faults.maxFragment));
+    faults.splitGapMs = qMax(1, obj["splitGapMs"].toInt(faults.splitGapMs));
+    faults.mergeRate = clamp01(obj["mergeRate"].toDouble());
+    faults.mergeWindowMs = qMax(0, obj["mergeWindowMs"].toInt(faults.mergeWindowMs));
+    faults.bandwidthBps = qMax<qint64>(0, static_cast<qint64>(obj["bandwidthBps"].toDouble()));
+    return faults;
+}
+
+FaultRule FaultRule::fromJson(const QJsonObject& obj)
+{
+    FaultRule rule;
+    const QJsonArray slaves = obj["slaves"].toArray();
+    if (slaves.size() == 2) {
+        rule.slaveFirst = slaves.at(0).toInt();
+        rule.slaveLast = slaves.at(1).toInt();
+    } else if (obj.contains("slave")) {
+        rule.slaveFirst = rule.slaveLast = obj["slave"].toInt();
+    }
+    rule.unitId = obj["unitId"].toInt(-1);
+    rule.function = obj["function"].toInt(-1);
+    rule.start = obj["start"].toInt(0);
+    rule.end = obj["end"].toInt(65535);
+    rule.hasDelay = obj.contains("delay");
+    rule.delay = DelayModel::fromJson(obj["delay"].toObject());
+    rule.dropRate = obj.contains("dropRate") ? clamp01(obj["dropRate"].toDouble()) : -1;
+    rule.exceptionCode = obj["exceptionCode"].toInt(0);
+    rule.exceptionRate = obj.contains("exceptionRate") ? clamp01(obj["exceptionRate"].toDouble())
+                                                       : (rule.exceptionCode ? 1.0 : 0.0);
+    return rule;
+}
+
+bool FaultRule::matches(int slave, int unit, int fc, int address) const
+{
+    if (slaveFirst >= 0 && (slave < slaveFirst || slave > slaveLast)) {
+        return false;
+    }
+    if (unitId >= 0 && unit != unitId) {
+        return false;
+    }
+    if (function >= 0 && fc != function) {
+        return false;
+    }
+    // 没有起始地址的请求(地址为-1)只按单元号和功能码匹配
+    return address < 0 || (address >= start && address <= end);
+}
+
+FaultConfig FaultConfig::fromJson(const QJsonObject& obj)
+{
+    FaultConfig config;
+    config.modbus = obj["mode"].toString("modbus") != "raw";
+    config.downstream = StreamFaults::fromJson(obj["downstream"].toObject());
+    config.upstream = StreamFaults::fromJson(obj["upstream"].toObject());
+    for (const QJsonValue& val : obj["rules"].toArray()) {
+        config.rules.append(FaultRule::fromJson(val.toObject()));
+    }
+    return config;
+}
+
+ShapedPipe::ShapedPipe(QTcpSocket* socket, const StreamFaults& faults, QRandomGenerator& random, QObject *parent)
+    : QObject(parent)
+    , m_socket(socket)
+    , m_faults(faults)
+    , m_random(random)
+    , m_timer(new QTimer(this))
+    , m_lastReleaseMs(0)
+    , m_splitting(false)
+    , m_tokens(0)
+    , m_lastRefillMs(0)
+{
+    m_timer->setSingleShot(true);
+    m_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_timer, &QTimer::timeout, this, &ShapedPipe::pump);
+    m_clock.start();
+    // 允许突发一个完整帧，之后按带宽补充
+    m_tokens = kMaxAduSize;
+}
+
+void ShapedPipe::enqueue(const QByteArray& frame, int delayMs)
+{
+    const qint64 now = m_clock.elapsed();
+    qint64 releaseAt = now + (delayMs >= 0 ? delayMs : m_faults.delay.sample(m_random));
+    if (m_faults.mergeRate > 0 && m_random.generateDouble() < m_faults.mergeRate) {
+        releaseAt += m_faults.mergeWindowMs;
+    }
+    // 保持顺序：不早于前一帧
+    releaseAt = qMax(releaseAt, m_lastReleaseMs);
+    m_lastReleaseMs = releaseAt;
+    m_queue.append({frame, releaseAt});
+    if (!m_timer->isActive()) {
+        pump();
+    }
+}
+
+void ShapedPipe::pump()
+{
+    const qint64 now = m_clock.elapsed();
+    if (m_faults.bandwidthBps > 0) {
+        m_tokens = qMin<double>(m_tokens + (now - m_lastRefillMs) * m_faults.bandwidthBps / 1000.0,
+                                qMax<qint64>(kMaxAduSize, m_faults.bandwidthBps));
+    }
+    m_lastRefillMs = now;
+
+    // 到期的帧一起放入待发送缓冲区；被扣留的帧和它后面已到期的帧因此合并成一次写入
+    if (m_pending.isEmpty()) {
+        while (!m_queue.isEmpty() && m_queue.first().releaseAtMs <= now) {
+            m_pending.append(m_queue.takeFirst().data);
+        }
+        m_splitting = !m_pending.isEmpty() && m_faults.splitRate > 0
+                      && m_random.generateDouble() < m_faults.splitRate;
+    }
+
+    if (!m_pending.isEmpty()) {
+        qint64 allowed = m_pending.size();
+        if (m_faults.bandwidthBps > 0) {
+            allowed = qMin<qint64>(allowed, static_cast<qint64>(m_tokens));
+        }
+        if (m_splitting) {
+            allowed = qMin<qint64>(allowed, 1 + m_random.bounded(m_faults.maxFragment));
+        }
+        if (allowed > 0) {
+            m_socket->write(m_pending.constData(), allowed);
+            m_pending.remove(0, static_cast<int>(allowed));
+            m_tokens -= allowed;
+        }
+    }
+
+    // 安排下一次发送
+    int waitMs = -1;
+    if (!m_pending.isEmpty()) {
+        waitMs = 1;
+        if (m_splitting) {
+            waitMs = m_faults.splitGapMs;
+        }
+        if (m_faults.bandwidthBps > 0 && m_tokens < 1) {
+            waitMs = qMax(waitMs, static_cast<int>(std::ceil((1 - m_tokens) * 1000.0 / m_faults.bandwidthBps)));
+        }
+    } else if (!m_queue.isEmpty()) {
+        waitMs = static_cast<int>(qMax<qint64>(0, m_queue.first().releaseAtMs - now));
+    }
+    if (waitMs >= 0) {
+        m_timer->start(waitMs);
+    }
+}
+
+struct FaultProxy::Session
+{
+    QTcpSocket* client = nullptr;
+    QTcpSocket* server = nullptr;
+    ShapedPipe* toClient = nullptr;
+    ShapedPipe* toServer = nullptr;
+    QByteArray clientBuffer;
+    QByteArray serverBuffer;
+    QHash<quint16, int> replyDelay;     // 事务号 -> 规则指定的应答延迟
+    QSet<quint16> dropReply;            // 已转发但应答需要丢弃的事务号
+};
+
+FaultProxy::FaultProxy(const FaultConfig& config, int slaveIndex, QObject *parent)
+    : QObject(parent)
+    , m_config(config)
+    , m_slaveIndex(slaveIndex)
+    , m_server(new QTcpServer(this))
+    , m_targetHost("127.0.0.1")
+    , m_targetPort(0)
+    , m_random(QRandomGenerator::global()->generate())
+    , m_dropped(0)
+    , m_exceptions(0)
+{
+    connect(m_server, &QTcpServer::newConnection, this, &FaultProxy::onNewConnection);
+}
+
+bool FaultProxy::listen(const QHostAddress& address, quint16 port)
+{
+    return m_server->listen(address, port);
+}
+
+void FaultProxy::setTarget(const QString& host, quint16 port)
+{
+    m_targetHost = host;
+    m_targetPort = port;
+}
+
+QString FaultProxy::errorString() const
+{
+    return m_server->errorString();
+}
+
+void FaultProxy::onNewConnection()
+{
+    while (QTcpSocket* client = m_server->nextPendingConnection()) {
+        auto session = new Session;
+        session->client = client;
+        session->server = new QTcpSocket(this);
+        client->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        session->server->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        session->toClient = new ShapedPipe(client, m_config.downstream, m_random, client);
+        session->toServer = new ShapedPipe(session->server, m_config.upstream, m_random, session->server);
+        m_sessions.append(session);
+
+        connect(client, &QTcpSocket::readyRead, this, [this, session]() { onClientData(session); });
+        connect(session->server, &QTcpSocket::readyRead, this, [this, session]() { onServerData(session); });
+        connect(client, &QTcpSocket::disconnected, this, [this, session]() { closeSession(session); });
+        connect(session->server, &QTcpSocket::disconnected, this, [this, session]() { closeSession(session); });
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+        connect(session->server, &QAbstractSocket::errorOccurred, this,
+#else
+        connect(session->server, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this,
+#endif
+                [this, session](QAbstractSocket::SocketError) {
+            qWarning() << "FaultProxy: target" << m_targetHost << m_targetPort << session->server->errorString();
+            closeSession(session);
+        });
+        // 连接建立前写入的数据由套接字缓存
+        session->server->connectToHost(m_targetHost, m_targetPort);
+    }
+}
+
+void FaultProxy::onClientData(Session* session)
+{
+    const QByteArray data = session->client->readAll();
+    if (!m_config.modbus) {
+        if (m_config.upstream.dropRate > 0 && m_random.generateDouble() < m_config.upstream.dropRate) {
+            ++m_dropped;
+            return;
+        }
+        session->toServer->enqueue(data);
+        return;
+    }
+
+    session->clientBuffer.append(data);
+    for (QByteArray adu = takeAdu(session->clientBuffer); !adu.isEmpty(); adu = takeAdu(session->clientBuffer)) {
+        const quint16 txn = transactionId(adu);
+        const int unit = static_cast<quint8>(adu.at(6));
+        const int fc = adu.size() > kMbapHeaderSize ? static_cast<quint8>(adu.at(7)) : -1;
+        const int address = adu.size() >= kMbapHeaderSize + 3
+                ? (static_cast<quint8>(adu.at(8)) << 8) | static_cast<quint8>(adu.at(9)) : -1;
+        const FaultRule* rule = findRule(unit, fc, address);
+
+        if (rule && rule->exceptionCode && m_random.generateDouble() < rule->exceptionRate) {
+            // 直接以异常应答回复，不转发给从站
+            QByteArray reply = adu.left(4);
+            reply.append(char(0)).append(char(3)).append(char(unit));
+            reply.append(char((fc & 0x7F) | 0x80)).append(char(rule->exceptionCode));
+            ++m_exceptions;
+            session->toClient->enqueue(reply, rule->hasDelay ? rule->delay.sample(m_random) : -1);
+            continue;
+        }
+
+        const double dropRate = (rule && rule->dropRate >= 0) ? rule->dropRate : m_config.downstream.dropRate;
+        const bool drop = dropRate > 0 && m_random.generateDouble() < dropRate;
+        if (m_config.upstream.dropRate > 0 && m_random.generateDouble() < m_config.upstream.dropRate) {
+            // 请求丢失：从站不会收到，也不会应答
+            ++m_dropped;
+            continue;
+        }
+        if (drop) {
+            // 应答丢失：从站照常处理(写操作生效)，但应答不送达主站
+            session->dropReply.insert(txn);
+        } else if (rule && rule->hasDelay) {
+            session->replyDelay.insert(txn, rule->delay.sample(m_random));
+        }
+        session->toServer->enqueue(adu);
+    }
+}
+
+void FaultProxy::onServerData(Session* session)
+{
+    const QByteArray data = session->server->readAll();
+    if (!m_config.modbus) {
+        if (m_config.downstream.dropRate > 0 && m_random.generateDouble() < m_config.downstream.dropRate) {
+            ++m_dropped;
+            return;
+        }
+        session->toClient->enqueue(data);
+        return;
+    }
+
+    session->serverBuffer.append(data);
+    for (QByteArray adu = takeAdu(session->serverBuffer); !adu.isEmpty(); adu = takeAdu(session->serverBuffer)) {
+        const quint16 txn = transactionId(adu);
+        if (session->dropReply.remove(txn)) {
+            ++m_dropped;
+            continue;
+        }
+        int delayMs = -1;
+        auto it = session->replyDelay.find(txn);
+        if (it != session->replyDelay.end()) {
+            delayMs = it.value();
+            session->replyDelay.erase(it);
+        }
+        session->toClient->enqueue(adu, delayMs);
+    }
+}
+
+void FaultProxy::closeSession(Session* session)
+{
+    if (!m_sessions.removeOne(session)) {
+        return;
+    }
+    session->client->disconnect(this);
+    session->server->disconnect(this);
+    session->client->close();
+    session->server->close();
+    session->client->deleteLater();
+    session->server->deleteLater();
+    delete session;
+}
+
+const FaultRule* FaultProxy::findRule(int unit, int fc, int address) const
+{
+    for (const FaultRule& rule : m_config.rules) {
+        if (rule.matches(m_slaveIndex, unit, fc, address)) {
+            return &rule;
+        }
+    }
+    return nullptr;
+}
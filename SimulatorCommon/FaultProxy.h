@@ -0,0 +1,182 @@
+#ifndef FAULTPROXY_H
+#define FAULTPROXY_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QHostAddress>
+#include <QJsonObject>
+#include <QList>
+#include <QRandomGenerator>
+#include <QVector>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief 延迟分布
+ *
+ * JSON: { "dist": "fixed|uniform|normal|exponential", "ms": 10, "minMs": 5, "maxMs": 50,
+ *         "meanMs": 20, "stddevMs": 5 }
+ */
+struct DelayModel
+{
+    enum Dist { None, Fixed, Uniform, Normal, Exponential };
+
+    Dist dist = None;
+    double a = 0;   ///< fixed: 延迟; uniform: 最小值; normal/exponential: 均值
+    double b = 0;   ///< uniform: 最大值; normal: 标准差
+
+    static DelayModel fromJson(const QJsonObject& obj);
+    int sample(QRandomGenerator& random) const;
+};
+
+/**
+ * @brief 一个方向上的字节流故障
+ *
+ * JSON: { "delay": {...}, "dropRate": 0.01, "splitRate": 0.1, "maxFragment": 3, "splitGapMs": 2,
+ *         "mergeRate": 0.1, "mergeWindowMs": 20, "bandwidthBps": 1200 }
+ */
+struct StreamFaults
+{
+    DelayModel delay;
+    double dropRate = 0;        ///< 丢弃整帧(Modbus模式)或整块数据(原始模式)的概率
+    double splitRate = 0;       ///< 帧被拆成多个TCP段发送的概率
+    int maxFragment = 4;        ///< 拆分时每段最大字节数
+    int splitGapMs = 2;         ///< 拆分段之间的间隔，保证对端分多次收到
+    double mergeRate = 0;       ///< 帧被扣留以便与后续帧合并发送的概率
+    int mergeWindowMs = 20;     ///< 合并时的扣留时间
+    qint64 bandwidthBps = 0;    ///< 带宽上限(字节/秒)，0表示不限
+
+    static StreamFaults fromJson(const QJsonObject& obj);
+};
+
+/**
+ * @brief 按从站和寄存器范围匹配的Modbus故障规则，按顺序第一条匹配的生效
+ *
+ * JSON: { "slaves": [0, 9], "unitId": 1, "function": 3, "start": 100, "end": 199,
+ *         "delay": {...}, "dropRate": 0.2, "exceptionCode": 2, "exceptionRate": 0.05 }
+ */
+struct FaultRule
+{
+    int slaveFirst = -1;        ///< 从站序号范围，-1表示全部
+    int slaveLast = -1;
+    int unitId = -1;
+    int function = -1;
+    int start = 0;
+    int end = 65535;
+    bool hasDelay = false;      ///< 为false时使用方向上的默认延迟
+    DelayModel delay;
+    double dropRate = -1;       ///< <0表示使用方向上的默认丢帧率
+    int exceptionCode = 0;      ///< Modbus异常码，0表示不注入
+    double exceptionRate = 0;
+
+    static FaultRule fromJson(const QJsonObject& obj);
+    bool matches(int slave, int unit, int fc, int address) const;
+};
+
+/**
+ * @brief 故障注入配置
+ *
+ * JSON: { "mode": "modbus|raw", "downstream": {...}, "upstream": {...}, "rules": [...] }
+ * downstream 为服务端到客户端方向(应答)，upstream 为客户端到服务端方向(请求)。
+ */
+struct FaultConfig
+{
+    bool modbus = true;
+    StreamFaults downstream;
+    StreamFaults upstream;
+    QVector<FaultRule> rules;
+
+    static FaultConfig fromJson(const QJsonObject& obj);
+};
+
+/**
+ * @brief 向一个方向的套接字按故障配置整形输出：延迟、合并、拆分和限速
+ *
+ * 帧按入队顺序输出，发送时间不早于前一帧，模拟串行处理的从站。
+ */
+class ShapedPipe : public QObject
+{
+    Q_OBJECT
+
+public:
+    ShapedPipe(QTcpSocket* socket, const StreamFaults& faults, QRandomGenerator& random, QObject *parent = nullptr);
+
+    /**
+     * @brief 入队一帧数据
+     * @param delayMs 在方向默认延迟之外单独指定的延迟，<0表示使用默认延迟
+     */
+    void enqueue(const QByteArray& frame, int delayMs = -1);
+
+private slots:
+    void pump();
+
+private:
+    struct Item {
+        QByteArray data;
+        qint64 releaseAtMs;
+    };
+
+    QTcpSocket* m_socket;
+    StreamFaults m_faults;
+    QRandomGenerator& m_random;
+    QTimer* m_timer;
+    QElapsedTimer m_clock;
+    QList<Item> m_queue;
+    qint64 m_lastReleaseMs;
+    QByteArray m_pending;       // 已到发送时间、受带宽或拆分限制尚未写出的数据
+    bool m_splitting;           // m_pending 是否按拆分模式逐段写出
+    double m_tokens;            // 令牌桶中可发送的字节数
+    qint64 m_lastRefillMs;
+};
+
+/**
+ * @brief 插在客户端和服务端之间的故障注入TCP代理
+ *
+ * 每个客户端连接对应一个到目标服务端的连接。Modbus模式下按MBAP头切分帧，
+ * 根据请求的单元号、功能码和起始地址匹配规则，可直接回复异常码、丢弃请求或单独设置应答延迟；
+ * 原始模式下只对字节流做延迟、丢弃、拆分、合并和限速。
+ */
+class FaultProxy : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param slaveIndex 规则中 "slaves" 匹配用的从站序号
+     */
+    FaultProxy(const FaultConfig& config, int slaveIndex = 0, QObject *parent = nullptr);
+
+    bool listen(const QHostAddress& address, quint16 port);
+    void setTarget(const QString& host, quint16 port);
+    QString errorString() const;
+
+    quint64 droppedFrames() const { return m_dropped; }
+    quint64 injectedExceptions() const { return m_exceptions; }
+
+private slots:
+    void onNewConnection();
+
+private:
+    struct Session;
+
+    void onClientData(Session* session);
+    void onServerData(Session* session);
+    void closeSession(Session* session);
+    const FaultRule* findRule(int unit, int fc, int address) const;
+
+    FaultConfig m_config;
+    int m_slaveIndex;
+    QTcpServer* m_server;
+    QString m_targetHost;
+    quint16 m_targetPort;
+    QRandomGenerator m_random;
+    QList<Session*> m_sessions;
+    quint64 m_dropped;
+    quint64 m_exceptions;
+};
+
+#endif // FAULTPROXY_H
@@ -0,0 +1,269 @@
+/**
+ * @file HeadlessJgtServer.cpp
+ * @brief HeadlessJgtServer类的实现
+ */
+#include "HeadlessJgtServer.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QTimer>
+
+namespace {
+
+const int kDefaultStatsIntervalMs = 5000;
+const int kMaxFrameBytes = 4096;        // 超过该长度仍未收到 '>' 视为垃圾数据
+
+}
+
+HeadlessJgtServer::HeadlessJgtServer(QObject *parent)
+    : QObject(parent)
+    , m_server(new QTcpServer(this))
+    , m_streamTimer(new QTimer(this))
+    , m_statsTimer(new QTimer(this))
+    , m_random(QRandomGenerator::securelySeeded())
+    , m_nextClientId(0)
+    , m_seq(0)
+    , m_commands(0)
+    , m_replies(0)
+    , m_streamed(0)
+    , m_bytesIn(0)
+    , m_bytesOut(0)
+    , m_badFrames(0)
+{
+    m_streamTimer->setTimerType(Qt::PreciseTimer);
+    connect(m_server, &QTcpServer::newConnection, this, &HeadlessJgtServer::onNewConnection);
+    connect(m_streamTimer, &QTimer::timeout, this, &HeadlessJgtServer::onStreamTick);
+    connect(m_statsTimer, &QTimer::timeout, this, &HeadlessJgtServer::printStats);
+}
+
+HeadlessJgtServer::~HeadlessJgtServer()
+{
+    qDeleteAll(m_clients);
+}
+
+bool HeadlessJgtServer::start(const QJsonObject& script, QString& error)
+{
+    for (const QJsonValue& val : script["rules"].toArray()) {
+        const QJsonObject obj = val.toObject();
+        Rule rule;
+        const QString command = obj["command"].toString("*");
+        rule.command = command == "*" ? QByteArray() : command.toUtf8();
+        rule.reply = obj["reply"].toString().toUtf8();
+        rule.probability = qBound(0.0, obj["probability"].toDouble(1.0), 1.0);
+        rule.delayMs = qMax(0, obj["delayMs"].toInt());
+        m_rules.append(rule);
+    }
+
+    int tickMs = 0;
+    for (const QJsonValue& val : script["streams"].toArray()) {
+        const QJsonObject obj = val.toObject();
+        Stream stream;
+        stream.periodMs = qMax(1, obj["periodMs"].toInt(100));
+        stream.repeat = qMax(1, obj["repeat"].toInt(1));
+        for (const QJsonValue& frame : obj["frames"].toArray()) {
+            stream.frames.append(frame.toString().toUtf8());
+        }
+        if (stream.frames.isEmpty()) {
+            error = "stream without frames";
+            return false;
+        }
+        stream.nextDueMs = 0;
+        m_streams.append(stream);
+        tickMs = tickMs ? qMin(tickMs, stream.periodMs) : stream.periodMs;
+    }
+
+    const QHostAddress address(script["bindAddress"].toString("0.0.0.0"));
+    const quint16 port = static_cast<quint16>(script["port"].toInt(8888));
+    if (!m_server->listen(address, port)) {
+        error = QString("%1:%2: %3").arg(address.toString()).arg(port).arg(m_server->errorString());
+        return false;
+    }
+
+    m_clock.start();
+    if (tickMs > 0) {
+        m_streamTimer->start(tickMs);
+    }
+    m_statsTimer->start(script["statsIntervalMs"].toInt(kDefaultStatsIntervalMs));
+
+    QTextStream(stdout) << QString("JGT server listening on %1:%2, %3 rules, %4 streams")
+                               .arg(address.toString()).arg(port).arg(m_rules.size()).arg(m_streams.size()) << "\n";
+    return true;
+}
+
+void HeadlessJgtServer::onNewConnection()
+{
+    while (QTcpSocket* socket = m_server->nextPendingConnection()) {
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        auto client = new Client{socket, m_nextClientId++, QByteArray()};
+        m_clients.append(client);
+        connect(socket, &QTcpSocket::readyRead, this, [this, client]() { onClientData(client); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, client]() { removeClient(client); });
+    }
+}
+
+void HeadlessJgtServer::onClientData(Client* client)
+{
+    const QByteArray data = client->socket->readAll();
+    m_bytesIn += data.size();
+    client->buffer.append(data);
+
+    // 按 '<' ... '>' 切分，帧外的字节丢弃
+    int pos = 0;
+    const QByteArray& buf = client->buffer;
+    while (true) {
+        const int begin = buf.indexOf('<', pos);
+        if (begin < 0) {
+            pos = buf.size();
+            break;
+        }
+        if (begin > pos) {
+            ++m_badFrames;
+        }
+        const int end = buf.indexOf('>', begin + 1);
+        if (end < 0) {
+            pos = begin;
+            if (buf.size() - begin > kMaxFrameBytes) {
+                ++m_badFrames;
+                pos = buf.size();
+            }
+            break;
+        }
+        const int comma = buf.indexOf(',', begin + 1);
+        if (comma >= 0 && comma < end) {
+            handleCommand(client, buf.mid(begin + 1, comma - begin - 1), buf.mid(comma + 1, end - comma - 1));
+        } else {
+            handleCommand(client, buf.mid(begin + 1, end - begin - 1), QByteArray());
+        }
+        pos = end + 1;
+    }
+    client->buffer.remove(0, pos);
+}
+
+void HeadlessJgtServer::handleCommand(Client* client, const QByteArray& command, const QByteArray& value)
+{
+    ++m_commands;
+    for (const Rule& rule : m_rules) {
+        if (!rule.command.isEmpty() && rule.command != command) {
+            continue;
+        }
+        if (rule.reply.isEmpty() || (rule.probability < 1.0 && m_random.generateDouble() >= rule.probability)) {
+            return;
+        }
+        const QByteArray reply = expand(rule.reply, command, value, client->id);
+        if (rule.delayMs == 0) {
+            client->socket->write(reply);
+            m_bytesOut += reply.size();
+            ++m_replies;
+        } else {
+            // 客户端可能在延迟期间断开
+            QPointer<QTcpSocket> socket(client->socket);
+            QTimer::singleShot(rule.delayMs, this, [this, socket, reply]() {
+                if (socket && socket->state() == QAbstractSocket::ConnectedState) {
+                    socket->write(reply);
+                    m_bytesOut += reply.size();
+                    ++m_replies;
+                }
+            });
+        }
+        return;
+    }
+}
+
+QByteArray HeadlessJgtServer::expand(const QByteArray& pattern, const QByteArray& command, const QByteArray& value, int clientId)
+{
+    if (!pattern.contains('{')) {
+        return pattern;
+    }
+    QByteArray out;
+    out.reserve(pattern.size() + 16);
+    int pos = 0;
+    while (pos < pattern.size()) {
+        const int open = pattern.indexOf('{', pos);
+        const int close = open < 0 ? -1 : pattern.indexOf('}', open);
+        if (close < 0) {
+            out.append(pattern.mid(pos));
+            break;
+        }
+        out.append(pattern.mid(pos, open - pos));
+        const QByteArray name = pattern.mid(open + 1, close - open - 1);
+        if (name == "command") {
+            out.append(command);
+        } else if (name == "value") {
+            out.append(value);
+        } else if (name == "seq") {
+            out.append(QByteArray::number(m_seq));
+        } else if (name == "client") {
+            out.append(QByteArray::number(clientId));
+        } else if (name.startsWith("rand:")) {
+            const QList<QByteArray> range = name.split(':');
+            const int lo = range.value(1).toInt();
+            const int hi = qMax(lo, range.value(2).toInt());
+            out.append(QByteArray::number(lo + m_random.bounded(hi - lo + 1)));
+        } else {
+            out.append(pattern.mid(open, close - open + 1));
+        }
+        pos = close + 1;
+    }
+    return out;
+}
+
+void HeadlessJgtServer::onStreamTick()
+{
+    if (m_clients.isEmpty()) {
+        return;
+    }
+    const qint64 now = m_clock.elapsed();
+    for (Stream& stream : m_streams) {
+        if (now < stream.nextDueMs) {
+            continue;
+        }
+        stream.nextDueMs = now + stream.periodMs;
+        for (Client* client : m_clients) {
+            // 同一周期内的帧合并为一次写入
+            QByteArray batch;
+            for (int r = 0; r < stream.repeat; ++r) {
+                for (const QByteArray& frame : stream.frames) {
+                    batch.append(expand(frame, QByteArray(), QByteArray(), client->id));
+                    ++m_streamed;
+                }
+                ++m_seq;
+            }
+            client->socket->write(batch);
+            m_bytesOut += batch.size();
+        }
+    }
+}
+
+void HeadlessJgtServer::removeClient(Client* client)
+{
+    if (!m_clients.removeOne(client)) {
+        return;
+    }
+    client->socket->deleteLater();
+    delete client;
+}
+
+void HeadlessJgtServer::printStats()
+{
+    const double seconds = m_statsTimer->interval() / 1000.0;
+    QTextStream(stdout) << QString("[%1 s] clients %2, commands %3/s, replies %4/s, streamed %5 frames/s, "
+                                   "in %6 KB/s, out %7 KB/s, bad %8")
+                               .arg(m_clock.elapsed() / 1000)
+                               .arg(m_clients.size())
+                               .arg(m_commands / seconds, 0, 'f', 0)
+                               .arg(m_replies / seconds, 0, 'f', 0)
+                               .arg(m_streamed / seconds, 0, 'f', 0)
+                               .arg(m_bytesIn / seconds / 1024.0, 0, 'f', 1)
+                               .arg(m_bytesOut / seconds / 1024.0, 0, 'f', 1)
+                               .arg(m_badFrames)
+                        << "\n";
+    m_commands = 0;
+    m_replies = 0;
+    m_streamed = 0;
+    m_bytesIn = 0;
+    m_bytesOut = 0;
+    m_badFrames = 0;
+}
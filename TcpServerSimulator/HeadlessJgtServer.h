@@ -0,0 +1,103 @@
+#ifndef HEADLESSJGTSERVER_H
+#define HEADLESSJGTSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QRandomGenerator>
+#include <QVector>
+
+class QTcpServer;
+class QTcpSocket;
+class QTimer;
+
+/**
+ * @brief 无界面多客户端JGT协议仿真器
+ *
+ * 同时接受任意数量的客户端，按 <CMD,VALUE> 切分命令帧，按脚本规则应答，
+ * 并可按固定周期向所有客户端推送状态帧，用于对 JGTDevice 的收发通路做压力测试。
+ *
+ * 脚本文件格式:
+ * {
+ *   "bindAddress": "0.0.0.0", "port": 8888, "statsIntervalMs": 5000,
+ *   "rules": [
+ *     { "command": "DPOWER", "reply": "<DPOWER,{value}>", "probability": 1.0, "delayMs": 0 },
+ *     { "command": "*", "reply": "<ACK,{command}>" }
+ *   ],
+ *   "streams": [
+ *     { "periodMs": 10, "repeat": 1, "frames": ["<STATUS,{seq}>", "<TEMP,{rand:200:400}>"] }
+ *   ]
+ * }
+ * 规则按顺序匹配，"*" 匹配任意命令，没有匹配的命令不应答；probability 为应答概率。
+ * 模板变量: {command} {value} {seq} {client} {rand:min:max}。
+ * 每个推送流每个周期向每个客户端写入 repeat 轮 frames，同一周期的帧合并为一次写入。
+ */
+class HeadlessJgtServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HeadlessJgtServer(QObject *parent = nullptr);
+    ~HeadlessJgtServer();
+
+    /**
+     * @brief 按脚本开始监听
+     * @param script 脚本对象，格式见类说明
+     * @param error 失败原因
+     */
+    bool start(const QJsonObject& script, QString& error);
+
+private slots:
+    void onNewConnection();
+    void onStreamTick();
+    void printStats();
+
+private:
+    struct Rule {
+        QByteArray command;     // 为空表示匹配任意命令
+        QByteArray reply;
+        double probability;
+        int delayMs;
+    };
+
+    struct Stream {
+        int periodMs;
+        int repeat;
+        QList<QByteArray> frames;
+        qint64 nextDueMs;
+    };
+
+    struct Client {
+        QTcpSocket* socket;
+        int id;
+        QByteArray buffer;
+    };
+
+    void onClientData(Client* client);
+    void handleCommand(Client* client, const QByteArray& command, const QByteArray& value);
+    QByteArray expand(const QByteArray& pattern, const QByteArray& command, const QByteArray& value, int clientId);
+    void removeClient(Client* client);
+
+    QTcpServer* m_server;
+    QTimer* m_streamTimer;
+    QTimer* m_statsTimer;
+    QElapsedTimer m_clock;
+    QRandomGenerator m_random;
+    QVector<Rule> m_rules;
+    QVector<Stream> m_streams;
+    QList<Client*> m_clients;
+    int m_nextClientId;
+    quint64 m_seq;
+
+    // 统计周期内的计数
+    quint64 m_commands;
+    quint64 m_replies;
+    quint64 m_streamed;
+    quint64 m_bytesIn;
+    quint64 m_bytesOut;
+    quint64 m_badFrames;
+};
+
+#endif // HEADLESSJGTSERVER_H
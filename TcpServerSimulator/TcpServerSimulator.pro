@@ -17,10 +17,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 SOURCES += \
     main.cpp \
-    mainwindow.cpp
+    mainwindow.cpp \
+    HeadlessJgtServer.cpp \
+    ../SimulatorCommon/FaultProxy.cpp
 
 HEADERS += \
-    mainwindow.h
+    mainwindow.h \
+    HeadlessJgtServer.h \
+    ../SimulatorCommon/FaultProxy.h
+
+INCLUDEPATH += $$PWD/../
 
 FORMS += \
     mainwindow.ui
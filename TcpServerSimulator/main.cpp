@@ -1,9 +1,125 @@
 #include "mainwindow.h"
+#include "HeadlessJgtServer.h"
+#include "SimulatorCommon/FaultProxy.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+/**
+ * @brief 故障注入代理模式: 在主站和本仿真器(或其他TCP服务端)之间注入延迟、丢包、拆包、粘包和限速
+ *
+ *   TcpServerSimulator --faults faults.json --listen 9000 --target 127.0.0.1:8000
+ *
+ * faults.json 格式见 FaultProxy.h，对 JGT 这类自定义文本协议使用 "mode": "raw"。
+ */
+static int runFaultProxy(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Fault injecting TCP proxy.");
+    parser.addHelpOption();
+    QCommandLineOption faultsOption("faults", "Fault injection JSON (see FaultProxy.h).", "file");
+    QCommandLineOption listenOption("listen", "Port the master connects to.", "port");
+    QCommandLineOption bindOption("bind", "Listen address.", "address", "0.0.0.0");
+    QCommandLineOption targetOption("target", "Server behind the proxy, host:port.", "address");
+    parser.addOptions({faultsOption, listenOption, bindOption, targetOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QFile file(parser.value(faultsOption));
+    if (!file.open(QIODevice::ReadOnly)) {
+        err << "cannot open " << file.fileName() << "\n";
+        return 1;
+    }
+    const QStringList target = parser.value(targetOption).split(':');
+    if (target.size() != 2 || !parser.isSet(listenOption)) {
+        err << "--faults needs --listen <port> and --target <host:port>" << "\n";
+        return 1;
+    }
+
+    FaultProxy proxy(FaultConfig::fromJson(QJsonDocument::fromJson(file.readAll()).object()));
+    proxy.setTarget(target.at(0), static_cast<quint16>(target.at(1).toUInt()));
+    if (!proxy.listen(QHostAddress(parser.value(bindOption)), static_cast<quint16>(parser.value(listenOption).toUInt()))) {
+        err << proxy.errorString() << "\n";
+        return 1;
+    }
+    return app.exec();
+}
+
+/**
+ * @brief 无界面模式: 多客户端JGT协议仿真
+ *
+ *   TcpServerSimulator --headless --script jgt_load.json
+ *   TcpServerSimulator --headless --port 8888 --echo --stream-period 10
+ *
+ * 脚本格式见 HeadlessJgtServer.h；客户端较多时注意提高进程的文件描述符上限(ulimit -n)。
+ */
+static int runHeadless(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Headless multi-client JGT protocol simulator.");
+    parser.addHelpOption();
+    QCommandLineOption headlessOption("headless", "Run without GUI.");
+    QCommandLineOption scriptOption("script", "Response/stream script JSON (see HeadlessJgtServer.h).", "file");
+    QCommandLineOption portOption("port", "Listen port for a quick run.", "port", "8888");
+    QCommandLineOption echoOption("echo", "Quick run: answer every command with the same <CMD,VALUE> frame.");
+    QCommandLineOption streamPeriodOption("stream-period", "Quick run: push a <STATUS,seq> frame to every client each period (ms).", "ms");
+    parser.addOptions({headlessOption, scriptOption, portOption, echoOption, streamPeriodOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QJsonObject script;
+    if (parser.isSet(scriptOption)) {
+        QFile file(parser.value(scriptOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            err << "cannot open " << file.fileName() << "\n";
+            return 1;
+        }
+        script = QJsonDocument::fromJson(file.readAll()).object();
+    } else {
+        script["port"] = parser.value(portOption).toInt();
+        if (parser.isSet(echoOption)) {
+            QJsonObject rule;
+            rule["command"] = "*";
+            rule["reply"] = "<{command},{value}>";
+            script["rules"] = QJsonArray{rule};
+        }
+        if (parser.isSet(streamPeriodOption)) {
+            QJsonObject stream;
+            stream["periodMs"] = parser.value(streamPeriodOption).toInt();
+            stream["frames"] = QJsonArray{"<STATUS,{seq}>"};
+            script["streams"] = QJsonArray{stream};
+        }
+    }
+
+    HeadlessJgtServer server;
+    QString error;
+    if (!server.start(script, error)) {
+        err << error << "\n";
+        return 1;
+    }
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; ++i) {
+        if (qstrcmp(argv[i], "--faults") == 0) {
+            return runFaultProxy(argc, argv);
+        }
+        if (qstrcmp(argv[i], "--headless") == 0) {
+            return runHeadless(argc, argv);
+        }
+    }
+
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
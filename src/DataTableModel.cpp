@@ -0,0 +1,241 @@
+/**
+ * @file DataTableModel.cpp
+ * @brief DataTableModel类的实现
+ */
+#include "DataTableModel.h"
+#include "core/DataManager.h"
+#include "core/ConfigImage.h"
+#include <QColor>
+#include <QTableView>
+#include <QTimer>
+
+namespace {
+const int kDefaultRefreshHz = 20;
+}
+
+DataTableModel::DataTableModel(DataManager* dataManager, QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_dataManager(dataManager)
+    , m_refreshTimer(new QTimer(this))
+    , m_stale(false)
+    , m_dirtyFirst(0)
+    , m_dirtyLast(-1)
+{
+    m_refreshTimer->setInterval(1000 / kDefaultRefreshHz);
+    connect(m_refreshTimer, &QTimer::timeout, this, &DataTableModel::flushDirtyRows);
+}
+
+void DataTableModel::setView(QTableView* view)
+{
+    m_view = view;
+}
+
+void DataTableModel::setRefreshRate(int hz)
+{
+    m_refreshTimer->setInterval(1000 / qMax(1, hz));
+}
+
+void DataTableModel::setDevice(const QString& deviceId, const QSharedPointer<const ConfigImage>& image)
+{
+    beginResetModel();
+    m_deviceId = deviceId;
+    m_rows.clear();
+    m_rowByKey.clear();
+    m_stale = m_dataManager && m_dataManager->isDeviceStale(deviceId);
+
+    // 先取一次当前值，切换设备后不必等到下一次采样才有数据
+    const QMap<QString, QVariant> current = m_dataManager ? m_dataManager->getDeviceData(deviceId)
+                                                          : QMap<QString, QVariant>();
+    const int paramCount = image ? image->paramCount() : 0;
+    m_rows.reserve(paramCount);
+    for (int i = 0; i < paramCount; ++i) {
+        const ConfigImage::Param& param = image->param(i);
+        Row row;
+        row.address = param.rawAddress;
+        row.bitpos = param.bitpos;
+        row.length = param.length;
+        row.key = image->string(param.key);
+        row.name = image->string(param.name);
+        row.access = image->string(param.access);
+        row.writable = param.flags & ConfigImage::Writable;
+        row.alarmed = false;
+        row.value = current.value(row.key, 0);
+        m_rowByKey.insert(row.key, m_rows.size());
+        m_rows.append(row);
+    }
+
+    m_dirty.fill(false, m_rows.size());
+    m_dirtyFirst = 0;
+    m_dirtyLast = -1;
+    m_refreshTimer->stop();
+    endResetModel();
+}
+
+void DataTableModel::setAlarmedKeys(const QSet<QString>& keys)
+{
+    int first = m_rows.size();
+    int last = -1;
+    for (int i = 0; i < m_rows.size(); ++i) {
+        const bool alarmed = keys.contains(m_rows.at(i).key);
+        if (m_rows.at(i).alarmed != alarmed) {
+            m_rows[i].alarmed = alarmed;
+            first = qMin(first, i);
+            last = i;
+        }
+    }
+    if (first <= last) {
+        emit dataChanged(index(first, 0), index(last, ColumnCount - 1), {Qt::BackgroundRole});
+    }
+}
+
+int DataTableModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : m_rows.size();
+}
+
+int DataTableModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant DataTableModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_rows.size()) {
+        return QVariant();
+    }
+    if (role == Qt::ForegroundRole) {
+        return (m_stale && index.column() == ColValue) ? QVariant(QColor(Qt::gray)) : QVariant();
+    }
+    if (role == Qt::BackgroundRole) {
+        return m_rows.at(index.row()).alarmed ? QVariant(QColor(255, 205, 205)) : QVariant();
+    }
+    if (role != Qt::DisplayRole && role != Qt::EditRole) {
+        return QVariant();
+    }
+
+    const Row& row = m_rows.at(index.row());
+    switch (index.column()) {
+    case ColAddress: return row.address;
+    case ColBitpos: return row.bitpos;
+    case ColLength: return row.length;
+    case ColKey: return row.key;
+    case ColName: return row.name;
+    case ColAccess: return row.access;
+    case ColValue: return row.value.toString();
+    default: return QVariant();
+    }
+}
+
+QVariant DataTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) {
+        return QVariant();
+    }
+    if (orientation == Qt::Vertical) {
+        return section + 1;
+    }
+
+    static const char* const labels[ColumnCount] = {"Address", "Bitpos", "Length", "Key", "Name", "Access", "Value"};
+    return (section >= 0 && section < ColumnCount) ? QString(labels[section]) : QVariant();
+}
+
+Qt::ItemFlags DataTableModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) {
+        return Qt::NoItemFlags;
+    }
+    Qt::ItemFlags f = Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+    if (index.column() == ColValue && m_rows.at(index.row()).writable) {
+        f |= Qt::ItemIsEditable;
+    }
+    return f;
+}
+
+bool DataTableModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole || index.column() != ColValue) {
+        return false;
+    }
+    Row& row = m_rows[index.row()];
+    if (!row.writable) {
+        return false;
+    }
+
+    // 先显示输入值，设备读回后由数据更新覆盖
+    row.value = value.toString();
+    emit dataChanged(index, index, {Qt::DisplayRole, Qt::EditRole});
+    emit writeRequested(m_deviceId, row.key, value.toString());
+    return true;
+}
+
+void DataTableModel::onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value)
+{
+    if (deviceId != m_deviceId) {
+        return;
+    }
+    auto it = m_rowByKey.constFind(key);
+    if (it == m_rowByKey.constEnd()) {
+        return;
+    }
+
+    const int r = it.value();
+    m_rows[r].value = value;
+    m_dirty[r] = true;
+    m_dirtyFirst = (m_dirtyFirst <= m_dirtyLast) ? qMin(m_dirtyFirst, r) : r;
+    m_dirtyLast = qMax(m_dirtyLast, r);
+    if (!m_refreshTimer->isActive()) {
+        m_refreshTimer->start();
+    }
+}
+
+void DataTableModel::onDeviceStaleChanged(const QString& deviceId, bool stale)
+{
+    if (deviceId != m_deviceId || stale == m_stale) {
+        return;
+    }
+    m_stale = stale;
+    if (!m_rows.isEmpty()) {
+        emit dataChanged(index(0, ColValue), index(m_rows.size() - 1, ColValue), {Qt::ForegroundRole});
+    }
+}
+
+void DataTableModel::flushDirtyRows()
+{
+    if (m_dirtyFirst > m_dirtyLast) {
+        m_refreshTimer->stop();
+        return;
+    }
+
+    // 只通知可见区域内的脏行；不可见的行滚动进入视图时会重新读取 data()，直接丢弃脏标记即可
+    int first = m_dirtyFirst;
+    int last = m_dirtyLast;
+    if (m_view) {
+        if (!m_view->isVisible()) {
+            first = 1;
+            last = 0;
+        } else {
+            const int top = m_view->rowAt(0);
+            const int bottom = m_view->rowAt(m_view->viewport()->height() - 1);
+            first = qMax(first, top < 0 ? 0 : top);
+            last = qMin(last, bottom < 0 ? m_rows.size() - 1 : bottom);
+        }
+    }
+
+    // 连续的脏行合并为一次 dataChanged
+    int runStart = -1;
+    for (int r = first; r <= last + 1; ++r) {
+        const bool dirty = (r <= last) && m_dirty.at(r);
+        if (dirty && runStart < 0) {
+            runStart = r;
+        } else if (!dirty && runStart >= 0) {
+            emit dataChanged(index(runStart, ColValue), index(r - 1, ColValue), {Qt::DisplayRole});
+            runStart = -1;
+        }
+    }
+
+    for (int r = m_dirtyFirst; r <= m_dirtyLast; ++r) {
+        m_dirty[r] = false;
+    }
+    m_dirtyFirst = 0;
+    m_dirtyLast = -1;
+}
@@ -0,0 +1,114 @@
+#ifndef DATATABLEMODEL_H
+#define DATATABLEMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QVariant>
+#include <QVector>
+
+class QTableView;
+class QTimer;
+class DataManager;
+class ConfigImage;
+
+/**
+ * @brief 寄存器数据表格模型
+ *
+ * 行由设备的配置镜像生成，数值来自 DataManager。
+ * 数据更新只记录脏行，由刷新定时器按固定帧率合并通知视图，
+ * 且只通知当前可见的行，高频设备不会占满界面线程。
+ */
+class DataTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { ColAddress, ColBitpos, ColLength, ColKey, ColName, ColAccess, ColValue, ColumnCount };
+
+    explicit DataTableModel(DataManager* dataManager, QObject *parent = nullptr);
+
+    /**
+     * @brief 设置显示数据的视图，刷新时按视图的可见区域裁剪
+     */
+    void setView(QTableView* view);
+
+    /**
+     * @brief 切换显示的设备，按设备的配置镜像重建全部行
+     * @param deviceId 设备ID
+     * @param image 设备的配置镜像，为空时表格为空
+     */
+    void setDevice(const QString& deviceId, const QSharedPointer<const ConfigImage>& image);
+
+    /**
+     * @brief 设置刷新帧率
+     * @param hz 每秒最多通知视图的次数
+     */
+    void setRefreshRate(int hz);
+
+    /**
+     * @brief 标记当前设备处于报警中的寄存器，这些行以报警底色显示
+     * @param keys 报警规则依赖的寄存器key
+     */
+    void setAlarmedKeys(const QSet<QString>& keys);
+
+    QString deviceId() const { return m_deviceId; }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+
+public slots:
+    /**
+     * @brief 接收DataManager的数据更新，只记录脏行，不立即通知视图
+     */
+    void onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value);
+
+    /**
+     * @brief 设备断开或恢复连接时更新Value列的过期显示
+     */
+    void onDeviceStaleChanged(const QString& deviceId, bool stale);
+
+signals:
+    /**
+     * @brief 用户在Value列编辑了可写寄存器
+     * @param deviceId 设备ID
+     * @param key 寄存器key
+     * @param value 输入的值
+     */
+    void writeRequested(const QString& deviceId, const QString& key, const QString& value);
+
+private slots:
+    void flushDirtyRows();
+
+private:
+    struct Row {
+        int address;
+        int bitpos;
+        int length;
+        QString key;
+        QString name;
+        QString access;
+        bool writable;
+        bool alarmed;
+        QVariant value;
+    };
+
+    DataManager* m_dataManager;
+    QPointer<QTableView> m_view;
+    QTimer* m_refreshTimer;         // 脏行刷新定时器，有脏行时才运行
+    QString m_deviceId;
+    bool m_stale;                   // 当前设备数据是否过期，过期时Value列灰色显示
+    QVector<Row> m_rows;
+    QHash<QString, int> m_rowByKey; // key -> 行号
+    QVector<bool> m_dirty;          // 自上次刷新以来数值变化的行
+    int m_dirtyFirst;               // 脏行范围，没有脏行时 m_dirtyFirst > m_dirtyLast
+    int m_dirtyLast;
+};
+
+#endif // DATATABLEMODEL_H
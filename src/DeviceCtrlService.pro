@@ -1,8 +1,9 @@
-QT       += core gui network serialport serialbus
+QT       += core gui network serialport serialbus concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
-CONFIG += c++11
+# C++17: 对齐的 new，ZMotionStateBlock 等 alignas(64) 成员在堆上分配时也从缓存行开始
+CONFIG += c++17
 
 INCLUDEPATH += $$PWD/core \
                $$PWD/devices \
@@ -25,27 +26,54 @@ SOURCES += \
     devices/JGTDevice.cpp \
     main.cpp \
     mainwindow.cpp \
+    DataTableModel.cpp \
     core/Device.cpp \
     core/DeviceManager.cpp \
     core/ProtocolHandler.cpp \
     core/ThreadManager.cpp \
     core/DataManager.cpp \
+    core/DeviceMetrics.cpp \
+    core/ConfigImage.cpp \
+    core/ModbusPlan.cpp \
+    core/DriverRegistry.cpp \
+    core/ModbusBus.cpp \
+    core/AlarmEngine.cpp \
+    core/TagCondition.cpp \
+    core/InterlockEngine.cpp \
     devices/LSJDevice.cpp \
     devices/JGQDevice.cpp \
-    devices/ZMotionDevice.cpp
+    devices/ZMotionDevice.cpp \
+    devices/ZMotionBackend.cpp \
+    devices/ZMotionSimBackend.cpp \
+    devices/ZMotionScopeTrace.cpp
 
 HEADERS += \
     core/modbusdata.h \
+    core/IoBank.h \
     devices/JGTDevice.h \
     mainwindow.h \
+    DataTableModel.h \
     core/Device.h \
     core/DeviceManager.h \
     core/ProtocolHandler.h \
     core/ThreadManager.h \
     core/DataManager.h \
+    core/DeviceMetrics.h \
+    core/ConfigImage.h \
+    core/ModbusPlan.h \
+    core/DriverRegistry.h \
+    core/ModbusBus.h \
+    core/AlarmEngine.h \
+    core/TagCondition.h \
+    core/InterlockEngine.h \
+    core/DeviceDriverPlugin.h \
+    core/LogRing.h \
     devices/LSJDevice.h \
     devices/JGQDevice.h \
-    devices/ZMotionDevice.h
+    devices/ZMotionDevice.h \
+    devices/ZMotionBackend.h \
+    devices/ZMotionSimBackend.h \
+    devices/ZMotionScopeTrace.h
 
 FORMS += \
     mainwindow.ui
@@ -75,6 +103,11 @@ win32 {
     # 添加ZMotion头文件路径
     INCLUDEPATH += $$PWD/../3rdLib/zmotion
     DEPENDPATH += $$PWD/../3rdLib/zmotion
+
+    # 真实控制器后端只在有SDK的平台编译，其它平台只有仿真后端
+    DEFINES += HAVE_ZAUX_SDK
+    SOURCES += devices/ZAuxBackend.cpp
+    HEADERS += devices/ZAuxBackend.h
     
     # 确保运行时能找到DLL
     #QMAKE_POST_LINK += $$quote(copy /Y \"$$PWD/../3rdLib/zmotion/*.dll\" \"$$DESTDIR\")
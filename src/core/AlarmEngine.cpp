@@ -0,0 +1,429 @@
+#include "AlarmEngine.h"
+#include "DataManager.h"
+#include <QDateTime>
+#include <QJsonValue>
+#include <QTimer>
+#include <QDebug>
+
+/**
+ * @file AlarmEngine.cpp
+ * @brief AlarmEngine类的实现
+ */
+
+namespace {
+
+// JGT设备的数值以 QJsonValue 形式到达，统一转为普通类型再比较
+inline QVariant plainValue(const QVariant& value)
+{
+    return value.userType() == QMetaType::QJsonValue ? value.toJsonValue().toVariant() : value;
+}
+
+}
+
+QString AlarmEvent::typeName(Type type)
+{
+    switch (type) {
+    case Raised: return "raised";
+    case Cleared: return "cleared";
+    case Triggered: return "triggered";
+    case Acknowledged: return "acknowledged";
+    }
+    return QString();
+}
+
+AlarmEngine::AlarmEngine(DataManager* dataManager, QObject *parent)
+    : QObject(parent)
+    , m_dataManager(dataManager)
+    , m_debounceTimer(new QTimer(this))
+{
+    m_clock.start();
+    m_debounceTimer->setSingleShot(true);
+    connect(m_debounceTimer, &QTimer::timeout, this, &AlarmEngine::onDebounceTimer);
+}
+
+AlarmEngine::~AlarmEngine()
+{
+}
+
+bool AlarmEngine::parseRule(const QJsonObject& object, const QString& deviceId, Rule* rule, QString* error)
+{
+    rule->id = object["id"].toString();
+    if (rule->id.isEmpty()) {
+        *error = "missing id";
+        return false;
+    }
+    rule->name = object["name"].toString(rule->id);
+    rule->deviceId = deviceId;
+    rule->severity = object["severity"].toString("alarm");
+    rule->definition = object;
+
+    const QString trigger = object["trigger"].toString("level");
+    if (trigger == "level") {
+        rule->trigger = Level;
+    } else if (trigger == "rising") {
+        rule->trigger = Rising;
+    } else if (trigger == "falling") {
+        rule->trigger = Falling;
+    } else if (trigger == "change") {
+        rule->trigger = Change;
+    } else {
+        *error = QString("rule '%1': unknown trigger '%2'").arg(rule->id).arg(trigger);
+        return false;
+    }
+
+    const QString combine = object["combine"].toString("all");
+    if (combine != "all" && combine != "any") {
+        *error = QString("rule '%1': combine must be 'all' or 'any'").arg(rule->id);
+        return false;
+    }
+    rule->combineAll = (combine == "all");
+    rule->latch = object["latch"].toBool(false);
+    rule->debounceMs = qMax(0, object["debounce_ms"].toInt(0));
+
+    // 单条件规则可以省略 conditions 数组
+    QJsonArray conditions = object["conditions"].toArray();
+    if (!object.contains("conditions")) {
+        conditions.append(object);
+    }
+    if (conditions.isEmpty()) {
+        *error = QString("rule '%1': no conditions").arg(rule->id);
+        return false;
+    }
+    rule->conditions.clear();
+    for (int i = 0; i < conditions.size(); ++i) {
+        Condition condition;
+        QString conditionError;
+        if (!TagCondition::parse(conditions.at(i).toObject(), deviceId, &condition, &conditionError)) {
+            *error = QString("rule '%1' condition %2: %3").arg(rule->id).arg(i).arg(conditionError);
+            return false;
+        }
+        rule->conditions.append(condition);
+    }
+
+    rule->known = 0;
+    rule->primed = false;
+    rule->raw = false;
+    rule->condition = false;
+    rule->active = false;
+    rule->acknowledged = false;
+    rule->pendingDeadline = -1;
+    return true;
+}
+
+int AlarmEngine::setDeviceRules(const QString& deviceId, const QJsonArray& rules, QStringList* errors)
+{
+    QHash<QString, Rule> previous;
+    QVector<Rule> updated;
+    for (const Rule& rule : m_rules) {
+        if (rule.deviceId == deviceId) {
+            previous.insert(rule.id, rule);
+        } else {
+            updated.append(rule);
+        }
+    }
+
+    QSet<QString> ids;
+    QVector<int> fresh;
+    for (int i = 0; i < rules.size(); ++i) {
+        Rule rule;
+        QString error;
+        if (!parseRule(rules.at(i).toObject(), deviceId, &rule, &error)) {
+            if (errors) {
+                *errors << QString("alarms[%1]: %2").arg(i).arg(error);
+            }
+            continue;
+        }
+        if (ids.contains(rule.id)) {
+            if (errors) {
+                *errors << QString("alarms[%1]: duplicate id '%2'").arg(i).arg(rule.id);
+            }
+            continue;
+        }
+        ids.insert(rule.id);
+
+        // 定义未变的规则保留报警、确认和去抖状态
+        auto it = previous.find(rule.id);
+        if (it != previous.end() && it->definition == rule.definition) {
+            updated.append(it.value());
+            previous.erase(it);
+        } else {
+            fresh.append(updated.size());
+            updated.append(rule);
+        }
+    }
+
+    m_rules.swap(updated);
+    rebuildIndex();
+
+    // 删除或修改了的规则消除其报警，修改后的规则按当前值重新评估
+    for (const Rule& rule : previous) {
+        if (rule.active) {
+            emitEvent(rule, AlarmEvent::Cleared);
+        }
+    }
+
+    for (int ruleIndex : fresh) {
+        Rule& rule = m_rules[ruleIndex];
+        if (rule.known < rule.conditions.size()) {
+            continue;
+        }
+        for (Condition& condition : rule.conditions) {
+            condition.evaluate(m_tags.at(condition.slot).value);
+        }
+        evaluateRule(ruleIndex, m_tags.at(rule.conditions.first().slot).value);
+    }
+    return ids.size();
+}
+
+void AlarmEngine::rebuildIndex()
+{
+    QHash<QString, QHash<QString, int>> index;
+    QVector<Tag> tags;
+
+    for (int r = 0; r < m_rules.size(); ++r) {
+        Rule& rule = m_rules[r];
+        rule.known = 0;
+        for (int c = 0; c < rule.conditions.size(); ++c) {
+            Condition& condition = rule.conditions[c];
+            QHash<QString, int>& keys = index[condition.device];
+            auto it = keys.constFind(condition.tag);
+            if (it == keys.constEnd()) {
+                Tag tag;
+                tag.value = plainValue(m_dataManager->getDeviceData(condition.device, condition.tag));
+                tag.known = tag.value.isValid();
+                it = keys.insert(condition.tag, tags.size());
+                tags.append(tag);
+            }
+            condition.slot = it.value();
+            tags[condition.slot].dependents.append(qMakePair(r, c));
+            if (tags.at(condition.slot).known) {
+                ++rule.known;
+            }
+        }
+    }
+    m_tags.swap(tags);
+    m_tagIndex.swap(index);
+
+    // 规则下标已变，去抖队列按保留下来的等待重新排队
+    m_debounceQueue.clear();
+    m_debounceTimer->stop();
+    for (int r = 0; r < m_rules.size(); ++r) {
+        if (m_rules.at(r).pendingDeadline >= 0) {
+            scheduleDebounce(r, m_rules.at(r).pendingDeadline);
+        }
+    }
+}
+
+void AlarmEngine::onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value)
+{
+    // 热路径：两次哈希查找，无规则依赖或数值未变时不做任何分配
+    auto device = m_tagIndex.constFind(deviceId);
+    if (device == m_tagIndex.constEnd()) {
+        return;
+    }
+    auto slot = device->constFind(key);
+    if (slot == device->constEnd()) {
+        return;
+    }
+
+    Tag& tag = m_tags[slot.value()];
+    const QVariant plain = plainValue(value);
+    if (tag.known && tag.value == plain) {
+        return;
+    }
+    const bool first = !tag.known;
+    tag.known = true;
+    tag.value = plain;
+
+    // dependents 按规则下标排列，同一规则的条件都更新后再评估一次规则
+    const QVector<QPair<int, int>>& dependents = tag.dependents;
+    for (int i = 0; i < dependents.size(); ++i) {
+        Rule& rule = m_rules[dependents.at(i).first];
+        if (first) {
+            ++rule.known;
+        }
+        rule.conditions[dependents.at(i).second].evaluate(plain);
+        if (i + 1 == dependents.size() || dependents.at(i + 1).first != dependents.at(i).first) {
+            evaluateRule(dependents.at(i).first, plain);
+        }
+    }
+}
+
+void AlarmEngine::evaluateRule(int ruleIndex, const QVariant& value)
+{
+    Rule& rule = m_rules[ruleIndex];
+    if (rule.known < rule.conditions.size()) {
+        return;
+    }
+
+    bool raw = rule.combineAll;
+    for (const Condition& condition : rule.conditions) {
+        if (rule.combineAll ? !condition.state : condition.state) {
+            raw = !rule.combineAll;
+            break;
+        }
+    }
+    rule.lastValue = value;
+
+    if (!rule.primed) {
+        rule.primed = true;
+        if (rule.trigger != Level) {
+            // 边沿规则需要一个已知的前值，首次评估只记录状态
+            rule.raw = raw;
+            rule.condition = raw;
+            return;
+        }
+    } else if (raw == rule.raw) {
+        return;
+    }
+    rule.raw = raw;
+
+    if (rule.debounceMs == 0) {
+        applyCondition(rule, raw);
+    } else if (raw == rule.condition) {
+        // 去抖期间恢复原状，放弃这次变化
+        rule.pendingDeadline = -1;
+    } else {
+        scheduleDebounce(ruleIndex, m_clock.elapsed() + rule.debounceMs);
+    }
+}
+
+void AlarmEngine::applyCondition(Rule& rule, bool condition)
+{
+    rule.pendingDeadline = -1;
+    if (rule.condition == condition) {
+        return;
+    }
+    rule.condition = condition;
+
+    if (rule.trigger == Level) {
+        if (condition && !rule.active) {
+            rule.active = true;
+            rule.acknowledged = false;
+            emitEvent(rule, AlarmEvent::Raised);
+        } else if (!condition && rule.active && (!rule.latch || rule.acknowledged)) {
+            rule.active = false;
+            emitEvent(rule, AlarmEvent::Cleared);
+        }
+        return;
+    }
+
+    const bool fired = (rule.trigger == Change) || (rule.trigger == Rising ? condition : !condition);
+    if (!fired) {
+        return;
+    }
+    if (!rule.latch) {
+        emitEvent(rule, AlarmEvent::Triggered);
+    } else if (!rule.active) {
+        // 锁存的边沿报警保持到确认
+        rule.active = true;
+        rule.acknowledged = false;
+        emitEvent(rule, AlarmEvent::Raised);
+    }
+}
+
+void AlarmEngine::scheduleDebounce(int ruleIndex, qint64 deadline)
+{
+    m_rules[ruleIndex].pendingDeadline = deadline;
+    m_debounceQueue.insert(deadline, ruleIndex);
+    if (m_debounceQueue.firstKey() == deadline) {
+        m_debounceTimer->start(static_cast<int>(qMax<qint64>(0, deadline - m_clock.elapsed())));
+    }
+}
+
+void AlarmEngine::onDebounceTimer()
+{
+    const qint64 now = m_clock.elapsed();
+    while (!m_debounceQueue.isEmpty() && m_debounceQueue.firstKey() <= now) {
+        const qint64 deadline = m_debounceQueue.firstKey();
+        const int ruleIndex = m_debounceQueue.take(deadline);
+        Rule& rule = m_rules[ruleIndex];
+        // 等待期间条件又变化过的旧条目 pendingDeadline 已不同，跳过
+        if (rule.pendingDeadline == deadline) {
+            applyCondition(rule, rule.raw);
+        }
+    }
+    if (!m_debounceQueue.isEmpty()) {
+        m_debounceTimer->start(static_cast<int>(qMax<qint64>(0, m_debounceQueue.firstKey() - now)));
+    }
+}
+
+void AlarmEngine::acknowledge(const QString& deviceId, const QString& ruleId)
+{
+    for (Rule& rule : m_rules) {
+        if (rule.deviceId != deviceId || rule.id != ruleId) {
+            continue;
+        }
+        if (!rule.active || rule.acknowledged) {
+            return;
+        }
+        rule.acknowledged = true;
+        emitEvent(rule, AlarmEvent::Acknowledged);
+        // 边沿报警确认即消除；电平报警在条件已恢复时消除，否则保持到条件恢复
+        if (rule.trigger != Level || !rule.condition) {
+            rule.active = false;
+            emitEvent(rule, AlarmEvent::Cleared);
+        }
+        return;
+    }
+}
+
+void AlarmEngine::acknowledgeAll()
+{
+    for (int i = 0; i < m_rules.size(); ++i) {
+        if (m_rules.at(i).active && !m_rules.at(i).acknowledged) {
+            acknowledge(m_rules.at(i).deviceId, m_rules.at(i).id);
+        }
+    }
+}
+
+QList<AlarmEvent> AlarmEngine::activeAlarms() const
+{
+    QList<AlarmEvent> alarms;
+    for (const Rule& rule : m_rules) {
+        if (!rule.active) {
+            continue;
+        }
+        AlarmEvent event;
+        event.ruleId = rule.id;
+        event.name = rule.name;
+        event.deviceId = rule.deviceId;
+        event.severity = rule.severity;
+        event.type = rule.acknowledged ? AlarmEvent::Acknowledged : AlarmEvent::Raised;
+        event.value = rule.lastValue;
+        alarms.append(event);
+    }
+    return alarms;
+}
+
+QSet<QString> AlarmEngine::alarmedTags(const QString& deviceId) const
+{
+    QSet<QString> tags;
+    for (const Rule& rule : m_rules) {
+        if (!rule.active) {
+            continue;
+        }
+        for (const Condition& condition : rule.conditions) {
+            if (condition.device == deviceId) {
+                tags.insert(condition.tag);
+            }
+        }
+    }
+    return tags;
+}
+
+void AlarmEngine::emitEvent(const Rule& rule, AlarmEvent::Type type)
+{
+    AlarmEvent event;
+    event.ruleId = rule.id;
+    event.name = rule.name;
+    event.deviceId = rule.deviceId;
+    event.severity = rule.severity;
+    event.type = type;
+    event.value = rule.lastValue;
+    event.timeMs = QDateTime::currentMSecsSinceEpoch();
+    emit alarmEvent(event);
+    if (type != AlarmEvent::Triggered) {
+        emit activeAlarmsChanged();
+    }
+}
@@ -0,0 +1,170 @@
+#ifndef ALARMENGINE_H
+#define ALARMENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMultiMap>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include "TagCondition.h"
+
+class QTimer;
+class DataManager;
+
+/**
+ * @brief 报警事件
+ */
+struct AlarmEvent {
+    enum Type {
+        Raised,         ///< 报警产生
+        Cleared,        ///< 报警消除
+        Triggered,      ///< 不锁存的边沿规则触发一次
+        Acknowledged    ///< 报警已确认
+    };
+
+    QString ruleId;
+    QString name;
+    QString deviceId;   ///< 规则所属设备
+    QString severity;
+    Type type = Raised;
+    QVariant value;     ///< 触发评估的标签值
+    qint64 timeMs = 0;  ///< 自纪元起的毫秒数
+
+    static QString typeName(Type type);
+};
+
+Q_DECLARE_METATYPE(AlarmEvent)
+
+/**
+ * @brief 报警规则引擎
+ *
+ * 规则写在设备配置的 "alarms" 数组中:
+ *   {
+ *     "id": "pump_temp", "name": "泵源温度报警", "severity": "alarm",
+ *     "trigger": "level",          level(默认)、rising、falling、change
+ *     "debounce_ms": 200,          条件持续多久才生效，0为立即
+ *     "latch": true,               锁存：条件恢复后仍保持报警，直到确认
+ *     "combine": "all",            多个条件的组合方式，all(默认) 或 any
+ *     "conditions": [ { "device": "lsj_001", "tag": "LSJ_YTTemp_Status", "op": ">", "value": 35, "deadband": 2 } ]
+ *   }
+ * 只有一个条件时可以把 tag/op/value/deadband/bit 直接写在规则中，条件的写法见 TagCondition。
+ * 数字IO按组发布，用 bit 选取其中一个IO点，如 { "device": "zmotion_001", "tag": "input_bank", "bit": 3 }。
+ *
+ * 增量评估：标签到依赖它的条件建有索引，一个样本只查两次哈希表；没有规则依赖的标签
+ * 和数值未变的样本直接返回，只重新评估依赖变化标签的规则，可以跟随全速轮询运行。
+ * 所有函数都在界面线程中调用。
+ */
+class AlarmEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AlarmEngine(DataManager* dataManager, QObject *parent = nullptr);
+    ~AlarmEngine();
+
+    /**
+     * @brief 替换一个设备的全部规则。id 和定义都未变的规则保留当前状态，
+     *        被删除的活动报警发出 Cleared 事件
+     * @param deviceId 规则所属设备
+     * @param rules 设备配置中的 "alarms" 数组
+     * @param errors 无效规则的错误信息，无效规则被忽略
+     * @return 生效的规则数
+     */
+    int setDeviceRules(const QString& deviceId, const QJsonArray& rules, QStringList* errors = nullptr);
+
+    /**
+     * @brief 当前活动的报警
+     */
+    QList<AlarmEvent> activeAlarms() const;
+
+    /**
+     * @brief 设备上处于活动报警中的规则所依赖的标签
+     */
+    QSet<QString> alarmedTags(const QString& deviceId) const;
+
+    int ruleCount() const { return m_rules.size(); }
+
+public slots:
+    /**
+     * @brief 接收DataManager的数据更新
+     */
+    void onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value);
+
+    /**
+     * @brief 确认报警，锁存的报警在条件已恢复时随之消除
+     */
+    void acknowledge(const QString& deviceId, const QString& ruleId);
+    void acknowledgeAll();
+
+signals:
+    void alarmEvent(const AlarmEvent& event);
+
+    /**
+     * @brief 活动报警集合变化(产生、消除或确认)
+     */
+    void activeAlarmsChanged();
+
+private slots:
+    void onDebounceTimer();
+
+private:
+    enum Trigger { Level, Rising, Falling, Change };
+
+    struct Condition : TagCondition {
+        int slot = -1;      ///< 标签在 m_tags 中的下标
+    };
+
+    struct Rule {
+        QString id;
+        QString name;
+        QString deviceId;
+        QString severity;
+        QJsonObject definition;     ///< 原始定义，重新加载时判断规则是否变化
+        Trigger trigger;
+        bool combineAll;
+        bool latch;
+        int debounceMs;
+        QVector<Condition> conditions;
+        int known;          ///< 已收到数值的条件数，全部收到后才开始评估
+        bool primed;        ///< 是否已完成首次评估，边沿规则的首次评估只记录状态
+        bool raw;           ///< 条件组合的即时结果
+        bool condition;     ///< 去抖后的结果
+        bool active;        ///< 报警中
+        bool acknowledged;
+        qint64 pendingDeadline; ///< 去抖等待中的到期时间，-1表示没有等待
+        QVariant lastValue;
+    };
+
+    struct Tag {
+        QVariant value;
+        bool known;
+        QVector<QPair<int, int>> dependents;    ///< (规则下标, 条件下标)
+    };
+
+    static bool parseRule(const QJsonObject& object, const QString& deviceId, Rule* rule, QString* error);
+
+    /**
+     * @brief 按当前规则重建标签索引，标签的当前值从DataManager取
+     */
+    void rebuildIndex();
+    void evaluateRule(int ruleIndex, const QVariant& value);
+    void applyCondition(Rule& rule, bool condition);
+    void emitEvent(const Rule& rule, AlarmEvent::Type type);
+    void scheduleDebounce(int ruleIndex, qint64 deadline);
+
+    QVector<Rule> m_rules;
+    QVector<Tag> m_tags;
+    QHash<QString, QHash<QString, int>> m_tagIndex;    ///< 设备ID -> 标签key -> m_tags 下标
+    QMultiMap<qint64, int> m_debounceQueue;            ///< 到期时间 -> 规则下标
+    DataManager* m_dataManager;
+    QTimer* m_debounceTimer;
+    QElapsedTimer m_clock;
+};
+
+#endif // ALARMENGINE_H
@@ -0,0 +1,463 @@
+/**
+ * @file ConfigImage.cpp
+ * @brief ConfigImage类的实现
+ */
+#include "ConfigImage.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMap>
+#include <QModbusDataUnit>
+#include <QSet>
+#include <QVector>
+#include <cstring>
+
+namespace {
+
+const quint16 kNoBlock = 0xFFFF;
+
+quint32 align8(quint32 size)
+{
+    return (size + 7u) & ~7u;
+}
+
+bool isModbusProtocol(const QString& protocol)
+{
+    return protocol == "modbus_tcp" || protocol == "modbus_rtu";
+}
+
+QModbusDataUnit::RegisterType parseRegType(const QString& regType)
+{
+    if (regType == "coil") return QModbusDataUnit::Coils;
+    if (regType == "discrete_input") return QModbusDataUnit::DiscreteInputs;
+    if (regType == "input_register") return QModbusDataUnit::InputRegisters;
+    if (regType == "holding_register") return QModbusDataUnit::HoldingRegisters;
+    return QModbusDataUnit::Invalid;
+}
+
+int regCountForLength(int length)
+{
+    return (length == 64) ? 4 : (length == 32) ? 2 : 1;
+}
+
+bool isBitType(QModbusDataUnit::RegisterType type)
+{
+    return type == QModbusDataUnit::Coils || type == QModbusDataUnit::DiscreteInputs;
+}
+
+bool isIntegral(const QJsonValue& val)
+{
+    return val.isDouble() && val.toDouble() == static_cast<double>(val.toInt());
+}
+
+/**
+ * @brief 字符串表构建器，相同的字符串只存一份
+ */
+class StringTable
+{
+public:
+    ConfigImage::StringRef add(const QString& str)
+    {
+        const QByteArray utf8 = str.toUtf8();
+        auto it = m_index.constFind(utf8);
+        if (it != m_index.constEnd()) {
+            return it.value();
+        }
+        ConfigImage::StringRef ref;
+        ref.offset = static_cast<quint32>(m_data.size());
+        ref.size = static_cast<quint32>(utf8.size());
+        m_data.append(utf8);
+        m_index.insert(utf8, ref);
+        return ref;
+    }
+
+    const QByteArray& data() const { return m_data; }
+
+private:
+    QByteArray m_data;
+    QHash<QByteArray, ConfigImage::StringRef> m_index;
+};
+
+void validateEndpoint(const QJsonObject& config, const QString& section, QStringList& errors)
+{
+    const QJsonObject params = config[section].toObject();
+    if (params["ip_address"].toString().isEmpty()) {
+        errors << QString("%1.ip_address is missing").arg(section);
+    }
+    const int port = params["port"].toInt(-1);
+    if (port <= 0 || port > 65535) {
+        errors << QString("%1.port must be 1..65535").arg(section);
+    }
+}
+
+}
+
+ConfigImage::ConfigImage()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_header(nullptr)
+    , m_params(nullptr)
+    , m_blocks(nullptr)
+    , m_strings(nullptr)
+{
+}
+
+ConfigImage::~ConfigImage()
+{
+    if (m_file && m_data) {
+        m_file->unmap(const_cast<uchar*>(m_data));
+    }
+}
+
+QStringList ConfigImage::validate(const QJsonObject& config)
+{
+    QStringList errors;
+    if (config["device_id"].toString().isEmpty()) {
+        errors << "device_id is missing";
+    }
+    const QString protocol = config["protocol"].toString();
+    const bool modbus = isModbusProtocol(protocol);
+    if (protocol == "modbus_tcp" || protocol == "tcp_socket") {
+        validateEndpoint(config, "tcp_params", errors);
+    } else if (protocol == "modbus_rtu") {
+        // RTU从站可以直接挂在串口上，也可以经以太网转串口网关访问
+        const QString transport = config["rtu_params"].toObject()["transport"].toString("serial");
+        if (transport == "tcp_gateway") {
+            validateEndpoint(config, "tcp_params", errors);
+        } else if (transport != "serial") {
+            errors << QString("unknown rtu_params.transport '%1'").arg(transport);
+        } else if (config["rtu_params"].toObject()["port_name"].toString().isEmpty()) {
+            errors << "rtu_params.port_name is missing";
+        }
+    } else if (protocol.isEmpty()) {
+        // 其他协议由驱动插件提供，是否有对应驱动在创建设备时检查
+        errors << "protocol is missing";
+    }
+    if (modbus) {
+        const int server = config["server_address"].toInt(-1);
+        if (server < 0 || server > 255) {
+            errors << "server_address must be 0..255";
+        }
+    }
+    const int offset = config["modbus_offset"].toInt();
+
+    // 同一地址上的参数合并为一个读写块，块的类型、宽度和方向必须一致
+    struct Slot {
+        QModbusDataUnit::RegisterType type;
+        int regCount;
+        bool writable;
+        QString key;
+    };
+    QHash<int, Slot> shared;
+    QSet<QString> keys;
+
+    const QJsonArray registers = config["registers"].toArray();
+    for (int i = 0; i < registers.size(); ++i) {
+        const QJsonObject obj = registers.at(i).toObject();
+        const QString key = obj["key"].toString();
+        const QString where = QString("registers[%1]%2").arg(i).arg(key.isEmpty() ? QString() : " (" + key + ")");
+        if (key.isEmpty()) {
+            errors << where + ": key is missing";
+        } else if (keys.contains(key)) {
+            errors << where + ": duplicate key";
+        }
+        keys.insert(key);
+
+        const QString access = obj["access"].toString();
+        if (access != "read" && access != "write" && access != "read_write") {
+            errors << where + QString(": access must be read, write or read_write, got '%1'").arg(access);
+        }
+        const bool writable = access.contains("write");
+
+        if (protocol == "tcp_socket" && obj["command"].toString().isEmpty()) {
+            errors << where + ": command is missing";
+        }
+        if (!modbus) {
+            continue;
+        }
+
+        const QModbusDataUnit::RegisterType type = parseRegType(obj["regtype"].toString());
+        if (type == QModbusDataUnit::Invalid) {
+            errors << where + QString(": unknown regtype '%1'").arg(obj["regtype"].toString());
+            continue;
+        }
+        if (!isIntegral(obj["address"]) || !isIntegral(obj["length"]) || !isIntegral(obj["bitpos"])) {
+            errors << where + ": address, length and bitpos must be integers";
+            continue;
+        }
+        const int length = obj["length"].toInt();
+        const int bitpos = obj["bitpos"].toInt();
+        const int address = obj["address"].toInt() + offset;
+        const int regCount = regCountForLength(length);
+        if (isBitType(type)) {
+            if (length != 1 || bitpos != 0) {
+                errors << where + ": coils and discrete inputs need length 1 and bitpos 0";
+            }
+        } else if (!((length >= 1 && length <= 16) || length == 32 || length == 64)) {
+            errors << where + QString(": length %1 is not 1..16, 32 or 64").arg(length);
+        } else if (bitpos < 0 || bitpos + length > qMax(16, length)) {
+            errors << where + QString(": bitpos %1 + length %2 exceeds the register").arg(bitpos).arg(length);
+        }
+        if (address < 0 || address + regCount - 1 > 65535) {
+            errors << where + QString(": address %1 (with modbus_offset) is out of range").arg(address);
+        }
+        if (writable && (type == QModbusDataUnit::DiscreteInputs || type == QModbusDataUnit::InputRegisters)) {
+            errors << where + ": input registers and discrete inputs cannot be written";
+        }
+
+        auto it = shared.constFind(address);
+        if (it == shared.constEnd()) {
+            shared.insert(address, Slot{type, regCount, writable, key});
+        } else if (it->type != type || it->regCount != regCount || it->writable != writable) {
+            errors << where + QString(": address %1 is shared with %2 but regtype, width or access differ")
+                              .arg(address).arg(it->key);
+        }
+    }
+    return errors;
+}
+
+QByteArray ConfigImage::compile(const QJsonObject& config, const QByteArray& source, QStringList* errors)
+{
+    const QStringList problems = validate(config);
+    if (errors) {
+        *errors = problems;
+    }
+    if (!problems.isEmpty()) {
+        return QByteArray();
+    }
+
+    const bool modbus = isModbusProtocol(config["protocol"].toString());
+    const int offset = config["modbus_offset"].toInt();
+    const QJsonArray registers = config["registers"].toArray();
+
+    // Modbus设备的参数按块(地址)排序，块内保持配置顺序
+    QVector<int> order;
+    order.reserve(registers.size());
+    QMap<int, QVector<int>> byAddress;
+    if (modbus) {
+        for (int i = 0; i < registers.size(); ++i) {
+            byAddress[registers.at(i).toObject()["address"].toInt() + offset].append(i);
+        }
+        for (const QVector<int>& indices : byAddress) {
+            order += indices;
+        }
+    } else {
+        for (int i = 0; i < registers.size(); ++i) {
+            order.append(i);
+        }
+    }
+
+    StringTable strings;
+    QVector<Param> params;
+    QVector<Block> blocks;
+    params.reserve(order.size());
+    for (int i : order) {
+        const QJsonObject obj = registers.at(i).toObject();
+        Param p;
+        std::memset(&p, 0, sizeof(p));
+        p.rawAddress = static_cast<quint16>(obj["address"].toInt());
+        p.address = static_cast<quint16>(obj["address"].toInt() + offset);
+        p.length = static_cast<quint16>(obj["length"].toInt());
+        p.bitpos = static_cast<quint16>(obj["bitpos"].toInt());
+        p.regType = static_cast<quint8>(parseRegType(obj["regtype"].toString()));
+        p.flags = obj["access"].toString().contains("write") ? Writable : 0;
+        p.block = kNoBlock;
+        p.key = strings.add(obj["key"].toString());
+        p.name = strings.add(obj["name"].toString());
+        p.access = strings.add(obj["access"].toString());
+        p.command = strings.add(obj["command"].toString());
+
+        if (modbus) {
+            if (blocks.isEmpty() || blocks.last().address != p.address) {
+                Block b;
+                std::memset(&b, 0, sizeof(b));
+                b.address = p.address;
+                b.regCount = static_cast<quint16>(regCountForLength(p.length));
+                b.regType = p.regType;
+                b.isRead = (p.flags & Writable) ? 0 : 1;
+                b.firstParam = static_cast<quint32>(params.size());
+                blocks.append(b);
+            }
+            ++blocks.last().paramCount;
+            p.block = static_cast<quint16>(blocks.size() - 1);
+        }
+        params.append(p);
+    }
+
+    QJsonObject settings = config;
+    settings.remove("registers");
+    const QByteArray settingsJson = QJsonDocument(settings).toJson(QJsonDocument::Compact);
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = kMagic;
+    header.version = kVersion;
+    header.sourceSize = static_cast<quint32>(source.size());
+    header.sourceDigest = source.isEmpty() ? 0 : sourceDigest(source);
+    header.settingsOffset = align8(sizeof(Header));
+    header.settingsSize = static_cast<quint32>(settingsJson.size());
+    header.paramsOffset = align8(header.settingsOffset + header.settingsSize);
+    header.paramCount = static_cast<quint32>(params.size());
+    header.blocksOffset = align8(header.paramsOffset + header.paramCount * sizeof(Param));
+    header.blockCount = static_cast<quint32>(blocks.size());
+    header.stringsOffset = align8(header.blocksOffset + header.blockCount * sizeof(Block));
+    header.stringsSize = static_cast<quint32>(strings.data().size());
+    header.totalSize = header.stringsOffset + header.stringsSize;
+
+    QByteArray image(static_cast<int>(header.totalSize), '\0');
+    char* out = image.data();
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + header.settingsOffset, settingsJson.constData(), header.settingsSize);
+    if (!params.isEmpty()) {
+        std::memcpy(out + header.paramsOffset, params.constData(), params.size() * sizeof(Param));
+    }
+    if (!blocks.isEmpty()) {
+        std::memcpy(out + header.blocksOffset, blocks.constData(), blocks.size() * sizeof(Block));
+    }
+    std::memcpy(out + header.stringsOffset, strings.data().constData(), header.stringsSize);
+    return image;
+}
+
+QSharedPointer<const ConfigImage> ConfigImage::open(const QString& path, QString* error)
+{
+    QSharedPointer<ConfigImage> image(new ConfigImage);
+    image->m_file.reset(new QFile(path));
+    if (!image->m_file->open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = image->m_file->errorString();
+        }
+        return QSharedPointer<const ConfigImage>();
+    }
+    const qint64 size = image->m_file->size();
+    const uchar* data = size > 0 ? image->m_file->map(0, size) : nullptr;
+    if (!data) {
+        // 不支持映射的文件系统上退回到读入内存
+        image->m_owned = image->m_file->readAll();
+        image->m_file.reset();
+        data = reinterpret_cast<const uchar*>(image->m_owned.constData());
+    }
+    if (!image->attach(data, size, error)) {
+        return QSharedPointer<const ConfigImage>();
+    }
+    return image;
+}
+
+QSharedPointer<const ConfigImage> ConfigImage::fromData(const QByteArray& data, QString* error)
+{
+    QSharedPointer<ConfigImage> image(new ConfigImage);
+    image->m_owned = data;
+    if (!image->attach(reinterpret_cast<const uchar*>(image->m_owned.constData()), image->m_owned.size(), error)) {
+        return QSharedPointer<const ConfigImage>();
+    }
+    return image;
+}
+
+QSharedPointer<const ConfigImage> ConfigImage::fromConfig(const QJsonObject& config, QStringList* errors)
+{
+    const QByteArray data = compile(config, QByteArray(), errors);
+    if (data.isEmpty()) {
+        return QSharedPointer<const ConfigImage>();
+    }
+    return fromData(data);
+}
+
+QString ConfigImage::imagePath(const QString& jsonPath)
+{
+    const QFileInfo info(jsonPath);
+    return info.dir().filePath(info.completeBaseName() + ".dcimg");
+}
+
+quint64 ConfigImage::sourceDigest(const QByteArray& source)
+{
+    // FNV-1a 64位
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    const uchar* p = reinterpret_cast<const uchar*>(source.constData());
+    for (int i = 0; i < source.size(); ++i) {
+        hash ^= p[i];
+        hash *= Q_UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+bool ConfigImage::matchesSource(const QByteArray& source) const
+{
+    return m_header->sourceSize == static_cast<quint32>(source.size())
+           && m_header->sourceDigest == sourceDigest(source);
+}
+
+QJsonObject ConfigImage::settings() const
+{
+    const QByteArray json = QByteArray::fromRawData(reinterpret_cast<const char*>(m_data) + m_header->settingsOffset,
+                                                    static_cast<int>(m_header->settingsSize));
+    return QJsonDocument::fromJson(json).object();
+}
+
+QString ConfigImage::string(const StringRef& ref) const
+{
+    return QString::fromUtf8(m_strings + ref.offset, static_cast<int>(ref.size));
+}
+
+QByteArray ConfigImage::bytes(const StringRef& ref) const
+{
+    return QByteArray::fromRawData(m_strings + ref.offset, static_cast<int>(ref.size));
+}
+
+bool ConfigImage::attach(const uchar* data, qint64 size, QString* error)
+{
+    auto fail = [error](const QString& reason) {
+        if (error) {
+            *error = reason;
+        }
+        return false;
+    };
+
+    if (!data || size < static_cast<qint64>(sizeof(Header))) {
+        return fail("image too small");
+    }
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (header->magic != kMagic) {
+        return fail("not a config image");
+    }
+    if (header->version != kVersion) {
+        return fail(QString("image version %1, expected %2").arg(header->version).arg(kVersion));
+    }
+    if (static_cast<qint64>(header->totalSize) != size) {
+        return fail("image size mismatch");
+    }
+    const auto within = [size](quint64 offset, quint64 bytes) { return offset + bytes <= quint64(size); };
+    if (!within(header->settingsOffset, header->settingsSize)
+        || !within(header->paramsOffset, quint64(header->paramCount) * sizeof(Param))
+        || !within(header->blocksOffset, quint64(header->blockCount) * sizeof(Block))
+        || !within(header->stringsOffset, header->stringsSize)
+        || header->paramsOffset % 4 || header->blocksOffset % 4) {
+        return fail("image sections out of range");
+    }
+
+    const Param* params = reinterpret_cast<const Param*>(data + header->paramsOffset);
+    const Block* blocks = reinterpret_cast<const Block*>(data + header->blocksOffset);
+    // 一次性检查全部引用，之后的访问不再做边界检查
+    const auto refOk = [header](const StringRef& ref) { return quint64(ref.offset) + ref.size <= header->stringsSize; };
+    for (quint32 i = 0; i < header->paramCount; ++i) {
+        const Param& p = params[i];
+        if (!refOk(p.key) || !refOk(p.name) || !refOk(p.access) || !refOk(p.command)
+            || (p.block != kNoBlock && p.block >= header->blockCount)) {
+            return fail(QString("param %1 is corrupt").arg(i));
+        }
+    }
+    for (quint32 i = 0; i < header->blockCount; ++i) {
+        if (quint64(blocks[i].firstParam) + blocks[i].paramCount > header->paramCount) {
+            return fail(QString("block %1 is corrupt").arg(i));
+        }
+    }
+
+    m_data = data;
+    m_size = size;
+    m_header = header;
+    m_params = params;
+    m_blocks = blocks;
+    m_strings = reinterpret_cast<const char*>(data + header->stringsOffset);
+    return true;
+}
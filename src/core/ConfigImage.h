@@ -0,0 +1,165 @@
+#ifndef CONFIGIMAGE_H
+#define CONFIGIMAGE_H
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QMetaType>
+#include <QScopedPointer>
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+
+class QFile;
+
+/**
+ * @brief 编译后的设备配置镜像
+ *
+ * 设备JSON经过校验后编译为紧凑的二进制镜像：参数表已解析偏移和寄存器类型，
+ * 读写块(轮询计划)已按地址分组，字符串集中存放在字符串表中。镜像文件以只读方式
+ * 映射到内存，启动时不再解析 registers，设备初始化和界面建表直接读取定长记录。
+ *
+ * 文件布局(小端，各段4字节对齐):
+ *   Header | 设置JSON(配置中除registers外的部分) | Param[] | Block[] | 字符串表
+ *
+ * 镜像记录了源JSON的长度和摘要，源文件修改后 matchesSource() 返回false，需重新编译。
+ */
+class ConfigImage
+{
+public:
+    static const quint32 kMagic = 0x4D494344;   ///< "DCIM"
+    static const quint32 kVersion = 1;
+
+    enum ParamFlag {
+        Writable = 0x01
+    };
+
+    /// 字符串表中的一个UTF-8字符串
+    struct StringRef {
+        quint32 offset;
+        quint32 size;
+    };
+
+    /// 一个参数的解码信息
+    struct Param {
+        quint16 address;        ///< 已加上 modbus_offset 的寄存器地址
+        quint16 rawAddress;     ///< 配置中的原始地址，界面显示用
+        quint16 length;         ///< 位长度
+        quint16 bitpos;         ///< 位偏移
+        quint8 regType;         ///< QModbusDataUnit::RegisterType
+        quint8 flags;           ///< ParamFlag
+        quint16 block;          ///< 所属 Block 下标，非Modbus设备为0xFFFF
+        StringRef key;
+        StringRef name;
+        StringRef access;
+        StringRef command;      ///< tcp_socket 设备的协议命令字
+    };
+
+    /// 一个读写块：同一地址上的参数合并为一次请求
+    struct Block {
+        quint16 address;
+        quint16 regCount;
+        quint8 regType;
+        quint8 isRead;
+        quint16 reserved;
+        quint32 firstParam;     ///< 块内参数在 Param[] 中连续存放
+        quint32 paramCount;
+    };
+
+    struct Header {
+        quint32 magic;
+        quint32 version;
+        quint32 totalSize;
+        quint32 sourceSize;     ///< 源JSON字节数
+        quint64 sourceDigest;   ///< 源JSON的FNV-1a摘要
+        quint32 settingsOffset;
+        quint32 settingsSize;
+        quint32 paramsOffset;
+        quint32 paramCount;
+        quint32 blocksOffset;
+        quint32 blockCount;
+        quint32 stringsOffset;
+        quint32 stringsSize;
+    };
+
+    ~ConfigImage();
+
+    /**
+     * @brief 按设备协议校验配置
+     * @return 错误列表，为空表示配置有效
+     */
+    static QStringList validate(const QJsonObject& config);
+
+    /**
+     * @brief 校验并编译配置
+     * @param config 设备配置
+     * @param source 源JSON文件内容，用于记录摘要；为空时镜像不与文件关联
+     * @param errors 校验失败时的错误列表
+     * @return 镜像数据，校验失败时为空
+     */
+    static QByteArray compile(const QJsonObject& config, const QByteArray& source, QStringList* errors = nullptr);
+
+    /**
+     * @brief 以只读内存映射方式打开镜像文件
+     */
+    static QSharedPointer<const ConfigImage> open(const QString& path, QString* error = nullptr);
+
+    /**
+     * @brief 使用内存中的镜像数据
+     */
+    static QSharedPointer<const ConfigImage> fromData(const QByteArray& image, QString* error = nullptr);
+
+    /**
+     * @brief 直接从配置编译出内存镜像，用于没有预编译镜像的场合
+     */
+    static QSharedPointer<const ConfigImage> fromConfig(const QJsonObject& config, QStringList* errors = nullptr);
+
+    /**
+     * @brief 源JSON对应的镜像文件路径(同目录，扩展名 .dcimg)
+     */
+    static QString imagePath(const QString& jsonPath);
+
+    static quint64 sourceDigest(const QByteArray& source);
+
+    /**
+     * @brief 镜像是否由给定内容的源JSON编译而来
+     */
+    bool matchesSource(const QByteArray& source) const;
+
+    /**
+     * @brief 配置中除 registers 外的部分(连接参数、协议参数等)，只在初始化时使用
+     */
+    QJsonObject settings() const;
+
+    int paramCount() const { return static_cast<int>(m_header->paramCount); }
+    const Param& param(int index) const { return m_params[index]; }
+    int blockCount() const { return static_cast<int>(m_header->blockCount); }
+    const Block& block(int index) const { return m_blocks[index]; }
+
+    /**
+     * @brief 复制字符串表中的字符串
+     */
+    QString string(const StringRef& ref) const;
+
+    /**
+     * @brief 不复制地引用字符串表中的字节，生命周期不超过镜像对象
+     */
+    QByteArray bytes(const StringRef& ref) const;
+
+private:
+    ConfigImage();
+    bool attach(const uchar* data, qint64 size, QString* error);
+
+    QByteArray m_owned;             ///< fromData/fromConfig 时持有镜像数据
+    QScopedPointer<QFile> m_file;   ///< open 时持有映射的文件
+    const uchar* m_data;
+    qint64 m_size;
+    const Header* m_header;
+    const Param* m_params;
+    const Block* m_blocks;
+    const char* m_strings;
+};
+
+// 热加载时镜像通过排队调用传给设备线程
+Q_DECLARE_METATYPE(QSharedPointer<const ConfigImage>)
+
+#endif // CONFIGIMAGE_H
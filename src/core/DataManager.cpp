@@ -37,4 +37,26 @@ QMap<QString, QMap<QString, QVariant>> DataManager::getAllData() const
 {
     QReadLocker locker(&m_lock);
     return m_data;
-}
\ No newline at end of file
+}
+
+void DataManager::setDeviceStale(const QString& deviceId, bool stale)
+{
+    {
+        QWriteLocker locker(&m_lock);
+        if (m_staleDevices.contains(deviceId) == stale) {
+            return;
+        }
+        if (stale) {
+            m_staleDevices.insert(deviceId);
+        } else {
+            m_staleDevices.remove(deviceId);
+        }
+    }
+    emit deviceStaleChanged(deviceId, stale);
+}
+
+bool DataManager::isDeviceStale(const QString& deviceId) const
+{
+    QReadLocker locker(&m_lock);
+    return m_staleDevices.contains(deviceId);
+}
@@ -6,6 +6,7 @@
 #include <QString>
 #include <QVariant>
 #include <QReadWriteLock>
+#include <QSet>
 
 /**
  * @brief 数据管理器类，管理来自设备的所有数据
@@ -51,6 +52,18 @@ public:
      */
     QMap<QString, QMap<QString, QVariant>> getAllData() const;
 
+    /**
+     * @brief 设置设备数据是否过期。设备断开期间其全部数据保留最后的值，但标记为过期
+     * @param deviceId 设备的ID
+     * @param stale 是否过期
+     */
+    void setDeviceStale(const QString& deviceId, bool stale);
+
+    /**
+     * @brief 返回设备数据是否过期
+     */
+    bool isDeviceStale(const QString& deviceId) const;
+
 signals:
     /**
      * @brief 数据更新时发出此信号
@@ -60,8 +73,16 @@ signals:
      */
     void dataUpdated(const QString& deviceId, const QString& key, const QVariant& value);
 
+    /**
+     * @brief 设备数据过期状态变化时发出此信号
+     * @param deviceId 设备的ID
+     * @param stale 是否过期
+     */
+    void deviceStaleChanged(const QString& deviceId, bool stale);
+
 private:
     QMap<QString, QMap<QString, QVariant>> m_data; ///< 来自所有设备的数据
+    QSet<QString> m_staleDevices;                   ///< 数据已过期(断开连接)的设备
     mutable QReadWriteLock m_lock;                  ///< 用于保护数据访问的读写锁
 };
 
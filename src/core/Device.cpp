@@ -1,15 +1,49 @@
 ﻿#include "Device.h"
+#include <QTimer>
+#include <QRandomGenerator>
+#include <QtMath>
+#include <QDebug>
+#include <QEvent>
+#include <QCoreApplication>
 
 /**
  * @file Device.cpp
  * @brief Device类的实现
  */
 
+namespace {
+
+// 优先写入事件，以 Qt::HighEventPriority 投递到设备线程
+class PriorityWriteEvent : public QEvent
+{
+public:
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = static_cast<QEvent::Type>(QEvent::registerEventType());
+        return type;
+    }
+
+    PriorityWriteEvent(const QString& key, const QString& value, qint64 triggerNs)
+        : QEvent(eventType()), key(key), value(value), triggerNs(triggerNs) {}
+
+    const QString key;
+    const QString value;
+    const qint64 triggerNs;
+};
+
+}
+
  Device::Device(const QString& id, const QString& name, QObject *parent)
      : QObject(parent)
      , m_deviceId(id)
      , m_deviceName(name)
      , m_connected(false)
+     , m_reconnectPolicyLoaded(false)
+     , m_autoReconnect(true)
+     , m_breakerOpen(false)
+     , m_reconnectFailures(0)
+     , m_connectedSinceNs(-1)
+     , m_reconnectTimer(nullptr)
  {
  }
  
@@ -27,6 +61,37 @@
      return m_deviceId;
  }
  
+ QString Device::threadGroup() const
+ {
+     return QString();
+ }
+
+ void Device::postPriorityWrite(Device* device, const QString& key, const QString& value, qint64 triggerNs)
+ {
+     QCoreApplication::postEvent(device, new PriorityWriteEvent(key, value, triggerNs), Qt::HighEventPriority);
+ }
+
+ bool Device::event(QEvent* event)
+ {
+     if (event->type() == PriorityWriteEvent::eventType()) {
+         const PriorityWriteEvent* write = static_cast<const PriorityWriteEvent*>(event);
+         writePriority(write->key, write->value, write->triggerNs);
+         return true;
+     }
+     return QObject::event(event);
+ }
+
+ void Device::writePriority(const QString& key, const QString& value, qint64 triggerNs)
+ {
+     if (!isConnected()) {
+         m_metrics.recordReactionFailure();
+         emit sig_printLog(QString("Priority write %1=%2 dropped: not connected").arg(key).arg(value).toUtf8(), true);
+         return;
+     }
+     writeData2Device(key, value);
+     m_metrics.recordReaction(triggerNs);
+ }
+
  QString Device::deviceName() const
  {
      return m_deviceName;
@@ -36,11 +101,218 @@
  {
      return m_connected;
  }
+
+ const DeviceMetrics& Device::metrics() const
+ {
+     return m_metrics;
+ }
+
+ QSharedPointer<const ConfigImage> Device::configImage() const
+ {
+     QMutexLocker locker(&m_configImageMutex);
+     return m_configImage;
+ }
  
  void Device::setConnected(bool connected)
  {
      if (m_connected != connected) {
          m_connected = connected;
+         if (connected) {
+             // 连接成功不立即复位退避和断路器，连接持续 stableMs 后才算恢复，见断开时的判断
+             m_connectedSinceNs = DeviceMetrics::monotonicNs();
+             if (m_reconnectTimer) {
+                 m_reconnectTimer->stop();
+             }
+         } else if (m_connectedSinceNs >= 0) {
+             loadReconnectPolicy();
+             const qint64 upMs = (DeviceMetrics::monotonicNs() - m_connectedSinceNs) / 1000000;
+             m_connectedSinceNs = -1;
+             if (upMs >= m_reconnectPolicy.stableMs) {
+                 m_reconnectFailures = 0;
+                 m_breakerOpen = false;
+             } else {
+                 // 连上后很快又断开(如设备接受连接后立即复位)，按一次失败计入退避
+                 ++m_reconnectFailures;
+                 emit sig_printLog(QString("Connection lost after %1 ms (< stableMs %2), counted as failure %3")
+                                   .arg(upMs).arg(m_reconnectPolicy.stableMs).arg(m_reconnectFailures).toUtf8(), false);
+             }
+         }
          emit connectedChanged(m_deviceId, m_connected);
+         if (!connected) {
+             scheduleReconnect();
+         }
+     }
+ }
+
+ void Device::connectAttemptFailed(const QString& reason)
+ {
+     ++m_reconnectFailures;
+     emit sig_printLog(QString("Connect attempt %1 failed: %2").arg(m_reconnectFailures).arg(reason).toUtf8(), false);
+     scheduleReconnect();
+ }
+
+ void Device::reconnectNow()
+ {
+     m_reconnectFailures = 0;
+     m_breakerOpen = false;
+     if (m_reconnectTimer) {
+         m_reconnectTimer->stop();
+     }
+     attemptConnect();
+ }
+
+ void Device::setAutoReconnect(bool enabled)
+ {
+     m_autoReconnect = enabled;
+     if (!enabled && m_reconnectTimer) {
+         m_reconnectTimer->stop();
      }
  }
+
+ void Device::resetMetrics()
+ {
+     m_metrics.reset();
+ }
+
+ void Device::reloadConfig(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image)
+ {
+     QString reason;
+     QSharedPointer<const ConfigImage> newImage = image;
+     if (config["device_id"].toString() != m_deviceId) {
+         reason = "device_id changed, restart the service to apply";
+     } else if (config["protocol"].toString() != getConfig()["protocol"].toString()
+                || config["model"].toString() != getConfig()["model"].toString()) {
+         reason = "protocol or model changed, restart the service to apply";
+     } else if (!newImage) {
+         QStringList errors;
+         newImage = ConfigImage::fromConfig(config, &errors);
+         if (!newImage) {
+             reason = errors.isEmpty() ? QString("invalid config") : errors.join("; ");
+         } else {
+             for (const QString& error : errors) {
+                 qWarning() << "Device" << m_deviceId << "config:" << error;
+             }
+         }
+     }
+
+     QString summary;
+     if (!newImage || !reason.isEmpty() || !applyConfig(config, *newImage, &summary)) {
+         if (reason.isEmpty()) {
+             reason = summary;
+         }
+         qWarning() << "Device" << m_deviceId << "config reload rejected:" << reason;
+         emit sig_printLog(QString("Config reload rejected: %1").arg(reason).toUtf8(), false);
+         return;
+     }
+
+     {
+         QMutexLocker locker(&m_configImageMutex);
+         m_configImage = newImage;
+     }
+     // 重连策略随配置更新，下次使用时重新读取
+     m_reconnectPolicy = ReconnectPolicy();
+     m_reconnectPolicyLoaded = false;
+
+     emit sig_printLog(QString("Config reloaded: %1").arg(summary).toUtf8(), false);
+     emit configReloaded(m_deviceId);
+ }
+
+ bool Device::applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary)
+ {
+     Q_UNUSED(config);
+     Q_UNUSED(image);
+     if (summary) {
+         *summary = "hot reload is not supported by this device type, restart the service to apply";
+     }
+     return false;
+ }
+
+ void Device::onReconnectTimer()
+ {
+     if (m_connected || !m_autoReconnect) {
+         return;
+     }
+     attemptConnect();
+ }
+
+ void Device::attemptConnect()
+ {
+     if (connectDevice()) {
+         // 异步连接的结果由子类稍后通过 setConnected/connectAttemptFailed 报告。
+         // connectDevice 内部先断开旧连接时可能已安排了一次重连，这里取消
+         if (m_reconnectTimer) {
+             m_reconnectTimer->stop();
+         }
+     } else if (!m_reconnectTimer || !m_reconnectTimer->isActive()) {
+         // 子类没有报告失败原因时按一次普通失败处理
+         connectAttemptFailed("connectDevice returned false");
+     }
+ }
+
+ void Device::attachConfigImage(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image)
+ {
+     QMutexLocker locker(&m_configImageMutex);
+     if (image) {
+         m_configImage = image;
+         return;
+     }
+     QStringList errors;
+     m_configImage = ConfigImage::fromConfig(config, &errors);
+     for (const QString& error : errors) {
+         qWarning() << "Device" << m_deviceId << "config:" << error;
+     }
+ }
+
+ void Device::loadReconnectPolicy()
+ {
+     if (m_reconnectPolicyLoaded) {
+         return;
+     }
+     m_reconnectPolicyLoaded = true;
+
+     QJsonObject reconnect = getConfig()["reconnect"].toObject();
+     m_reconnectPolicy.enabled = reconnect["enabled"].toBool(m_reconnectPolicy.enabled);
+     m_reconnectPolicy.initialDelayMs = reconnect["initialDelayMs"].toInt(m_reconnectPolicy.initialDelayMs);
+     m_reconnectPolicy.maxDelayMs = reconnect["maxDelayMs"].toInt(m_reconnectPolicy.maxDelayMs);
+     m_reconnectPolicy.multiplier = qMax(1.0, reconnect["multiplier"].toDouble(m_reconnectPolicy.multiplier));
+     m_reconnectPolicy.jitter = qBound(0.0, reconnect["jitter"].toDouble(m_reconnectPolicy.jitter), 1.0);
+     m_reconnectPolicy.breakerThreshold = reconnect["breakerThreshold"].toInt(m_reconnectPolicy.breakerThreshold);
+     m_reconnectPolicy.breakerCooldownMs = reconnect["breakerCooldownMs"].toInt(m_reconnectPolicy.breakerCooldownMs);
+     m_reconnectPolicy.stableMs = qMax(0, reconnect["stableMs"].toInt(m_reconnectPolicy.stableMs));
+ }
+
+ void Device::scheduleReconnect()
+ {
+     loadReconnectPolicy();
+     if (!m_autoReconnect || !m_reconnectPolicy.enabled) {
+         return;
+     }
+     if (!m_reconnectTimer) {
+         m_reconnectTimer = new QTimer(this);
+         m_reconnectTimer->setSingleShot(true);
+         connect(m_reconnectTimer, &QTimer::timeout, this, &Device::onReconnectTimer);
+     }
+     if (m_reconnectTimer->isActive()) {
+         return;
+     }
+
+     int delayMs;
+     if (m_reconnectPolicy.breakerThreshold > 0 && m_reconnectFailures >= m_reconnectPolicy.breakerThreshold) {
+         // 断路器打开：连续失败过多，不再按退避频繁重试，只在冷却时间后试探一次
+         if (!m_breakerOpen) {
+             m_breakerOpen = true;
+             emit sig_printLog(QString("Reconnect circuit breaker open after %1 failures, next attempt in %2 s")
+                               .arg(m_reconnectFailures).arg(m_reconnectPolicy.breakerCooldownMs / 1000).toUtf8(), false);
+         }
+         delayMs = m_reconnectPolicy.breakerCooldownMs;
+     } else {
+         // 指数退避，等待时间在 [1-jitter, 1+jitter] 倍之间随机浮动
+         double base = m_reconnectPolicy.initialDelayMs * qPow(m_reconnectPolicy.multiplier, m_reconnectFailures);
+         base = qMin(base, static_cast<double>(m_reconnectPolicy.maxDelayMs));
+         double factor = 1.0 + m_reconnectPolicy.jitter * (2.0 * QRandomGenerator::global()->generateDouble() - 1.0);
+         delayMs = qMax(0, static_cast<int>(base * factor));
+     }
+
+     m_reconnectTimer->start(delayMs);
+     emit reconnectScheduled(m_deviceId, m_reconnectFailures + 1, delayMs, m_breakerOpen);
+ }
@@ -4,6 +4,13 @@
 #include <QObject>
 #include <QString>
 #include <QJsonObject>
+#include <QSharedPointer>
+#include <QMutex>
+#include "DeviceMetrics.h"
+#include "ConfigImage.h"
+
+class QTimer;
+class QEvent;
 
  /**
   * @brief 设备基类，所有设备的父类
@@ -35,6 +42,16 @@
       * @brief 如果设备已连接，则返回true
       */
      bool isConnected() const;
+
+     /**
+      * @brief 返回设备运行统计(事务延迟、错误、吞吐量等)，可在任意线程读取
+      */
+     const DeviceMetrics& metrics() const;
+
+     /**
+      * @brief 返回编译后的配置镜像，寄存器类设备以它建立读写计划，可能为空
+      */
+     QSharedPointer<const ConfigImage> configImage() const;
  
      /**
       * @brief 连接设备
@@ -50,6 +67,21 @@
       * @brief 返回设备的配置
       */
      virtual const QJsonObject& getConfig() const = 0;
+
+     /**
+      * @brief 线程分组。非空时同组设备共用一个工作线程(如同一条总线上的从站)，默认每个设备独占线程
+      */
+     virtual QString threadGroup() const;
+
+     /**
+      * @brief 投递一次优先写入，可在任意线程调用。写入以高优先级事件送到设备线程，
+      *        排在已排队的普通事件(轮询、界面写入等)之前执行
+      * @param device 目标设备
+      * @param key 数据的键
+      * @param value 要写入的值
+      * @param triggerNs 触发时的 DeviceMetrics::monotonicNs()，用于统计反应延迟
+      */
+     static void postPriorityWrite(Device* device, const QString& key, const QString& value, qint64 triggerNs);
  
  public slots:
     /**
@@ -84,6 +116,30 @@
       *        主要用于在程序退出前，安全地停止设备内部的定时器等资源。
       */
      virtual void stop() {}
+
+     /**
+      * @brief 立即重连：复位退避和断路器后调用 connectDevice()，用于手动重连
+      */
+     void reconnectNow();
+
+     /**
+      * @brief 启用或禁用自动重连。程序退出前应先禁用，避免停止设备时又安排重连
+      */
+     void setAutoReconnect(bool enabled);
+
+     /**
+      * @brief 清零运行统计，应在设备所属线程中调用(如 BlockingQueuedConnection)
+      */
+     void resetMetrics();
+
+     /**
+      * @brief 热加载配置，应在设备所属线程中调用(如 QueuedConnection)。
+      *        子类只重建变化的部分并原子地换用新配置，不重启线程、不断开连接。
+      *        协议或设备ID变化、子类不支持热加载时保留原配置并记录原因
+      * @param config 新配置
+      * @param image 新配置的镜像，为空时由 config 编译
+      */
+     void reloadConfig(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image);
  
  signals:
      /**
@@ -111,18 +167,97 @@
       * @param bytes 数据
       */
      void sig_printLog(const QByteArray &bytes, bool isWrite);
+
+     /**
+      * @brief 已安排下一次自动重连
+      * @param deviceId 设备的ID
+      * @param attempt 下一次是连续第几次尝试
+      * @param delayMs 距下一次尝试的时间(ms)
+      * @param breakerOpen 断路器是否已打开(连续失败过多，按冷却时间重试)
+      */
+     void reconnectScheduled(const QString& deviceId, int attempt, int delayMs, bool breakerOpen);
+
+     /**
+      * @brief 热加载成功，新的配置镜像已生效
+      * @param deviceId 设备的ID
+      */
+     void configReloaded(const QString& deviceId);
  
  protected:
+     DeviceMetrics m_metrics;   ///< 运行统计，由子类在设备线程中记录
+     QSharedPointer<const ConfigImage> m_configImage; ///< 配置镜像，构造时设置，热加载时在设备线程中替换
+
      /**
-      * @brief 设置设备的连接状态
+      * @brief 设置设备的连接状态。已连接变为断开时自动安排重连
       * @param connected 新的连接状态
       */
      void setConnected(bool connected);
+
+     /**
+      * @brief 一次连接尝试失败时由子类调用，按退避策略安排下一次重连
+      * @param reason 失败原因，用于日志
+      */
+     void connectAttemptFailed(const QString& reason);
+
+     /**
+      * @brief 设置配置镜像。未提供预编译镜像时由配置在内存中编译，配置无效时镜像为空
+      * @param config 设备配置
+      * @param image 预编译镜像，可为空
+      */
+     void attachConfigImage(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image);
+
+     /**
+      * @brief 在设备线程中应用新配置，由 reloadConfig() 调用。返回前 m_configImage 仍是旧镜像，
+      *        子类可据此比较新旧配置。默认不支持热加载
+      * @param config 新配置
+      * @param image 新配置的镜像
+      * @param summary 输出变化摘要，失败时为原因
+      * @return 已应用返回true；返回false时设备必须保持原配置不变
+      */
+     virtual bool applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary);
+
+     /**
+      * @brief 在设备线程中执行优先写入。子类应绕过轮询队列尽快下发，下发成功时调用
+      *        m_metrics.recordReaction(triggerNs)，未能下发时调用 m_metrics.recordReactionFailure()。
+      *        默认在已连接时调用 writeData2Device() 后即记为已下发，只适用于 writeData2Device() 同步下发的设备；
+      *        缓冲或排队发送的设备必须覆盖，在实际发出时记录
+      */
+     virtual void writePriority(const QString& key, const QString& value, qint64 triggerNs);
+
+     bool event(QEvent* event) override;
+
+ private slots:
+     void onReconnectTimer();
  
  private:
+     // 自动重连策略，来自配置中的 "reconnect" 对象
+     struct ReconnectPolicy {
+         bool enabled = true;
+         int initialDelayMs = 500;       ///< 第一次重连前的等待时间
+         int maxDelayMs = 30000;         ///< 退避等待时间上限
+         double multiplier = 2.0;        ///< 每次失败后等待时间的倍数
+         double jitter = 0.2;            ///< 等待时间随机浮动比例，避免多台设备同时重连
+         int breakerThreshold = 10;      ///< 连续失败达到该次数后打开断路器，0表示不启用
+         int breakerCooldownMs = 300000; ///< 断路器打开后的重试间隔
+         int stableMs = 5000;            ///< 连接持续该时间后才清零失败次数、关闭断路器，之前断开按失败计
+     };
+
+     void loadReconnectPolicy();
+     void scheduleReconnect();
+     void attemptConnect();
+
      QString m_deviceId;   ///< 设备的唯一标识符
      QString m_deviceName; ///< 设备的名称
      bool m_connected;    ///< 设备的连接状态
+
+     ReconnectPolicy m_reconnectPolicy;
+     bool m_reconnectPolicyLoaded;  ///< 策略在设备线程中首次使用时读取，构造时子类配置尚不可用
+     bool m_autoReconnect;          ///< 是否允许自动重连
+     bool m_breakerOpen;            ///< 断路器是否打开
+     int m_reconnectFailures;       ///< 连续失败次数，连接稳定 stableMs 后清零
+     qint64 m_connectedSinceNs;     ///< 本次连接建立的时刻(DeviceMetrics::monotonicNs)，未连接时为-1
+     QTimer* m_reconnectTimer;      ///< 重连定时器，首次使用时在设备线程中创建
+     mutable QMutex m_configImageMutex; ///< 保护界面线程读取 m_configImage 与热加载时的替换
  };
 
 #endif // DEVICE_H
@@ -0,0 +1,48 @@
+#ifndef DEVICEDRIVERPLUGIN_H
+#define DEVICEDRIVERPLUGIN_H
+
+#include <QtPlugin>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <QString>
+
+class Device;
+class ConfigImage;
+
+/**
+ * @brief 设备驱动插件接口
+ *
+ * 驱动以Qt插件(共享库)形式放在程序目录的 drivers/ 下，不需要重新编译主程序。
+ * 插件用 Q_PLUGIN_METADATA(IID DeviceDriverPlugin_iid FILE "driver.json") 声明它提供的驱动，
+ * 主程序启动时只读取元数据，某个驱动第一次被配置使用时才加载共享库：
+ *
+ *   {
+ *     "drivers": [
+ *       { "protocol": "modbus_tcp", "model": "fast_laser", "description": "..." },
+ *       { "protocol": "vendor_sdk", "default": true }
+ *     ]
+ *   }
+ *
+ * "default" 为true时，该驱动同时作为配置中未指定 model 的设备的默认驱动，可替换内置驱动。
+ */
+class DeviceDriverPlugin
+{
+public:
+    virtual ~DeviceDriverPlugin() {}
+
+    /**
+     * @brief 创建设备对象，在界面线程中调用，设备随后被移到自己的工作线程
+     * @param protocol 配置中的 protocol
+     * @param model 匹配到的元数据中的 model，默认驱动为空
+     * @param image 编译后的配置镜像，可能为空
+     * @return 设备对象，不支持时返回nullptr
+     */
+    virtual Device* createDevice(const QString& protocol, const QString& model,
+                                 const QString& id, const QString& name, const QJsonObject& config,
+                                 const QSharedPointer<const ConfigImage>& image) = 0;
+};
+
+#define DeviceDriverPlugin_iid "DeviceCtrlService.DeviceDriverPlugin/1.0"
+Q_DECLARE_INTERFACE(DeviceDriverPlugin, DeviceDriverPlugin_iid)
+
+#endif // DEVICEDRIVERPLUGIN_H
@@ -5,11 +5,9 @@
  */
 
 #include "Device.h"
+#include "DriverRegistry.h"
 #include <QThread>
-#include "devices/LSJDevice.h"
-#include "devices/JGQDevice.h"
-#include "devices/JGTDevice.h"
-#include "devices/ZMotionDevice.h"
+#include <QDebug>
 
 DeviceManager::DeviceManager(QObject *parent)
     : QObject(parent)
@@ -21,35 +19,24 @@ DeviceManager::~DeviceManager()
     qDeleteAll(m_devices);
 }
 
-bool DeviceManager::addDevice(const QJsonObject& config)
+bool DeviceManager::addDevice(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image)
 {
     QString id = config["device_id"].toString();
-    QString name = config["device_name"].toString();
-    QString protocol = config["protocol"].toString();
 
     if (id.isEmpty() || m_devices.contains(id)) {
         return false;
     }
 
-    Device* device = nullptr;
-    if (protocol == "modbus_rtu") {
-        device = new LSJDevice(id, name, config);
-    } else if (protocol == "modbus_tcp") {
-        device = new JGQDevice(id, name, config);
-    } else if (protocol == "tcp_socket") {
-        device = new JGTDevice(id, name, config);
-    } else if (protocol == "zmotion_api") {
-        device = new ZMotionDevice(id, name, config);
-    } else {
-        // TODO: Add support for other protocols
-    }
-
-    if (device) {
-        m_devices.insert(id, device);
-        return true;
+    // 按 protocol 和 model 由驱动注册表选择设备类，内置驱动和插件驱动一视同仁
+    QString error;
+    Device* device = DriverRegistry::instance().create(config, image, &error);
+    if (!device) {
+        qWarning() << "DeviceManager: cannot create device" << id << ":" << error;
+        return false;
     }
 
-    return false;
+    m_devices.insert(id, device);
+    return true;
 }
 
 void DeviceManager::removeDevice(const QString& id)
@@ -90,6 +77,8 @@ void DeviceManager::cleanup()
 
         QThread* thread = getDeviceThread(device->deviceId());
         if (thread && thread->isRunning()) {
+            // 先禁用自动重连，stop() 断开连接时不会再安排重连
+            QMetaObject::invokeMethod(device, "setAutoReconnect", Qt::BlockingQueuedConnection, Q_ARG(bool, false));
             // 使用阻塞连接，确保 stop() 在其所属线程执行完毕后才返回
             QMetaObject::invokeMethod(device, "stop", Qt::BlockingQueuedConnection);
         }
@@ -5,9 +5,11 @@
 #include <QMap>
 #include <QString>
 #include <QJsonObject>
+#include <QSharedPointer>
 
 class Device;
 class QThread;
+class ConfigImage;
 
 /**
  * @brief 设备管理器类，管理系统中的所有设备
@@ -32,9 +34,11 @@ public:
     /**
      * @brief 向系统添加一个新设备
      * @param config 设备的配置
+     * @param image 预编译的配置镜像，为空时设备自行由 config 编译
      * @return 如果设备添加成功，则返回true，否则返回false
      */
-    bool addDevice(const QJsonObject& config);
+    bool addDevice(const QJsonObject& config,
+                   const QSharedPointer<const ConfigImage>& image = QSharedPointer<const ConfigImage>());
 
     /**
      * @brief 从系统中移除一个设备
@@ -0,0 +1,385 @@
+/**
+ * @file DeviceMetrics.cpp
+ * @brief LatencyHistogram和DeviceMetrics类的实现
+ */
+#include "DeviceMetrics.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+int LatencyHistogram::bucketIndex(qint64 us)
+{
+    if (us < SubBuckets) {
+        return us < 0 ? 0 : static_cast<int>(us);
+    }
+    const int magnitude = 63 - static_cast<int>(qCountLeadingZeroBits(static_cast<quint64>(us)));
+    if (magnitude > MaxMagnitude) {
+        return BucketCount - 1;
+    }
+    const int sub = static_cast<int>((us >> (magnitude - SubBucketBits)) & (SubBuckets - 1));
+    return SubBuckets + (magnitude - SubBucketBits) * SubBuckets + sub;
+}
+
+qint64 LatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SubBuckets) {
+        return index;
+    }
+    const int magnitude = (index - SubBuckets) / SubBuckets + SubBucketBits;
+    const int sub = (index - SubBuckets) % SubBuckets;
+    const qint64 width = qint64(1) << (magnitude - SubBucketBits);
+    return (qint64(1) << magnitude) + sub * width + width - 1;
+}
+
+void LatencyHistogram::record(qint64 us)
+{
+    if (us < 0) {
+        us = 0;
+    }
+    m_buckets[bucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_sumUs.fetch_add(static_cast<quint64>(us), std::memory_order_relaxed);
+    qint64 prevMax = m_maxUs.load(std::memory_order_relaxed);
+    while (us > prevMax && !m_maxUs.compare_exchange_weak(prevMax, us, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (int i = 0; i < BucketCount; ++i) {
+        m_buckets[i].store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_sumUs.store(0, std::memory_order_relaxed);
+    m_maxUs.store(0, std::memory_order_relaxed);
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    // 桶计数与总数不是同一时刻读取，以桶计数之和为准
+    quint64 counts[BucketCount];
+    quint64 total = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    const quint64 rank = qMax<quint64>(1, static_cast<quint64>(p / 100.0 * total + 0.5));
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            return qMin(bucketUpperBound(i), m_maxUs.load(std::memory_order_relaxed));
+        }
+    }
+    return m_maxUs.load(std::memory_order_relaxed);
+}
+
+LatencyHistogram::Summary LatencyHistogram::summary() const
+{
+    Summary s;
+    s.count = m_count.load(std::memory_order_relaxed);
+    if (s.count == 0) {
+        return s;
+    }
+    s.meanUs = static_cast<double>(m_sumUs.load(std::memory_order_relaxed)) / s.count;
+    s.p50Us = percentile(50);
+    s.p90Us = percentile(90);
+    s.p99Us = percentile(99);
+    s.maxUs = m_maxUs.load(std::memory_order_relaxed);
+    return s;
+}
+
+RollingWindow::RollingWindow(int capacity)
+    : m_samples(new std::atomic<qint64>[capacity])
+    , m_capacity(capacity)
+    , m_written(0)
+{
+}
+
+void RollingWindow::record(qint64 us)
+{
+    const quint64 n = m_written.load(std::memory_order_relaxed);
+    m_samples[n % m_capacity].store(us < 0 ? 0 : us, std::memory_order_relaxed);
+    m_written.store(n + 1, std::memory_order_release);
+}
+
+void RollingWindow::reset()
+{
+    m_written.store(0, std::memory_order_release);
+}
+
+LatencyHistogram::Summary RollingWindow::summary() const
+{
+    LatencyHistogram::Summary s;
+    const quint64 written = m_written.load(std::memory_order_acquire);
+    const int n = static_cast<int>(qMin<quint64>(written, m_capacity));
+    if (n == 0) {
+        return s;
+    }
+
+    // 读取期间可能有新样本覆盖最旧的槽位，对统计结果影响可以忽略
+    std::vector<qint64> samples(n);
+    double sum = 0;
+    for (int i = 0; i < n; ++i) {
+        samples[i] = m_samples[i].load(std::memory_order_relaxed);
+        sum += samples[i];
+    }
+    std::sort(samples.begin(), samples.end());
+
+    auto at = [&](double p) { return samples[qMin(n - 1, static_cast<int>(p / 100.0 * n))]; };
+    s.count = n;
+    s.meanUs = sum / n;
+    s.p50Us = at(50);
+    s.p90Us = at(90);
+    s.p99Us = at(99);
+    s.maxUs = samples.back();
+    return s;
+}
+
+DeviceMetrics::DeviceMetrics()
+    : m_tagAge(DeviceWindow)
+    , m_tagInterval(DeviceWindow)
+    , m_tagJitter(DeviceWindow)
+    , m_blockCount(0)
+{
+    m_clock.start();
+    for (int i = 0; i < MaxBlocks; ++i) {
+        m_blocks[i] = nullptr;
+    }
+    reset();
+}
+
+DeviceMetrics::~DeviceMetrics()
+{
+    for (int i = 0; i < MaxBlocks; ++i) {
+        delete m_blocks[i];
+    }
+}
+
+int DeviceMetrics::addBlock(const QString& name)
+{
+    const int index = m_blockCount.load(std::memory_order_relaxed);
+    if (index >= MaxBlocks) {
+        return -1;
+    }
+    Block* block = new Block;
+    block->name = name;
+    m_blocks[index] = block;
+    m_blockCount.store(index + 1, std::memory_order_release);
+    return index;
+}
+
+void DeviceMetrics::addRequest(quint64 bytesOut)
+{
+    m_requests.fetch_add(1, std::memory_order_relaxed);
+    if (bytesOut > 0) {
+        m_bytesOut.fetch_add(bytesOut, std::memory_order_relaxed);
+    }
+}
+
+void DeviceMetrics::addBytesIn(quint64 bytes)
+{
+    m_bytesIn.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void DeviceMetrics::addBytesOut(quint64 bytes)
+{
+    m_bytesOut.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void DeviceMetrics::recordTransaction(int block, qint64 startNs, Outcome outcome)
+{
+    Block* b = (block >= 0 && block < m_blockCount.load(std::memory_order_acquire)) ? m_blocks[block] : nullptr;
+    switch (outcome) {
+    case Ok: {
+        const qint64 us = (nowNs() - startNs) / 1000;
+        m_replies.fetch_add(1, std::memory_order_relaxed);
+        m_latency.record(us);
+        if (b) {
+            b->latency.record(us);
+        }
+        return;
+    }
+    case Timeout:
+        m_timeouts.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case ProtocolError:
+        m_protocolErrors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    case CommError:
+        m_commErrors.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+    if (b) {
+        b->errors.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+qint64 DeviceMetrics::monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void DeviceMetrics::recordReaction(qint64 triggerNs)
+{
+    m_reaction.record((monotonicNs() - triggerNs) / 1000);
+}
+
+void DeviceMetrics::recordReactionFailure()
+{
+    m_reactionFailures.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DeviceMetrics::setQueueDepth(int depth)
+{
+    m_queueDepth.store(depth, std::memory_order_relaxed);
+    int prevMax = m_queueDepthMax.load(std::memory_order_relaxed);
+    while (depth > prevMax && !m_queueDepthMax.compare_exchange_weak(prevMax, depth, std::memory_order_relaxed)) {
+    }
+}
+
+void DeviceMetrics::recordScanCycle(qint64 durationNs)
+{
+    m_scanCycle.record(durationNs / 1000);
+}
+
+void DeviceMetrics::recordSample(int block, qint64 dueNs)
+{
+    if (block < 0 || block >= m_blockCount.load(std::memory_order_acquire)) {
+        return;
+    }
+    Block* b = m_blocks[block];
+    const qint64 now = nowNs();
+    const qint64 ageUs = (now - dueNs) / 1000;
+    b->age.record(ageUs);
+    m_tagAge.record(ageUs);
+
+    if (b->lastSampleNs >= 0) {
+        const qint64 interval = now - b->lastSampleNs;
+        b->interval.record(interval / 1000);
+        m_tagInterval.record(interval / 1000);
+        if (b->lastIntervalNs >= 0) {
+            const qint64 jitterUs = qAbs(interval - b->lastIntervalNs) / 1000;
+            b->jitter.record(jitterUs);
+            m_tagJitter.record(jitterUs);
+        }
+        b->lastIntervalNs = interval;
+    }
+    b->lastSampleNs = now;
+}
+
+DeviceMetrics::Snapshot DeviceMetrics::snapshot() const
+{
+    Snapshot s;
+    s.uptimeMs = m_clock.elapsed() - m_resetMs.load(std::memory_order_relaxed);
+    s.requests = m_requests.load(std::memory_order_relaxed);
+    s.replies = m_replies.load(std::memory_order_relaxed);
+    s.timeouts = m_timeouts.load(std::memory_order_relaxed);
+    s.protocolErrors = m_protocolErrors.load(std::memory_order_relaxed);
+    s.commErrors = m_commErrors.load(std::memory_order_relaxed);
+    s.bytesIn = m_bytesIn.load(std::memory_order_relaxed);
+    s.bytesOut = m_bytesOut.load(std::memory_order_relaxed);
+    s.queueDepth = m_queueDepth.load(std::memory_order_relaxed);
+    s.queueDepthMax = m_queueDepthMax.load(std::memory_order_relaxed);
+    s.latency = m_latency.summary();
+    s.scanCycle = m_scanCycle.summary();
+    s.tagAge = m_tagAge.summary();
+    s.tagInterval = m_tagInterval.summary();
+    s.tagJitter = m_tagJitter.summary();
+    s.reaction = m_reaction.summary();
+    s.reactionFailures = m_reactionFailures.load(std::memory_order_relaxed);
+
+    const int blockCount = m_blockCount.load(std::memory_order_acquire);
+    s.blocks.reserve(blockCount);
+    for (int i = 0; i < blockCount; ++i) {
+        BlockSnapshot block;
+        block.name = m_blocks[i]->name;
+        block.latency = m_blocks[i]->latency.summary();
+        block.age = m_blocks[i]->age.summary();
+        block.interval = m_blocks[i]->interval.summary();
+        block.jitter = m_blocks[i]->jitter.summary();
+        block.errors = m_blocks[i]->errors.load(std::memory_order_relaxed);
+        s.blocks.append(block);
+    }
+    return s;
+}
+
+void DeviceMetrics::reset()
+{
+    m_resetMs.store(m_clock.elapsed(), std::memory_order_relaxed);
+    m_requests.store(0, std::memory_order_relaxed);
+    m_replies.store(0, std::memory_order_relaxed);
+    m_timeouts.store(0, std::memory_order_relaxed);
+    m_protocolErrors.store(0, std::memory_order_relaxed);
+    m_commErrors.store(0, std::memory_order_relaxed);
+    m_bytesIn.store(0, std::memory_order_relaxed);
+    m_bytesOut.store(0, std::memory_order_relaxed);
+    m_queueDepth.store(0, std::memory_order_relaxed);
+    m_queueDepthMax.store(0, std::memory_order_relaxed);
+    m_latency.reset();
+    m_scanCycle.reset();
+    m_tagAge.reset();
+    m_tagInterval.reset();
+    m_tagJitter.reset();
+    m_reaction.reset();
+    m_reactionFailures.store(0, std::memory_order_relaxed);
+    const int blockCount = m_blockCount.load(std::memory_order_acquire);
+    for (int i = 0; i < blockCount; ++i) {
+        m_blocks[i]->latency.reset();
+        m_blocks[i]->age.reset();
+        m_blocks[i]->interval.reset();
+        m_blocks[i]->jitter.reset();
+        m_blocks[i]->errors.store(0, std::memory_order_relaxed);
+    }
+}
+
+QString DeviceMetrics::Snapshot::toString() const
+{
+    auto ms = [](qint64 us) { return QString::number(us / 1000.0, 'f', 2); };
+
+    QString text = QString("requests %1, replies %2, timeouts %3, exceptions %4, errors %5\n")
+                       .arg(requests).arg(replies).arg(timeouts).arg(protocolErrors).arg(commErrors);
+    text += QString("bytes in %1, out %2, queue %3 (max %4)\n").arg(bytesIn).arg(bytesOut).arg(queueDepth).arg(queueDepthMax);
+    text += QString("latency p50 %1 ms, p99 %2 ms, max %3 ms\n").arg(ms(latency.p50Us)).arg(ms(latency.p99Us)).arg(ms(latency.maxUs));
+    if (scanCycle.count > 0) {
+        text += QString("scan cycle p50 %1 ms, p99 %2 ms, max %3 ms\n")
+                    .arg(ms(scanCycle.p50Us)).arg(ms(scanCycle.p99Us)).arg(ms(scanCycle.maxUs));
+    }
+    if (tagAge.count > 0) {
+        text += QString("tag age p50 %1 ms, p99 %2 ms, max %3 ms\n")
+                    .arg(ms(tagAge.p50Us)).arg(ms(tagAge.p99Us)).arg(ms(tagAge.maxUs));
+        text += QString("tag interval p50 %1 ms, p99 %2 ms, max %3 ms; jitter p50 %4 ms, p99 %5 ms\n")
+                    .arg(ms(tagInterval.p50Us)).arg(ms(tagInterval.p99Us)).arg(ms(tagInterval.maxUs))
+                    .arg(ms(tagJitter.p50Us)).arg(ms(tagJitter.p99Us));
+    }
+    if (reaction.count > 0) {
+        text += QString("interlock reaction n=%1 p50 %2 ms, p99 %3 ms, max %4 ms\n")
+                    .arg(reaction.count).arg(ms(reaction.p50Us)).arg(ms(reaction.p99Us)).arg(ms(reaction.maxUs));
+    }
+    if (reactionFailures > 0) {
+        text += QString("interlock writes failed %1\n").arg(reactionFailures);
+    }
+    for (const BlockSnapshot& block : blocks) {
+        text += QString("  %1: n=%2 p50 %3 ms p99 %4 ms max %5 ms err %6")
+                    .arg(block.name).arg(block.latency.count).arg(ms(block.latency.p50Us))
+                    .arg(ms(block.latency.p99Us)).arg(ms(block.latency.maxUs)).arg(block.errors);
+        if (block.age.count > 0) {
+            text += QString(", age p99 %1 ms, interval p99 %2 ms, jitter p99 %3 ms")
+                        .arg(ms(block.age.p99Us)).arg(ms(block.interval.p99Us)).arg(ms(block.jitter.p99Us));
+        }
+        text += '\n';
+    }
+    text.chop(1);
+    return text;
+}
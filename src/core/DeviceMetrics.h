@@ -0,0 +1,244 @@
+#ifndef DEVICEMETRICS_H
+#define DEVICEMETRICS_H
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <memory>
+
+/**
+ * @brief 定长桶延迟直方图(HDR风格，单位us)
+ *
+ * 0~15us 每1us一个桶，之后每个2的幂区间再均分为16个桶，相对误差约6%，
+ * 最大可记录约9.5小时。记录只做原子加，可在设备线程记录、界面线程读取。
+ */
+class LatencyHistogram
+{
+public:
+    enum { SubBucketBits = 4, SubBuckets = 1 << SubBucketBits, MaxMagnitude = 35,
+           BucketCount = SubBuckets + (MaxMagnitude - SubBucketBits + 1) * SubBuckets };
+
+    /**
+     * @brief 直方图统计结果
+     */
+    struct Summary {
+        quint64 count = 0;
+        double meanUs = 0;
+        qint64 p50Us = 0;
+        qint64 p90Us = 0;
+        qint64 p99Us = 0;
+        qint64 maxUs = 0;
+    };
+
+    LatencyHistogram();
+
+    void record(qint64 us);
+    void reset();
+    Summary summary() const;
+
+    /**
+     * @brief 返回第p百分位(0~100)所在桶的上界
+     */
+    qint64 percentile(double p) const;
+
+private:
+    static int bucketIndex(qint64 us);
+    static qint64 bucketUpperBound(int index);
+
+    std::atomic<quint64> m_buckets[BucketCount];
+    std::atomic<quint64> m_count;
+    std::atomic<quint64> m_sumUs;
+    std::atomic<qint64> m_maxUs;
+};
+
+/**
+ * @brief 最近N个样本的滚动窗口(单位us)
+ *
+ * 与累计直方图不同，百分位只反映最近的样本，调度改进后能很快体现出来。
+ * 只允许一个线程写入(设备线程)，读取方复制窗口后排序计算。
+ */
+class RollingWindow
+{
+public:
+    explicit RollingWindow(int capacity);
+
+    RollingWindow(const RollingWindow&) = delete;
+    RollingWindow& operator=(const RollingWindow&) = delete;
+
+    void record(qint64 us);
+    void reset();
+
+    /**
+     * @brief 窗口内样本的统计，count为窗口内样本数
+     */
+    LatencyHistogram::Summary summary() const;
+
+private:
+    std::unique_ptr<std::atomic<qint64>[]> m_samples;
+    const int m_capacity;
+    std::atomic<quint64> m_written;     // 累计写入次数，对容量取模得到下一个写入位置
+};
+
+/**
+ * @brief 设备运行统计
+ *
+ * 记录事务延迟(整体和按寄存器块/操作分别统计)、超时、协议异常、通信错误、
+ * 收发字节数、请求队列深度和扫描周期。全部为原子计数，设备线程记录时不加锁，
+ * 界面线程可随时通过 snapshot() 读取。
+ */
+class DeviceMetrics
+{
+public:
+    enum { MaxBlocks = 64 };
+
+    /**
+     * @brief 事务结果
+     */
+    enum Outcome { Ok, Timeout, ProtocolError, CommError };
+
+    /**
+     * @brief 单个寄存器块/操作的统计
+     */
+    struct BlockSnapshot {
+        QString name;
+        LatencyHistogram::Summary latency;
+        LatencyHistogram::Summary age;          ///< 数据发布时距该块本轮轮询到期的时间
+        LatencyHistogram::Summary interval;     ///< 相邻两次采样的间隔
+        LatencyHistogram::Summary jitter;       ///< 相邻两次采样间隔之差的绝对值
+        quint64 errors = 0;
+    };
+
+    /**
+     * @brief 某一时刻的统计快照
+     */
+    struct Snapshot {
+        qint64 uptimeMs = 0;            ///< 统计开始以来的时间
+        quint64 requests = 0;           ///< 已发出的请求数
+        quint64 replies = 0;            ///< 成功完成的事务数
+        quint64 timeouts = 0;
+        quint64 protocolErrors = 0;     ///< 协议异常(如Modbus异常响应)
+        quint64 commErrors = 0;         ///< 其它通信错误
+        quint64 bytesIn = 0;
+        quint64 bytesOut = 0;
+        int queueDepth = 0;             ///< 当前请求队列深度
+        int queueDepthMax = 0;          ///< 请求队列深度峰值
+        LatencyHistogram::Summary latency;      ///< 全部事务的延迟
+        LatencyHistogram::Summary scanCycle;    ///< 扫描周期
+        LatencyHistogram::Summary tagAge;       ///< 全部块的数据年龄(滚动窗口)
+        LatencyHistogram::Summary tagInterval;  ///< 全部块的采样间隔(滚动窗口)
+        LatencyHistogram::Summary tagJitter;    ///< 全部块的采样抖动(滚动窗口)
+        LatencyHistogram::Summary reaction;     ///< 联锁优先写入的触发到下发延迟
+        quint64 reactionFailures = 0;           ///< 未能下发的联锁优先写入数
+        QVector<BlockSnapshot> blocks;
+
+        quint64 errors() const { return timeouts + protocolErrors + commErrors; }
+
+        /**
+         * @brief 多行文本，每个寄存器块一行，用于界面提示和日志
+         */
+        QString toString() const;
+    };
+
+    DeviceMetrics();
+    ~DeviceMetrics();
+
+    DeviceMetrics(const DeviceMetrics&) = delete;
+    DeviceMetrics& operator=(const DeviceMetrics&) = delete;
+
+    /**
+     * @brief 注册一个寄存器块/操作，应在设备开始通信前调用
+     * @param name 显示名称
+     * @return 块编号，已达 MaxBlocks 时返回-1(只计入整体统计)
+     */
+    int addBlock(const QString& name);
+
+    /**
+     * @brief 统计用时钟(ns)，请求发出时取值，完成时传给 recordTransaction
+     */
+    qint64 nowNs() const { return m_clock.nsecsElapsed(); }
+
+    /**
+     * @brief 进程内单调时钟(ns)。与 nowNs() 不同，不同设备、不同线程取的值可以直接相减，
+     *        用于跨设备的延迟(如联锁触发到目标设备下发)
+     */
+    static qint64 monotonicNs();
+
+    void addRequest(quint64 bytesOut = 0);
+    void addBytesIn(quint64 bytes);
+    void addBytesOut(quint64 bytes);
+
+    /**
+     * @brief 记录一次事务完成
+     * @param block 块编号，-1表示不属于任何块
+     * @param startNs 请求发出时的 nowNs()
+     * @param outcome 结果，只有成功的事务计入延迟直方图
+     */
+    void recordTransaction(int block, qint64 startNs, Outcome outcome = Ok);
+
+    void setQueueDepth(int depth);
+    void recordScanCycle(qint64 durationNs);
+
+    /**
+     * @brief 记录一个块的新采样值已发布，只能在设备线程调用
+     * @param block 块编号
+     * @param dueNs 该块本轮轮询到期(入队)时的 nowNs()
+     *
+     * 数据年龄 = 发布时间 - 到期时间，包含排队等待和通信延迟；
+     * 同时由上次发布时间得到采样间隔和抖动。
+     */
+    void recordSample(int block, qint64 dueNs);
+
+    /**
+     * @brief 记录一次优先写入已下发
+     * @param triggerNs 触发时的 monotonicNs()
+     */
+    void recordReaction(qint64 triggerNs);
+
+    /**
+     * @brief 记录一次优先写入未能下发(未连接、发送失败等)，不计入 reaction 直方图
+     */
+    void recordReactionFailure();
+
+    Snapshot snapshot() const;
+    void reset();
+
+private:
+    enum { DeviceWindow = 1024, BlockWindow = 128 };
+
+    struct Block {
+        QString name;
+        LatencyHistogram latency;
+        RollingWindow age;
+        RollingWindow interval;
+        RollingWindow jitter;
+        std::atomic<quint64> errors;
+        qint64 lastSampleNs;        // 只在设备线程访问
+        qint64 lastIntervalNs;
+        Block() : age(BlockWindow), interval(BlockWindow), jitter(BlockWindow), errors(0),
+                  lastSampleNs(-1), lastIntervalNs(-1) {}
+    };
+
+    QElapsedTimer m_clock;
+    std::atomic<qint64> m_resetMs;
+    std::atomic<quint64> m_requests;
+    std::atomic<quint64> m_replies;
+    std::atomic<quint64> m_timeouts;
+    std::atomic<quint64> m_protocolErrors;
+    std::atomic<quint64> m_commErrors;
+    std::atomic<quint64> m_bytesIn;
+    std::atomic<quint64> m_bytesOut;
+    std::atomic<int> m_queueDepth;
+    std::atomic<int> m_queueDepthMax;
+    LatencyHistogram m_latency;
+    LatencyHistogram m_scanCycle;
+    LatencyHistogram m_reaction;
+    std::atomic<quint64> m_reactionFailures;
+    RollingWindow m_tagAge;
+    RollingWindow m_tagInterval;
+    RollingWindow m_tagJitter;
+    Block* m_blocks[MaxBlocks];
+    std::atomic<int> m_blockCount;  // 块指针和名称写入后再发布数量，读取方只访问已发布的块
+};
+
+#endif // DEVICEMETRICS_H
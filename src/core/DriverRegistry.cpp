@@ -0,0 +1,147 @@
+#include "DriverRegistry.h"
+/**
+ * @file DriverRegistry.cpp
+ * @brief DriverRegistry类的实现
+ */
+
+#include "Device.h"
+#include "DeviceDriverPlugin.h"
+#include <QDir>
+#include <QJsonArray>
+#include <QLibrary>
+#include <QPluginLoader>
+#include <QDebug>
+
+DriverRegistry& DriverRegistry::instance()
+{
+    static DriverRegistry registry;
+    return registry;
+}
+
+DriverRegistry::DriverRegistry()
+{
+}
+
+DriverRegistry::~DriverRegistry()
+{
+    // 删除加载器不会卸载共享库；不调用 unload()，程序退出时设备对象可能晚于注册表析构
+    qDeleteAll(m_loaders);
+}
+
+QString DriverRegistry::key(const QString& protocol, const QString& model)
+{
+    return protocol + '/' + model;
+}
+
+bool DriverRegistry::registerDriver(const QString& protocol, const QString& model, const Factory& factory,
+                                    bool isDefault, const QString& origin)
+{
+    if (protocol.isEmpty() || !factory) {
+        return false;
+    }
+    Driver driver;
+    driver.factory = factory;
+    driver.origin = origin.isEmpty() ? QString("built-in") : origin;
+    const QString driverKey = key(protocol, model);
+    if (m_drivers.contains(driverKey)) {
+        qWarning() << "DriverRegistry: driver" << driverKey << "from" << m_drivers.value(driverKey).origin
+                   << "replaced by" << driver.origin;
+    }
+    m_drivers.insert(driverKey, driver);
+    if (isDefault || !m_defaults.contains(protocol)) {
+        m_defaults.insert(protocol, model);
+    }
+    return true;
+}
+
+int DriverRegistry::loadPlugins(const QString& dirPath)
+{
+    QDir dir(dirPath);
+    if (!dir.exists()) {
+        return 0;
+    }
+
+    int count = 0;
+    for (const QString& fileName : dir.entryList(QDir::Files, QDir::Name)) {
+        const QString path = dir.absoluteFilePath(fileName);
+        if (!QLibrary::isLibrary(path)) {
+            continue;
+        }
+        // metaData() 只读取库中嵌入的元数据，不加载库
+        QPluginLoader* loader = new QPluginLoader(path);
+        const QJsonObject metaData = loader->metaData();
+        if (metaData["IID"].toString() != DeviceDriverPlugin_iid) {
+            delete loader;
+            continue;
+        }
+        m_loaders.append(loader);
+
+        const QJsonArray drivers = metaData["MetaData"].toObject()["drivers"].toArray();
+        for (const QJsonValue& value : drivers) {
+            const QJsonObject entry = value.toObject();
+            const QString protocol = entry["protocol"].toString();
+            const QString model = entry["model"].toString();
+            Factory factory = [loader, protocol, model](const QString& id, const QString& name, const QJsonObject& config,
+                                                        const QSharedPointer<const ConfigImage>& image) -> Device* {
+                auto plugin = qobject_cast<DeviceDriverPlugin*>(loader->instance());
+                if (!plugin) {
+                    qWarning() << "DriverRegistry: cannot load" << loader->fileName() << ":" << loader->errorString();
+                    return nullptr;
+                }
+                return plugin->createDevice(protocol, model, id, name, config, image);
+            };
+            if (registerDriver(protocol, model, factory, entry["default"].toBool(false), path)) {
+                ++count;
+            } else {
+                qWarning() << "DriverRegistry: invalid driver entry in" << path;
+            }
+        }
+    }
+    return count;
+}
+
+Device* DriverRegistry::create(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image,
+                               QString* error) const
+{
+    const QString protocol = config["protocol"].toString();
+    QString model = config["model"].toString();
+    if (model.isEmpty()) {
+        auto it = m_defaults.constFind(protocol);
+        if (it == m_defaults.constEnd()) {
+            if (error) {
+                *error = QString("no driver for protocol '%1'").arg(protocol);
+            }
+            return nullptr;
+        }
+        model = it.value();
+    }
+
+    auto it = m_drivers.constFind(key(protocol, model));
+    if (it == m_drivers.constEnd()) {
+        if (error) {
+            *error = QString("no driver for protocol '%1' model '%2'").arg(protocol).arg(model);
+        }
+        return nullptr;
+    }
+    Device* device = it.value().factory(config["device_id"].toString(), config["device_name"].toString(), config, image);
+    if (!device && error) {
+        *error = QString("driver %1 failed to create the device").arg(it.key());
+    }
+    return device;
+}
+
+QStringList DriverRegistry::drivers() const
+{
+    QStringList result;
+    for (auto it = m_drivers.constBegin(); it != m_drivers.constEnd(); ++it) {
+        const QString protocol = it.key().section('/', 0, 0);
+        const QString model = it.key().section('/', 1);
+        QString entry = it.key();
+        if (m_defaults.value(protocol) == model) {
+            entry += " (default)";
+        }
+        entry += " [" + it.value().origin + "]";
+        result << entry;
+    }
+    return result;
+}
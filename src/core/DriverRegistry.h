@@ -0,0 +1,90 @@
+#ifndef DRIVERREGISTRY_H
+#define DRIVERREGISTRY_H
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include <functional>
+
+class Device;
+class ConfigImage;
+class QPluginLoader;
+
+/**
+ * @brief 设备驱动注册表，按 (protocol, model) 选择创建设备的工厂
+ *
+ * 内置驱动在各自的源文件中用 REGISTER_DEVICE_DRIVER 自行注册；外部驱动由 loadPlugins()
+ * 从插件元数据注册，共享库在第一次创建该驱动的设备时才加载。
+ * 配置中指定了 model 时必须有完全匹配的驱动；未指定时使用该协议的默认驱动。
+ * 注册表只在界面线程中使用(静态注册发生在 main() 之前)。
+ */
+class DriverRegistry
+{
+public:
+    typedef std::function<Device*(const QString& id, const QString& name, const QJsonObject& config,
+                                  const QSharedPointer<const ConfigImage>& image)> Factory;
+
+    static DriverRegistry& instance();
+
+    /**
+     * @brief 注册一个驱动。同一 (protocol, model) 重复注册时后注册的生效
+     * @param protocol 配置中的 protocol
+     * @param model 设备型号
+     * @param factory 创建设备的工厂
+     * @param isDefault 是否作为该协议未指定 model 时的默认驱动
+     * @param origin 来源，内置驱动为空，插件为共享库路径，用于日志
+     */
+    bool registerDriver(const QString& protocol, const QString& model, const Factory& factory,
+                        bool isDefault = false, const QString& origin = QString());
+
+    /**
+     * @brief 读取目录下驱动插件的元数据并注册其中的驱动，不加载共享库
+     * @return 注册的驱动个数
+     */
+    int loadPlugins(const QString& dirPath);
+
+    /**
+     * @brief 按配置中的 protocol 和 model 创建设备
+     * @param error 失败原因
+     * @return 设备对象，没有匹配的驱动或驱动创建失败时返回nullptr
+     */
+    Device* create(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image,
+                   QString* error = nullptr) const;
+
+    /**
+     * @brief 已注册的驱动列表，形如 "modbus_tcp/laser (default) [built-in]"，用于日志和诊断
+     */
+    QStringList drivers() const;
+
+private:
+    DriverRegistry();
+    ~DriverRegistry();
+    DriverRegistry(const DriverRegistry&) = delete;
+    DriverRegistry& operator=(const DriverRegistry&) = delete;
+
+    struct Driver {
+        Factory factory;
+        QString origin;
+    };
+
+    static QString key(const QString& protocol, const QString& model);
+
+    QMap<QString, Driver> m_drivers;          ///< "protocol/model" -> 驱动
+    QMap<QString, QString> m_defaults;        ///< protocol -> 默认驱动的 model
+    QList<QPluginLoader*> m_loaders;          ///< 插件加载器，设备对象的代码在库中，库从不卸载
+};
+
+/**
+ * @brief 在设备类的源文件中注册内置驱动，构造函数形如 (id, name, config, image)
+ */
+#define REGISTER_DEVICE_DRIVER(DeviceClass, protocol, model, isDefault) \
+    static const bool DeviceClass##_registered = DriverRegistry::instance().registerDriver( \
+        protocol, model, \
+        [](const QString& id, const QString& name, const QJsonObject& config, \
+           const QSharedPointer<const ConfigImage>& image) -> Device* { \
+            return new DeviceClass(id, name, config, image); \
+        }, isDefault)
+
+#endif // DRIVERREGISTRY_H
@@ -0,0 +1,194 @@
+#include "InterlockEngine.h"
+#include "Device.h"
+#include "DeviceMetrics.h"
+#include <QJsonValue>
+#include <QSet>
+#include <QDebug>
+
+/**
+ * @file InterlockEngine.cpp
+ * @brief InterlockEngine类的实现
+ */
+
+InterlockEngine::InterlockEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+InterlockEngine::~InterlockEngine()
+{
+}
+
+void InterlockEngine::attach(Device* device)
+{
+    {
+        QWriteLocker locker(&m_lock);
+        m_devices.insert(device->deviceId(), device);
+    }
+    // 直接连接：在发出数据更新的设备线程中评估
+    connect(device, &Device::dataUpdated, this, &InterlockEngine::onDataUpdated, Qt::DirectConnection);
+    connect(device, &Device::connectedChanged, this, &InterlockEngine::onConnectedChanged, Qt::DirectConnection);
+}
+
+void InterlockEngine::clear()
+{
+    QWriteLocker locker(&m_lock);
+    for (Device* device : m_devices) {
+        disconnect(device, &Device::dataUpdated, this, &InterlockEngine::onDataUpdated);
+        disconnect(device, &Device::connectedChanged, this, &InterlockEngine::onConnectedChanged);
+    }
+    m_devices.clear();
+    m_ruleSets.clear();
+}
+
+bool InterlockEngine::parseRule(const QJsonObject& object, const QString& deviceId, Rule* rule, QString* error)
+{
+    rule->id = object["id"].toString();
+    if (rule->id.isEmpty()) {
+        *error = "missing id";
+        return false;
+    }
+    rule->name = object["name"].toString(rule->id);
+    rule->definition = object;
+
+    QString conditionError;
+    if (!TagCondition::parse(object, deviceId, &rule->condition, &conditionError)) {
+        *error = QString("rule '%1': %2").arg(rule->id).arg(conditionError);
+        return false;
+    }
+    // 评估在源设备线程中进行，其它设备的标签不在这里更新
+    if (rule->condition.device != deviceId) {
+        *error = QString("rule '%1': condition must use a tag of %2").arg(rule->id).arg(deviceId);
+        return false;
+    }
+
+    const QJsonArray actions = object["actions"].toArray();
+    if (actions.isEmpty()) {
+        *error = QString("rule '%1': no actions").arg(rule->id);
+        return false;
+    }
+    rule->actions.clear();
+    for (int i = 0; i < actions.size(); ++i) {
+        const QJsonObject actionObject = actions.at(i).toObject();
+        Action action;
+        action.device = actionObject["device"].toString();
+        action.key = actionObject["key"].toString();
+        if (action.device.isEmpty() || action.key.isEmpty()) {
+            *error = QString("rule '%1' action %2: missing device or key").arg(rule->id).arg(i);
+            return false;
+        }
+        const QJsonValue value = actionObject["value"];
+        action.value = value.isUndefined() ? QString("1") : value.toVariant().toString();
+        rule->actions.append(action);
+    }
+    return true;
+}
+
+int InterlockEngine::setDeviceRules(const QString& deviceId, const QJsonArray& rules, QStringList* errors)
+{
+    QSharedPointer<RuleSet> ruleSet(new RuleSet);
+    QSet<QString> ids;
+    for (int i = 0; i < rules.size(); ++i) {
+        Rule rule;
+        QString error;
+        if (!parseRule(rules.at(i).toObject(), deviceId, &rule, &error)) {
+            if (errors) {
+                *errors << QString("interlocks[%1]: %2").arg(i).arg(error);
+            }
+            continue;
+        }
+        if (ids.contains(rule.id)) {
+            if (errors) {
+                *errors << QString("interlocks[%1]: duplicate id '%2'").arg(i).arg(rule.id);
+            }
+            continue;
+        }
+        ids.insert(rule.id);
+        ruleSet->byTag[rule.condition.tag].append(ruleSet->rules.size());
+        ruleSet->rules.append(rule);
+    }
+
+    QWriteLocker locker(&m_lock);
+    // 定义未变的规则保留条件状态，条件已成立时重新加载不会再次触发
+    const QSharedPointer<RuleSet> previous = m_ruleSets.value(deviceId);
+    if (previous) {
+        for (Rule& rule : ruleSet->rules) {
+            for (const Rule& old : previous->rules) {
+                if (old.id == rule.id && old.definition == rule.definition) {
+                    rule.condition.state = old.condition.state;
+                    rule.tripped.storeRelease(old.tripped.loadAcquire());
+                    break;
+                }
+            }
+        }
+    }
+    if (ruleSet->rules.isEmpty()) {
+        m_ruleSets.remove(deviceId);
+    } else {
+        m_ruleSets.insert(deviceId, ruleSet);
+    }
+    return ruleSet->rules.size();
+}
+
+void InterlockEngine::onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value)
+{
+    QReadLocker locker(&m_lock);
+    const auto ruleSet = m_ruleSets.constFind(deviceId);
+    if (ruleSet == m_ruleSets.constEnd()) {
+        return;
+    }
+    RuleSet* rules = ruleSet.value().data();
+    const auto indices = rules->byTag.constFind(key);
+    if (indices == rules->byTag.constEnd()) {
+        return;
+    }
+
+    const qint64 triggerNs = DeviceMetrics::monotonicNs();
+    for (int index : indices.value()) {
+        Rule& rule = rules->rules[index];
+        const bool wasTrue = rule.condition.state;
+        const bool isTrue = rule.condition.evaluate(value);
+        rule.tripped.storeRelease(isTrue ? 1 : 0);
+        if (!isTrue || wasTrue) {
+            continue;
+        }
+        for (const Action& action : rule.actions) {
+            Device* target = m_devices.value(action.device, nullptr);
+            if (!target) {
+                qWarning() << "Interlock" << deviceId << rule.id << "target device not loaded:" << action.device;
+                continue;
+            }
+            Device::postPriorityWrite(target, action.key, action.value, triggerNs);
+        }
+        emit interlockFired(deviceId, rule.id, rule.name);
+    }
+}
+
+void InterlockEngine::onConnectedChanged(const QString& deviceId, bool connected)
+{
+    if (!connected) {
+        return;
+    }
+    QReadLocker locker(&m_lock);
+    Device* target = m_devices.value(deviceId, nullptr);
+    if (!target) {
+        return;
+    }
+
+    // 断开期间的动作可能没有下发；条件仍成立的规则重新置位，延迟从重新连接时算起
+    const qint64 triggerNs = DeviceMetrics::monotonicNs();
+    for (const QSharedPointer<RuleSet>& ruleSet : m_ruleSets) {
+        for (const Rule& rule : ruleSet->rules) {
+            if (!rule.tripped.loadAcquire()) {
+                continue;
+            }
+            for (const Action& action : rule.actions) {
+                if (action.device == deviceId) {
+                    qDebug() << "Interlock" << rule.condition.device << rule.id << "re-asserted on reconnect:"
+                             << deviceId << action.key << "=" << action.value;
+                    Device::postPriorityWrite(target, action.key, action.value, triggerNs);
+                }
+            }
+        }
+    }
+}
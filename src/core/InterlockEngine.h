@@ -0,0 +1,109 @@
+#ifndef INTERLOCKENGINE_H
+#define INTERLOCKENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QVariant>
+#include <QVector>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include "TagCondition.h"
+
+class Device;
+
+/**
+ * @brief 跨设备联锁引擎
+ *
+ * 规则写在源设备配置的 "interlocks" 数组中:
+ *   {
+ *     "id": "flow_lost", "name": "冷水机断流停激光",
+ *     "tag": "LSJ_Flow_Status", "op": "==", "value": 0,
+ *     "actions": [ { "device": "jgq_001", "key": "JGQ_MO_Ctrl", "value": 0 },
+ *                  { "device": "zmotion_001", "key": "stop_all" } ]
+ *   }
+ * 条件写法见 TagCondition，只能使用源设备自己的标签；ZMotion的输入口用 "tag": "input_bank" 加
+ * "bit" 选取IO点。条件由不成立变为成立时(包括首个样本
+ * 即成立)执行一次全部动作；动作的 value 缺省为1。
+ *
+ * 源设备的数据更新以直接连接在源设备线程中评估，不经过界面线程；动作通过
+ * Device::postPriorityWrite() 以高优先级事件投递到目标设备线程，由目标设备绕过轮询队列下发。
+ * 触发到下发的延迟记在目标设备运行统计的 reaction 直方图中。
+ *
+ * 目标设备未连接时动作无法下发。条件仍成立时目标设备一旦重新连接，引擎就把指向它的动作
+ * 再投递一次(在目标设备线程中)，保证安全输出最终被置位。
+ */
+class InterlockEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit InterlockEngine(QObject *parent = nullptr);
+    ~InterlockEngine();
+
+    /**
+     * @brief 加入设备：评估它的数据更新，并可作为联锁动作的目标。应在设备线程启动前调用
+     */
+    void attach(Device* device);
+
+    /**
+     * @brief 移除全部设备和规则，删除设备前调用；返回时不再有评估在进行
+     */
+    void clear();
+
+    /**
+     * @brief 替换一个设备的全部联锁规则，定义未变的规则保留条件状态
+     * @param deviceId 源设备
+     * @param rules 设备配置中的 "interlocks" 数组
+     * @param errors 无效规则的错误信息，无效规则被忽略
+     * @return 生效的规则数
+     */
+    int setDeviceRules(const QString& deviceId, const QJsonArray& rules, QStringList* errors = nullptr);
+
+signals:
+    /**
+     * @brief 联锁规则已触发，动作已投递。在源设备线程中发出
+     */
+    void interlockFired(const QString& deviceId, const QString& ruleId, const QString& name);
+
+private slots:
+    void onDataUpdated(const QString& deviceId, const QString& key, const QVariant& value);
+
+    /**
+     * @brief 目标设备重新连接时，重新投递条件仍成立的规则中指向它的动作。在目标设备线程中调用
+     */
+    void onConnectedChanged(const QString& deviceId, bool connected);
+
+private:
+    struct Action {
+        QString device;
+        QString key;
+        QString value;
+    };
+
+    struct Rule {
+        QString id;
+        QString name;
+        QJsonObject definition;     ///< 原始定义，重新加载时判断规则是否变化
+        TagCondition condition;
+        QVector<Action> actions;
+        QAtomicInt tripped;         ///< 条件当前是否成立，供目标设备线程读取；condition 只在源设备线程访问
+    };
+
+    // 一个源设备的规则，只在该设备线程中评估
+    struct RuleSet {
+        QVector<Rule> rules;
+        QHash<QString, QVector<int>> byTag;     ///< 标签key -> 规则下标
+    };
+
+    static bool parseRule(const QJsonObject& object, const QString& deviceId, Rule* rule, QString* error);
+
+    QReadWriteLock m_lock;      ///< 评估时读锁(各设备线程并行)，修改规则和设备表时写锁
+    QHash<QString, QSharedPointer<RuleSet>> m_ruleSets;    ///< 源设备ID -> 规则
+    QHash<QString, Device*> m_devices;                     ///< 动作目标
+};
+
+#endif // INTERLOCKENGINE_H
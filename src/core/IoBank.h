@@ -0,0 +1,75 @@
+#ifndef IOBANK_H
+#define IOBANK_H
+
+#include <QMetaType>
+#include <QString>
+#include <cstring>
+
+/**
+ * @brief 一组数字IO的打包状态
+ *
+ * 设备每个周期只发布一次IO组更新，而不是每个变化的IO点一次。
+ * words 为当前全部IO状态，changed 为本次相对上次发布发生变化的位，
+ * 使用者只需按需解包关心的IO点。
+ */
+struct IoBank
+{
+    enum { MaxIo = 256, Words = MaxIo / 32 };
+
+    quint16 firstIo;        ///< 第一个IO点编号
+    quint16 count;          ///< IO点数量
+    quint32 words[Words];   ///< 当前状态位图，第i个IO点为 words[i/32] 的第 i%32 位
+    quint32 changed[Words]; ///< 本次发生变化的位
+
+    IoBank() : firstIo(0), count(0)
+    {
+        std::memset(words, 0, sizeof(words));
+        std::memset(changed, 0, sizeof(changed));
+    }
+
+    /**
+     * @brief 返回第index个IO点(相对firstIo)的状态
+     */
+    bool test(int index) const
+    {
+        return index >= 0 && index < count && ((words[index / 32] >> (index % 32)) & 1u);
+    }
+
+    /**
+     * @brief 返回第index个IO点(相对firstIo)本次是否变化
+     */
+    bool isChanged(int index) const
+    {
+        return index >= 0 && index < count && ((changed[index / 32] >> (index % 32)) & 1u);
+    }
+
+    /**
+     * @brief 是否有任意IO点变化
+     */
+    bool anyChanged() const
+    {
+        quint32 any = 0;
+        for (int i = 0; i < Words; ++i) {
+            any |= changed[i];
+        }
+        return any != 0;
+    }
+
+    /**
+     * @brief 按十六进制输出状态位图(高位字在前)，用于日志显示
+     */
+    QString toString() const
+    {
+        QString text;
+        for (int w = (count + 31) / 32 - 1; w >= 0; --w) {
+            text += QString("%1").arg(words[w], 8, 16, QChar('0')).toUpper();
+            if (w > 0) {
+                text += ' ';
+            }
+        }
+        return text;
+    }
+};
+Q_DECLARE_METATYPE(IoBank)
+
+#endif // IOBANK_H
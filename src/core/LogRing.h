@@ -0,0 +1,142 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include <QByteArray>
+#include <QString>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief 一条日志记录
+ */
+struct LogEntry
+{
+    enum Kind { Recv, Send, Data };
+
+    QString deviceId;   ///< 产生日志的设备
+    QByteArray payload; ///< 通信原始数据，Data 类型时为 "key = value" 文本
+    qint64 timeMs = 0;  ///< 当日毫秒数，入队时记录
+    Kind kind = Recv;
+};
+
+/**
+ * @brief 定长无锁多生产者多消费者日志环形缓冲区
+ *
+ * 设备线程直接入队，界面线程定时批量出队显示。
+ * 每个槽位带序号，生产者和消费者只通过原子变量同步；
+ * 缓冲区满时丢弃新日志并计数，不会阻塞设备线程。
+ */
+class LogRing
+{
+public:
+    /**
+     * @param capacity 槽位数，向上取整为2的幂
+     */
+    explicit LogRing(size_t capacity = 4096)
+        : m_cells(roundUpPow2(capacity))
+        , m_mask(m_cells.size() - 1)
+        , m_enqueuePos(0)
+        , m_dequeuePos(0)
+        , m_dropped(0)
+    {
+        for (size_t i = 0; i < m_cells.size(); ++i) {
+            m_cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    LogRing(const LogRing&) = delete;
+    LogRing& operator=(const LogRing&) = delete;
+
+    /**
+     * @brief 入队，可在任意线程调用
+     * @return 缓冲区已满时返回false，该条日志被丢弃
+     */
+    bool push(LogEntry&& entry)
+    {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->entry = std::move(entry);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队，可在任意线程调用
+     * @return 缓冲区为空时返回false
+     */
+    bool pop(LogEntry& entry)
+    {
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        entry = std::move(cell->entry);
+        cell->entry = LogEntry();   // 及时释放槽位中的数据
+        cell->seq.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 取出并清零自上次调用以来丢弃的日志条数
+     */
+    quint64 takeDropped()
+    {
+        return m_dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        LogEntry entry;
+    };
+
+    static size_t roundUpPow2(size_t n)
+    {
+        size_t size = 2;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<Cell> m_cells;
+    size_t m_mask;
+    // 生产者和消费者位置用填充隔开，避免落在同一缓存行上互相干扰
+    char m_pad0[64];
+    std::atomic<size_t> m_enqueuePos;
+    char m_pad1[64];
+    std::atomic<size_t> m_dequeuePos;
+    std::atomic<quint64> m_dropped;
+};
+
+#endif // LOGRING_H
@@ -0,0 +1,327 @@
+#include "ModbusBus.h"
+/**
+ * @file ModbusBus.cpp
+ * @brief ModbusBus类的实现
+ */
+
+#include <QModbusRtuSerialMaster>
+#include <QModbusTcpClient>
+#include <QSerialPort>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <QDebug>
+
+namespace {
+// 各线程中的总线，只在 acquire/release 时访问
+QMutex g_busMutex;
+QHash<QString, ModbusBus*> g_buses;
+
+bool isGateway(const QJsonObject& config)
+{
+    return config["rtu_params"].toObject()["transport"].toString() == "tcp_gateway";
+}
+
+// 总线使用的连接参数，"组.参数" -> 值(未配置的取与构造函数相同的缺省值)；总线按第一个成员的参数创建
+QJsonObject busSettings(const QJsonObject& config)
+{
+    QJsonObject settings;
+    auto copy = [&settings, &config](const char* group, const char* name, int defaultValue) {
+        settings[QString("%1.%2").arg(group).arg(name)] = config[group].toObject()[name].toInt(defaultValue);
+    };
+    if (!isGateway(config)) {
+        copy("rtu_params", "baud_rate", 9600);
+        copy("rtu_params", "data_bits", 8);
+        copy("rtu_params", "stop_bits", 1);
+        const QString parity = config["rtu_params"].toObject()["parity"].toString();
+        settings["rtu_params.parity"] = (parity == "even" || parity == "odd") ? parity : QString("none");
+        copy("bus_params", "inter_frame_delay_us", -1);
+    }
+    copy("protocol_params", "response_timeout", 0);
+    copy("protocol_params", "retry_count", 0);
+    copy("bus_params", "gap_ms", 0);
+    copy("bus_params", "dead_after", 3);
+    copy("bus_params", "dead_backoff_ms", 5000);
+    return settings;
+}
+}
+
+QString ModbusBus::busKey(const QJsonObject& config)
+{
+    if (isGateway(config)) {
+        const QJsonObject tcpParams = config["tcp_params"].toObject();
+        return QString("tcp:%1:%2").arg(tcpParams["ip_address"].toString()).arg(tcpParams["port"].toInt());
+    }
+    return "serial:" + config["rtu_params"].toObject()["port_name"].toString();
+}
+
+ModbusBus* ModbusBus::acquire(const QJsonObject& config, ModbusBusMember* member)
+{
+    const QString key = busKey(config);
+    QMutexLocker locker(&g_busMutex);
+    ModbusBus* bus = g_buses.value(key, nullptr);
+    if (!bus) {
+        bus = new ModbusBus(key, config);
+        g_buses.insert(key, bus);
+    } else if (bus->thread() != QThread::currentThread()) {
+        // 同一总线的设备必须在同一线程中(ThreadManager 按 Device::threadGroup() 分配)
+        qWarning() << "ModbusBus:" << key << "is already used from another thread";
+        return nullptr;
+    } else {
+        // 后加入的成员参数不同时不会生效，提示配置不一致
+        const QJsonObject settings = busSettings(config);
+        QStringList mismatches;
+        for (auto it = settings.constBegin(); it != settings.constEnd(); ++it) {
+            const QJsonValue busValue = bus->m_settings.value(it.key());
+            if (busValue != it.value()) {
+                mismatches << QString("%1 %2 (bus uses %3)").arg(it.key())
+                                  .arg(it.value().toVariant().toString()).arg(busValue.toVariant().toString());
+            }
+        }
+        if (!mismatches.isEmpty()) {
+            qWarning() << "ModbusBus:" << key << "device" << config["device_id"].toString()
+                       << "settings differ from the first device on the bus and are ignored:" << mismatches.join(", ");
+        }
+    }
+    if (bus->indexOf(member) < 0) {
+        Member entry;
+        entry.member = member;
+        entry.ready = false;
+        entry.urgent = false;
+        entry.timeouts = 0;
+        entry.retryAtMs = 0;
+        bus->m_members.append(entry);
+    }
+    return bus;
+}
+
+ModbusBus::ModbusBus(const QString& key, const QJsonObject& config)
+    : QObject(nullptr)
+    , m_key(key)
+    , m_client(nullptr)
+    , m_current(nullptr)
+    , m_next(0)
+    , m_settings(busSettings(config))
+{
+    QJsonObject busParams = config["bus_params"].toObject();
+    m_gapMs = busParams["gap_ms"].toInt(0);
+    m_deadAfter = busParams["dead_after"].toInt(3);
+    m_deadBackoffMs = busParams["dead_backoff_ms"].toInt(5000);
+
+    if (isGateway(config)) {
+        QJsonObject tcpParams = config["tcp_params"].toObject();
+        m_client = new QModbusTcpClient(this);
+        m_client->setConnectionParameter(QModbusDevice::NetworkAddressParameter, tcpParams["ip_address"].toString());
+        m_client->setConnectionParameter(QModbusDevice::NetworkPortParameter, tcpParams["port"].toInt());
+    } else {
+        QJsonObject rtuParams = config["rtu_params"].toObject();
+        auto serial = new QModbusRtuSerialMaster(this);
+        serial->setConnectionParameter(QModbusDevice::SerialPortNameParameter, rtuParams["port_name"].toString());
+        serial->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, rtuParams["baud_rate"].toInt(9600));
+        serial->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, rtuParams["data_bits"].toInt(8));
+        serial->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, rtuParams["stop_bits"].toInt(1));
+        const QString parity = rtuParams["parity"].toString();
+        serial->setConnectionParameter(QModbusDevice::SerialParityParameter,
+                                       parity == "even" ? QSerialPort::EvenParity
+                                       : parity == "odd" ? QSerialPort::OddParity : QSerialPort::NoParity);
+        // 帧间至少3.5个字符时间的静默由 QModbusRtuSerialMaster 保证，这里只允许加长
+        const int interFrameDelay = busParams["inter_frame_delay_us"].toInt(-1);
+        if (interFrameDelay >= 0) {
+            serial->setInterFrameDelay(interFrameDelay);
+        }
+        m_client = serial;
+    }
+    QJsonObject protocolParams = config["protocol_params"].toObject();
+    m_client->setTimeout(protocolParams["response_timeout"].toInt());
+    m_client->setNumberOfRetries(protocolParams["retry_count"].toInt());
+    connect(m_client, &QModbusClient::stateChanged, this, &ModbusBus::onStateChanged);
+
+    m_gapTimer = new QTimer(this);
+    m_gapTimer->setSingleShot(true);
+    m_gapTimer->setInterval(m_gapMs);
+    connect(m_gapTimer, &QTimer::timeout, this, &ModbusBus::schedule);
+
+    m_retryTimer = new QTimer(this);
+    m_retryTimer->setSingleShot(true);
+    connect(m_retryTimer, &QTimer::timeout, this, &ModbusBus::schedule);
+
+    m_clock.start();
+}
+
+ModbusBus::~ModbusBus()
+{
+}
+
+void ModbusBus::release(ModbusBusMember* member)
+{
+    const int index = indexOf(member);
+    if (index < 0) {
+        return;
+    }
+    m_members.remove(index);
+    if (m_current == member) {
+        m_current = nullptr;
+        scheduleLater();
+    }
+    if (!m_members.isEmpty()) {
+        m_next %= m_members.size();
+        return;
+    }
+
+    {
+        QMutexLocker locker(&g_busMutex);
+        g_buses.remove(m_key);
+    }
+    m_gapTimer->stop();
+    m_retryTimer->stop();
+    m_client->disconnectDevice();
+    deleteLater();
+}
+
+bool ModbusBus::open()
+{
+    if (m_client->state() != QModbusDevice::UnconnectedState) {
+        return true;
+    }
+    return m_client->connectDevice();
+}
+
+void ModbusBus::close()
+{
+    m_client->disconnectDevice();
+}
+
+void ModbusBus::requestTurn(ModbusBusMember* member, bool urgent)
+{
+    const int index = indexOf(member);
+    if (index < 0) {
+        return;
+    }
+    m_members[index].ready = true;
+    m_members[index].urgent = m_members[index].urgent || urgent;
+    if (!m_current) {
+        scheduleLater();
+    }
+}
+
+void ModbusBus::transactionFinished(ModbusBusMember* member, bool timedOut)
+{
+    // 断开或成员退出后迟到的应答不影响调度
+    if (member != m_current) {
+        return;
+    }
+    m_current = nullptr;
+
+    const int index = indexOf(member);
+    if (index >= 0) {
+        Member& entry = m_members[index];
+        if (timedOut) {
+            ++entry.timeouts;
+            if (m_deadAfter > 0 && entry.timeouts >= m_deadAfter) {
+                if (entry.timeouts == m_deadAfter) {
+                    qWarning() << "ModbusBus:" << m_key << member->memberName() << "not responding, probing every"
+                               << m_deadBackoffMs << "ms";
+                }
+                entry.retryAtMs = m_clock.elapsed() + m_deadBackoffMs;
+            }
+        } else {
+            if (m_deadAfter > 0 && entry.timeouts >= m_deadAfter) {
+                qDebug() << "ModbusBus:" << m_key << member->memberName() << "responding again";
+            }
+            entry.timeouts = 0;
+            entry.retryAtMs = 0;
+        }
+    }
+
+    if (m_gapMs > 0) {
+        m_gapTimer->start();
+    } else {
+        scheduleLater();
+    }
+}
+
+void ModbusBus::schedule()
+{
+    if (m_current || m_gapTimer->isActive() || m_client->state() != QModbusDevice::ConnectedState) {
+        return;
+    }
+
+    // 优先写入不参与轮转，总线空闲后立即交出；轮转起点不变
+    for (int index = 0; index < m_members.size(); ++index) {
+        if (!m_members.at(index).urgent) {
+            continue;
+        }
+        m_members[index].urgent = false;
+        ModbusBusMember* member = m_members.at(index).member;
+        m_current = member;
+        if (member->sendNextRequest()) {
+            return;
+        }
+        m_current = nullptr;
+    }
+
+    // 从上次的下一个成员开始轮转，每个成员每轮最多一个事务
+    const qint64 now = m_clock.elapsed();
+    qint64 nextRetry = -1;
+    for (int n = 0; n < m_members.size(); ++n) {
+        if (m_members.isEmpty()) {
+            break;
+        }
+        const int index = (m_next + n) % m_members.size();
+        Member& entry = m_members[index];
+        if (!entry.ready) {
+            continue;
+        }
+        if (entry.retryAtMs > now) {
+            nextRetry = nextRetry < 0 ? entry.retryAtMs : qMin(nextRetry, entry.retryAtMs);
+            continue;
+        }
+        ModbusBusMember* member = entry.member;
+        m_current = member;
+        if (member->sendNextRequest()) {
+            m_next = (index + 1) % m_members.size();
+            return;
+        }
+        m_current = nullptr;
+        // sendNextRequest 中成员可能已退出，重新定位
+        const int current = indexOf(member);
+        if (current >= 0) {
+            m_members[current].ready = false;
+        }
+    }
+
+    // 只剩退避中的成员时，等最早的一个到期
+    if (nextRetry >= 0) {
+        m_retryTimer->start(static_cast<int>(nextRetry - now));
+    }
+}
+
+void ModbusBus::onStateChanged(int state)
+{
+    if (state == QModbusDevice::ConnectedState) {
+        scheduleLater();
+    } else if (state == QModbusDevice::UnconnectedState) {
+        // 在途请求随连接一起失败，重新连接后从头调度
+        m_current = nullptr;
+        m_gapTimer->stop();
+        m_retryTimer->stop();
+    }
+}
+
+int ModbusBus::indexOf(ModbusBusMember* member) const
+{
+    for (int i = 0; i < m_members.size(); ++i) {
+        if (m_members.at(i).member == member) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ModbusBus::scheduleLater()
+{
+    // 排队执行，避免在成员的应答处理函数中重入
+    QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+}
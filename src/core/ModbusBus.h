@@ -0,0 +1,126 @@
+#ifndef MODBUSBUS_H
+#define MODBUSBUS_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QJsonObject>
+#include <QElapsedTimer>
+
+class QModbusClient;
+class QTimer;
+
+/**
+ * @brief 共享总线上的一个从站设备
+ */
+class ModbusBusMember
+{
+public:
+    virtual ~ModbusBusMember() {}
+
+    /**
+     * @brief 轮到该成员使用总线时调用。成员发出一个请求，应答结束(含超时)时调用
+     *        ModbusBus::transactionFinished()
+     * @return 已发出请求返回true；没有待发请求返回false，之后有请求时再调用 requestTurn()
+     */
+    virtual bool sendNextRequest() = 0;
+
+    /**
+     * @brief 成员名称，用于日志
+     */
+    virtual QString memberName() const = 0;
+};
+
+/**
+ * @brief 多个从站共用的Modbus总线：一个串口(RS-485)或一个以太网转串口网关的TCP连接
+ *
+ * 同一总线上的设备由 ThreadManager 放在同一个工作线程中，共用一个 QModbusClient。
+ * 总线上同一时刻只有一个事务：调度器按轮转顺序把总线交给有待发请求的成员，
+ * 一个事务结束后(等待可选的静默间隔)立即交给下一个成员，没有固定的帧间隔空等。
+ * 连续超时的从站暂时只按退避间隔试探，不再每轮占用一次超时时间。
+ *
+ * 配置(取自第一个使用该总线的设备，后加入的设备参数不同时输出警告):
+ *   rtu_params.transport   "serial"(默认) 或 "tcp_gateway"(网关使用 tcp_params，以 server_address 作为单元标识)
+ *   rtu_params             port_name、baud_rate、data_bits、stop_bits、parity
+ *   protocol_params        response_timeout、retry_count
+ *   bus_params             inter_frame_delay_us(串口帧间静默，-1按波特率自动)、gap_ms(事务间额外静默)、
+ *                          dead_after(连续超时多少次后退避，0不退避)、dead_backoff_ms(退避期间试探间隔)
+ *
+ * 除 busKey() 和 acquire() 外的函数都只能在总线所在线程中调用。
+ */
+class ModbusBus : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @brief 设备配置对应的总线标识，如 "serial:COM3"、"tcp:192.168.1.20:502"
+     */
+    static QString busKey(const QJsonObject& config);
+
+    /**
+     * @brief 加入配置对应的总线，总线不存在时在当前线程中创建
+     * @return 总线，已在其他线程中创建时返回nullptr
+     */
+    static ModbusBus* acquire(const QJsonObject& config, ModbusBusMember* member);
+
+    /**
+     * @brief 退出总线，最后一个成员退出时关闭连接并删除总线
+     */
+    void release(ModbusBusMember* member);
+
+    QString key() const { return m_key; }
+    QModbusClient* client() const { return m_client; }
+    int memberCount() const { return m_members.size(); }
+
+    /**
+     * @brief 打开总线连接，已连接或正在连接时直接返回true
+     */
+    bool open();
+    void close();
+
+    /**
+     * @brief 成员有待发请求，等待轮到它使用总线
+     * @param urgent 优先写入：当前事务结束后先于轮转顺序交给该成员，退避中也不等待
+     */
+    void requestTurn(ModbusBusMember* member, bool urgent = false);
+
+    /**
+     * @brief 当前成员的事务已结束
+     * @param timedOut 是否因从站无应答而结束
+     */
+    void transactionFinished(ModbusBusMember* member, bool timedOut);
+
+private slots:
+    void schedule();
+    void onStateChanged(int state);
+
+private:
+    struct Member {
+        ModbusBusMember* member;
+        bool ready;             ///< 是否有待发请求
+        bool urgent;            ///< 是否有待发的优先写入
+        int timeouts;           ///< 连续超时次数
+        qint64 retryAtMs;       ///< 退避中的成员在此时间之后才再次使用总线
+    };
+
+    ModbusBus(const QString& key, const QJsonObject& config);
+    ~ModbusBus();
+    int indexOf(ModbusBusMember* member) const;
+    void scheduleLater();
+
+    QString m_key;
+    QModbusClient* m_client;
+    QVector<Member> m_members;
+    ModbusBusMember* m_current;     ///< 正在使用总线的成员
+    int m_next;                     ///< 轮转起点
+    QJsonObject m_settings;         ///< 创建总线时的连接参数，acquire() 时与后加入的成员比较
+    QTimer* m_gapTimer;             ///< 事务间静默定时器
+    QTimer* m_retryTimer;           ///< 退避成员到期定时器
+    QElapsedTimer m_clock;
+    int m_gapMs;
+    int m_deadAfter;
+    int m_deadBackoffMs;
+};
+
+#endif // MODBUSBUS_H
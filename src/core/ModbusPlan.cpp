@@ -0,0 +1,140 @@
+#include "ModbusPlan.h"
+/**
+ * @file ModbusPlan.cpp
+ * @brief Modbus读写计划的建立与热加载比较
+ */
+
+#include "ConfigImage.h"
+#include "DeviceMetrics.h"
+
+namespace {
+
+bool sameParam(const ModbusParameter& a, const ModbusParameter& b)
+{
+    return a.address == b.address && a.key == b.key && a.name == b.name && a.length == b.length
+            && a.bitpos == b.bitpos && a.access == b.access && a.regType == b.regType;
+}
+
+// 布局相同：请求内容和参数解码方式都不变，参数值和统计可以原样沿用
+bool sameLayout(const ModbusSturct& a, const ModbusSturct& b)
+{
+    if (a.address != b.address || a.regCount != b.regCount || a.isReadReg != b.isReadReg
+            || a.regType != b.regType || a.spList.size() != b.spList.size()) {
+        return false;
+    }
+    for (int i = 0; i < a.spList.size(); ++i) {
+        if (!sameParam(a.spList.at(i), b.spList.at(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+QString ModbusPlanDiff::summary() const
+{
+    return QString("%1 blocks added, %2 removed, %3 changed, %4 unchanged")
+            .arg(added).arg(removed).arg(changed).arg(kept);
+}
+
+void buildModbusPlan(const ConfigImage& image, DeviceMetrics& metrics,
+                     QMap<quint16, ModbusSturct>& dataMap,
+                     QMap<QString, QPair<quint16, int>>& keyIndexMap,
+                     const QMap<quint16, ModbusSturct>* previous,
+                     ModbusPlanDiff* diff)
+{
+    // 读写块已由配置编译器按地址分组，这里只把定长记录展开为运行时结构
+    dataMap.clear();
+    keyIndexMap.clear();
+    ModbusPlanDiff result;
+    for (int b = 0; b < image.blockCount(); ++b)
+    {
+        const ConfigImage::Block& block = image.block(b);
+        ModbusSturct infoStruct;
+        infoStruct.address = block.address;
+        infoStruct.regCount = block.regCount;
+        infoStruct.isReadReg = block.isRead;
+        infoStruct.regType = static_cast<QModbusDataUnit::RegisterType>(block.regType);
+        infoStruct.dueNs = 0;
+        infoStruct.metricsBlock = -1;
+        infoStruct.spList.reserve(static_cast<int>(block.paramCount));
+        for (quint32 i = 0; i < block.paramCount; ++i)
+        {
+            const ConfigImage::Param& param = image.param(static_cast<int>(block.firstParam + i));
+            ModbusParameter infoParam;
+            infoParam.address = param.address;
+            infoParam.key = image.string(param.key);
+            infoParam.name = image.string(param.name);
+            infoParam.length = param.length;
+            infoParam.bitpos = param.bitpos;
+            infoParam.access = image.string(param.access);
+            infoParam.regType = static_cast<QModbusDataUnit::RegisterType>(param.regType);
+            infoParam.value = 0; // 初始化为0
+            keyIndexMap[infoParam.key] = qMakePair(infoStruct.address, static_cast<int>(i));
+            infoStruct.spList.append(infoParam);
+        }
+
+        const ModbusSturct* old = nullptr;
+        if (previous) {
+            auto it = previous->constFind(infoStruct.address);
+            if (it != previous->constEnd()) {
+                old = &it.value();
+            }
+        }
+        if (old && sameLayout(*old, infoStruct)) {
+            dataMap.insert(infoStruct.address, *old);
+            ++result.kept;
+            continue;
+        }
+
+        if (old) {
+            ++result.changed;
+            // 同一地址和方向的块继续累计到原统计块
+            if (old->isReadReg == infoStruct.isReadReg) {
+                infoStruct.metricsBlock = old->metricsBlock;
+            }
+            for (ModbusParameter& param : infoStruct.spList) {
+                for (const ModbusParameter& oldParam : old->spList) {
+                    if (oldParam.key == param.key && oldParam.bitpos == param.bitpos
+                            && oldParam.length == param.length && oldParam.regType == param.regType) {
+                        param.value = oldParam.value;
+                        break;
+                    }
+                }
+            }
+        } else if (previous) {
+            ++result.added;
+        }
+        if (infoStruct.metricsBlock < 0) {
+            infoStruct.metricsBlock = metrics.addBlock(QString("%1 %2").arg(block.isRead ? "R" : "W").arg(block.address));
+        }
+        dataMap.insert(infoStruct.address, infoStruct);
+    }
+
+    if (previous) {
+        for (auto it = previous->constBegin(); it != previous->constEnd(); ++it) {
+            if (!dataMap.contains(it.key())) {
+                ++result.removed;
+            }
+        }
+    }
+    if (diff) {
+        *diff = result;
+    }
+}
+
+void remapModbusQueue(QQueue<ModbusSturct>& queue, const QMap<quint16, ModbusSturct>& dataMap)
+{
+    QQueue<ModbusSturct> remapped;
+    for (const ModbusSturct& request : queue) {
+        auto it = dataMap.constFind(request.address);
+        if (it == dataMap.constEnd()) {
+            continue;
+        }
+        ModbusSturct current = it.value();
+        current.dueNs = request.dueNs;
+        remapped.enqueue(current);
+    }
+    queue.swap(remapped);
+}
@@ -0,0 +1,48 @@
+#ifndef MODBUSPLAN_H
+#define MODBUSPLAN_H
+
+#include <QMap>
+#include <QPair>
+#include <QQueue>
+#include <QString>
+#include "modbusdata.h"
+
+class ConfigImage;
+class DeviceMetrics;
+
+/**
+ * @brief 新旧读写计划的差异统计
+ */
+struct ModbusPlanDiff
+{
+    int added = 0;      ///< 新增的块
+    int removed = 0;    ///< 删除的块
+    int changed = 0;    ///< 地址不变但参数布局变化、重新建立的块
+    int kept = 0;       ///< 完全相同、原样沿用的块
+
+    bool isEmpty() const { return added == 0 && removed == 0 && changed == 0; }
+    QString summary() const;
+};
+
+/**
+ * @brief 由配置镜像展开 Modbus 设备的读写计划，JGQDevice 和 LSJDevice 共用
+ * @param image 配置镜像
+ * @param metrics 设备运行统计，新地址的块在其中注册
+ * @param dataMap 输出：寄存器地址 -> 读写块
+ * @param keyIndexMap 输出：参数key -> (块地址, 块内下标)
+ * @param previous 正在使用的计划，热加载时传入：布局相同的块原样沿用(保留参数值)，
+ *                 同一地址和方向的块沿用统计块编号，变化的块中布局未变的参数保留当前值
+ * @param diff 输出新旧计划的差异，可为空
+ */
+void buildModbusPlan(const ConfigImage& image, DeviceMetrics& metrics,
+                     QMap<quint16, ModbusSturct>& dataMap,
+                     QMap<QString, QPair<quint16, int>>& keyIndexMap,
+                     const QMap<quint16, ModbusSturct>* previous = nullptr,
+                     ModbusPlanDiff* diff = nullptr);
+
+/**
+ * @brief 换用新计划后整理请求队列：已删除地址的请求丢弃，其余换成新计划中的块，保留入队时间
+ */
+void remapModbusQueue(QQueue<ModbusSturct>& queue, const QMap<quint16, ModbusSturct>& dataMap);
+
+#endif // MODBUSPLAN_H
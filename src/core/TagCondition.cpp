@@ -0,0 +1,106 @@
+#include "TagCondition.h"
+#include "IoBank.h"
+#include <QHash>
+#include <QJsonValue>
+
+/**
+ * @file TagCondition.cpp
+ * @brief TagCondition的实现
+ */
+
+bool TagCondition::parse(const QJsonObject& object, const QString& defaultDevice, TagCondition* condition, QString* error)
+{
+    condition->device = object["device"].toString(defaultDevice);
+    condition->tag = object["tag"].toString();
+    if (condition->tag.isEmpty()) {
+        *error = "missing tag";
+        return false;
+    }
+
+    static const QHash<QString, Op> ops = {
+        {">", Greater}, {">=", GreaterEqual}, {"<", Less}, {"<=", LessEqual}, {"==", Equal}, {"!=", NotEqual}
+    };
+    const QString opName = object["op"].toString("==");
+    if (!ops.contains(opName)) {
+        *error = QString("unknown op '%1'").arg(opName);
+        return false;
+    }
+    condition->op = ops.value(opName);
+
+    const QJsonValue value = object["value"];
+    condition->isText = value.isString();
+    if (condition->isText) {
+        if (condition->op != Equal && condition->op != NotEqual) {
+            *error = QString("op '%1' needs a numeric value").arg(opName);
+            return false;
+        }
+        condition->text = value.toString();
+        condition->threshold = 0;
+    } else if (value.isDouble() || value.isBool()) {
+        condition->threshold = value.isBool() ? (value.toBool() ? 1 : 0) : value.toDouble();
+    } else if (value.isUndefined()) {
+        // 缺省与报警位比较: tag == 1
+        condition->threshold = 1;
+    } else {
+        *error = "value must be a number, bool or string";
+        return false;
+    }
+
+    const QJsonValue bit = object["bit"];
+    condition->bit = -1;
+    if (!bit.isUndefined()) {
+        const double bitValue = bit.toDouble(-1);
+        if (!bit.isDouble() || bitValue < 0 || bitValue >= IoBank::MaxIo || bitValue != static_cast<int>(bitValue)) {
+            *error = QString("bit must be an integer from 0 to %1").arg(IoBank::MaxIo - 1);
+            return false;
+        }
+        if (condition->isText) {
+            *error = "bit needs a numeric value";
+            return false;
+        }
+        condition->bit = static_cast<int>(bitValue);
+    }
+
+    condition->deadband = qMax(0.0, object["deadband"].toDouble(0));
+    condition->state = false;
+    return true;
+}
+
+bool TagCondition::evaluate(const QVariant& value)
+{
+    // JGT设备的数值以 QJsonValue 形式到达，统一转为普通类型再比较
+    const QVariant plain = value.userType() == QMetaType::QJsonValue ? value.toJsonValue().toVariant() : value;
+    if (isText) {
+        const bool equal = (plain.toString() == text);
+        state = (op == Equal) ? equal : !equal;
+        return state;
+    }
+
+    bool ok = false;
+    double v = 0;
+    if (bit < 0) {
+        v = plain.toDouble(&ok);
+    } else if (plain.userType() == qMetaTypeId<IoBank>()) {
+        // IO组整组发布，按IO点取位
+        v = plain.value<IoBank>().test(bit) ? 1 : 0;
+        ok = true;
+    } else {
+        const qulonglong word = plain.toULongLong(&ok);
+        v = (bit < 64 && ((word >> bit) & 1u)) ? 1 : 0;
+    }
+    if (!ok) {
+        state = false;
+        return state;
+    }
+    // 回差：已成立的条件要退回阈值另一侧 deadband 才恢复
+    const double band = state ? deadband : 0;
+    switch (op) {
+    case Greater: state = v > threshold - band; break;
+    case GreaterEqual: state = v >= threshold - band; break;
+    case Less: state = v < threshold + band; break;
+    case LessEqual: state = v <= threshold + band; break;
+    case Equal: state = (v == threshold); break;
+    case NotEqual: state = (v != threshold); break;
+    }
+    return state;
+}
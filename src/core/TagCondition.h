@@ -0,0 +1,46 @@
+#ifndef TAGCONDITION_H
+#define TAGCONDITION_H
+
+#include <QJsonObject>
+#include <QString>
+#include <QVariant>
+
+/**
+ * @brief 对一个标签的比较条件，报警规则和联锁规则共用
+ *
+ * 配置格式: { "device": "lsj_001", "tag": "LSJ_YTTemp_Status", "op": ">", "value": 35, "deadband": 2 }
+ * device 缺省为规则所属设备；op 为 > >= < <= == !=(缺省 ==)；value 缺省为1，为字符串时按字符串比较。
+ * deadband 为 >、<、>=、<= 的回差：条件成立后要越过阈值再退回 deadband 才恢复。
+ * bit 可选，取值中的一位(0或1)再比较：值为 IoBank(如ZMotion的 input_bank/output_bank)时
+ * 为相对 firstIo 的IO点编号，值为整数(如状态字)时为位号，如 { "tag": "input_bank", "bit": 5, "value": 0 }。
+ */
+struct TagCondition
+{
+    enum Op { Greater, GreaterEqual, Less, LessEqual, Equal, NotEqual };
+
+    QString device;
+    QString tag;
+    Op op = Equal;
+    double threshold = 1;
+    QString text;           ///< 字符串比较时的值
+    bool isText = false;
+    double deadband = 0;
+    int bit = -1;           ///< 取值中的位，-1表示比较整个值
+    bool state = false;     ///< 上次评估结果，回差依赖它
+
+    /**
+     * @brief 解析条件
+     * @param object 条件配置
+     * @param defaultDevice 未写 device 时使用的设备ID
+     * @param error 失败原因
+     */
+    static bool parse(const QJsonObject& object, const QString& defaultDevice, TagCondition* condition, QString* error);
+
+    /**
+     * @brief 用新值评估条件并更新 state
+     * @return 条件是否成立
+     */
+    bool evaluate(const QVariant& value);
+};
+
+#endif // TAGCONDITION_H
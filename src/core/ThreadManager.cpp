@@ -35,22 +35,38 @@ bool ThreadManager::startDeviceThread(Device* device)
         return false;
     }
 
-    QThread* thread = new QThread;
+    const QString group = device->threadGroup();
+    QThread* thread = group.isEmpty() ? nullptr : m_groupThreads.value(group).data();
+    const bool newThread = !thread || !thread->isRunning();
+    if (newThread) {
+        thread = new QThread;
+        // 线程结束时，自动删除线程对象
+        connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+        if (!group.isEmpty()) {
+            m_groupThreads.insert(group, thread);
+        }
+    }
     device->moveToThread(thread);
 
-    // 线程结束时，自动删除线程对象
-    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
-    // 线程启动后，先在线程内初始化，然后连接设备
-    connect(thread, &QThread::started, device, [device](){
-        device->initInThread();
-        device->connectDevice();
-    });
+    if (newThread) {
+        // 线程启动后，先在线程内初始化，然后连接设备
+        connect(thread, &QThread::started, device, [device](){
+            device->initInThread();
+            device->connectDevice();
+        });
+    } else {
+        // 加入已在运行的组线程：按顺序排队到该线程中初始化和连接
+        QMetaObject::invokeMethod(device, "initInThread", Qt::QueuedConnection);
+        QMetaObject::invokeMethod(device, "connectDevice", Qt::QueuedConnection);
+    }
     // 线程管理器析构时，通知设备停止工作
     connect(this, &ThreadManager::aboutToQuit, device, &Device::stop, Qt::QueuedConnection);
 
     m_threads.insert(device->deviceId(), thread);
     m_deviceManager->registerDeviceThread(device->deviceId(), thread);
-    thread->start();
+    if (newThread) {
+        thread->start();
+    }
 
     return true;
 }
@@ -5,6 +5,7 @@
 #include <QMap>
 #include <QString>
 #include <QThread>
+#include <QPointer>
 
 class Device;
 class DeviceManager;
@@ -32,14 +33,15 @@ public:
     void cleanup();
 
     /**
-     * @brief 为指定设备启动一个新线程
+     * @brief 为指定设备启动一个新线程。Device::threadGroup() 非空且该组的线程已在运行时，
+     *        设备加入该线程(如同一条Modbus总线上的从站)
      * @param device 要启动线程的设备
      * @return 如果线程启动成功，则返回true，否则返回false
      */
     bool startDeviceThread(Device* device);
 
     /**
-     * @brief 停止指定设备的线程
+     * @brief 停止指定设备的线程，同组设备共用的线程会一起停止
      * @param deviceId 要停止线程的设备的ID
      */
     void stopDeviceThread(const QString& deviceId);
@@ -54,6 +56,7 @@ signals:
 private:
     DeviceManager* m_deviceManager; ///< 设备管理器的指针，非所有
     QMap<QString, QThread*> m_threads; ///< 线程映射表，以设备ID为键
+    QMap<QString, QPointer<QThread>> m_groupThreads; ///< 线程分组 -> 该组共用的线程
 };
 
 #endif // THREADMANAGER_H
\ No newline at end of file
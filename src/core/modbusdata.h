@@ -22,8 +22,21 @@ struct ModbusSturct
     bool isReadReg;                //读寄存器还是写寄存器
     QModbusDataUnit::RegisterType  regType;         //寄存器类型
     QList<ModbusParameter> spList;
+    int metricsBlock;              //运行统计中的块编号
+    qint64 dueNs;                  //本轮轮询入队时间，用于统计数据年龄
 };
 
+/* 估算一帧数据区的字节数，用于统计收发字节数
+     * regType: 寄存器类型，线圈和离散输入按位打包
+     * count: 寄存器/位个数
+    */
+static int modbusDataBytes(QModbusDataUnit::RegisterType regType, int count)
+{
+    if(regType == QModbusDataUnit::Coils || regType == QModbusDataUnit::DiscreteInputs)
+        return (count + 7) / 8;
+    return count * 2;
+}
+
 
 
 /* 从寄存器值中获取指定位置、长度的值
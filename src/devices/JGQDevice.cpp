@@ -5,15 +5,30 @@
 #include <QVariant>
 #include <QDebug>
 #include <QJsonArray>
+#include <QModbusReply>
+#include "core/ModbusPlan.h"
+#include "core/DriverRegistry.h"
 
-JGQDevice::JGQDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent)
+namespace {
+// Modbus TCP: MBAP头7字节 + 功能码1字节
+const int kAduOverhead = 8;
+}
+
+REGISTER_DEVICE_DRIVER(JGQDevice, "modbus_tcp", "laser", true);
+
+JGQDevice::JGQDevice(const QString& id, const QString& name, const QJsonObject& config,
+                     const QSharedPointer<const ConfigImage>& image, QObject *parent)
     : Device(id, name, parent)
     , m_config(config)
     , m_modbusDevice(nullptr) // 初始化为空指针
     , m_requestTimer(nullptr) // 初始化为空指针
+    , m_connectTimer(nullptr)
+    , m_scanStartNs(-1)
 {
+    attachConfigImage(m_config, image);
     initDataMap();
     m_serverAddress = m_config["server_address"].toInt();
+    m_connectTimeout = m_config["tcp_params"].toObject()["connect_timeout_ms"].toInt(3000);
 }
 
 JGQDevice::~JGQDevice()
@@ -39,6 +54,17 @@ void JGQDevice::initInThread()
     connect(m_requestTimer, &QTimer::timeout, this, &JGQDevice::processRequestQueue);
     m_requestTimer->setInterval(50); // 帧间隔50ms
     m_requestTimer->setSingleShot(true);
+
+    // 连接超时：对端不可达时不等待系统默认的TCP超时
+    m_connectTimer = new QTimer(this);
+    m_connectTimer->setSingleShot(true);
+    m_connectTimer->setInterval(m_connectTimeout);
+    connect(m_connectTimer, &QTimer::timeout, this, [this]() {
+        if (m_modbusDevice && m_modbusDevice->state() != QModbusDevice::ConnectedState) {
+            m_modbusDevice->disconnectDevice();
+            emit sig_printLog(QString("Connect timed out after %1 ms").arg(m_connectTimeout).toUtf8(), false);
+        }
+    });
 }
 
 void JGQDevice::stop()
@@ -83,6 +109,32 @@ void JGQDevice::writeData2Device(const QString &key, const QString &value)
     }
 }
 
+void JGQDevice::writePriority(const QString &key, const QString &value, qint64 triggerNs)
+{
+    const QPair<quint16, int> indices = m_keyIndexMap.value(key, qMakePair(quint16(0), -1));
+    const auto block = m_dataMap.constFind(indices.first);
+    if (indices.second < 0 || block == m_dataMap.constEnd() || block.value().isReadReg) {
+        qWarning() << "JGQDevice::writePriority: Key not writable:" << key;
+        emit sig_printLog(QString("Priority write %1=%2 rejected: not a writable key").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    if (!isConnected()) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 dropped: not connected").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+
+    // 值写入计划后照常随轮询重复下发；这里另发一次，Modbus TCP 请求可以并行在途
+    writeData2Device(key, value);
+    if (!sendWriteRequest(m_dataMap.value(indices.first))) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 failed to send, retried by polling").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    m_metrics.recordReaction(triggerNs);
+    emit sig_printLog(QString("Priority write %1=%2").arg(key).arg(value).toUtf8(), true);
+}
+
 bool JGQDevice::connectDevice()
 {
     if (!m_modbusDevice)
@@ -93,7 +145,13 @@ bool JGQDevice::connectDevice()
     }
     
     // 复用已有的m_modbusDevice实例进行连接
-    return m_modbusDevice->connectDevice();
+    if (!m_modbusDevice->connectDevice()) {
+        return false;
+    }
+    if (m_connectTimeout > 0) {
+        m_connectTimer->start();
+    }
+    return true;
 }
 
 void JGQDevice::disconnectDevice()
@@ -104,8 +162,23 @@ void JGQDevice::disconnectDevice()
 
 void JGQDevice::onStateChanged(int state)
 {
-    setConnected(state == QModbusDevice::ConnectedState);
-    if (isConnected()) {
+    if (state == QModbusDevice::ConnectedState || state == QModbusDevice::UnconnectedState) {
+        m_connectTimer->stop();
+    }
+    if (state == QModbusDevice::UnconnectedState) {
+        if (isConnected()) {
+            setConnected(false);
+        } else if (m_modbusDevice) {
+            connectAttemptFailed(m_modbusDevice->errorString());
+        }
+    } else if (state == QModbusDevice::ConnectedState) {
+        setConnected(true);
+    } else if (state == QModbusDevice::ClosingState) {
+        // 连接状态在进入 UnconnectedState 时才更新(重连策略据此区分断开和连接失败)，
+        // 关闭过程中就停止轮询，不再向正在关闭的连接发请求
+        m_requestTimer->stop();
+    }
+    if (isConnected() && state != QModbusDevice::ClosingState) {
         // 连接成功后，启动第一次请求处理
         processRequestQueue();
     }
@@ -120,7 +193,13 @@ void JGQDevice::onReadReady()
     if (reply->error() == QModbusDevice::NoError)
     {
         const QModbusDataUnit unit = reply->result();
-        if(unit.valueCount() == 1)
+        // 热加载前发出的请求：该地址的块已删除或寄存器个数已变化，应答按新计划无法解码
+        auto current = m_dataMap.constFind(unit.startAddress());
+        if(current == m_dataMap.constEnd() || current.value().regCount != static_cast<int>(unit.valueCount()))
+        {
+            qDebug()<<QString("JGQDevice：Discard reply for reloaded block %1").arg(unit.startAddress());
+        }
+        else if(unit.valueCount() == 1)
         {
             quint16 regAddr = unit.startAddress();
             quint16 regValue = unit.value(0);
@@ -167,7 +246,7 @@ void JGQDevice::onReadReady()
 
 void JGQDevice::processRequestQueue()
 {
-    if (!isConnected())
+    if (!isConnected() || !m_modbusDevice || m_modbusDevice->state() != QModbusDevice::ConnectedState)
         return;
 
     if (m_requestQueue.isEmpty()) {
@@ -176,6 +255,7 @@ void JGQDevice::processRequestQueue()
             return;
     }
     ModbusSturct infoStruct = m_requestQueue.dequeue();
+    m_metrics.setQueueDepth(m_requestQueue.size());
 
     if (infoStruct.isReadReg)
     {
@@ -193,9 +273,17 @@ void JGQDevice::processRequestQueue()
 
 void JGQDevice::generatePollingRequests()
 {
+    // 两次生成轮询请求的间隔即一个完整扫描周期
+    qint64 now = m_metrics.nowNs();
+    if (m_scanStartNs >= 0) {
+        m_metrics.recordScanCycle(now - m_scanStartNs);
+    }
+    m_scanStartNs = now;
+
     QMap<quint16, ModbusSturct>::iterator itr = m_dataMap.begin();
     while(itr != m_dataMap.end())
     {
+        itr.value().dueNs = now;
         m_requestQueue.enqueue(itr.value());
         itr++;
     }
@@ -203,69 +291,55 @@ void JGQDevice::generatePollingRequests()
 
 void JGQDevice::initDataMap()
 {
-    int addrOffSet = m_config["modbus_offset"].toInt();
-    QJsonArray registers = m_config["registers"].toArray();
-    for (const QJsonValue& value : registers)
-    {
-        QJsonObject obj = value.toObject();
-        quint16 address = obj["address"].toInt() + addrOffSet;
-        QString key = obj["key"].toString();
-        QString name = obj["name"].toString();
-        quint16 length = obj["length"].toInt();
-        quint16 bitpos = obj["bitpos"].toInt();
-        QString access = obj["access"].toString();
-        QModbusDataUnit::RegisterType regType;
-        if(obj["regtype"].toString() == "coil"){
-            regType = QModbusDataUnit::Coils;
-        }else if(obj["regtype"].toString() == "discrete_input"){
-            regType = QModbusDataUnit::DiscreteInputs;
-        }
-        else if(obj["regtype"].toString() == "input_register"){
-            regType = QModbusDataUnit::InputRegisters;
-        }
-        else if(obj["regtype"].toString() == "holding_register"){
-            regType = QModbusDataUnit::HoldingRegisters;
-        }else{
-            regType = QModbusDataUnit::Invalid;
-        }
-        ModbusParameter infoParam;
-        infoParam.address = address;
-        infoParam.key = key;
-        infoParam.name = name;
-        infoParam.length = length;
-        infoParam.bitpos = bitpos;
-        infoParam.access = access;
-        infoParam.regType = regType;
-        infoParam.value = 0; // 初始化为0
-
-        int regCount = 1;
-        if(length == 32)
-            regCount = 2;
-        else if(length == 64)
-            regCount = 4;
-
-        bool isReadReg = true;
-        if(access.contains("write"))
-            isReadReg = false;
-
-        if(m_dataMap.find(address) != m_dataMap.end())
-        {
-            m_dataMap[address].spList.append(infoParam);
-            int newIndex = m_dataMap[address].spList.size() - 1;
-            m_keyIndexMap[key] = qMakePair(address, newIndex);
-        }
-        else
-        {
-            ModbusSturct infoStruct;
-            infoStruct.address = address;
-            infoStruct.regCount = regCount;
-            infoStruct.isReadReg = isReadReg;
-            infoStruct.regType = regType;
-            infoStruct.spList.append(infoParam);
-            m_dataMap.insert(address,infoStruct);
-            m_keyIndexMap[key] = qMakePair(address, 0);
+    if (!m_configImage) {
+        return;
+    }
+    buildModbusPlan(*m_configImage, m_metrics, m_dataMap, m_keyIndexMap);
+}
+
+bool JGQDevice::applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary)
+{
+    // 在新容器中建立计划后一次交换；本函数在设备线程中执行，轮询不会看到建立到一半的计划
+    QMap<quint16, ModbusSturct> dataMap;
+    QMap<QString, QPair<quint16, int>> keyIndexMap;
+    ModbusPlanDiff diff;
+    buildModbusPlan(image, m_metrics, dataMap, keyIndexMap, &m_dataMap, &diff);
+    m_dataMap.swap(dataMap);
+    m_keyIndexMap.swap(keyIndexMap);
+    remapModbusQueue(m_requestQueue, m_dataMap);
+    m_metrics.setQueueDepth(m_requestQueue.size());
+
+    QStringList notes;
+    notes << diff.summary();
+    const QJsonObject oldTcp = m_config["tcp_params"].toObject();
+    const QJsonObject newTcp = config["tcp_params"].toObject();
+    m_config = config;
+    m_serverAddress = m_config["server_address"].toInt();
+    m_connectTimeout = newTcp["connect_timeout_ms"].toInt(3000);
+    if (m_connectTimer) {
+        m_connectTimer->setInterval(m_connectTimeout);
+    }
+    if (m_modbusDevice) {
+        QJsonObject protocolParams = m_config["protocol_params"].toObject();
+        m_modbusDevice->setTimeout(protocolParams["response_timeout"].toInt());
+        m_modbusDevice->setNumberOfRetries(protocolParams["retry_count"].toInt());
+        // 对端地址变化只更新连接参数，当前连接保持不变，下次重连时生效
+        if (oldTcp["ip_address"] != newTcp["ip_address"] || oldTcp["port"] != newTcp["port"]) {
+            m_modbusDevice->setConnectionParameter(QModbusDevice::NetworkAddressParameter, newTcp["ip_address"].toString());
+            m_modbusDevice->setConnectionParameter(QModbusDevice::NetworkPortParameter, newTcp["port"].toInt());
+            notes << "endpoint changed, takes effect on next reconnect";
         }
     }
+
+    // 原计划为空时轮询已停止，有了新块后重新启动
+    if (isConnected() && m_requestTimer && !m_requestTimer->isActive()) {
+        m_requestTimer->start();
+    }
+
+    if (summary) {
+        *summary = notes.join(", ");
+    }
+    return true;
 }
 
 QModbusDataUnit JGQDevice::readRequest(QModbusDataUnit::RegisterType regType, quint16 qRegAddr, int iRegCount) const
@@ -370,24 +444,43 @@ void JGQDevice::updateParamValue(quint16 qRegAddr, quint64 qRegValue)
 
 void JGQDevice::sendReadRequest(const ModbusSturct& infoStruct)
 {
-    if (auto *reply = m_modbusDevice->sendReadRequest(readRequest(infoStruct.regType,infoStruct.address,infoStruct.regCount), m_serverAddress))
+    const qint64 startNs = m_metrics.nowNs();
+    if (auto *reply = m_modbusDevice->sendReadRequest(readRequest(infoStruct.regType,infoStruct.address,infoStruct.regCount)
+                                                          ,m_serverAddress))
     {
-        if (!reply->isFinished())
+        m_metrics.addRequest(kAduOverhead + 4);
+        if (!reply->isFinished()) {
+            const int block = infoStruct.metricsBlock;
+            const qint64 dueNs = infoStruct.dueNs;
+            connect(reply, &QModbusReply::finished, this, [this, reply, block, startNs, dueNs](){
+                if (recordReply(reply, block, startNs)) {
+                    m_metrics.recordSample(block, dueNs);
+                }
+            });
             connect(reply, &QModbusReply::finished, this, &JGQDevice::onReadReady);
+        }
         else
             delete reply; // broadcast replies return immediately
     }
+    else
+    {
+        m_metrics.recordTransaction(infoStruct.metricsBlock, startNs, DeviceMetrics::CommError);
+    }
 }
 
-void JGQDevice::sendWriteRequest(const ModbusSturct &infoStruct)
+bool JGQDevice::sendWriteRequest(const ModbusSturct &infoStruct)
 {
     QModbusDataUnit writeUnit = writeRequest(infoStruct.regType,infoStruct.address, infoStruct.regCount);
     QVector<quint16> mList = getWriteRegValues(infoStruct.address);
     writeUnit.setValues(mList);
+    const qint64 startNs = m_metrics.nowNs();
+    const int block = infoStruct.metricsBlock;
     if (auto *reply = m_modbusDevice->sendWriteRequest(writeUnit, m_serverAddress))
     {
+        m_metrics.addRequest(kAduOverhead + 5 + modbusDataBytes(writeUnit.registerType(), writeUnit.valueCount()));
         if (!reply->isFinished()) {
-            connect(reply, &QModbusReply::finished, this, [this, reply](){
+            connect(reply, &QModbusReply::finished, this, [this, reply, block, startNs](){
+                recordReply(reply, block, startNs);
                 if (reply->error() == QModbusDevice::ProtocolError)
                 {
                     qDebug()<<QString("JGQDevice：Write response error: %1 (Mobus exception: 0x%2)")
@@ -408,11 +501,39 @@ void JGQDevice::sendWriteRequest(const ModbusSturct &infoStruct)
             // broadcast replies return immediately
             reply->deleteLater();
         }
+        return true;
     }
     else
     {
         qDebug()<<"JGQDevice：Write error: " + m_modbusDevice->errorString();
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::CommError);
+        return false;
+    }
+}
+
+bool JGQDevice::recordReply(QModbusReply* reply, int block, qint64 startNs)
+{
+    switch (reply->error()) {
+    case QModbusDevice::NoError: {
+        const QModbusDataUnit unit = reply->result();
+        // 读响应带回数据区，写响应只回显地址和数量
+        const bool isRead = reply->rawResult().functionCode() <= QModbusPdu::ReadInputRegisters;
+        m_metrics.addBytesIn(kAduOverhead + (isRead ? 1 + modbusDataBytes(unit.registerType(), unit.valueCount()) : 4));
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::Ok);
+        return true;
+    }
+    case QModbusDevice::TimeoutError:
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::Timeout);
+        break;
+    case QModbusDevice::ProtocolError:
+        m_metrics.addBytesIn(kAduOverhead + 1);
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::ProtocolError);
+        break;
+    default:
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::CommError);
+        break;
     }
+    return false;
 }
 
 const QJsonObject& JGQDevice::getConfig() const
@@ -9,6 +9,7 @@
 
 class QModbusTcpClient;
 class QTimer;
+class QModbusReply;
 
 /**
  * @brief 激光器设备类
@@ -22,9 +23,12 @@ public:
      * @brief 构造一个JGQDevice对象
      * @param id 设备的唯一标识符
      * @param config 设备的配置
+     * @param image 预编译的配置镜像，为空时由 config 编译
      * @param parent 父对象
      */
-    explicit JGQDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent = nullptr);
+    explicit JGQDevice(const QString& id, const QString& name, const QJsonObject& config,
+                       const QSharedPointer<const ConfigImage>& image = QSharedPointer<const ConfigImage>(),
+                       QObject *parent = nullptr);
     ~JGQDevice();
     void writeData2Device(const QString &key,const QString &value);
     bool connectDevice() override;
@@ -35,6 +39,17 @@ public slots:
     void initInThread() override;
     void stop() override;
 
+protected:
+    /**
+     * @brief 热加载：只重建变化的读写块，连接保持不变
+     */
+    bool applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary) override;
+
+    /**
+     * @brief 优先写入：更新值后立即发出该写块的请求，不等轮询队列轮到它
+     */
+    void writePriority(const QString& key, const QString& value, qint64 triggerNs) override;
+
 private slots:
     void onStateChanged(int state);
     void onReadReady();
@@ -42,7 +57,14 @@ private slots:
 
 private:
     void sendReadRequest(const ModbusSturct &infoStruct);
-    void sendWriteRequest(const ModbusSturct &infoStruct);
+    /**
+     * @brief 发送写请求，请求已发出返回true
+     */
+    bool sendWriteRequest(const ModbusSturct &infoStruct);
+    /**
+     * @brief 按应答结果记录事务统计，成功时返回true
+     */
+    bool recordReply(QModbusReply* reply, int block, qint64 startNs);
     void generatePollingRequests();
     void initDataMap();
     QModbusDataUnit readRequest(QModbusDataUnit::RegisterType regType, quint16 qRegAddr, int iRegCount) const;
@@ -58,6 +80,9 @@ private:
     int m_serverAddress;                    ///< Modbus从站地址
     QQueue<ModbusSturct> m_requestQueue;    ///< 请求队列
     QTimer* m_requestTimer;                 ///< 用于控制帧间隔的定时器
+    QTimer* m_connectTimer;                 ///< 连接超时定时器
+    qint64 m_scanStartNs;                   ///< 本轮扫描开始时间，<0表示尚未开始
+    int m_connectTimeout;                   ///< 连接超时(ms)，超时后放弃本次连接
     QMap<quint16,ModbusSturct> m_dataMap;  //保存参数Map Key:寄存器地址 QList<SignalParameter>寄存器下对应的参数列表
 
     //键是 ModbusParameter 的 key ,值 ModbusSturct  address（键），spList 中的索引。
@@ -1,42 +1,172 @@
 ﻿#include "JGTDevice.h"
 #include <QTimer>
 #include <QDebug>
-#include <QJsonArray>
 #include <QJsonObject>
+#include "core/DriverRegistry.h"
 
-JGTDevice::JGTDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent)
+REGISTER_DEVICE_DRIVER(JGTDevice, "tcp_socket", "laser_head", true);
+
+JGTDevice::JGTDevice(const QString& id, const QString& name, const QJsonObject& config,
+                     const QSharedPointer<const ConfigImage>& image, QObject *parent)
     : Device(id, name, parent)
     , m_config(config)
     , m_tcpSocket(nullptr)
+    , m_flushTimer(nullptr)
+    , m_flushPending(false)
+    , m_connectTimer(nullptr)
+    , m_batchStartNs(0)
 {
+    // 预先建立 key <-> command 双向映射，写入和解析应答时都不再访问配置
+    attachConfigImage(m_config, image);
+    if (m_configImage) {
+        buildCommandMaps(*m_configImage, m_commandMap, m_keyByCommand);
+    }
+
+    QJsonObject protocolParams = m_config["protocol_params"].toObject();
+    m_flushInterval = protocolParams["flush_interval_ms"].toInt(0);
+    m_maxBatchBytes = protocolParams["max_batch_bytes"].toInt(1400);
+    m_tcpNoDelay = protocolParams["tcp_nodelay"].toBool(true);
+    m_connectTimeout = m_config["tcp_params"].toObject()["connect_timeout_ms"].toInt(3000);
+
+    // 协议无应答确认，延迟统计的是命令从入缓冲区到写入套接字的批次等待时间
+    m_batchBlock = m_metrics.addBlock("Batch");
 }
 
 JGTDevice::~JGTDevice()
 {
 }
 
+void JGTDevice::buildCommandMaps(const ConfigImage& image, QHash<QString, QByteArray>& commandMap,
+                                 QHash<QByteArray, QString>& keyByCommand)
+{
+    for (int i = 0; i < image.paramCount(); ++i) {
+        const ConfigImage::Param& param = image.param(i);
+        const QString key = image.string(param.key);
+        const QByteArray command = image.string(param.command).toUtf8();
+        commandMap.insert(key, command);
+        keyByCommand.insert(command, key);
+    }
+}
+
+bool JGTDevice::applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary)
+{
+    QHash<QString, QByteArray> commandMap;
+    QHash<QByteArray, QString> keyByCommand;
+    buildCommandMaps(image, commandMap, keyByCommand);
+
+    int added = 0;
+    int changed = 0;
+    for (auto it = commandMap.constBegin(); it != commandMap.constEnd(); ++it) {
+        auto old = m_commandMap.constFind(it.key());
+        if (old == m_commandMap.constEnd()) {
+            ++added;
+        } else if (old.value() != it.value()) {
+            ++changed;
+        }
+    }
+    const int removed = m_commandMap.size() - (commandMap.size() - added);
+    m_commandMap.swap(commandMap);
+    m_keyByCommand.swap(keyByCommand);
+
+    QStringList notes;
+    notes << QString("%1 commands added, %2 removed, %3 changed").arg(added).arg(removed).arg(changed);
+
+    // 批次参数立即生效，已在缓冲区中的命令按新的截止时间发送
+    const QJsonObject oldTcp = m_config["tcp_params"].toObject();
+    m_config = config;
+    QJsonObject protocolParams = m_config["protocol_params"].toObject();
+    m_flushInterval = protocolParams["flush_interval_ms"].toInt(0);
+    m_maxBatchBytes = protocolParams["max_batch_bytes"].toInt(1400);
+    m_tcpNoDelay = protocolParams["tcp_nodelay"].toBool(true);
+    const QJsonObject newTcp = m_config["tcp_params"].toObject();
+    m_connectTimeout = newTcp["connect_timeout_ms"].toInt(3000);
+    if (m_flushTimer) {
+        m_flushTimer->setInterval(m_flushInterval);
+    }
+    if (m_connectTimer) {
+        m_connectTimer->setInterval(m_connectTimeout);
+    }
+    if (m_tcpSocket && m_tcpSocket->state() == QAbstractSocket::ConnectedState) {
+        m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, m_tcpNoDelay ? 1 : 0);
+    }
+    // connectDevice() 每次从配置读取对端地址，当前连接保持不变
+    if (oldTcp["ip_address"] != newTcp["ip_address"] || oldTcp["port"] != newTcp["port"]) {
+        notes << "endpoint changed, takes effect on next reconnect";
+    }
+
+    if (summary) {
+        *summary = notes.join(", ");
+    }
+    return true;
+}
+
 void JGTDevice::initInThread()
 {
     m_tcpSocket = new QTcpSocket(this);
     connect(m_tcpSocket, &QTcpSocket::stateChanged, this, &JGTDevice::onSocketStateChanged);
     connect(m_tcpSocket, &QTcpSocket::readyRead, this, &JGTDevice::onReadyRead);
+
+    // 微批次定时器：同一批次内的写入合并后一次发送
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(m_flushInterval);
+    connect(m_flushTimer, &QTimer::timeout, this, &JGTDevice::flushTxBuffer);
+
+    // 连接超时：对端不可达时不等待系统默认的TCP超时
+    m_connectTimer = new QTimer(this);
+    m_connectTimer->setSingleShot(true);
+    m_connectTimer->setInterval(m_connectTimeout);
+    connect(m_connectTimer, &QTimer::timeout, this, [this]() {
+        if (m_tcpSocket->state() != QAbstractSocket::ConnectedState) {
+            m_tcpSocket->abort();
+            emit sig_printLog(QString("Connect timed out after %1 ms").arg(m_connectTimeout).toUtf8(), false);
+        }
+    });
+
+    // reserve后resize(0)不会释放内存，缓冲区可在批次间复用
+    m_txBuffer.reserve(m_maxBatchBytes);
 }
 
 void JGTDevice::writeData2Device(const QString &key, const QString &value)
 {
-    // Find the command from config
-    QJsonArray registers = m_config["registers"].toArray();
-    for (const QJsonValue& val : registers) {
-        QJsonObject obj = val.toObject();
-        if (obj["key"].toString() == key) {
-            QString command = obj["command"].toString();
-            if (m_tcpSocket && m_tcpSocket->state() == QAbstractSocket::ConnectedState) {
-                m_tcpSocket->write(encodeRequest(command, value));
-            }
-            return;
-        }
+    auto it = m_commandMap.constFind(key);
+    if (it == m_commandMap.constEnd()) {
+        qWarning() << "JGTDevice: Could not find key" << key << "in config";
+        return;
+    }
+
+    if (m_tcpSocket && m_tcpSocket->state() == QAbstractSocket::ConnectedState) {
+        encodeRequest(it.value(), value);
+        scheduleFlush();
     }
-    qWarning() << "JGTDevice: Could not find key" << key << "in config";
+}
+
+void JGTDevice::writePriority(const QString &key, const QString &value, qint64 triggerNs)
+{
+    auto it = m_commandMap.constFind(key);
+    if (it == m_commandMap.constEnd()) {
+        qWarning() << "JGTDevice::writePriority: Key not writable:" << key;
+        emit sig_printLog(QString("Priority write %1=%2 rejected: not a writable key").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    if (!m_tcpSocket || m_tcpSocket->state() != QAbstractSocket::ConnectedState) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 dropped: not connected").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+
+    // 已缓冲的命令先于本条，一并立即写出，截止定时器和已投递的刷新随之作废
+    encodeRequest(it.value(), value);
+    if (m_flushTimer) {
+        m_flushTimer->stop();
+    }
+    if (!flushTxBuffer()) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 failed: %3").arg(key).arg(value)
+                          .arg(m_tcpSocket->errorString()).toUtf8(), true);
+        return;
+    }
+    m_metrics.recordReaction(triggerNs);
 }
 
 bool JGTDevice::connectDevice()
@@ -50,6 +180,9 @@ bool JGTDevice::connectDevice()
         QString ip = tcpParams["ip_address"].toString();
         int port = tcpParams["port"].toInt();
         m_tcpSocket->connectToHost(ip, port);
+        if (m_connectTimeout > 0) {
+            m_connectTimer->start();
+        }
     }
     return true; // Asynchronous connection
 }
@@ -73,71 +206,154 @@ void JGTDevice::writeText2Device(const QString &text)
 
     if (m_tcpSocket && m_tcpSocket->state() == QAbstractSocket::ConnectedState)
     {
-        QByteArray bytes = text.toUtf8();
-        m_tcpSocket->write(bytes);
-        emit sig_printLog(bytes,true);
+        if (m_txBuffer.isEmpty()) {
+            m_batchStartNs = m_metrics.nowNs();
+        }
+        m_txBuffer.append(text.toUtf8());
+        scheduleFlush();
     }
 }
 
 void JGTDevice::stop()
 {
+    if (m_flushTimer) {
+        m_flushTimer->stop();
+    }
+    flushTxBuffer();
     disconnectDevice();
 }
 
 void JGTDevice::onSocketStateChanged(QAbstractSocket::SocketState socketState)
 {
     bool connected = (socketState == QAbstractSocket::ConnectedState);
-    emit connectedChanged(deviceId(), connected);
+    if (connected || socketState == QAbstractSocket::UnconnectedState) {
+        m_connectTimer->stop();
+    }
+    if (connected) {
+        // 套接字引擎在连接建立后才存在，选项需在此时设置
+        m_tcpSocket->setSocketOption(QAbstractSocket::LowDelayOption, m_tcpNoDelay ? 1 : 0);
+    } else if (socketState == QAbstractSocket::UnconnectedState) {
+        // 断开后丢弃未发送的命令，避免重连后发送过期参数
+        if (!m_txBuffer.isEmpty()) {
+            m_metrics.recordTransaction(m_batchBlock, m_batchStartNs, DeviceMetrics::CommError);
+        }
+        m_txBuffer.resize(0);
+        if (m_flushTimer) {
+            m_flushTimer->stop();
+        }
+    }
+
+    // 只在连接建立或彻底断开时更新状态，连接过程中的中间状态不影响重连判断
+    if (connected) {
+        setConnected(true);
+    } else if (socketState == QAbstractSocket::UnconnectedState) {
+        if (isConnected()) {
+            setConnected(false);
+        } else {
+            connectAttemptFailed(m_tcpSocket->errorString());
+        }
+    }
 }
 
 void JGTDevice::onReadyRead()
 {
     QByteArray data = m_tcpSocket->readAll();
     if (!data.isEmpty()) {
+        m_metrics.addBytesIn(data.size());
         emit sig_printLog(data, false);
         // 如果需要，可以在这里直接调用解析逻辑
 //         parseResponse(data);
     }
 }
 
-QByteArray JGTDevice::encodeRequest(const QString& command, const QString& value)
+void JGTDevice::encodeRequest(const QByteArray& command, const QString& value)
 {
     // Protocol: <command,value>
-    return QString("<%1,%2>").arg(command).arg(value).toUtf8();
+    if (m_txBuffer.isEmpty()) {
+        m_batchStartNs = m_metrics.nowNs();
+    }
+    m_txBuffer.append('<');
+    m_txBuffer.append(command);
+    m_txBuffer.append(',');
+    // 参数值通常是纯ASCII数字，直接逐字节写入缓冲区，避免临时QByteArray
+    const QChar* chars = value.constData();
+    const int len = value.size();
+    for (int i = 0; i < len; ++i) {
+        const ushort c = chars[i].unicode();
+        if (c >= 0x80) {
+            m_txBuffer.append(value.midRef(i).toUtf8());
+            break;
+        }
+        m_txBuffer.append(static_cast<char>(c));
+    }
+    m_txBuffer.append('>');
+}
+
+void JGTDevice::scheduleFlush()
+{
+    if (m_txBuffer.size() >= m_maxBatchBytes) {
+        if (m_flushTimer) {
+            m_flushTimer->stop();
+        }
+        flushTxBuffer();
+        return;
+    }
+
+    if (m_flushInterval > 0) {
+        // 截止时间从批次中第一条命令开始计算，后续命令不再推迟发送
+        if (m_flushTimer && !m_flushTimer->isActive()) {
+            m_flushTimer->start();
+        }
+    } else if (!m_flushPending) {
+        // 当前事件中的所有写入处理完毕后再统一发送
+        m_flushPending = true;
+        QMetaObject::invokeMethod(this, "flushTxBuffer", Qt::QueuedConnection);
+    }
+}
+
+bool JGTDevice::flushTxBuffer()
+{
+    m_flushPending = false;
+    if (m_txBuffer.isEmpty()) {
+        return false;
+    }
+
+    bool written = false;
+    if (m_tcpSocket && m_tcpSocket->state() == QAbstractSocket::ConnectedState
+            && m_tcpSocket->write(m_txBuffer) == m_txBuffer.size()) {
+        written = true;
+        // 立即交给内核，整批命令只产生一次系统调用
+        m_tcpSocket->flush();
+        m_metrics.addRequest(m_txBuffer.size());
+        m_metrics.recordTransaction(m_batchBlock, m_batchStartNs);
+        // 日志发出深拷贝：共享缓冲区会使下面的 resize(0) 分离出新缓冲区，丢掉预留的容量
+        emit sig_printLog(QByteArray(m_txBuffer.constData(), m_txBuffer.size()), true);
+    } else {
+        m_metrics.recordTransaction(m_batchBlock, m_batchStartNs, DeviceMetrics::CommError);
+    }
+    m_txBuffer.resize(0);
+    return written;
 }
 
 void JGTDevice::parseResponse(const QByteArray& data)
 {
-    QString responseStr(data);
-    // The response might contain multiple messages concatenated, e.g., "<MSG1><MSG2>"
-    // We need to split them. A simple way is to replace "><" with a unique separator and then split.
-    responseStr.replace("><", ">#<");
-    QStringList messages = responseStr.split('#');
-
-    for (const QString& msg : messages) {
-        if (msg.startsWith('<') && msg.endsWith('>')) {
-            // Remove '<' and '>'
-            QString content = msg.mid(1, msg.length() - 2);
-            // content is now "COMMAND,VALUE" or "COMMAND"
-            QStringList parts = content.split(',');
-            if (parts.isEmpty()) continue;
-
-            QString command = parts[0];
-            QString value = (parts.size() > 1) ? parts[1] : "";
-
-            // Find the key associated with this command
-            QJsonArray registers = m_config["registers"].toArray();
-            for (const QJsonValue& regVal : registers) {
-                QJsonObject obj = regVal.toObject();
-                if (obj["command"].toString() == command) {
-                    QString key = obj["key"].toString();
-                    // Update DataManager with the new value
-                    emit dataUpdated(deviceId(), key, QJsonValue(value));
-                    qDebug() << "JGTDevice parsed response for key:" << key << "value:" << value;
-                    break; // Found command, move to next message in the frame
-                }
-            }
+    // 应答可能是多条消息拼接，如 "<MSG1><MSG2>"，逐条按 '<' ... '>' 切分，
+    // 消息内容为 "COMMAND,VALUE" 或 "COMMAND"
+    int pos = 0;
+    while ((pos = data.indexOf('<', pos)) >= 0) {
+        const int end = data.indexOf('>', pos + 1);
+        if (end < 0) {
+            break;
+        }
+        const int comma = data.indexOf(',', pos + 1);
+        const bool hasValue = comma >= 0 && comma < end;
+        const QByteArray command = data.mid(pos + 1, (hasValue ? comma : end) - pos - 1);
+        auto it = m_keyByCommand.constFind(command);
+        if (it != m_keyByCommand.constEnd()) {
+            const QString value = hasValue ? QString::fromUtf8(data.constData() + comma + 1, end - comma - 1) : QString();
+            emit dataUpdated(deviceId(), it.value(), QJsonValue(value));
         }
+        pos = end + 1;
     }
 }
 
@@ -3,6 +3,7 @@
 
 #include "core/Device.h"
 #include <QJsonObject>
+#include <QHash>
 #include <QTcpSocket>
 #include <QTimer>
 
@@ -13,7 +14,9 @@ class JGTDevice : public Device
     Q_OBJECT
 
 public:
-    explicit JGTDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent = nullptr);
+    explicit JGTDevice(const QString& id, const QString& name, const QJsonObject& config,
+                       const QSharedPointer<const ConfigImage>& image = QSharedPointer<const ConfigImage>(),
+                       QObject *parent = nullptr);
     ~JGTDevice();
 
     void disconnectDevice() override;
@@ -26,18 +29,54 @@ public slots:
     void writeText2Device(const QString &text) override;
     void stop() override;
 
+protected:
+    /**
+     * @brief 热加载：重建命令映射并更新批次参数，连接保持不变
+     */
+    bool applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary) override;
+
+    /**
+     * @brief 优先写入：连同缓冲区中已有的命令立即发送，不等微批次截止
+     */
+    void writePriority(const QString& key, const QString& value, qint64 triggerNs) override;
 
 private slots:
     void onSocketStateChanged(QAbstractSocket::SocketState socketState);
     void onReadyRead();
+    /**
+     * @brief 将发送缓冲区中累积的所有命令一次性写入套接字
+     * @return 已写入套接字返回true，缓冲区为空或未连接时返回false
+     */
+    bool flushTxBuffer();
 
 private:
-    QByteArray encodeRequest(const QString& command, const QString& value);
+    /**
+     * @brief 将 <command,value> 直接编码追加到发送缓冲区
+     */
+    void encodeRequest(const QByteArray& command, const QString& value);
+    /**
+     * @brief 安排一次发送：本轮事件循环结束时或微批次截止时间到达时刷新
+     */
+    void scheduleFlush();
     void parseResponse(const QByteArray& data);
+    static void buildCommandMaps(const ConfigImage& image, QHash<QString, QByteArray>& commandMap,
+                                 QHash<QByteArray, QString>& keyByCommand);
 
     QJsonObject m_config;
     QTcpSocket* m_tcpSocket;
 
+    QHash<QString, QByteArray> m_commandMap; ///< key -> 协议命令字，构造时从配置镜像建立
+    QHash<QByteArray, QString> m_keyByCommand; ///< 协议命令字 -> key，解析应答用
+    QByteArray m_txBuffer;                   ///< 可复用的发送缓冲区，多条命令合并为一个TCP段
+    QTimer* m_flushTimer;                    ///< 微批次截止定时器
+    bool m_flushPending;                     ///< 是否已投递本轮事件循环的刷新
+    int m_flushInterval;                     ///< 微批次截止时间(ms)，0表示在本轮事件循环结束时刷新
+    int m_maxBatchBytes;                     ///< 缓冲区达到该字节数时立即刷新
+    bool m_tcpNoDelay;                       ///< 是否关闭Nagle算法(TCP_NODELAY)
+    QTimer* m_connectTimer;                  ///< 连接超时定时器
+    int m_connectTimeout;                    ///< 连接超时(ms)，超时后放弃本次连接
+    int m_batchBlock;                        ///< 运行统计中批次发送的块编号
+    qint64 m_batchStartNs;                   ///< 当前批次第一条命令入缓冲区的时间
 };
 
 #endif // JGTDEVICE_H
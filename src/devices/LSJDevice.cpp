@@ -3,21 +3,38 @@
  * @brief LSJDevice类的实现
  */
 #include "LSJDevice.h"
-#include <QModbusRtuSerialMaster>
+#include <QModbusClient>
 #include <QModbusDataUnit>
 #include <QTimer>
 #include <QVariant>
 #include <QDebug>
-#include <QSerialPort>
 #include <QJsonArray>
-LSJDevice::LSJDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent)
+#include <QModbusReply>
+#include "core/ModbusPlan.h"
+#include "core/DriverRegistry.h"
+#include "core/ModbusBus.h"
+
+namespace {
+// Modbus RTU: 从站地址1字节 + 功能码1字节 + CRC 2字节
+const int kAduOverhead = 4;
+// 请求未能发出(如串口已断开)时，等待多久再申请总线
+const int kRetryInterval = 100;
+}
+
+REGISTER_DEVICE_DRIVER(LSJDevice, "modbus_rtu", "chiller", true);
+
+LSJDevice::LSJDevice(const QString& id, const QString& name, const QJsonObject& config,
+                     const QSharedPointer<const ConfigImage>& image, QObject *parent)
     : Device(id, name, parent)
     , m_config(config)
-    , m_modbusDevice(nullptr)
+    , m_bus(nullptr)
     , m_requestTimer(nullptr)
+    , m_scanStartNs(-1)
 {
+    attachConfigImage(m_config, image);
     initDataMap();
     m_serverAddress = m_config["server_address"].toInt();
+    m_scanInterval = m_config["protocol_params"].toObject()["scan_interval_ms"].toInt(0);
 }
 
 LSJDevice::~LSJDevice()
@@ -26,22 +43,17 @@ LSJDevice::~LSJDevice()
 
 void LSJDevice::initInThread()
 {
-    m_modbusDevice = new QModbusRtuSerialMaster(this);
-    connect(m_modbusDevice, &QModbusClient::stateChanged, this, &LSJDevice::onStateChanged);
-
-    QJsonObject rtuParams = m_config["rtu_params"].toObject();
-    m_modbusDevice->setConnectionParameter(QModbusDevice::SerialPortNameParameter, rtuParams["port_name"].toString());
-    m_modbusDevice->setConnectionParameter(QModbusDevice::SerialBaudRateParameter, 9600);
-    m_modbusDevice->setConnectionParameter(QModbusDevice::SerialDataBitsParameter, QSerialPort::Data8);
-    m_modbusDevice->setConnectionParameter(QModbusDevice::SerialParityParameter, QSerialPort::NoParity);
-    m_modbusDevice->setConnectionParameter(QModbusDevice::SerialStopBitsParameter, QSerialPort::OneStop);
-
-    QJsonObject protocolParams = m_config["protocol_params"].toObject();
-    m_modbusDevice->setTimeout(protocolParams["response_timeout"].toInt());
-    m_modbusDevice->setNumberOfRetries(protocolParams["retry_count"].toInt());
+    // 同一串口或网关上的设备共用一条总线，由总线调度器轮流发送，不再各自按固定帧间隔发送
+    m_bus = ModbusBus::acquire(m_config, this);
+    if (m_bus) {
+        connect(m_bus->client(), &QModbusClient::stateChanged, this, &LSJDevice::onStateChanged);
+    } else {
+        emit sig_printLog(QString("Modbus bus %1 is not available in this thread").arg(ModbusBus::busKey(m_config)).toUtf8(), false);
+    }
 
+    // 请求发送失败后的重试，以及扫描间隔未到时的等待
     m_requestTimer = new QTimer(this);
-    m_requestTimer->setInterval(100); // 帧间隔100ms
+    m_requestTimer->setInterval(kRetryInterval);
     m_requestTimer->setSingleShot(true);
     connect(m_requestTimer, &QTimer::timeout, this, &LSJDevice::processRequestQueue);
 }
@@ -52,10 +64,11 @@ void LSJDevice::stop()
         m_requestTimer->stop();
     }
 
-    if (m_modbusDevice) {
-        m_modbusDevice->disconnectDevice();
-        m_modbusDevice->deleteLater(); // Use deleteLater for safety within a slot
-        m_modbusDevice = nullptr;
+    if (m_bus) {
+        // 最后一个退出的设备关闭总线
+        disconnect(m_bus->client(), nullptr, this, nullptr);
+        m_bus->release(this);
+        m_bus = nullptr;
     }
 }
 
@@ -96,25 +109,119 @@ void LSJDevice::writeData2Device(const QString &key, const QString &value)
 
 bool LSJDevice::connectDevice()
 {
-    if (!m_modbusDevice)
+    if (!m_bus)
         return false;
 
-    if (m_modbusDevice->state() != QModbusDevice::UnconnectedState) {
-        m_modbusDevice->disconnectDevice();
+    // 总线可能已由同一总线上的其他设备连接好
+    if (m_bus->client()->state() == QModbusDevice::ConnectedState) {
+        onStateChanged(QModbusDevice::ConnectedState);
+        return true;
     }
-
-    return m_modbusDevice->connectDevice();
+    return m_bus->open();
 }
 
 void LSJDevice::disconnectDevice()
 {
-    if (m_modbusDevice)
-        m_modbusDevice->disconnectDevice();
+    // 总线上还有其他设备时不关闭连接
+    if (m_bus && m_bus->memberCount() == 1)
+        m_bus->close();
+}
+
+void LSJDevice::writePriority(const QString &key, const QString &value, qint64 triggerNs)
+{
+    const QPair<quint16, int> indices = m_keyIndexMap.value(key, qMakePair(quint16(0), -1));
+    const auto block = m_dataMap.constFind(indices.first);
+    if (indices.second < 0 || block == m_dataMap.constEnd() || block.value().isReadReg) {
+        qWarning() << "LSJDevice::writePriority: Key not writable:" << key;
+        emit sig_printLog(QString("Priority write %1=%2 rejected: not a writable key").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    if (!isConnected() || !m_bus) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 dropped: not connected").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+
+    writeData2Device(key, value);
+    m_priorityWrites.enqueue(qMakePair(indices.first, triggerNs));
+    m_bus->requestTurn(this, true);
+    emit sig_printLog(QString("Priority write %1=%2").arg(key).arg(value).toUtf8(), true);
+}
+
+bool LSJDevice::sendNextRequest()
+{
+    if (!isConnected())
+        return false;
+
+    // 优先写入先于轮询请求，每次总线交给本设备时发一个
+    while (!m_priorityWrites.isEmpty()) {
+        const QPair<quint16, qint64> write = m_priorityWrites.dequeue();
+        const auto block = m_dataMap.constFind(write.first);
+        if (block == m_dataMap.constEnd()) {
+            continue;   // 写块已被热加载删除
+        }
+        const bool inFlight = sendWriteRequest(block.value());
+        if (inFlight) {
+            m_metrics.recordReaction(write.second);
+        } else {
+            m_metrics.recordReactionFailure();
+            emit sig_printLog(QString("Priority write of block %1 failed to send, retried by polling").arg(write.first).toUtf8(), true);
+        }
+        if (!m_priorityWrites.isEmpty()) {
+            m_bus->requestTurn(this, true);
+        }
+        if (inFlight) {
+            return true;
+        }
+    }
+
+    if (m_requestQueue.isEmpty()) {
+        // 扫描间隔未到时先让出总线，到时再申请
+        if (m_scanInterval > 0 && m_scanStartNs >= 0) {
+            const qint64 remainingMs = m_scanInterval - (m_metrics.nowNs() - m_scanStartNs) / 1000000;
+            if (remainingMs > 0) {
+                m_requestTimer->start(static_cast<int>(remainingMs));
+                return false;
+            }
+        }
+        generatePollingRequests();
+        // 如果生成请求后队列仍为空（例如没有可读寄存器），则等待下一个写请求
+        if (m_requestQueue.isEmpty())
+            return false;
+    }
+    ModbusSturct infoStruct = m_requestQueue.dequeue();
+    m_metrics.setQueueDepth(m_requestQueue.size());
+
+    const bool inFlight = infoStruct.isReadReg ? sendReadRequest(infoStruct) : sendWriteRequest(infoStruct);
+    if (!inFlight) {
+        m_requestTimer->start(kRetryInterval);
+    }
+    return inFlight;
+}
+
+QString LSJDevice::memberName() const
+{
+    return deviceId();
 }
 
 void LSJDevice::onStateChanged(int state)
 {
-    setConnected(state == QModbusDevice::ConnectedState);
+    if (state == QModbusDevice::UnconnectedState) {
+        if (!m_priorityWrites.isEmpty()) {
+            emit sig_printLog(QString("%1 priority writes dropped: disconnected").arg(m_priorityWrites.size()).toUtf8(), true);
+            for (int i = 0; i < m_priorityWrites.size(); ++i) {
+                m_metrics.recordReactionFailure();
+            }
+            m_priorityWrites.clear();
+        }
+        if (isConnected()) {
+            setConnected(false);
+        } else if (m_bus) {
+            connectAttemptFailed(m_bus->client()->errorString());
+        }
+    } else if (state == QModbusDevice::ConnectedState) {
+        setConnected(true);
+    }
     if (isConnected()) {
         // 连接成功后，启动第一次请求处理
         processRequestQueue();
@@ -130,7 +237,13 @@ void LSJDevice::onReadReady()
     if (reply->error() == QModbusDevice::NoError)
     {
         const QModbusDataUnit unit = reply->result();
-        if(unit.valueCount() == 1)
+        // 热加载前发出的请求：该地址的块已删除或寄存器个数已变化，应答按新计划无法解码
+        auto current = m_dataMap.constFind(unit.startAddress());
+        if(current == m_dataMap.constEnd() || current.value().regCount != static_cast<int>(unit.valueCount()))
+        {
+            qDebug()<<QString("LSJDevice：Discard reply for reloaded block %1").arg(unit.startAddress());
+        }
+        else if(unit.valueCount() == 1)
         {
             quint16 regAddr = unit.startAddress();
             quint16 regValue = unit.value(0);
@@ -183,37 +296,26 @@ void LSJDevice::onReadReady()
 
 void LSJDevice::processRequestQueue()
 {
-    if (!isConnected())
+    if (!isConnected() || !m_bus)
         return;
 
-    if (m_requestQueue.isEmpty()) {
-        generatePollingRequests();
-        // 如果生成请求后队列仍为空（例如没有可读寄存器），则等待下一个写请求
-        if (m_requestQueue.isEmpty())
-            return;
-    }
-//    qDebug()<<"queue:"<<m_requestQueue.size();
-    ModbusSturct infoStruct = m_requestQueue.dequeue();
-
-    if (infoStruct.isReadReg)
-    {
-        sendReadRequest(infoStruct);
-    }
-    else
-    {
-        sendWriteRequest(infoStruct);
-    }
-
-    if (!m_requestTimer->isActive()) {
-        m_requestTimer->start();
-    }
+    // 请求在轮到本设备使用总线时由 sendNextRequest() 发出
+    m_bus->requestTurn(this);
 }
 
 void LSJDevice::generatePollingRequests()
 {
+    // 两次生成轮询请求的间隔即一个完整扫描周期
+    qint64 now = m_metrics.nowNs();
+    if (m_scanStartNs >= 0) {
+        m_metrics.recordScanCycle(now - m_scanStartNs);
+    }
+    m_scanStartNs = now;
+
     QMap<quint16, ModbusSturct>::iterator itr = m_dataMap.begin();
     while(itr != m_dataMap.end())
     {
+        itr.value().dueNs = now;
         m_requestQueue.enqueue(itr.value());
         itr++;
     }
@@ -221,74 +323,46 @@ void LSJDevice::generatePollingRequests()
 
 void LSJDevice::initDataMap()
 {
-    int addrOffSet = m_config["modbus_offset"].toInt();
-    QJsonArray registers = m_config["registers"].toArray();
-    for (const QJsonValue& value : registers)
-    {
-        QJsonObject obj = value.toObject();
-        quint16 address = obj["address"].toInt() + addrOffSet;
-        QString key = obj["key"].toString();
-        QString name = obj["name"].toString();
-        quint16 length = obj["length"].toInt();
-        quint16 bitpos = obj["bitpos"].toInt();
-        QString access = obj["access"].toString();
-        QModbusDataUnit::RegisterType regType;
-        if(obj["regtype"].toString() == "coil"){
-            regType = QModbusDataUnit::Coils;
-        }else if(obj["regtype"].toString() == "discrete_input"){
-            regType = QModbusDataUnit::DiscreteInputs;
-        }
-        else if(obj["regtype"].toString() == "input_register"){
-            regType = QModbusDataUnit::InputRegisters;
-        }
-        else if(obj["regtype"].toString() == "holding_register"){
-            regType = QModbusDataUnit::HoldingRegisters;
-        }else{
-            regType = QModbusDataUnit::Invalid;
-        }
-        ModbusParameter infoParam;
-        infoParam.address = address;
-        infoParam.key = key;
-        infoParam.name = name;
-        infoParam.length = length;
-        infoParam.bitpos = bitpos;
-        infoParam.access = access;
-        infoParam.regType = regType;
-        infoParam.value = 0; // 初始化为0
-
-        int regCount = 1;
-        if(length == 32)
-            regCount = 2;
-        else if(length == 64)
-            regCount = 4;
-
-        bool isReadReg = true;
-        if(access.contains("write"))
-            isReadReg = false;
-
-        if(m_dataMap.find(address) != m_dataMap.end())
-        {
-            m_dataMap[address].spList.append(infoParam);
+    if (!m_configImage) {
+        return;
+    }
+    buildModbusPlan(*m_configImage, m_metrics, m_dataMap, m_keyIndexMap);
+}
 
-            // 更新 m_keyIndexMap：记录新添加的 ModbusParameter 的位置
-            int newIndex = m_dataMap[address].spList.size() - 1; // 新元素的索引
-            m_keyIndexMap[key] = qMakePair(address, newIndex);
-        }
-        else
-        {
-            ModbusSturct infoStruct;
-            infoStruct.address = address;
-            infoStruct.regCount = regCount;
-            infoStruct.isReadReg = isReadReg;
-            infoStruct.regType = regType;
-            infoStruct.spList.append(infoParam);
-            m_dataMap.insert(address,infoStruct);
-
-            // 更新 m_keyIndexMap：记录新创建的 ModbusSturct 中第一个 ModbusParameter 的位置
-            // 因为是新创建的 spList，第一个元素索引必然是 0
-            m_keyIndexMap[key] = qMakePair(address, 0);
-        }
+bool LSJDevice::applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary)
+{
+    // 在新容器中建立计划后一次交换；本函数在设备线程中执行，轮询不会看到建立到一半的计划
+    QMap<quint16, ModbusSturct> dataMap;
+    QMap<QString, QPair<quint16, int>> keyIndexMap;
+    ModbusPlanDiff diff;
+    buildModbusPlan(image, m_metrics, dataMap, keyIndexMap, &m_dataMap, &diff);
+    m_dataMap.swap(dataMap);
+    m_keyIndexMap.swap(keyIndexMap);
+    remapModbusQueue(m_requestQueue, m_dataMap);
+    m_metrics.setQueueDepth(m_requestQueue.size());
+
+    QStringList notes;
+    notes << diff.summary();
+    // 串口、网关和超时参数属于整条总线，由同一总线上的设备共用，不随单个设备热加载
+    const bool busChanged = m_config["rtu_params"] != config["rtu_params"]
+            || m_config["tcp_params"] != config["tcp_params"]
+            || m_config["bus_params"] != config["bus_params"]
+            || m_config["protocol_params"].toObject()["response_timeout"] != config["protocol_params"].toObject()["response_timeout"]
+            || m_config["protocol_params"].toObject()["retry_count"] != config["protocol_params"].toObject()["retry_count"];
+    m_config = config;
+    m_serverAddress = m_config["server_address"].toInt();
+    m_scanInterval = m_config["protocol_params"].toObject()["scan_interval_ms"].toInt(0);
+    if (busChanged) {
+        notes << "bus settings changed, restart the service to apply";
+    }
+
+    // 原计划为空时本设备已不再申请总线，有了新块后重新申请
+    processRequestQueue();
+
+    if (summary) {
+        *summary = notes.join(", ");
     }
+    return true;
 }
 
 QModbusDataUnit LSJDevice::readRequest(QModbusDataUnit::RegisterType regType, quint16 qRegAddr, int iRegCount) const
@@ -392,27 +466,50 @@ void LSJDevice::updateParamValue(quint16 qRegAddr, quint64 qRegValue)
     }
 }
 
-void LSJDevice::sendReadRequest(const ModbusSturct& infoStruct)
+bool LSJDevice::sendReadRequest(const ModbusSturct& infoStruct)
 {
-    if (auto *reply = m_modbusDevice->sendReadRequest(readRequest(infoStruct.regType,infoStruct.address,infoStruct.regCount)
+    const qint64 startNs = m_metrics.nowNs();
+    if (auto *reply = m_bus->client()->sendReadRequest(readRequest(infoStruct.regType,infoStruct.address,infoStruct.regCount)
                                                           ,m_serverAddress))
     {
-        if (!reply->isFinished())
+        m_metrics.addRequest(kAduOverhead + 4);
+        if (!reply->isFinished()) {
+            const int block = infoStruct.metricsBlock;
+            const qint64 dueNs = infoStruct.dueNs;
+            connect(reply, &QModbusReply::finished, this, [this, reply, block, startNs, dueNs](){
+                if (recordReply(reply, block, startNs)) {
+                    m_metrics.recordSample(block, dueNs);
+                }
+                if (m_bus) {
+                    m_bus->transactionFinished(this, reply->error() == QModbusDevice::TimeoutError);
+                }
+            });
             connect(reply, &QModbusReply::finished, this, &LSJDevice::onReadReady);
+            return true;
+        }
         else
             delete reply; // broadcast replies return immediately
     }
+    else
+    {
+        m_metrics.recordTransaction(infoStruct.metricsBlock, startNs, DeviceMetrics::CommError);
+    }
+    return false;
 }
 
-void LSJDevice::sendWriteRequest(const ModbusSturct &infoStruct)
+bool LSJDevice::sendWriteRequest(const ModbusSturct &infoStruct)
 {
     QModbusDataUnit writeUnit = writeRequest(infoStruct.regType,infoStruct.address, infoStruct.regCount);
     QVector<quint16> mList = getWriteRegValues(infoStruct.address);
     writeUnit.setValues(mList);
-    if (auto *reply = m_modbusDevice->sendWriteRequest(writeUnit, m_serverAddress))
+    const qint64 startNs = m_metrics.nowNs();
+    const int block = infoStruct.metricsBlock;
+    if (auto *reply = m_bus->client()->sendWriteRequest(writeUnit, m_serverAddress))
     {
+        m_metrics.addRequest(kAduOverhead + 5 + modbusDataBytes(writeUnit.registerType(), writeUnit.valueCount()));
         if (!reply->isFinished()) {
-            connect(reply, &QModbusReply::finished, this, [this, reply](){
+            connect(reply, &QModbusReply::finished, this, [this, reply, block, startNs](){
+                recordReply(reply, block, startNs);
                 if (reply->error() == QModbusDevice::ProtocolError)
                 {
                     qDebug()<<QString("LSJDevice：Write response error: %1 (Mobus exception: 0x%2)")
@@ -425,8 +522,12 @@ void LSJDevice::sendWriteRequest(const ModbusSturct &infoStruct)
                                     .arg(reply->errorString())
                                     .arg(reply->error(),-1,16);
                 }
+                if (m_bus) {
+                    m_bus->transactionFinished(this, reply->error() == QModbusDevice::TimeoutError);
+                }
                 reply->deleteLater();
             });
+            return true;
         }
         else
         {
@@ -436,12 +537,44 @@ void LSJDevice::sendWriteRequest(const ModbusSturct &infoStruct)
     }
     else
     {
-        qDebug()<<"LSJDevice：Write error: " + m_modbusDevice->errorString();
+        qDebug()<<"LSJDevice：Write error: " + m_bus->client()->errorString();
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::CommError);
+    }
+    return false;
+}
+
+bool LSJDevice::recordReply(QModbusReply* reply, int block, qint64 startNs)
+{
+    switch (reply->error()) {
+    case QModbusDevice::NoError: {
+        const QModbusDataUnit unit = reply->result();
+        // 读响应带回数据区，写响应只回显地址和数量
+        const bool isRead = reply->rawResult().functionCode() <= QModbusPdu::ReadInputRegisters;
+        m_metrics.addBytesIn(kAduOverhead + (isRead ? 1 + modbusDataBytes(unit.registerType(), unit.valueCount()) : 4));
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::Ok);
+        return true;
+    }
+    case QModbusDevice::TimeoutError:
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::Timeout);
+        break;
+    case QModbusDevice::ProtocolError:
+        m_metrics.addBytesIn(kAduOverhead + 1);
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::ProtocolError);
+        break;
+    default:
+        m_metrics.recordTransaction(block, startNs, DeviceMetrics::CommError);
+        break;
     }
+    return false;
 }
 
 
 
+QString LSJDevice::threadGroup() const
+{
+    return "modbus_bus:" + ModbusBus::busKey(m_config);
+}
+
 const QJsonObject& LSJDevice::getConfig() const
 {
     return m_config;
@@ -6,14 +6,15 @@
 #include <QModbusDataUnit>
 #include <QQueue>
 #include "modbusdata.h"
+#include "core/ModbusBus.h"
 
-class QModbusRtuSerialMaster;
 class QTimer;
+class QModbusReply;
 
 /**
  * @brief 冷水机设备类
  */
-class LSJDevice : public Device
+class LSJDevice : public Device, public ModbusBusMember
 {
     Q_OBJECT
 
@@ -22,27 +23,56 @@ public:
      * @brief 构造一个LSJDevice对象
      * @param id 设备的唯一标识符
      * @param config 设备的配置
+     * @param image 预编译的配置镜像，为空时由 config 编译
      * @param parent 父对象
      */
-    explicit LSJDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent = nullptr);
+    explicit LSJDevice(const QString& id, const QString& name, const QJsonObject& config,
+                       const QSharedPointer<const ConfigImage>& image = QSharedPointer<const ConfigImage>(),
+                       QObject *parent = nullptr);
     ~LSJDevice();
     void writeData2Device(const QString &key,const QString &value);
     bool connectDevice() override;
     void disconnectDevice() override;
     const QJsonObject& getConfig() const override;
+    /**
+     * @brief 同一串口或网关上的设备共用一个线程和一条总线
+     */
+    QString threadGroup() const override;
+
+    // ModbusBusMember
+    bool sendNextRequest() override;
+    QString memberName() const override;
 
 public slots:
     void initInThread() override;
     void stop() override;
 
+protected:
+    /**
+     * @brief 热加载：只重建变化的读写块，连接保持不变
+     */
+    bool applyConfig(const QJsonObject& config, const ConfigImage& image, QString* summary) override;
+
+    /**
+     * @brief 优先写入：更新值后申请优先使用总线，在途事务结束后立即发出该写块的请求
+     */
+    void writePriority(const QString& key, const QString& value, qint64 triggerNs) override;
+
 private slots:
     void onStateChanged(int state);
     void onReadReady();
     void processRequestQueue();
 
 private:
-    void sendReadRequest(const ModbusSturct &infoStruct);
-    void sendWriteRequest(const ModbusSturct &infoStruct);
+    /**
+     * @brief 发出一个请求，应答在途时返回true(应答结束时通知总线)
+     */
+    bool sendReadRequest(const ModbusSturct &infoStruct);
+    bool sendWriteRequest(const ModbusSturct &infoStruct);
+    /**
+     * @brief 按应答结果记录事务统计，成功时返回true
+     */
+    bool recordReply(QModbusReply* reply, int block, qint64 startNs);
     void generatePollingRequests();
     void initDataMap();
     QModbusDataUnit readRequest(QModbusDataUnit::RegisterType regType, quint16 qRegAddr, int iRegCount) const;
@@ -54,9 +84,12 @@ private:
 
 
     QJsonObject m_config;                   ///< 设备的配置
-    QModbusRtuSerialMaster* m_modbusDevice; ///< Modbus RTU主站
+    ModbusBus* m_bus;                       ///< 共享的Modbus总线，在 initInThread 中加入
     QQueue<ModbusSturct> m_requestQueue;    ///< 请求队列
-    QTimer* m_requestTimer;                 ///< 用于控制帧间隔的定时器
+    QQueue<QPair<quint16, qint64>> m_priorityWrites; ///< 待发的优先写入：写块地址、触发时间
+    QTimer* m_requestTimer;                 ///< 发送失败重试和扫描间隔等待的定时器
+    int m_scanInterval;                     ///< 两轮扫描开始之间的最小间隔(ms)，0表示连续扫描
+    qint64 m_scanStartNs;                   ///< 本轮扫描开始时间，<0表示尚未开始
     int m_serverAddress;                    //从站地址
     QMap<quint16,ModbusSturct> m_dataMap;  //保存参数Map Key:寄存器地址 QList<SignalParameter>寄存器下对应的参数列表
 
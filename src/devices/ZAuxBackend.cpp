@@ -0,0 +1,136 @@
+/**
+ * @file ZAuxBackend.cpp
+ * @brief ZAuxBackend类的实现
+ */
+#include "ZAuxBackend.h"
+#include "zauxdll2.h" // 包含ZMotion库的函数声明
+
+ZAuxBackend::ZAuxBackend()
+    : m_handle(nullptr)
+{
+}
+
+ZAuxBackend::~ZAuxBackend()
+{
+    close();
+}
+
+QString ZAuxBackend::name() const
+{
+    return "zaux";
+}
+
+int ZAuxBackend::openEth(const QString& ipAddress, int timeoutMs)
+{
+    close();
+    QByteArray ipBytes = ipAddress.toLocal8Bit();
+    if (timeoutMs > 0) {
+        // ZAux_OpenEth 对不可达的控制器会阻塞数秒，FastOpen 可以限定等待时间 (type 2: 以太网)
+        return ZAux_FastOpen(2, ipBytes.data(), static_cast<uint32>(timeoutMs), &m_handle);
+    }
+    return ZAux_OpenEth(ipBytes.data(), &m_handle);
+}
+
+void ZAuxBackend::close()
+{
+    if (m_handle) {
+        ZAux_Close(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+bool ZAuxBackend::isOpen() const
+{
+    return m_handle != nullptr;
+}
+
+int ZAuxBackend::execute(const QString& command, QString* response)
+{
+    char buffer[1024] = {0};
+    QByteArray commandBytes = command.toLatin1();
+    int result = ZAux_Execute(m_handle, commandBytes.constData(), buffer, sizeof(buffer));
+    if (response) {
+        *response = QString::fromLatin1(buffer);
+    }
+    return result;
+}
+
+int ZAuxBackend::setUnits(int axis, float value) { return ZAux_Direct_SetUnits(m_handle, axis, value); }
+int ZAuxBackend::setSpeed(int axis, float value) { return ZAux_Direct_SetSpeed(m_handle, axis, value); }
+int ZAuxBackend::setAccel(int axis, float value) { return ZAux_Direct_SetAccel(m_handle, axis, value); }
+int ZAuxBackend::setDecel(int axis, float value) { return ZAux_Direct_SetDecel(m_handle, axis, value); }
+int ZAuxBackend::setSramp(int axis, float value) { return ZAux_Direct_SetSramp(m_handle, axis, value); }
+int ZAuxBackend::setCreep(int axis, float value) { return ZAux_Direct_SetCreep(m_handle, axis, value); }
+int ZAuxBackend::setDatumIn(int axis, int ioNum) { return ZAux_Direct_SetDatumIn(m_handle, axis, ioNum); }
+int ZAuxBackend::setInvertIn(int ioNum, int invert) { return ZAux_Direct_SetInvertIn(m_handle, ioNum, invert); }
+int ZAuxBackend::setDpos(int axis, float value) { return ZAux_Direct_SetDpos(m_handle, axis, value); }
+int ZAuxBackend::setMerge(int axis, int value) { return ZAux_Direct_SetMerge(m_handle, axis, value); }
+
+int ZAuxBackend::getDpos(int axis, float* value) { return ZAux_Direct_GetDpos(m_handle, axis, value); }
+int ZAuxBackend::getIfIdle(int axis, int* value) { return ZAux_Direct_GetIfIdle(m_handle, axis, value); }
+
+int ZAuxBackend::getAllAxisInfo(int maxAxis, int* idle, float* dpos, float* mpos, int* axisStatus)
+{
+    return ZAux_Direct_GetAllAxisInfo(m_handle, maxAxis, idle, dpos, mpos, axisStatus);
+}
+
+int ZAuxBackend::getAllAxisPara(const char* param, int maxAxis, float* values)
+{
+    return ZAux_Direct_GetAllAxisPara(m_handle, param, maxAxis, values);
+}
+
+int ZAuxBackend::getModbusDpos(int maxAxis, float* values) { return ZAux_GetModbusDpos(m_handle, maxAxis, values); }
+
+int ZAuxBackend::getIn(int ioNum, quint32* value) { return ZAux_Direct_GetIn(m_handle, ioNum, value); }
+int ZAuxBackend::getInMulti(int startIo, int endIo, qint32* words) { return ZAux_Direct_GetInMulti(m_handle, startIo, endIo, words); }
+int ZAuxBackend::getModbusIn(int startIo, int endIo, quint8* values) { return ZAux_GetModbusIn(m_handle, startIo, endIo, values); }
+
+int ZAuxBackend::getOutMulti(int startIo, int endIo, qint32* words)
+{
+    return ZAux_Direct_GetOutMulti(m_handle, static_cast<uint16>(startIo), static_cast<uint16>(endIo),
+                                   reinterpret_cast<uint32*>(words));
+}
+
+int ZAuxBackend::setOp(int ioNum, quint32 value) { return ZAux_Direct_SetOp(m_handle, ioNum, value); }
+
+int ZAuxBackend::singleVmove(int axis, int direction) { return ZAux_Direct_Single_Vmove(m_handle, axis, direction); }
+int ZAuxBackend::singleMove(int axis, float distance) { return ZAux_Direct_Single_Move(m_handle, axis, distance); }
+int ZAuxBackend::singleDatum(int axis, int mode) { return ZAux_Direct_Single_Datum(m_handle, axis, mode); }
+int ZAuxBackend::singleCancel(int axis, int mode) { return ZAux_Direct_Single_Cancel(m_handle, axis, mode); }
+
+int ZAuxBackend::multiMoveAbs(int moveCount, int axisCount, int* axisList, float* positions)
+{
+    return ZAux_Direct_MultiMoveAbs(m_handle, moveCount, axisCount, axisList, positions);
+}
+
+int ZAuxBackend::moveCircAbs(int axisCount, int* axisList, float end1, float end2,
+                             float center1, float center2, int direction)
+{
+    return ZAux_Direct_MoveCircAbs(m_handle, axisCount, axisList, end1, end2, center1, center2, direction);
+}
+
+int ZAuxBackend::moveSmooth(int axisCount, int* axisList, float end1, float end2, float end3,
+                            float next1, float next2, float next3, float radius)
+{
+    return ZAux_Direct_MoveSmooth(m_handle, axisCount, axisList, end1, end2, end3, next1, next2, next3, radius);
+}
+
+int ZAuxBackend::moveOp(int axis, int ioNum, int value) { return ZAux_Direct_MoveOp(m_handle, axis, ioNum, value); }
+int ZAuxBackend::getRemainBuffer(int axis, int* value) { return ZAux_Direct_GetRemain_Buffer(m_handle, axis, value); }
+int ZAuxBackend::getMovesBuffered(int axis, int* value) { return ZAux_Direct_GetMovesBuffered(m_handle, axis, value); }
+
+int ZAuxBackend::getTable(int start, int count, float* values) { return ZAux_Direct_GetTable(m_handle, start, count, values); }
+int ZAuxBackend::trigger() { return ZAux_Trigger(m_handle); }
+
+int ZAuxBackend::cycleUpEnable(quint32 channel, float intervalMs, const char* sets)
+{
+    return ZAux_CycleUpEnable(m_handle, channel, intervalMs, sets);
+}
+
+int ZAuxBackend::cycleUpDisable(quint32 channel) { return ZAux_CycleUpDisable(m_handle, channel); }
+quint32 ZAuxBackend::cycleUpGetRecvTimes(quint32 channel) { return ZAux_CycleUpGetRecvTimes(m_handle, channel); }
+
+int ZAuxBackend::cycleUpReadBuff(quint32 channel, const char* name, quint32 index, double* value)
+{
+    return static_cast<int>(ZAux_CycleUpReadBuff(m_handle, channel, name, index, value));
+}
@@ -0,0 +1,71 @@
+#ifndef ZAUXBACKEND_H
+#define ZAUXBACKEND_H
+
+#include "ZMotionBackend.h"
+#include "zmotion.h" // 包含ZMotion库的基础定义
+
+/**
+ * @brief 基于厂商 zauxdll 的ZMotion后端，直接转发到 ZAux_* 函数
+ */
+class ZAuxBackend : public ZMotionBackend
+{
+public:
+    ZAuxBackend();
+    ~ZAuxBackend() override;
+
+    QString name() const override;
+
+    int openEth(const QString& ipAddress, int timeoutMs) override;
+    void close() override;
+    bool isOpen() const override;
+    int execute(const QString& command, QString* response = nullptr) override;
+
+    int setUnits(int axis, float value) override;
+    int setSpeed(int axis, float value) override;
+    int setAccel(int axis, float value) override;
+    int setDecel(int axis, float value) override;
+    int setSramp(int axis, float value) override;
+    int setCreep(int axis, float value) override;
+    int setDatumIn(int axis, int ioNum) override;
+    int setInvertIn(int ioNum, int invert) override;
+    int setDpos(int axis, float value) override;
+    int setMerge(int axis, int value) override;
+
+    int getDpos(int axis, float* value) override;
+    int getIfIdle(int axis, int* value) override;
+    int getAllAxisInfo(int maxAxis, int* idle, float* dpos, float* mpos, int* axisStatus) override;
+    int getAllAxisPara(const char* param, int maxAxis, float* values) override;
+    int getModbusDpos(int maxAxis, float* values) override;
+
+    int getIn(int ioNum, quint32* value) override;
+    int getInMulti(int startIo, int endIo, qint32* words) override;
+    int getModbusIn(int startIo, int endIo, quint8* values) override;
+    int getOutMulti(int startIo, int endIo, qint32* words) override;
+    int setOp(int ioNum, quint32 value) override;
+
+    int singleVmove(int axis, int direction) override;
+    int singleMove(int axis, float distance) override;
+    int singleDatum(int axis, int mode) override;
+    int singleCancel(int axis, int mode) override;
+
+    int multiMoveAbs(int moveCount, int axisCount, int* axisList, float* positions) override;
+    int moveCircAbs(int axisCount, int* axisList, float end1, float end2,
+                    float center1, float center2, int direction) override;
+    int moveSmooth(int axisCount, int* axisList, float end1, float end2, float end3,
+                   float next1, float next2, float next3, float radius) override;
+    int moveOp(int axis, int ioNum, int value) override;
+    int getRemainBuffer(int axis, int* value) override;
+    int getMovesBuffered(int axis, int* value) override;
+    int getTable(int start, int count, float* values) override;
+    int trigger() override;
+
+    int cycleUpEnable(quint32 channel, float intervalMs, const char* sets) override;
+    int cycleUpDisable(quint32 channel) override;
+    quint32 cycleUpGetRecvTimes(quint32 channel) override;
+    int cycleUpReadBuff(quint32 channel, const char* name, quint32 index, double* value) override;
+
+private:
+    ZMC_HANDLE m_handle; ///< ZMotion连接句柄
+};
+
+#endif // ZAUXBACKEND_H
@@ -0,0 +1,27 @@
+/**
+ * @file ZMotionBackend.cpp
+ * @brief ZMotion后端工厂
+ */
+#include "ZMotionBackend.h"
+#include "ZMotionSimBackend.h"
+#ifdef HAVE_ZAUX_SDK
+#include "ZAuxBackend.h"
+#endif
+#include <QDebug>
+
+ZMotionBackend* ZMotionBackend::create(const QJsonObject& config)
+{
+    QString type = config["type"].toString("zaux");
+    if (type == "sim") {
+        return new ZMotionSimBackend(config["sim"].toObject());
+    }
+
+#ifdef HAVE_ZAUX_SDK
+    if (type == "zaux") {
+        return new ZAuxBackend();
+    }
+#endif
+
+    qWarning() << "ZMotionBackend: backend" << type << "is not available in this build";
+    return nullptr;
+}
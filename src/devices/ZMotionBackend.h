@@ -0,0 +1,103 @@
+#ifndef ZMOTIONBACKEND_H
+#define ZMOTIONBACKEND_H
+
+#include <QString>
+#include <QJsonObject>
+
+/**
+ * @brief ZMotion控制器访问后端接口
+ *
+ * 将ZMotionDevice用到的 ZAux_* 函数抽象为虚接口，由具体后端实现：
+ * ZAuxBackend 调用厂商SDK(仅Windows)，ZMotionSimBackend 为进程内仿真控制器。
+ * 函数名与参数和SDK保持一一对应，返回值为SDK错误码(0表示成功)。
+ * 连接句柄由后端内部持有。
+ */
+class ZMotionBackend
+{
+public:
+    virtual ~ZMotionBackend() {}
+
+    /**
+     * @brief 根据配置创建后端
+     * @param config 设备配置中的 "backend" 对象，type 为 "zaux" 或 "sim"
+     * @return 后端对象，由调用者负责释放。类型未知或未编译进来(如非Windows下的 "zaux")时返回nullptr，
+     *         不会用仿真后端代替；仿真后端只在 type 为 "sim" 时使用
+     */
+    static ZMotionBackend* create(const QJsonObject& config);
+
+    /**
+     * @brief 返回后端名称，用于日志
+     */
+    virtual QString name() const = 0;
+
+    // 连接
+    /**
+     * @brief 以太网连接控制器
+     * @param ipAddress 控制器IP
+     * @param timeoutMs 连接超时(ms)，<=0 时使用SDK默认的阻塞连接
+     */
+    virtual int openEth(const QString& ipAddress, int timeoutMs) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+
+    /**
+     * @brief 执行BASIC命令(ZAux_Execute)，可用冒号分隔多条语句，在一次通信中完成
+     * @param command 命令字符串
+     * @param response 控制器返回的文本，可为空
+     */
+    virtual int execute(const QString& command, QString* response = nullptr) = 0;
+
+    // 轴参数
+    virtual int setUnits(int axis, float value) = 0;
+    virtual int setSpeed(int axis, float value) = 0;
+    virtual int setAccel(int axis, float value) = 0;
+    virtual int setDecel(int axis, float value) = 0;
+    virtual int setSramp(int axis, float value) = 0;
+    virtual int setCreep(int axis, float value) = 0;
+    virtual int setDatumIn(int axis, int ioNum) = 0;
+    virtual int setInvertIn(int ioNum, int invert) = 0;
+    virtual int setDpos(int axis, float value) = 0;
+    virtual int setMerge(int axis, int value) = 0;
+
+    // 轴状态
+    virtual int getDpos(int axis, float* value) = 0;
+    virtual int getIfIdle(int axis, int* value) = 0;
+    virtual int getAllAxisInfo(int maxAxis, int* idle, float* dpos, float* mpos, int* axisStatus) = 0;
+    virtual int getAllAxisPara(const char* param, int maxAxis, float* values) = 0;
+    virtual int getModbusDpos(int maxAxis, float* values) = 0;
+
+    // IO
+    virtual int getIn(int ioNum, quint32* value) = 0;
+    virtual int getInMulti(int startIo, int endIo, qint32* words) = 0;
+    virtual int getModbusIn(int startIo, int endIo, quint8* values) = 0;    ///< 按位打包，每字节8个输入口
+    virtual int getOutMulti(int startIo, int endIo, qint32* words) = 0;
+    virtual int setOp(int ioNum, quint32 value) = 0;
+
+    // 单轴运动
+    virtual int singleVmove(int axis, int direction) = 0;
+    virtual int singleMove(int axis, float distance) = 0;
+    virtual int singleDatum(int axis, int mode) = 0;
+    virtual int singleCancel(int axis, int mode) = 0;
+
+    // 插补运动与运动缓冲
+    virtual int multiMoveAbs(int moveCount, int axisCount, int* axisList, float* positions) = 0;
+    virtual int moveCircAbs(int axisCount, int* axisList, float end1, float end2,
+                            float center1, float center2, int direction) = 0;
+    virtual int moveSmooth(int axisCount, int* axisList, float end1, float end2, float end3,
+                           float next1, float next2, float next3, float radius) = 0;
+    virtual int moveOp(int axis, int ioNum, int value) = 0;
+    virtual int getRemainBuffer(int axis, int* value) = 0;
+    virtual int getMovesBuffered(int axis, int* value) = 0;
+
+    // TABLE与示波器: 示波器由BASIC命令 SCOPE 配置，Trigger 启动，数据写入TABLE后整块读取
+    virtual int getTable(int start, int count, float* values) = 0;
+    virtual int trigger() = 0;
+
+    // 周期上报
+    virtual int cycleUpEnable(quint32 channel, float intervalMs, const char* sets) = 0;
+    virtual int cycleUpDisable(quint32 channel) = 0;
+    virtual quint32 cycleUpGetRecvTimes(quint32 channel) = 0;
+    virtual int cycleUpReadBuff(quint32 channel, const char* name, quint32 index, double* value) = 0;
+};
+
+#endif // ZMOTIONBACKEND_H
@@ -2,37 +2,117 @@
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QTime>
-#include "zauxdll2.h" // 包含ZMotion库的函数声明
+#include <QDateTime>
+#include <QDir>
+#include <QtMath>
+#include <QtAlgorithms>
+#include <qnumeric.h>
+#include <cstring>
 #include "ZMotionDevice.h"
+#include "ZMotionBackend.h"
+#include "core/DriverRegistry.h"
 
-// ZMotion常量定义（如果头文件中没有定义）
-#ifndef ZMC_ETH
-#define ZMC_ETH 1
-#endif
+// 运动控制卡不使用寄存器表，不需要配置镜像
+static const bool ZMotionDevice_registered = DriverRegistry::instance().registerDriver(
+    "zmotion_api", "zmotion",
+    [](const QString& id, const QString& name, const QJsonObject& config,
+       const QSharedPointer<const ConfigImage>&) -> Device* {
+        return new ZMotionDevice(id, name, config);
+    }, true);
 
 ZMotionDevice::ZMotionDevice(const QString& id, const QString& name, const QJsonObject& config, QObject *parent)
     : Device(id, name, parent)
     , m_config(config)
     , m_statusTimer(nullptr)
-    , m_zmcHandle(nullptr)
+    , m_backend(nullptr)
+    , m_enabledMask(0)
+    , m_maxAxisCount(0)
+    , m_commFailures(0)
+    , m_lastSampleNs(-1)
+    , m_forcePublish(true)
+    , m_cycleUpActive(false)
+    , m_cycleUpRecvTimes(0)
+    , m_trajectoryTimer(nullptr)
+    , m_trajectoryNext(0)
+    , m_trajectoryActive(false)
+    , m_commandTimer(nullptr)
+    , m_nextCommandId(0)
+    , m_scopeTimer(nullptr)
+    , m_scopeActive(false)
+    , m_scopeDownloaded(-1)
+    , m_scopeExpectedMs(0)
 {
+    qRegisterMetaType<ZMotionTrajectory>("ZMotionTrajectory");
+    qRegisterMetaType<IoBank>("IoBank");
+    qRegisterMetaType<ZMotionScopeTrace>("ZMotionScopeTrace");
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+
     // 读取轴配置
     QJsonArray axesConfig = m_config["axes"].toArray();
     for (const QJsonValue& axisVal : axesConfig) {
         QJsonObject axisObj = axisVal.toObject();
         if (axisObj["enabled"].toBool()) {
-            m_enabledAxes.append(axisObj["id"].toInt());
+            int axisId = axisObj["id"].toInt();
+            if (axisId < 0 || axisId >= ZMotionStateBlock::MaxAxes) {
+                qWarning() << "ZMotion axis" << axisId << "out of range, ignored";
+                continue;
+            }
+            m_enabledAxes.append(axisId);
+            m_enabledMask |= 1u << axisId;
+            m_maxAxisCount = qMax(m_maxAxisCount, axisId + 1);
         }
     }
+    QJsonObject ioConfig = m_config["io"].toObject();
+    m_inputCount = qBound(0, ioConfig["inputCount"].toInt(16), int(ZMotionStateBlock::MaxIo));
+    m_outputCount = qBound(0, ioConfig["outputCount"].toInt(16), int(ZMotionStateBlock::MaxIo));
+    QJsonObject timing = m_config["timing"].toObject();
+    m_statusInterval = timing["statusUpdateInterval"].toInt(500);
+    m_lostAfterErrors = qMax(1, m_config["connection"].toObject()["lostAfterErrors"].toInt(3));
+    QJsonObject cycleUp = timing["cycleUp"].toObject();
+    m_cycleUpEnabled = cycleUp["enabled"].toBool(false);
+    m_cycleUpChannel = cycleUp["channel"].toInt(0);
+    m_cycleUpInterval = cycleUp["intervalMs"].toDouble(10.0);
+    m_cycleUpTimeout = cycleUp["fallbackTimeoutMs"].toInt(500);
+    m_trajectoryReserve = m_config["trajectory"].toObject()["reserveBuffer"].toInt(1);
+    QJsonObject scope = m_config["scope"].toObject();
+    m_scopeTableStart = scope["tableStart"].toInt(0);
+    m_scopeMaxChannels = scope["maxChannels"].toInt(16);
+    m_scopeChunk = qMax(1, scope["downloadChunk"].toInt(1000));
+    m_scopePollInterval = scope["pollIntervalMs"].toInt(50);
+    m_scopeOutputDir = scope["outputDir"].toString();
+
+    // 控制器访问后端：真实SDK或仿真控制器。后端不可用时保持为空，连接时报告失败
+    m_backend = ZMotionBackend::create(m_config["backend"].toObject());
+
+    m_axisStatusBlock = m_metrics.addBlock("AxisStatus");
+    m_inputsBlock = m_metrics.addBlock("Inputs");
+    m_outputsBlock = m_metrics.addBlock("Outputs");
+    m_commandBlock = m_metrics.addBlock("Command");
+
+    // 状态块按最大规格定长分配，批量读取接口直接写入
+    std::memset(&m_state, 0, sizeof(m_state));
+    std::memset(&m_published, 0, sizeof(m_published));
+    std::memset(m_prevMpos, 0, sizeof(m_prevMpos));
+    m_sampleClock.start();
+    invalidateParamCache();
+
+    static const char* const axisFieldNames[AxisFieldCount] = {"position", "status", "speed", "alarm"};
+    for (int axisId = 0; axisId < ZMotionStateBlock::MaxAxes; ++axisId) {
+        for (int field = 0; field < AxisFieldCount; ++field) {
+            m_axisKeys[axisId][field] = QString("axis%1_%2").arg(axisId).arg(axisFieldNames[field]);
+        }
+    }
+
     QString tmpInfo = QString("ZMotionDevice created: %1 with %2 enabled axes.").arg(id).arg(m_enabledAxes.size());
     emit sig_printLog(tmpInfo.toUtf8(),false);
 }
 
 ZMotionDevice::~ZMotionDevice()
 {
-    if (m_zmcHandle) {
-        ZAux_Close(m_zmcHandle);
-        m_zmcHandle = nullptr;
+    if (m_backend) {
+        m_backend->close();
+        delete m_backend;
+        m_backend = nullptr;
     }
 }
 
@@ -41,7 +121,21 @@ void ZMotionDevice::initInThread()
     // 在工作线程中创建定时器
     m_statusTimer = new QTimer(this);
     connect(m_statusTimer, &QTimer::timeout, this, &ZMotionDevice::onStatusTimer);
-    m_statusTimer->setInterval(500); // 500ms更新间隔
+    m_statusTimer->setInterval(m_statusInterval);
+
+    // 轨迹送入定时器：持续保持控制器运动缓冲区有足够的待执行段
+    m_trajectoryTimer = new QTimer(this);
+    connect(m_trajectoryTimer, &QTimer::timeout, this, &ZMotionDevice::feedTrajectory);
+    m_trajectoryTimer->setInterval(m_config["trajectory"].toObject()["feedIntervalMs"].toInt(10));
+
+    // 命令队列：每条命令单独占用一次事件循环，命令之间状态轮询可以及时执行
+    m_commandTimer = new QTimer(this);
+    m_commandTimer->setSingleShot(true);
+    m_commandTimer->setInterval(0);
+    connect(m_commandTimer, &QTimer::timeout, this, &ZMotionDevice::processCommandQueue);
+
+    m_scopeTimer = new QTimer(this);
+    connect(m_scopeTimer, &QTimer::timeout, this, &ZMotionDevice::pollScopeCapture);
 }
 
 bool ZMotionDevice::connectDevice()
@@ -50,28 +144,46 @@ bool ZMotionDevice::connectDevice()
     QJsonObject connParams = m_config["connection"].toObject();
     QString ipAddress = connParams["ip"].toString("192.168.1.100");
     int port = connParams["port"].toInt(8089);
+    int timeoutMs = connParams["timeout"].toInt(5000);
+
+    if (!m_backend) {
+        QString backendType = m_config["backend"].toObject()["type"].toString("zaux");
+        QString reason = QString("ZMotion backend '%1' is not available in this build").arg(backendType);
+        emit sig_printLog(reason.toUtf8(), false);
+        setConnected(false);
+        connectAttemptFailed(reason);
+        return false;
+    }
     
     // 如果已经连接，先断开
-    if (m_zmcHandle) {
-        ZAux_Close(m_zmcHandle);
-        m_zmcHandle = nullptr;
+    if (isBackendOpen()) {
+        stopCycleUp();
+        m_backend->close();
     }
     
     // 连接ZMotion控制卡
-    QByteArray ipBytes = ipAddress.toLocal8Bit();
-    const char* ipCStr = ipBytes.data();
-    int result = ZAux_OpenEth(const_cast<char*>(ipCStr), &m_zmcHandle);
+    int result = m_backend->openEth(ipAddress, timeoutMs);
 
     if (result != 0) {
         handleZMotionError(result, "Connect");
         setConnected(false);
+        connectAttemptFailed(getZMotionErrorString(result));
         return false;
     }
     
+    // 新连接后首次采样无条件发布全部状态，速度从第二次采样开始计算
+    m_forcePublish = true;
+    m_lastSampleNs = -1;
+    m_commFailures = 0;
+    invalidateParamCache();
+
     setConnected(true);
+    if (m_cycleUpEnabled) {
+        startCycleUp();
+    }
     m_statusTimer->start();
     
-    QString logMsg = QString("ZMotion connected to %1:%2").arg(ipAddress).arg(port);
+    QString logMsg = QString("ZMotion connected to %1:%2 (backend: %3)").arg(ipAddress).arg(port).arg(m_backend->name());
     emit sig_printLog(logMsg.toUtf8(), false);
     
     return true;
@@ -79,13 +191,16 @@ bool ZMotionDevice::connectDevice()
 
 void ZMotionDevice::disconnectDevice()
 {
+    abortTrajectory();
+    abortScopeCapture();
+    cancelQueuedCommands(-1);
     if (m_statusTimer) {
         m_statusTimer->stop();
     }
+    stopCycleUp();
     
-    if (m_zmcHandle) {
-        ZAux_Close(m_zmcHandle);
-        m_zmcHandle = nullptr;
+    if (isBackendOpen()) {
+        m_backend->close();
     }
     
     setConnected(false);
@@ -99,7 +214,7 @@ const QJsonObject& ZMotionDevice::getConfig() const
 
 void ZMotionDevice::writeData2Device(const QString &key, const QString &value)
 {
-    if (!m_zmcHandle) {
+    if (!isBackendOpen()) {
         emit sig_printLog(QString("ZMotion not connected, cannot write %1=%2").arg(key).arg(value).toLocal8Bit(), false);
         return;
     }
@@ -109,6 +224,44 @@ void ZMotionDevice::writeData2Device(const QString &key, const QString &value)
     emit sig_printLog(logMsg.toUtf8(), true);
 }
 
+void ZMotionDevice::writePriority(const QString &key, const QString &value, qint64 triggerNs)
+{
+    if (!isBackendOpen()) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 dropped: not connected").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+
+    bool ok = false;
+    bool sent = false;
+    if (key == "stop_all") {
+        sent = stopAllAxes();
+        ok = true;
+    } else if (key.startsWith("axis") && key.endsWith("_stop")) {
+        const int axisId = key.mid(4, key.size() - 9).toInt(&ok);
+        if (ok) {
+            sent = stopAxis(axisId);
+        }
+    } else if (key.startsWith("output")) {
+        const int outputId = key.mid(6).toInt(&ok);
+        if (ok) {
+            sent = setDigitalOutput(outputId, value.toInt() != 0);
+        }
+    }
+    if (!ok) {
+        qWarning() << "ZMotionDevice::writePriority: unknown key:" << key;
+        emit sig_printLog(QString("Priority write %1=%2 rejected: unknown key").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    if (!sent) {
+        m_metrics.recordReactionFailure();
+        emit sig_printLog(QString("Priority write %1=%2 failed").arg(key).arg(value).toUtf8(), true);
+        return;
+    }
+    // 控制器调用是同步的，返回时命令已下发
+    m_metrics.recordReaction(triggerNs);
+}
+
 void ZMotionDevice::writeText2Device(const QString &text)
 {
     if (text.isEmpty()) {
@@ -127,244 +280,956 @@ void ZMotionDevice::stop()
 
 void ZMotionDevice::onStatusTimer()
 {
-    if (m_zmcHandle) {
-        readAllAxisStatus();
-        readAllIOStatus();
+    if (!isBackendOpen()) {
+        return;
     }
+
+    // 推送模式下只解码本地已接收的上报缓冲，不产生网络请求
+    if (m_cycleUpActive && readCycleUpStatus()) {
+        return;
+    }
+    const qint64 startNs = m_metrics.nowNs();
+    const bool axisOk = readAllAxisStatus();
+    const bool ioOk = readAllIOStatus();
+    // 整轮读取成功才结束强制发布，失败的部分下一轮仍全部发布
+    if (axisOk && ioOk) {
+        m_commFailures = 0;
+        m_forcePublish = false;
+    }
+    m_metrics.recordScanCycle(m_metrics.nowNs() - startNs);
 }
 
-void ZMotionDevice::setAxisParameters(int axisId, double units, double speed, double accel, double decel, double sramp)
+bool ZMotionDevice::startCycleUp()
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
-        return;
+    if (!isBackendOpen() || m_maxAxisCount == 0) {
+        return false;
     }
 
-    int result;
+    // 语法: 参数1, 参数2(index), 参数3(index, numes)
+    QString sets = QString("DPOS(0,%1),MPOS(0,%1),IDLE(0,%1),AXISSTATUS(0,%1)").arg(m_maxAxisCount);
+    if (m_inputCount > 0) {
+        sets += QString(",IN(0,%1)").arg(m_inputCount);
+    }
+    if (m_outputCount > 0) {
+        sets += QString(",OP(0,%1)").arg(m_outputCount);
+    }
 
-    // 设置脉冲当量
-    result = ZAux_Direct_SetUnits(m_zmcHandle, axisId, units);
+    int result = m_backend->cycleUpEnable(m_cycleUpChannel, static_cast<float>(m_cycleUpInterval),
+                                    sets.toLatin1().constData());
     if (result != 0) {
-        handleZMotionError(result, QString("SetUnits Axis%1").arg(axisId));
+        handleZMotionError(result, "CycleUpEnable");
+        m_cycleUpActive = false;
+        return false;
     }
 
-    // 设置速度
-    result = ZAux_Direct_SetSpeed(m_zmcHandle, axisId, speed);
-    if (result != 0) {
-        handleZMotionError(result, QString("SetSpeed Axis%1").arg(axisId));
+    m_cycleUpActive = true;
+    m_cycleUpRecvTimes = m_backend->cycleUpGetRecvTimes(m_cycleUpChannel);
+    m_cycleUpWatchdog.start();
+    if (m_statusTimer) {
+        // 解码节拍跟随上报周期，本地解码的开销很小
+        m_statusTimer->setInterval(qMax(1, qCeil(m_cycleUpInterval)));
     }
 
-    // 设置加速度
-    result = ZAux_Direct_SetAccel(m_zmcHandle, axisId, accel);
-    if (result != 0) {
-        handleZMotionError(result, QString("SetAccel Axis%1").arg(axisId));
+    QString logMsg = QString("ZMotion cycle-up enabled on channel %1 every %2 ms: %3")
+                         .arg(m_cycleUpChannel).arg(m_cycleUpInterval).arg(sets);
+    emit sig_printLog(logMsg.toUtf8(), false);
+    return true;
+}
+
+void ZMotionDevice::stopCycleUp()
+{
+    if (m_cycleUpActive && isBackendOpen()) {
+        m_backend->cycleUpDisable(m_cycleUpChannel);
+    }
+    m_cycleUpActive = false;
+    if (m_statusTimer) {
+        m_statusTimer->setInterval(m_statusInterval);
     }
+}
 
-    // 设置减速度
-    result = ZAux_Direct_SetDecel(m_zmcHandle, axisId, decel);
-    if (result != 0) {
-        handleZMotionError(result, QString("SetDecel Axis%1").arg(axisId));
+bool ZMotionDevice::readCycleUpStatus()
+{
+    quint32 recvTimes = m_backend->cycleUpGetRecvTimes(m_cycleUpChannel);
+    if (recvTimes == m_cycleUpRecvTimes) {
+        // 控制器停止推送(固件不支持或链路异常)，回退到定时轮询
+        if (m_cycleUpWatchdog.elapsed() > m_cycleUpTimeout) {
+            stopCycleUp();
+            emit sig_printLog("ZMotion cycle-up stalled, falling back to polling", false);
+            return false;
+        }
+        return true; // 没有新数据，本周期无需处理
     }
+    m_cycleUpRecvTimes = recvTimes;
+    m_cycleUpWatchdog.restart();
 
-    // 设置S曲线时间
-    result = ZAux_Direct_SetSramp(m_zmcHandle, axisId, sramp);
-    if (result != 0) {
-        handleZMotionError(result, QString("SetSramp Axis%1").arg(axisId));
+    double value = 0.0;
+    for (int axisId : m_enabledAxes) {
+        if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "DPOS", axisId, &value) == 0) {
+            m_state.dpos[axisId] = static_cast<float>(value);
+        }
+        if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "MPOS", axisId, &value) == 0) {
+            m_state.mpos[axisId] = static_cast<float>(value);
+        }
+        if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "IDLE", axisId, &value) == 0) {
+            m_state.idle[axisId] = static_cast<qint32>(value);
+        }
+        if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "AXISSTATUS", axisId, &value) == 0) {
+            m_state.alarm[axisId] = static_cast<qint32>(value);
+        }
     }
+    updateDerivedState();
+    publishAxisStatus();
 
-    QString logMsg = QString("Axis%1 params set: Units=%2, Speed=%3, Accel=%4, Decel=%5, S-Ramp=%6")
-                         .arg(axisId).arg(units).arg(speed).arg(accel).arg(decel).arg(sramp);
-    emit sig_printLog(logMsg.toUtf8(), true);
+    if (m_inputCount > 0) {
+        std::memset(m_state.inputs, 0, sizeof(m_state.inputs));
+        for (int i = 0; i < m_inputCount; ++i) {
+            if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "IN", i, &value) == 0 && value != 0.0) {
+                m_state.inputs[i / 32] |= static_cast<qint32>(1u << (i % 32));
+            }
+        }
+        publishIoBank(false);
+    }
+    if (m_outputCount > 0) {
+        std::memset(m_state.outputs, 0, sizeof(m_state.outputs));
+        for (int i = 0; i < m_outputCount; ++i) {
+            if (m_backend->cycleUpReadBuff(m_cycleUpChannel, "OP", i, &value) == 0 && value != 0.0) {
+                m_state.outputs[i / 32] |= static_cast<qint32>(1u << (i % 32));
+            }
+        }
+        publishIoBank(true);
+    }
+    m_forcePublish = false;
+    return true;
+}
+
+quint64 ZMotionDevice::setAxisParameters(int axisId, double units, double speed, double accel, double decel, double sramp)
+{
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return 0;
+    }
+
+    AxisCommand command;
+    command.type = CmdSetParameters;
+    command.axisId = axisId;
+    command.params[ParamUnits] = static_cast<float>(units);
+    command.params[ParamSpeed] = static_cast<float>(speed);
+    command.params[ParamAccel] = static_cast<float>(accel);
+    command.params[ParamDecel] = static_cast<float>(decel);
+    command.params[ParamSramp] = static_cast<float>(sramp);
+    command.paramMask = (1u << ParamUnits) | (1u << ParamSpeed) | (1u << ParamAccel)
+                      | (1u << ParamDecel) | (1u << ParamSramp);
+    return enqueueCommand(command);
+}
+
+quint64 ZMotionDevice::moveContinuous(int axisId, int direction)
+{
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return 0;
+    }
+
+    AxisCommand command;
+    command.type = CmdMoveContinuous;
+    command.axisId = axisId;
+    command.mode = direction;
+    return enqueueCommand(command);
 }
 
-void ZMotionDevice::moveContinuous(int axisId, int direction)
+quint64 ZMotionDevice::moveRelative(int axisId, double distance)
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return 0;
+    }
+
+    AxisCommand command;
+    command.type = CmdMoveRelative;
+    command.axisId = axisId;
+    command.distance = distance;
+    return enqueueCommand(command);
+}
+
+quint64 ZMotionDevice::startHoming(int axisId, int mode, int homingIoPort, bool invertIo, double creepSpeed)
+{
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return 0;
+    }
+
+    AxisCommand command;
+    command.type = CmdStartHoming;
+    command.axisId = axisId;
+    command.mode = mode;
+    command.homingIo = homingIoPort;
+    command.invertIo = invertIo;
+    command.params[ParamCreep] = static_cast<float>(creepSpeed);
+    command.params[ParamDatumIn] = static_cast<float>(homingIoPort);
+    command.paramMask = (1u << ParamCreep) | (1u << ParamDatumIn);
+    return enqueueCommand(command);
+}
+
+quint64 ZMotionDevice::zeroPosition(int axisId)
+{
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return 0;
+    }
+
+    AxisCommand command;
+    command.type = CmdZeroPosition;
+    command.axisId = axisId;
+    return enqueueCommand(command);
+}
+
+quint64 ZMotionDevice::enqueueCommand(AxisCommand command)
+{
+    command.id = ++m_nextCommandId;
+    m_commandQueue.enqueue(command);
+    m_metrics.setQueueDepth(m_commandQueue.size());
+    if (m_commandTimer && !m_commandTimer->isActive()) {
+        m_commandTimer->start();
+    }
+    return command.id;
+}
+
+void ZMotionDevice::cancelQueuedCommands(int axisId)
+{
+    for (int i = m_commandQueue.size() - 1; i >= 0; --i) {
+        if (axisId < 0 || m_commandQueue.at(i).axisId == axisId) {
+            quint64 id = m_commandQueue.at(i).id;
+            m_commandQueue.removeAt(i);
+            emit commandFinished(id, false);
+        }
+    }
+    m_metrics.setQueueDepth(m_commandQueue.size());
+}
+
+void ZMotionDevice::processCommandQueue()
+{
+    if (m_commandQueue.isEmpty()) {
         return;
     }
-    
-    // 检查轴是否空闲
-    int isIdle = 0;
-    if (ZAux_Direct_GetIfIdle(m_zmcHandle, axisId, &isIdle) == 0 && isIdle == 0) {
-        qWarning() << QString("ZMotion Axis %1 is busy, 'moveContinuous' command ignored.").arg(axisId);
+    if (!isBackendOpen()) {
+        cancelQueuedCommands(-1);
         return;
     }
 
-    // direction: 1 for positive, -1 for negative. API: 1 for positive, 0 for negative.
-    int apiDirection = (direction > 0) ? 1 : 0;
-    
-    int result = ZAux_Direct_Single_Vmove(m_zmcHandle, axisId, apiDirection);
-    if (result != 0) {
-        handleZMotionError(result, QString("VMove Axis%1").arg(axisId));
-        return;
+    AxisCommand command = m_commandQueue.dequeue();
+    const qint64 startNs = m_metrics.nowNs();
+    bool ok = false;
+    if (command.type == CmdSetParameters) {
+        // 连续的参数命令(可属于不同轴)合并为一次控制器事务，且只下发变化的参数
+        QVector<quint64> ids;
+        ids.append(command.id);
+        for (int p = 0; p < ParamCount; ++p) {
+            if (command.paramMask & (1u << p)) {
+                collectParamDelta(command.axisId, p, command.params[p]);
+            }
+        }
+        QString logMsg = QString("Axis%1 params set: Units=%2, Speed=%3, Accel=%4, Decel=%5, S-Ramp=%6")
+                             .arg(command.axisId).arg(command.params[ParamUnits]).arg(command.params[ParamSpeed])
+                             .arg(command.params[ParamAccel]).arg(command.params[ParamDecel]).arg(command.params[ParamSramp]);
+        while (!m_commandQueue.isEmpty() && m_commandQueue.head().type == CmdSetParameters) {
+            AxisCommand next = m_commandQueue.dequeue();
+            ids.append(next.id);
+            for (int p = 0; p < ParamCount; ++p) {
+                if (next.paramMask & (1u << p)) {
+                    collectParamDelta(next.axisId, p, next.params[p]);
+                }
+            }
+        }
+
+        const int changed = m_paramBatch.size();
+        ok = flushParamBatch();
+        if (changed > 0) {
+            emit sig_printLog(QString("%1 (%2 changed)").arg(logMsg).arg(changed).toUtf8(), true);
+        }
+        for (quint64 id : ids) {
+            emit commandFinished(id, ok);
+        }
+    } else {
+        ok = executeCommand(command);
+        emit commandFinished(command.id, ok);
     }
+    // 命令失败的具体原因已在执行时输出日志，统计中统一记为控制器拒绝
+    m_metrics.addRequest();
+    m_metrics.recordTransaction(m_commandBlock, startNs, ok ? DeviceMetrics::Ok : DeviceMetrics::ProtocolError);
+    m_metrics.setQueueDepth(m_commandQueue.size());
 
-    QString dirStr = (direction > 0) ? "positive" : "negative";
-    QString logMsg = QString("Axis%1 continuous move started in %2 direction").arg(axisId).arg(dirStr);
-    emit sig_printLog(logMsg.toUtf8(), true);
+    if (!m_commandQueue.isEmpty()) {
+        m_commandTimer->start();
+    }
 }
 
-void ZMotionDevice::moveRelative(int axisId, double distance)
+bool ZMotionDevice::executeCommand(const AxisCommand& command)
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
-        return;
+    const int axisId = command.axisId;
+    int result = 0;
+
+    switch (command.type) {
+    case CmdMoveContinuous: {
+        if (checkAxisBusy(axisId, "moveContinuous")) {
+            return false;
+        }
+
+        // direction: 1 for positive, -1 for negative. API: 1 for positive, 0 for negative.
+        int apiDirection = (command.mode > 0) ? 1 : 0;
+        result = m_backend->singleVmove(axisId, apiDirection);
+        if (result != 0) {
+            handleZMotionError(result, QString("VMove Axis%1").arg(axisId));
+            return false;
+        }
+        m_state.idle[axisId] = 0;
+
+        QString dirStr = (command.mode > 0) ? "positive" : "negative";
+        QString logMsg = QString("Axis%1 continuous move started in %2 direction").arg(axisId).arg(dirStr);
+        emit sig_printLog(logMsg.toUtf8(), true);
+        return true;
     }
 
-    // 检查轴是否空闲
-    int isIdle = 0;
-    if (ZAux_Direct_GetIfIdle(m_zmcHandle, axisId, &isIdle) == 0 && isIdle == 0) {
-        qWarning() << QString("ZMotion Axis %1 is busy, 'moveRelative' command ignored.").arg(axisId);
-        return;
+    case CmdMoveRelative: {
+        if (checkAxisBusy(axisId, "moveRelative")) {
+            return false;
+        }
+
+        // Single_Move 本身就是相对运动，直接下发距离，无需先读取当前位置
+        result = m_backend->singleMove(axisId, static_cast<float>(command.distance));
+        if (result != 0) {
+            handleZMotionError(result, QString("MoveRel Axis%1").arg(axisId));
+            return false;
+        }
+        m_state.idle[axisId] = 0;
+
+        QString logMsg = QString("Axis%1 move relative by %2").arg(axisId).arg(command.distance);
+        emit sig_printLog(logMsg.toUtf8(), true);
+        return true;
     }
 
-    // ZAux库没有直接的相对运动指令，因此我们通过计算实现
-    // 1. 获取当前位置
-    float currentPos = 0.0f;
-    ZAux_Direct_GetDpos(m_zmcHandle, axisId, &currentPos);
-    
-    // 2. 计算目标绝对位置
-    double targetPos = currentPos + distance;
+    case CmdStartHoming: {
+        if (checkAxisBusy(axisId, "startHoming")) {
+            return false;
+        }
+        if (command.homingIo < 0 || command.homingIo >= ZMotionStateBlock::MaxIo) {
+            QString logMsg = QString("Home Axis%1 rejected: homing IO %2 out of range (0-%3)")
+                                 .arg(axisId).arg(command.homingIo).arg(ZMotionStateBlock::MaxIo - 1);
+            qWarning() << logMsg;
+            emit sig_printLog(logMsg.toUtf8(), false);
+            return false;
+        }
 
-    // 3. 使用绝对位置移动指令
-    int result = ZAux_Direct_Single_Move(m_zmcHandle, axisId, targetPos);
-    if (result != 0) {
-        handleZMotionError(result, QString("MoveRel (via Abs) Axis%1").arg(axisId));
-        return;
+        // 爬行速度、原点开关IO口及其反转设置合并为一次下发
+        // ZMC系列控制器默认原点信号为常闭(NC)，即低电平有效。如果使用常开(NO)传感器，则需要反转输入信号。
+        collectParamDelta(axisId, ParamCreep, command.params[ParamCreep]);
+        collectParamDelta(axisId, ParamDatumIn, command.params[ParamDatumIn]);
+        collectParamDelta(command.homingIo, ParamInvertIn, command.invertIo ? 1.0f : 0.0f);
+        flushParamBatch();
+
+        // 爬行速度设置失败不是致命错误；原点IO口和反转设置失败则不继续
+        const bool datumReady = m_paramCache[axisId][ParamDatumIn] == command.params[ParamDatumIn]
+                && m_invertCache[command.homingIo] == (command.invertIo ? 1 : 0);
+        if (!datumReady) {
+            return false;
+        }
+
+        result = m_backend->singleDatum(axisId, command.mode);
+        if (result != 0) {
+            handleZMotionError(result, QString("Home Axis%1 with mode %2").arg(axisId).arg(command.mode));
+            return false;
+        }
+        m_state.idle[axisId] = 0;
+
+        QString logMsg = QString("Axis%1 homing started: mode=%2, IO=%3, Invert=%4, Creep=%5")
+                             .arg(axisId).arg(command.mode).arg(command.homingIo).arg(command.invertIo)
+                             .arg(command.params[ParamCreep]);
+        emit sig_printLog(logMsg.toUtf8(), true);
+        return true;
     }
 
-    QString logMsg = QString("Axis%1 move relative by %2 (to %3)").arg(axisId).arg(distance).arg(targetPos);
-    emit sig_printLog(logMsg.toUtf8(), true);
+    case CmdZeroPosition: {
+        result = m_backend->setDpos(axisId, 0);
+        if (result != 0) {
+            handleZMotionError(result, QString("zeroPosition Axis%1").arg(axisId));
+            return false;
+        }
+
+        // 手动更新内部缓存和UI，因为硬件状态可能不会立即通过轮询反映出来
+        m_state.dpos[axisId] = 0.0f;
+        m_published.dpos[axisId] = 0.0f;
+        updateAxisData(axisId, AxisPosition, 0.0);
+
+        QString logMsg = QString("Axis%1 position zeroed").arg(axisId);
+        emit sig_printLog(logMsg.toUtf8(), true);
+        return true;
+    }
+
+    default:
+        return false;
+    }
 }
 
-void ZMotionDevice::startHoming(int axisId, int mode, int homingIoPort, bool invertIo, double creepSpeed)
+bool ZMotionDevice::checkAxisBusy(int axisId, const char* operation)
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
-        return;
+    // 轨迹运行中其轴的运动缓冲区被持续送入轨迹段，不能插入其它运动
+    if (m_trajectoryActive && m_trajectory.axes.contains(axisId)) {
+        qWarning() << QString("ZMotion Axis %1 is running a trajectory, '%2' command ignored.").arg(axisId).arg(operation);
+        return true;
     }
 
-    // 检查轴是否空闲
+    // 轮询缓存可能滞后(如文本命令或控制器程序启动的运动)，每次都向控制器确认
     int isIdle = 0;
-    if (ZAux_Direct_GetIfIdle(m_zmcHandle, axisId, &isIdle) == 0 && isIdle == 0) {
-        qWarning() << QString("ZMotion Axis %1 is busy, 'startHoming' command ignored.").arg(axisId);
+    if (m_backend->getIfIdle(axisId, &isIdle) == 0) {
+        m_state.idle[axisId] = isIdle;
+        if (isIdle == 0) {
+            qWarning() << QString("ZMotion Axis %1 is busy, '%2' command ignored.").arg(axisId).arg(operation);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ZMotionDevice::collectParamDelta(int id, int param, float value)
+{
+    if (param == ParamInvertIn) {
+        if (id < 0 || id >= ZMotionStateBlock::MaxIo || m_invertCache[id] == static_cast<qint8>(value)) {
+            return;
+        }
+    } else if (m_paramCache[id][param] == value) { // 未知(NaN)与任何值都不相等
         return;
     }
 
-    int result;
+    // 同一参数在本批次中多次出现时只保留最后一次的值
+    for (PendingParam& pending : m_paramBatch) {
+        if (pending.id == id && pending.param == param) {
+            pending.value = value;
+            return;
+        }
+    }
+    m_paramBatch.append({id, param, value});
+}
+
+bool ZMotionDevice::flushParamBatch()
+{
+    static const char* const paramNames[ParamCount] = {"UNITS", "SPEED", "ACCEL", "DECEL", "SRAMP", "CREEP", "DATUM_IN"};
+    static const int maxCommandLength = 480; // 单次 Execute 命令长度上限
+
+    bool ok = true;
+    int begin = 0;
+    while (begin < m_paramBatch.size()) {
+        // 多条赋值语句用冒号连接，一次通信完成
+        QString command;
+        int end = begin;
+        while (end < m_paramBatch.size() && command.size() < maxCommandLength) {
+            const PendingParam& pending = m_paramBatch.at(end);
+            if (!command.isEmpty()) {
+                command += ':';
+            }
+            if (pending.param == ParamInvertIn) {
+                command += QString("INVERT_IN(%1,%2)").arg(pending.id).arg(static_cast<int>(pending.value));
+            } else {
+                command += QString("%1(%2)=%3").arg(paramNames[pending.param]).arg(pending.id)
+                                                 .arg(static_cast<double>(pending.value), 0, 'g', 9);
+            }
+            ++end;
+        }
 
-    // 1. 设置爬行速度 (可选，但推荐)
-    result = ZAux_Direct_SetCreep(m_zmcHandle, axisId, creepSpeed);
+        bool batchOk = (m_backend->execute(command) == 0);
+        for (int i = begin; i < end; ++i) {
+            const PendingParam& pending = m_paramBatch.at(i);
+            if (!batchOk) {
+                // 控制器拒绝了合并命令，逐条下发以确定失败的参数
+                int result = writeParamDirect(pending);
+                if (result != 0) {
+                    handleZMotionError(result, QString("Set%1 %2").arg(pending.param == ParamInvertIn ? "INVERT_IN" : paramNames[pending.param]).arg(pending.id));
+                    ok = false;
+                    continue;
+                }
+            }
+            if (pending.param == ParamInvertIn) {
+                m_invertCache[pending.id] = static_cast<qint8>(pending.value);
+            } else {
+                m_paramCache[pending.id][pending.param] = pending.value;
+            }
+        }
+        begin = end;
+    }
+
+    m_paramBatch.clear();
+    return ok;
+}
+
+int ZMotionDevice::writeParamDirect(const PendingParam& param)
+{
+    switch (param.param) {
+    case ParamUnits:    return m_backend->setUnits(param.id, param.value);
+    case ParamSpeed:    return m_backend->setSpeed(param.id, param.value);
+    case ParamAccel:    return m_backend->setAccel(param.id, param.value);
+    case ParamDecel:    return m_backend->setDecel(param.id, param.value);
+    case ParamSramp:    return m_backend->setSramp(param.id, param.value);
+    case ParamCreep:    return m_backend->setCreep(param.id, param.value);
+    case ParamDatumIn:  return m_backend->setDatumIn(param.id, static_cast<int>(param.value));
+    case ParamInvertIn: return m_backend->setInvertIn(param.id, static_cast<int>(param.value));
+    default:            return -2;
+    }
+}
+
+void ZMotionDevice::invalidateParamCache()
+{
+    // 重新连接后控制器参数可能已被其它程序修改，全部标记为未知
+    for (int axisId = 0; axisId < ZMotionStateBlock::MaxAxes; ++axisId) {
+        for (int p = 0; p < ParamCount; ++p) {
+            m_paramCache[axisId][p] = qQNaN();
+        }
+    }
+    std::memset(m_invertCache, -1, sizeof(m_invertCache));
+}
+
+bool ZMotionDevice::stopAxis(int axisId)
+{
+    if (!isBackendOpen() || !isAxisEnabled(axisId)) {
+        return false;
+    }
+
+    // 停止命令不排队，同时丢弃该轴尚未执行的命令
+    cancelQueuedCommands(axisId);
+
+    // 停止轨迹中的任一轴都会中止整条轨迹，避免后续段继续被送入缓冲区
+    if (m_trajectoryActive && m_trajectory.axes.contains(axisId)) {
+        abortTrajectory();
+    }
+    
+    // 模式2：减速停止
+    int result = m_backend->singleCancel(axisId, 2);
     if (result != 0) {
-        handleZMotionError(result, QString("SetCreep Axis%1").arg(axisId));
-        // 此处不返回，因为不是致命错误
+        handleZMotionError(result, QString("Stop Axis%1").arg(axisId));
+        return false;
+    }
+    
+    QString logMsg = QString("Axis%1 stopped").arg(axisId);
+    emit sig_printLog(logMsg.toUtf8(), true);
+    return true;
+}
+
+bool ZMotionDevice::stopAllAxes()
+{
+    if (!isBackendOpen()) {
+        return false;
     }
 
-    // 2. 设置原点开关IO口
-    result = ZAux_Direct_SetDatumIn(m_zmcHandle, axisId, homingIoPort);
+    cancelQueuedCommands(-1);
+    abortTrajectory();
+    
+    // 某一轴失败时继续停止其余轴
+    bool allStopped = true;
+    for (int axisId : m_enabledAxes) {
+        // 模式2：减速停止
+        int result = m_backend->singleCancel(axisId, 2);
+        if (result != 0) {
+            handleZMotionError(result, QString("Stop Axis%1").arg(axisId));
+            allStopped = false;
+        }
+    }
+    
+    emit sig_printLog("All axes emergency stopped", true);
+    return allStopped;
+}
+
+
+bool ZMotionDevice::setDigitalOutput(int outputId, bool state)
+{
+    if (!isBackendOpen()) {
+        return false;
+    }
+
+    // state: true for ON (1), false for OFF (0)
+    int result = m_backend->setOp(outputId, state ? 1 : 0);
     if (result != 0) {
-        handleZMotionError(result, QString("SetDatumIn Axis%1").arg(axisId));
-        return; // 这是关键步骤，失败则不继续
+        handleZMotionError(result, QString("SetOutput %1").arg(outputId));
+        return false;
     }
 
-    // 3. 设置IO口是否反转
-    // ZMC系列控制器默认原点信号为常闭(NC)，即低电平有效。如果使用常开(NO)传感器，则需要反转输入信号。
-    int invertValue = invertIo ? 1 : 0;
-    result = ZAux_Direct_SetInvertIn(m_zmcHandle, homingIoPort, invertValue);
-	if (result != 0) {
-        handleZMotionError(result, QString("SetInvertIn Port%1").arg(homingIoPort));
+    if (outputId >= 0 && outputId < ZMotionStateBlock::MaxIo) {
+        quint32 bit = 1u << (outputId % 32);
+        quint32 word = static_cast<quint32>(m_state.outputs[outputId / 32]);
+        word = state ? (word | bit) : (word & ~bit);
+        m_state.outputs[outputId / 32] = static_cast<qint32>(word);
+        publishIoBank(true);
+    }
+
+    QString logMsg = QString("Output%1 set to %2").arg(outputId).arg(state ? "ON" : "OFF");
+    emit sig_printLog(logMsg.toUtf8(), true);
+    return true;
+}
+
+void ZMotionDevice::startTrajectory(const ZMotionTrajectory& trajectory)
+{
+    if (!isBackendOpen()) {
+        return;
+    }
+    if (m_trajectoryActive) {
+        qWarning() << "ZMotion trajectory already running, 'startTrajectory' command ignored.";
+        return;
+    }
+    if (trajectory.axes.isEmpty() || trajectory.segments.isEmpty()) {
         return;
     }
+    for (int axisId : trajectory.axes) {
+        if (!isAxisEnabled(axisId)) {
+            qWarning() << QString("ZMotion Axis %1 is not enabled, 'startTrajectory' command ignored.").arg(axisId);
+            return;
+        }
+    }
+    for (const ZMotionPathSegment& seg : trajectory.segments) {
+        if (seg.end.size() != trajectory.axes.size()
+                || (seg.type == ZMotionPathSegment::Arc && trajectory.axes.size() < 2)) {
+            qWarning() << "ZMotion trajectory segment does not match axis list, 'startTrajectory' command ignored.";
+            return;
+        }
+    }
 
-    // 4. 设置回零模式并启动
-    result = ZAux_Direct_Single_Datum(m_zmcHandle, axisId, mode);
+    m_trajectory = trajectory;
+    m_trajectoryNext = 0;
+
+    // 打开连续插补，相邻运动段之间不减速停顿
+    int base = m_trajectory.axes.first();
+    int result = m_backend->setMerge(base, 1);
     if (result != 0) {
-        handleZMotionError(result, QString("Home Axis%1 with mode %2").arg(axisId).arg(mode));
+        handleZMotionError(result, QString("SetMerge Axis%1").arg(base));
         return;
     }
 
-    QString logMsg = QString("Axis%1 homing started: mode=%2, IO=%3, Invert=%4, Creep=%5")
-                         .arg(axisId).arg(mode).arg(homingIoPort).arg(invertIo).arg(creepSpeed);
+    m_trajectoryActive = true;
+    for (int axisId : m_trajectory.axes) {
+        m_state.idle[axisId] = 0;
+    }
+    QString logMsg = QString("Trajectory started: %1 segments on %2 axes")
+                         .arg(m_trajectory.segments.size()).arg(m_trajectory.axes.size());
     emit sig_printLog(logMsg.toUtf8(), true);
+
+    feedTrajectory();
+    if (m_trajectoryActive) {
+        m_trajectoryTimer->start();
+    }
 }
 
-void ZMotionDevice::stopAxis(int axisId)
+void ZMotionDevice::abortTrajectory()
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
+    if (!m_trajectoryActive) {
         return;
     }
-    
-    // 模式2：减速停止
-    int result = ZAux_Direct_Single_Cancel(m_zmcHandle, axisId, 2);
+
+    if (isBackendOpen()) {
+        // 模式2：取消当前运动和缓冲运动
+        for (int axisId : m_trajectory.axes) {
+            m_backend->singleCancel(axisId, 2);
+        }
+        // 缓冲中的关光指令已被取消，直接关闭轨迹用到的激光输出
+        QList<int> laserOutputs;
+        for (const ZMotionPathSegment& seg : m_trajectory.segments) {
+            if (seg.laserOutput >= 0 && !laserOutputs.contains(seg.laserOutput)) {
+                laserOutputs.append(seg.laserOutput);
+                m_backend->setOp(seg.laserOutput, 0);
+            }
+        }
+    }
+    finishTrajectory(false);
+}
+
+void ZMotionDevice::feedTrajectory()
+{
+    if (!m_trajectoryActive || !isBackendOpen()) {
+        return;
+    }
+
+    const int base = m_trajectory.axes.first();
+    const int total = m_trajectory.segments.size();
+
+    if (m_trajectoryNext >= total) {
+        // 全部段已送入，等待缓冲区执行完毕
+        int buffered = 0;
+        int isIdle = 0;
+        if (m_backend->getMovesBuffered(base, &buffered) == 0 && buffered == 0
+                && m_backend->getIfIdle(base, &isIdle) == 0 && isIdle != 0) {
+            finishTrajectory(true);
+        }
+        return;
+    }
+
+    int remain = 0;
+    int result = m_backend->getRemainBuffer(base, &remain);
     if (result != 0) {
-        handleZMotionError(result, QString("Stop Axis%1").arg(axisId));
+        handleZMotionError(result, QString("GetRemain_Buffer Axis%1").arg(base));
+        abortTrajectory();
         return;
     }
-    
-    QString logMsg = QString("Axis%1 stopped").arg(axisId);
+
+    const int axisCount = m_trajectory.axes.size();
+    int* axisList = m_trajectory.axes.data();
+    int freeSlots = remain - m_trajectoryReserve;
+    const int sentBefore = m_trajectoryNext;
+
+    while (freeSlots > 0 && m_trajectoryNext < total) {
+        const ZMotionPathSegment& seg = m_trajectory.segments.at(m_trajectoryNext);
+
+        // 激光开关指令同样占用一个缓冲位，必须和对应运动段一起送入
+        const int needed = (seg.laserOutput >= 0) ? 2 : 1;
+        if (freeSlots < needed) {
+            break;
+        }
+        if (seg.laserOutput >= 0) {
+            result = m_backend->moveOp(base, seg.laserOutput, seg.laserOn ? 1 : 0);
+            if (result != 0) {
+                handleZMotionError(result, QString("MoveOp Output%1").arg(seg.laserOutput));
+                abortTrajectory();
+                return;
+            }
+            --freeSlots;
+        }
+
+        const bool hasNextLine = (m_trajectoryNext + 1 < total)
+                && m_trajectory.segments.at(m_trajectoryNext + 1).type == ZMotionPathSegment::Line;
+        if (seg.type == ZMotionPathSegment::Arc) {
+            // 圆弧在前两个轴构成的平面内插补
+            result = m_backend->moveCircAbs(2, axisList, seg.end[0], seg.end[1],
+                                             seg.center[0], seg.center[1], seg.direction);
+            if (result != 0) {
+                handleZMotionError(result, QString("MoveCircAbs Segment%1").arg(m_trajectoryNext));
+                abortTrajectory();
+                return;
+            }
+            ++m_trajectoryNext;
+            --freeSlots;
+        } else if (seg.smoothRadius > 0 && axisCount <= 3 && hasNextLine) {
+            const ZMotionPathSegment& next = m_trajectory.segments.at(m_trajectoryNext + 1);
+            float end[3] = {0, 0, 0};
+            float nextEnd[3] = {0, 0, 0};
+            for (int i = 0; i < axisCount; ++i) {
+                end[i] = seg.end[i];
+                nextEnd[i] = next.end[i];
+            }
+            result = m_backend->moveSmooth(axisCount, axisList, end[0], end[1], end[2],
+                                            nextEnd[0], nextEnd[1], nextEnd[2], seg.smoothRadius);
+            if (result != 0) {
+                handleZMotionError(result, QString("MoveSmooth Segment%1").arg(m_trajectoryNext));
+                abortTrajectory();
+                return;
+            }
+            ++m_trajectoryNext;
+            --freeSlots;
+        } else {
+            int sent = sendLineBatch(freeSlots);
+            if (sent <= 0) {
+                abortTrajectory();
+                return;
+            }
+            freeSlots -= sent;
+        }
+    }
+
+    if (m_trajectoryNext != sentBefore) {
+        emit trajectoryProgress(m_trajectoryNext, total);
+    }
+}
+
+int ZMotionDevice::sendLineBatch(int count)
+{
+    // 合并连续的普通直线段(无激光指令、无过渡圆弧)，一次 MultiMoveAbs 调用送入
+    const int axisCount = m_trajectory.axes.size();
+    const int total = m_trajectory.segments.size();
+    int batch = 0;
+    m_lineBatchBuf.resize(0);
+    while (batch < count && m_trajectoryNext + batch < total) {
+        const ZMotionPathSegment& seg = m_trajectory.segments.at(m_trajectoryNext + batch);
+        // 首段的激光指令已由调用者送入
+        if (seg.type != ZMotionPathSegment::Line || (batch > 0 && seg.laserOutput >= 0)
+                || (batch > 0 && seg.smoothRadius > 0)) {
+            break;
+        }
+        for (int i = 0; i < axisCount; ++i) {
+            m_lineBatchBuf.append(seg.end[i]);
+        }
+        ++batch;
+    }
+
+    int result = m_backend->multiMoveAbs(batch, axisCount, m_trajectory.axes.data(), m_lineBatchBuf.data());
+    if (result != 0) {
+        handleZMotionError(result, QString("MultiMoveAbs Segment%1").arg(m_trajectoryNext));
+        return -1;
+    }
+    m_trajectoryNext += batch;
+    return batch;
+}
+
+void ZMotionDevice::finishTrajectory(bool completed)
+{
+    if (m_trajectoryTimer) {
+        m_trajectoryTimer->stop();
+    }
+    if (isBackendOpen() && !m_trajectory.axes.isEmpty()) {
+        m_backend->setMerge(m_trajectory.axes.first(), 0);
+    }
+    m_trajectoryActive = false;
+
+    QString logMsg = QString("Trajectory %1 after %2/%3 segments")
+                         .arg(completed ? "completed" : "aborted")
+                         .arg(m_trajectoryNext).arg(m_trajectory.segments.size());
     emit sig_printLog(logMsg.toUtf8(), true);
+    emit trajectoryFinished(completed);
 }
 
-void ZMotionDevice::zeroPosition(int axisId)
+bool ZMotionDevice::startScopeCapture(const QVector<int>& axes, int intervalTicks, int samples)
 {
-    if (!m_zmcHandle || !m_enabledAxes.contains(axisId)) {
-        return;
+    if (!isBackendOpen()) {
+        return false;
+    }
+    if (m_scopeActive) {
+        qWarning() << "ZMotion scope capture already running, 'startScopeCapture' command ignored.";
+        return false;
+    }
+    if (axes.isEmpty() || samples <= 0) {
+        return false;
+    }
+    for (int axisId : axes) {
+        if (!isAxisEnabled(axisId)) {
+            qWarning() << QString("ZMotion Axis %1 is not enabled, 'startScopeCapture' command ignored.").arg(axisId);
+            return false;
+        }
     }
+    const int channels = axes.size() * ZMotionScopeTrace::ChannelsPerAxis;
+    if (channels > m_scopeMaxChannels) {
+        qWarning() << QString("ZMotion scope supports at most %1 channels, %2 requested.").arg(m_scopeMaxChannels).arg(channels);
+        return false;
+    }
+
+    // 采样周期 = 伺服周期 × 间隔，查询失败时按1ms计
+    double servoPeriodUs = 1000.0;
+    queryValue("SERVO_PERIOD", &servoPeriodUs);
+    intervalTicks = qMax(1, intervalTicks);
 
-    int result = ZAux_Direct_SetDpos(m_zmcHandle, axisId, 0);
+    // 各通道数据在TABLE中依次存放: [通道0的samples个点][通道1]...，与 ZMotionScopeTrace 的内存布局一致
+    QStringList params;
+    for (int axisId : axes) {
+        for (int c = 0; c < ZMotionScopeTrace::ChannelsPerAxis; ++c) {
+            params << QString("%1(%2)").arg(ZMotionScopeTrace::parameterName(static_cast<ZMotionScopeTrace::Channel>(c))).arg(axisId);
+        }
+    }
+    const int tableEnd = m_scopeTableStart + channels * samples - 1;
+    QString command = QString("SCOPE(ON,%1,%2,%3,%4)").arg(intervalTicks).arg(m_scopeTableStart).arg(tableEnd).arg(params.join(','));
+    int result = m_backend->execute(command);
     if (result != 0) {
-        handleZMotionError(result, QString("zeroPosition Axis%1").arg(axisId));
-        return;
+        handleZMotionError(result, "SCOPE");
+        return false;
+    }
+    result = m_backend->trigger();
+    if (result != 0) {
+        handleZMotionError(result, "Trigger");
+        return false;
     }
 
-    // 手动更新内部缓存和UI，因为硬件状态可能不会立即通过轮询反映出来
-    m_axisPositions[axisId] = 0.0;
-    updateAxisData(axisId, "position", 0.0);
+    m_scopeTrace.reset(axes, samples, qRound64(servoPeriodUs * 1000.0 * intervalTicks));
+    m_scopeTrace.setTimestamp(QDateTime::currentMSecsSinceEpoch());
+    m_scopeDownloaded = -1;
+    m_scopeExpectedMs = static_cast<qint64>(samples * intervalTicks * servoPeriodUs / 1000.0);
+    m_scopeClock.start();
+    m_scopeActive = true;
+    m_scopeTimer->setInterval(m_scopePollInterval);
+    m_scopeTimer->start();
 
-    QString logMsg = QString("Axis%1 position zeroed").arg(axisId);
+    QString logMsg = QString("Scope capture started: %1 channels x %2 samples every %3 us")
+                         .arg(channels).arg(samples).arg(servoPeriodUs * intervalTicks);
     emit sig_printLog(logMsg.toUtf8(), true);
+    return true;
 }
 
-void ZMotionDevice::stopAllAxes()
+void ZMotionDevice::abortScopeCapture()
 {
-    if (!m_zmcHandle) {
+    if (!m_scopeActive) {
         return;
     }
-    
-    for (int axisId : m_enabledAxes) {
-        // 模式2：减速停止
-        ZAux_Direct_Single_Cancel(m_zmcHandle, axisId, 2);
+    if (isBackendOpen()) {
+        m_backend->execute("SCOPE(OFF)");
     }
-    
-    emit sig_printLog("All axes emergency stopped", true);
+    finishScopeCapture(false);
 }
 
-
-void ZMotionDevice::setDigitalOutput(int outputId, bool state)
+void ZMotionDevice::pollScopeCapture()
 {
-    if (!m_zmcHandle) {
+    if (!m_scopeActive) {
+        m_scopeTimer->stop();
+        return;
+    }
+    if (!isBackendOpen()) {
+        finishScopeCapture(false);
         return;
     }
 
-    // state: true for ON (1), false for OFF (0)
-    int result = ZAux_Direct_SetOp(m_zmcHandle, outputId, state ? 1 : 0);
+    if (m_scopeDownloaded < 0) {
+        // 采集阶段：等待控制器写满每个通道
+        double scopePos = 0.0;
+        if (queryValue("SCOPE_POS", &scopePos) && scopePos >= m_scopeTableStart + m_scopeTrace.sampleCount()) {
+            m_scopeDownloaded = 0;
+            m_scopeTimer->setInterval(0);
+        } else if (m_scopeClock.elapsed() > m_scopeExpectedMs * 2 + 1000) {
+            emit sig_printLog("Scope capture timed out", false);
+            finishScopeCapture(false);
+        }
+        return;
+    }
+
+    // 下载阶段：每次读取一块，块与块之间状态轮询可以正常执行
+    const int total = m_scopeTrace.channelCount() * m_scopeTrace.sampleCount();
+    const int count = qMin(m_scopeChunk, total - m_scopeDownloaded);
+    int result = m_backend->getTable(m_scopeTableStart + m_scopeDownloaded, count, m_scopeTrace.data() + m_scopeDownloaded);
     if (result != 0) {
-        handleZMotionError(result, QString("SetOutput %1").arg(outputId));
+        handleZMotionError(result, QString("GetTable %1").arg(m_scopeTableStart + m_scopeDownloaded));
+        finishScopeCapture(false);
         return;
     }
+    m_scopeDownloaded += count;
+    if (m_scopeDownloaded >= total) {
+        finishScopeCapture(true);
+    }
+}
+
+void ZMotionDevice::finishScopeCapture(bool ok)
+{
+    m_scopeTimer->stop();
+    m_scopeActive = false;
 
-    m_outputStates[outputId] = state;
-    updateIOData(outputId, "output", state);
+    if (ok && !m_scopeOutputDir.isEmpty()) {
+        QString fileName = QString("scope_%1.zsc")
+                               .arg(QDateTime::fromMSecsSinceEpoch(m_scopeTrace.timestamp()).toString("yyyyMMdd_hhmmss"));
+        QString path = QDir(m_scopeOutputDir).filePath(fileName);
+        QString error;
+        if (!m_scopeTrace.save(path, &error)) {
+            qWarning() << "ZMotion scope trace save failed:" << path << error;
+        } else {
+            emit sig_printLog(QString("Scope trace saved to %1").arg(path).toUtf8(), false);
+        }
+    }
 
-    QString logMsg = QString("Output%1 set to %2").arg(outputId).arg(state ? "ON" : "OFF");
+    QString logMsg = QString("Scope capture %1").arg(ok ? "completed" : "aborted");
     emit sig_printLog(logMsg.toUtf8(), true);
+    emit scopeCaptureFinished(ok, m_scopeTrace);
+}
+
+bool ZMotionDevice::queryValue(const QString& name, double* value)
+{
+    QString response;
+    if (m_backend->execute("?" + name, &response) != 0) {
+        return false;
+    }
+    bool ok = false;
+    double parsed = response.trimmed().toDouble(&ok);
+    if (ok) {
+        *value = parsed;
+    }
+    return ok;
 }
 
 bool ZMotionDevice::getInput(int inputId)
 {
-    if (!m_zmcHandle) {
+    if (!isBackendOpen()) {
         return false;
     }
     
-    uint32 value = 0;
-    int result = ZAux_Direct_GetIn(m_zmcHandle, inputId, &value);
+    quint32 value = 0;
+    int result = m_backend->getIn(inputId, &value);
     
     if (result != 0) {
         handleZMotionError(result, QString("GetInput %1").arg(inputId));
@@ -374,76 +1239,240 @@ bool ZMotionDevice::getInput(int inputId)
     return (value != 0);
 }
 
-void ZMotionDevice::readAllAxisStatus()
+bool ZMotionDevice::readAllAxisStatus()
 {
-    if (!m_zmcHandle) {
-        return;
+    if (!isBackendOpen()) {
+        return false;
     }
-    
-    for (int axisId : m_enabledAxes) {
-        // 读取轴位置
-        float position = 0.0f;
-        int result = ZAux_Direct_GetDpos(m_zmcHandle, axisId, &position);
-        
-        if (result == 0) {
-            double oldPos = m_axisPositions.value(axisId, 0.0);
-            if (qAbs(oldPos - position) > 0.001) { // 位置变化超过0.001mm才更新
-                m_axisPositions[axisId] = position;
-                updateAxisData(axisId, "position", position);
-            }
+    if (m_maxAxisCount == 0) {
+        return true;
+    }
+
+    // 一次请求读取所有轴的 IDLE/DPOS/MPOS/AXISSTATUS，直接写入状态块
+    const qint64 startNs = m_metrics.nowNs();
+    int result = m_backend->getAllAxisInfo(m_maxAxisCount, m_state.idle, m_state.dpos,
+                                           m_state.mpos, m_state.alarm);
+    if (result != 0) {
+        // 旧固件不支持GetAllAxisInfo时，退化为两次批量读取: Modbus快速读DPOS + 全轴IDLE参数
+        result = m_backend->getModbusDpos(m_maxAxisCount, m_state.dpos);
+        if (result != 0) {
+            recordBackendCall(m_axisStatusBlock, startNs, result);
+            handleStatusReadError(result);
+            return false;
         }
-        
-        // 读取轴状态
-        int isIdle = 0;
-        result = ZAux_Direct_GetIfIdle(m_zmcHandle, axisId, &isIdle);
-        
-        if (result == 0) {
-            // ZAux_Direct_GetIfIdle: 1表示空闲, 0表示运动
-            // 为了与旧逻辑保持某种程度的一致性，我们可以定义一个简单的状态
+        float idleValues[ZMotionStateBlock::MaxAxes];
+        result = m_backend->getAllAxisPara("IDLE", m_maxAxisCount, idleValues);
+        if (result != 0) {
+            recordBackendCall(m_axisStatusBlock, startNs, result);
+            handleStatusReadError(result);
+            return false;
+        }
+        for (int i = 0; i < m_maxAxisCount; ++i) {
+            m_state.idle[i] = static_cast<qint32>(idleValues[i]);
+        }
+        std::memcpy(m_state.mpos, m_state.dpos, sizeof(float) * m_maxAxisCount);
+    }
+    recordBackendCall(m_axisStatusBlock, startNs, result);
+
+    updateDerivedState();
+    publishAxisStatus();
+    return true;
+}
+
+void ZMotionDevice::updateDerivedState()
+{
+    // 速度由相邻两次采样的反馈位置差分得到，不额外占用一次通信
+    qint64 now = m_sampleClock.nsecsElapsed();
+    if (m_lastSampleNs >= 0 && now > m_lastSampleNs) {
+        const float invDt = static_cast<float>(1e9 / (now - m_lastSampleNs));
+        for (int i = 0; i < m_maxAxisCount; ++i) {
+            m_state.speed[i] = qAbs(m_state.mpos[i] - m_prevMpos[i]) * invDt;
+        }
+    }
+    m_lastSampleNs = now;
+    std::memcpy(m_prevMpos, m_state.mpos, sizeof(float) * m_maxAxisCount);
+}
+
+void ZMotionDevice::publishAxisStatus()
+{
+    // 逐字段与上次发布的快照比较，得到每个字段的变化位图(无分支，编译器可向量化)
+    quint32 positionMask = 0;
+    quint32 statusMask = 0;
+    quint32 speedMask = 0;
+    quint32 alarmMask = 0;
+    for (int i = 0; i < m_maxAxisCount; ++i) {
+        positionMask |= quint32(qAbs(m_state.dpos[i] - m_published.dpos[i]) > 0.001f) << i; // 位置变化超过0.001mm才更新
+        statusMask |= quint32((m_state.idle[i] != 0) != (m_published.idle[i] != 0)) << i;
+        speedMask |= quint32(qAbs(m_state.speed[i] - m_published.speed[i]) > 0.001f) << i;
+        alarmMask |= quint32(m_state.alarm[i] != m_published.alarm[i]) << i;
+    }
+    if (m_forcePublish) {
+        positionMask = statusMask = speedMask = alarmMask = m_enabledMask;
+    }
+
+    publishAxisField(positionMask & m_enabledMask, AxisPosition);
+    publishAxisField(statusMask & m_enabledMask, AxisStatus);
+    publishAxisField(speedMask & m_enabledMask, AxisSpeed);
+    publishAxisField(alarmMask & m_enabledMask, AxisAlarm);
+}
+
+void ZMotionDevice::publishAxisField(quint32 changedMask, AxisField field)
+{
+    while (changedMask) {
+        const int axisId = qCountTrailingZeroBits(changedMask);
+        changedMask &= changedMask - 1;
+
+        switch (field) {
+        case AxisPosition:
+            m_published.dpos[axisId] = m_state.dpos[axisId];
+            updateAxisData(axisId, field, static_cast<double>(m_state.dpos[axisId]));
+            break;
+        case AxisStatus:
+            // IDLE: 非0表示空闲, 0表示运动
             // 0: 运动中, 1: 停止
-            int currentStatus = isIdle ? 1 : 0;
-            int oldStatus = m_axisStatus.value(axisId, -1);
-            if (oldStatus != currentStatus) {
-                m_axisStatus[axisId] = currentStatus;
-                updateAxisData(axisId, "status", currentStatus);
-            }
+            m_published.idle[axisId] = m_state.idle[axisId];
+            updateAxisData(axisId, field, m_state.idle[axisId] ? 1 : 0);
+            break;
+        case AxisSpeed:
+            m_published.speed[axisId] = m_state.speed[axisId];
+            updateAxisData(axisId, field, static_cast<double>(m_state.speed[axisId]));
+            break;
+        case AxisAlarm:
+            m_published.alarm[axisId] = m_state.alarm[axisId];
+            updateAxisData(axisId, field, m_state.alarm[axisId]);
+            break;
+        default:
+            break;
         }
     }
 }
 
-void ZMotionDevice::readAllIOStatus()
+bool ZMotionDevice::readAllIOStatus()
 {
-    if (!m_zmcHandle) {
-        return;
+    if (!isBackendOpen()) {
+        return false;
     }
-    
-    // 读取输入状态 (假设有16个输入)
-    for (int i = 0; i < 16; i++) {
-        uint32 value = 0;
-        int result = ZAux_Direct_GetIn(m_zmcHandle, i, &value);
-        
-        if (result == 0) {
-            bool state = (value != 0);
-            bool oldState = m_inputStates.value(i, false);
-            if (oldState != state) {
-                m_inputStates[i] = state;
-                updateIOData(i, "input", state);
+
+    // 输入、输出各一次请求，按位存储，每个int32存放32个IO点
+    if (m_inputCount > 0) {
+        const qint64 startNs = m_metrics.nowNs();
+        int result = m_backend->getInMulti(0, m_inputCount - 1, m_state.inputs);
+        if (result != 0) {
+            // 退化为Modbus快速读取，按位打包，每个字节存放8个输入口
+            quint8 inputBytes[(ZMotionStateBlock::MaxIo + 7) / 8];
+            result = m_backend->getModbusIn(0, m_inputCount - 1, inputBytes);
+            if (result == 0) {
+                std::memset(m_state.inputs, 0, sizeof(m_state.inputs));
+                for (int i = 0; i < m_inputCount; ++i) {
+                    if ((inputBytes[i >> 3] >> (i & 7)) & 1) {
+                        m_state.inputs[i / 32] |= static_cast<qint32>(1u << (i % 32));
+                    }
+                }
             }
         }
+        recordBackendCall(m_inputsBlock, startNs, result);
+        if (result != 0) {
+            handleStatusReadError(result);
+            return false;
+        }
+        publishIoBank(false);
+    }
+
+    // 输出也可能由控制器程序或缓冲输出(MoveOp)改变，同样回读
+    if (m_outputCount > 0) {
+        const qint64 startNs = m_metrics.nowNs();
+        int result = m_backend->getOutMulti(0, m_outputCount - 1, m_state.outputs);
+        recordBackendCall(m_outputsBlock, startNs, result);
+        if (result != 0) {
+            handleStatusReadError(result);
+            return false;
+        }
+        publishIoBank(true);
     }
+    return true;
 }
 
+void ZMotionDevice::publishIoBank(bool isOutput)
+{
+    const int count = isOutput ? m_outputCount : m_inputCount;
+    const qint32* current = isOutput ? m_state.outputs : m_state.inputs;
+    qint32* published = isOutput ? m_published.outputs : m_published.inputs;
+    if (count <= 0) {
+        return;
+    }
+
+    // 按字异或得到变化位，整组IO只发布一次，由使用者按需解包
+    IoBank bank;
+    bank.count = static_cast<quint16>(count);
+    quint32 anyChanged = 0;
+    const int wordCount = (count + 31) / 32;
+    for (int w = 0; w < wordCount; ++w) {
+        const int bitsInWord = qMin(32, count - w * 32);
+        const quint32 validMask = (bitsInWord == 32) ? 0xFFFFFFFFu : ((1u << bitsInWord) - 1);
+        const quint32 word = static_cast<quint32>(current[w]) & validMask;
+        bank.words[w] = word;
+        bank.changed[w] = m_forcePublish ? validMask : ((word ^ static_cast<quint32>(published[w])) & validMask);
+        anyChanged |= bank.changed[w];
+        published[w] = static_cast<qint32>(word);
+    }
+    if (!anyChanged) {
+        return;
+    }
+
+    emit dataUpdated(deviceId(), isOutput ? QStringLiteral("output_bank") : QStringLiteral("input_bank"),
+                     QVariant::fromValue(bank));
+}
+
+bool ZMotionDevice::isBackendOpen() const
+{
+    return m_backend && m_backend->isOpen();
+}
+
+bool ZMotionDevice::isAxisEnabled(int axisId) const
+{
+    return axisId >= 0 && axisId < ZMotionStateBlock::MaxAxes && ((m_enabledMask >> axisId) & 1u);
+}
+
+void ZMotionDevice::updateAxisData(int axisId, AxisField field, const QVariant& value)
+{
+    emit dataUpdated(deviceId(), m_axisKeys[axisId][field], value);
+}
 
-void ZMotionDevice::updateAxisData(int axisId, const QString& parameter, const QVariant& value)
+void ZMotionDevice::recordBackendCall(int block, qint64 startNs, int result)
 {
-    QString key = QString("axis%1_%2").arg(axisId).arg(parameter);
-    emit dataUpdated(deviceId(), key, value);
+    m_metrics.addRequest();
+    DeviceMetrics::Outcome outcome = DeviceMetrics::Ok;
+    if (result == -5) {
+        outcome = DeviceMetrics::Timeout;
+    } else if (result == -1) {
+        outcome = DeviceMetrics::CommError;
+    } else if (result != 0) {
+        outcome = DeviceMetrics::ProtocolError;
+    }
+    m_metrics.recordTransaction(block, startNs, outcome);
 }
 
-void ZMotionDevice::updateIOData(int ioId, const QString& type, bool state)
+void ZMotionDevice::handleStatusReadError(int errorCode)
 {
-    QString key = QString("%1%2").arg(type).arg(ioId);
-    emit dataUpdated(deviceId(), key, state ? "1" : "0");
+    // 只有通信失败和超时说明链路有问题，参数错误等不计入
+    if (errorCode != -1 && errorCode != -5) {
+        return;
+    }
+    if (++m_commFailures < m_lostAfterErrors) {
+        return;
+    }
+
+    // 连续多次轮询失败视为连接已断开，关闭句柄后由基类按退避策略自动重连
+    handleZMotionError(errorCode, "ReadStatus");
+    emit sig_printLog(QString("ZMotion connection lost after %1 failed status reads").arg(m_commFailures).toUtf8(), false);
+    abortTrajectory();
+    abortScopeCapture();
+    cancelQueuedCommands(-1);
+    m_statusTimer->stop();
+    stopCycleUp();
+    m_backend->close();
+    m_commFailures = 0;
+    setConnected(false);
 }
 
 void ZMotionDevice::handleZMotionError(int errorCode, const QString& operation)
@@ -3,9 +3,69 @@
 
 #include "core/Device.h"
 #include <QJsonObject>
-#include <QMap>
+#include <QVector>
 #include <QTimer>
-#include "zmotion.h" // 包含ZMotion库的基础定义
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QMetaType>
+#include <cstddef>
+#include "core/IoBank.h"
+#include "ZMotionScopeTrace.h"
+
+class ZMotionBackend;
+
+/**
+ * @brief 轨迹中的一段插补运动
+ */
+struct ZMotionPathSegment
+{
+    enum Type { Line, Arc };
+
+    Type type = Line;
+    QVector<float> end;         ///< 各轴终点绝对坐标，顺序与 ZMotionTrajectory::axes 一致
+    float center[2] = {0, 0};   ///< 圆弧圆心绝对坐标(前两个轴)
+    int direction = 0;          ///< 圆弧方向 0-逆时针 1-顺时针
+    float smoothRadius = 0;     ///< >0时与下一段直线之间自动插入过渡圆弧(MoveSmooth，最多3轴)
+    int laserOutput = -1;       ///< >=0时在本段开始前通过运动缓冲(MoveOp)同步切换该输出口
+    bool laserOn = false;       ///< 输出口目标状态
+};
+
+/**
+ * @brief 多轴轨迹：参与插补的轴列表和按顺序执行的运动段
+ */
+struct ZMotionTrajectory
+{
+    QVector<int> axes;                      ///< 插补轴列表，第一个轴为主轴(BASE)
+    QVector<ZMotionPathSegment> segments;   ///< 运动段
+};
+Q_DECLARE_METATYPE(ZMotionTrajectory)
+
+/**
+ * @brief 控制器状态快照：所有轴和IO的定长平铺数组
+ *
+ * 批量读取接口直接写入这些数组，轮询时不分配内存。每个轴数组为128字节，
+ * 两个IO位图合计64字节共用一个缓存行，各数组都从缓存行边界开始(对齐的堆分配需要C++17)。
+ */
+struct alignas(64) ZMotionStateBlock
+{
+    enum { MaxAxes = 32, MaxIo = 256, IoWords = MaxIo / 32 };
+
+    alignas(64) float dpos[MaxAxes];        ///< 指令位置
+    alignas(64) float mpos[MaxAxes];        ///< 反馈位置
+    alignas(64) float speed[MaxAxes];       ///< 反馈速度，由相邻两次采样的MPOS差分得到
+    alignas(64) qint32 idle[MaxAxes];       ///< IDLE: 非0表示空闲
+    alignas(64) qint32 alarm[MaxAxes];      ///< AXISSTATUS 轴状态字
+    alignas(64) qint32 inputs[IoWords];     ///< 输入口位图，每个字存放32个输入口
+    qint32 outputs[IoWords];                ///< 输出口位图，与输入口位图在同一缓存行
+};
+
+static_assert(offsetof(ZMotionStateBlock, dpos) % 64 == 0 && offsetof(ZMotionStateBlock, mpos) % 64 == 0
+              && offsetof(ZMotionStateBlock, speed) % 64 == 0 && offsetof(ZMotionStateBlock, idle) % 64 == 0
+              && offsetof(ZMotionStateBlock, alarm) % 64 == 0 && offsetof(ZMotionStateBlock, inputs) % 64 == 0,
+              "ZMotionStateBlock arrays must start on cache line boundaries");
+static_assert(offsetof(ZMotionStateBlock, outputs) == offsetof(ZMotionStateBlock, inputs) + 32
+              && sizeof(ZMotionStateBlock) == 5 * 128 + 64,
+              "ZMotionStateBlock IO bitmaps must share one cache line");
 
 /**
  * @brief ZMotion运动控制卡设备类
@@ -29,32 +89,156 @@ public slots:
     void initInThread() override;
     void stop() override;
 
-    // 新的轴控制接口
-    void setAxisParameters(int axisId, double units, double speed, double accel, double decel, double sramp);
-    void moveContinuous(int axisId, int direction); // direction: 1 for positive, -1 for negative
-    void moveRelative(int axisId, double distance);
-    void startHoming(int axisId, int mode, int homingIoPort, bool invertIo, double creepSpeed);
-    void stopAxis(int axisId);
-    void zeroPosition(int axisId);
-    void setDigitalOutput(int outputId, bool state);
+    // 轴控制接口
+    // 以下命令进入命令队列，在设备线程中逐条异步执行，不阻塞状态轮询。
+    // 返回命令编号，执行结束时通过 commandFinished 通知；轴未启用或未连接时返回0。
+    quint64 setAxisParameters(int axisId, double units, double speed, double accel, double decel, double sramp);
+    quint64 moveContinuous(int axisId, int direction); // direction: 1 for positive, -1 for negative
+    quint64 moveRelative(int axisId, double distance);
+    quint64 startHoming(int axisId, int mode, int homingIoPort, bool invertIo, double creepSpeed);
+    quint64 zeroPosition(int axisId);
+
+    // 停止命令立即执行，并取消该轴尚未执行的排队命令。命令已下发到控制器时返回true
+    bool stopAxis(int axisId);
+    bool setDigitalOutput(int outputId, bool state);
+
+    /**
+     * @brief 开始连续轨迹运动。轨迹段被持续送入控制器运动缓冲区，段与段之间不停顿。
+     * @param trajectory 轨迹
+     */
+    void startTrajectory(const ZMotionTrajectory& trajectory);
+
+    /**
+     * @brief 中止当前轨迹，取消所有缓冲运动并关闭轨迹中使用的激光输出
+     */
+    void abortTrajectory();
+
+    /**
+     * @brief 启动示波器采集，由控制器按伺服周期记录各轴 DPOS/MPOS/MSPEED/FE 到TABLE，
+     *        采集完成后整块下载。结果通过 scopeCaptureFinished 通知。
+     * @param axes 采集的轴，每轴占用4个通道
+     * @param intervalTicks 采样间隔(伺服周期数)
+     * @param samples 每通道采样点数
+     * @return 启动成功返回true
+     */
+    bool startScopeCapture(const QVector<int>& axes, int intervalTicks, int samples);
+
+    /**
+     * @brief 中止示波器采集
+     */
+    void abortScopeCapture();
+
+protected:
+    /**
+     * @brief 优先写入(联锁动作)，立即执行，不进命令队列:
+     *        stop_all 停止全部轴；axis<N>_stop 停止一个轴；output<N> 设置输出口，value 非0为开
+     */
+    void writePriority(const QString& key, const QString& value, qint64 triggerNs) override;
+
+signals:
+    /**
+     * @brief 轨迹送入进度
+     * @param segmentsSent 已送入运动缓冲区的段数
+     * @param total 总段数
+     */
+    void trajectoryProgress(int segmentsSent, int total);
+
+    /**
+     * @brief 轨迹执行结束
+     * @param completed 正常走完为true，被中止或出错为false
+     */
+    void trajectoryFinished(bool completed);
+
+    /**
+     * @brief 排队的轴命令执行结束
+     * @param commandId 提交命令时返回的编号
+     * @param ok 执行成功为true，失败、被停止命令取消或连接断开为false
+     */
+    void commandFinished(quint64 commandId, bool ok);
+
+    /**
+     * @brief 示波器采集结束
+     * @param ok 采集并下载成功为true
+     * @param trace 采集数据，失败时为不完整数据
+     */
+    void scopeCaptureFinished(bool ok, const ZMotionScopeTrace& trace);
 
 private slots:
     void onStatusTimer();
+    void feedTrajectory();
+    void processCommandQueue();
+    void pollScopeCapture();
 
 private:
-    // 轴控制功能
-    void stopAllAxes();
+    // 轴控制功能，全部启用轴的停止命令都已下发时返回true
+    bool stopAllAxes();
 
     // IO控制功能
     bool getInput(int inputId);
     
     // 状态读取和数据处理
-    void readAllAxisStatus();
-    void readAllIOStatus();
-    void updateAxisData(int axisId, const QString& parameter, const QVariant& value);
-    void updateIOData(int ioId, const QString& type, bool state);
+    // 读取并发布成功时返回true；通信失败经 handleStatusReadError 计入断线判断
+    bool readAllAxisStatus();
+    bool readAllIOStatus();
+    void publishAxisStatus();
+    void publishIoBank(bool isOutput);
+    void updateDerivedState();
+    bool isAxisEnabled(int axisId) const;
+    bool isBackendOpen() const;     // 后端不可用(m_backend为空)时返回false
+
+    // 轨迹流式送入
+    int sendLineBatch(int count);
+    void finishTrajectory(bool completed);
+
+    // 周期上报(CycleUp): 控制器按固定周期主动推送DPOS/IDLE/IN
+    bool startCycleUp();
+    void stopCycleUp();
+    bool readCycleUpStatus();
+
+    // 发布到DataManager的轴字段，对应 key: axis<N>_position/status/speed/alarm
+    enum AxisField { AxisPosition, AxisStatus, AxisSpeed, AxisAlarm, AxisFieldCount };
+    void updateAxisData(int axisId, AxisField field, const QVariant& value);
+    void publishAxisField(quint32 changedMask, AxisField field);
     
+    // 轴参数缓存：只有与控制器当前值不同的参数才会下发
+    enum AxisParam { ParamUnits, ParamSpeed, ParamAccel, ParamDecel, ParamSramp, ParamCreep, ParamDatumIn,
+                     ParamCount, ParamInvertIn = ParamCount };
+
+    // 排队执行的轴命令
+    enum CommandType { CmdSetParameters, CmdMoveContinuous, CmdMoveRelative, CmdStartHoming, CmdZeroPosition };
+    struct AxisCommand {
+        quint64 id = 0;
+        CommandType type = CmdSetParameters;
+        int axisId = 0;
+        float params[ParamCount];   // CmdSetParameters/CmdStartHoming 的参数值，paramMask 标记有效项
+        quint32 paramMask = 0;
+        int mode = 0;               // 运动方向或回零模式
+        int homingIo = 0;
+        bool invertIo = false;
+        double distance = 0.0;
+    };
+    struct PendingParam {
+        int id;                     // 轴号；ParamInvertIn 时为IO号
+        int param;
+        float value;
+    };
+
+    quint64 enqueueCommand(AxisCommand command);
+    void cancelQueuedCommands(int axisId);
+    bool executeCommand(const AxisCommand& command);
+    bool checkAxisBusy(int axisId, const char* operation);
+    void collectParamDelta(int id, int param, float value);
+    bool flushParamBatch();
+    int writeParamDirect(const PendingParam& param);
+    void invalidateParamCache();
+
+    // 示波器采集
+    void finishScopeCapture(bool ok);
+    bool queryValue(const QString& name, double* value);
+
     // 错误处理
+    void recordBackendCall(int block, qint64 startNs, int result);
+    void handleStatusReadError(int errorCode);
     void handleZMotionError(int errorCode, const QString& operation);
     QString getZMotionErrorString(int errorCode);
 
@@ -63,16 +247,70 @@ private:
     QTimer* m_statusTimer;          // 状态轮询定时器
     
     // ZMotion连接
-    ZMC_HANDLE m_zmcHandle;         // ZMotion连接句柄
+    ZMotionBackend* m_backend;      // 控制器访问后端(SDK或仿真)，持有连接句柄；配置的后端不可用时为空
     
     // 轴配置 (构造函数中从config读取)
     QList<int> m_enabledAxes;       // 启用的轴列表
-    
-    // 状态数据缓存 (运行时需要的)
-    QMap<int, double> m_axisPositions;      // 轴当前位置
-    QMap<int, int> m_axisStatus;            // 轴状态
-    QMap<int, bool> m_inputStates;          // 输入IO状态
-    QMap<int, bool> m_outputStates;         // 输出IO状态
+    quint32 m_enabledMask;          // 启用轴位图，命令入口用于快速检查轴号
+    int m_maxAxisCount;             // 批量读取的轴数量 (最大启用轴号+1)
+    int m_inputCount;               // 输入IO数量
+    int m_outputCount;              // 输出IO数量
+    int m_statusInterval;           // 状态轮询间隔(ms)
+    int m_lostAfterErrors;          // 连续多少次状态读取通信失败后判定连接断开
+    int m_commFailures;             // 当前连续通信失败次数
+    int m_axisStatusBlock;          // 运行统计中各类状态读取的块编号
+    int m_inputsBlock;
+    int m_outputsBlock;
+
+    // 状态缓存：m_state 为最新读取值，m_published 为最近一次发布的值，两者逐字段比较得到变化位图
+    ZMotionStateBlock m_state;
+    ZMotionStateBlock m_published;
+    float m_prevMpos[ZMotionStateBlock::MaxAxes]; // 上次采样的MPOS，用于计算速度
+    QElapsedTimer m_sampleClock;    // 采样时间基准
+    qint64 m_lastSampleNs;          // 上次采样时间，<0表示尚无采样
+    bool m_forcePublish;            // 连接后首次采样无条件发布全部状态
+
+    // 预先生成的轴数据key，发布时不再拼接字符串
+    QString m_axisKeys[ZMotionStateBlock::MaxAxes][AxisFieldCount];
+
+    // 周期上报配置与状态 (timing.cycleUp)
+    bool m_cycleUpEnabled;          // 配置是否启用推送模式
+    bool m_cycleUpActive;           // 推送模式当前是否生效，失效时回退到定时轮询
+    int m_cycleUpChannel;           // 上报通道号
+    double m_cycleUpInterval;       // 上报周期(ms)
+    int m_cycleUpTimeout;           // 超过该时间未收到新的上报包则回退到轮询(ms)
+    quint32 m_cycleUpRecvTimes;     // 上次解码时的上报包计数
+    QElapsedTimer m_cycleUpWatchdog; // 距上次收到上报包的时间
+
+    // 轨迹流式送入状态 (trajectory)
+    QTimer* m_trajectoryTimer;      // 运动缓冲区补充定时器
+    ZMotionTrajectory m_trajectory; // 当前轨迹
+    int m_trajectoryNext;           // 下一个待送入的段索引
+    bool m_trajectoryActive;        // 轨迹是否在执行
+    int m_trajectoryReserve;        // 运动缓冲区保留的空位数
+    QVector<float> m_lineBatchBuf;  // MultiMoveAbs 坐标缓冲区
+
+    // 命令队列
+    QTimer* m_commandTimer;         // 单次定时器，每次事件循环执行一条命令，状态轮询可以穿插进来
+    QQueue<AxisCommand> m_commandQueue;
+    int m_commandBlock;             // 运行统计中命令执行的块编号
+    quint64 m_nextCommandId;
+    float m_paramCache[ZMotionStateBlock::MaxAxes][ParamCount]; // NaN表示未知
+    qint8 m_invertCache[ZMotionStateBlock::MaxIo];              // -1表示未知
+    QVector<PendingParam> m_paramBatch; // 待下发的参数变化，合并为一次 Execute
+
+    // 示波器采集 (scope)
+    QTimer* m_scopeTimer;           // 采集阶段查询进度，下载阶段每次事件循环读取一块
+    bool m_scopeActive;
+    ZMotionScopeTrace m_scopeTrace; // 当前采集数据
+    int m_scopeDownloaded;          // 已下载的数据个数，<0表示仍在采集
+    qint64 m_scopeExpectedMs;       // 预计采集时长
+    QElapsedTimer m_scopeClock;
+    int m_scopeTableStart;          // 使用的TABLE起始位置
+    int m_scopeMaxChannels;         // 控制器支持的最大示波器通道数
+    int m_scopeChunk;               // 每次 GetTable 读取的数据个数
+    int m_scopePollInterval;        // 采集阶段进度查询间隔(ms)
+    QString m_scopeOutputDir;       // 非空时采集完成后自动保存到该目录
 };
 
 #endif // ZMOTIONDEVICE_H
@@ -0,0 +1,161 @@
+/**
+ * @file ZMotionScopeTrace.cpp
+ * @brief ZMotionScopeTrace类的实现
+ */
+#include "ZMotionScopeTrace.h"
+#include <QDataStream>
+#include <QFile>
+#include <QTextStream>
+
+namespace {
+const quint32 kTraceMagic = 0x5A534350; // "ZSCP"
+const quint16 kTraceVersion = 1;
+}
+
+ZMotionScopeTrace::ZMotionScopeTrace()
+    : m_samples(0)
+    , m_samplePeriodNs(0)
+    , m_timestamp(0)
+{
+}
+
+void ZMotionScopeTrace::reset(const QVector<int>& axes, int samples, qint64 samplePeriodNs)
+{
+    m_axes = axes;
+    m_samples = samples;
+    m_samplePeriodNs = samplePeriodNs;
+    m_timestamp = 0;
+    m_data.fill(0.0f, axes.size() * ChannelsPerAxis * samples);
+}
+
+float ZMotionScopeTrace::value(int axisIndex, Channel channel, int sample) const
+{
+    if (axisIndex < 0 || axisIndex >= m_axes.size() || sample < 0 || sample >= m_samples) {
+        return 0.0f;
+    }
+    return m_data.at((axisIndex * ChannelsPerAxis + channel) * m_samples + sample);
+}
+
+const char* ZMotionScopeTrace::parameterName(Channel channel)
+{
+    switch (channel) {
+    case Dpos: return "DPOS";
+    case Mpos: return "MPOS";
+    case Speed: return "MSPEED";
+    case FollowingError: return "FE";
+    default: return "";
+    }
+}
+
+bool ZMotionScopeTrace::save(const QString& path, QString* error) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    // 文件头: magic, 版本, 轴数, 每轴通道数, 采样点数, 采样周期, 采集时间, 轴号列表; 之后为float32数据
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    out << kTraceMagic << kTraceVersion << static_cast<quint16>(m_axes.size())
+        << static_cast<quint32>(ChannelsPerAxis) << static_cast<quint32>(m_samples)
+        << m_samplePeriodNs << m_timestamp;
+    for (int axisId : m_axes) {
+        out << static_cast<quint16>(axisId);
+    }
+    for (float v : m_data) {
+        out << v;
+    }
+
+    if (out.status() != QDataStream::Ok) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+bool ZMotionScopeTrace::load(const QString& path, QString* error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint16 axisCount = 0;
+    quint32 channelsPerAxis = 0;
+    quint32 samples = 0;
+    qint64 periodNs = 0;
+    qint64 timestamp = 0;
+    in >> magic >> version >> axisCount >> channelsPerAxis >> samples >> periodNs >> timestamp;
+    if (magic != kTraceMagic || version != kTraceVersion || channelsPerAxis != ChannelsPerAxis) {
+        if (error) *error = "Not a scope trace file or unsupported version";
+        return false;
+    }
+    // 数据量与文件大小不符时拒绝，避免按损坏的头部分配过大内存
+    const qint64 expected = static_cast<qint64>(axisCount) * channelsPerAxis * samples;
+    if (expected * static_cast<qint64>(sizeof(float)) > file.size()) {
+        if (error) *error = "Scope trace file is truncated";
+        return false;
+    }
+
+    QVector<int> axes;
+    for (int i = 0; i < axisCount; ++i) {
+        quint16 axisId = 0;
+        in >> axisId;
+        axes.append(axisId);
+    }
+    reset(axes, static_cast<int>(samples), periodNs);
+    m_timestamp = timestamp;
+    for (float& v : m_data) {
+        in >> v;
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        if (error) *error = "Scope trace file is truncated";
+        return false;
+    }
+    return true;
+}
+
+bool ZMotionScopeTrace::exportCsv(const QString& path, QString* error) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "time_ms";
+    for (int axisId : m_axes) {
+        for (int c = 0; c < ChannelsPerAxis; ++c) {
+            out << ",axis" << axisId << '_' << parameterName(static_cast<Channel>(c));
+        }
+    }
+    out << '\n';
+
+    const int channels = channelCount();
+    for (int s = 0; s < m_samples; ++s) {
+        out << QString::number(s * m_samplePeriodNs / 1e6, 'f', 3);
+        for (int c = 0; c < channels; ++c) {
+            out << ',' << m_data.at(c * m_samples + s);
+        }
+        out << '\n';
+    }
+
+    out.flush();
+    if (out.status() != QTextStream::Ok) {
+        if (error) *error = file.errorString();
+        return false;
+    }
+    return true;
+}
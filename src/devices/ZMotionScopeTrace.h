@@ -0,0 +1,81 @@
+#ifndef ZMOTIONSCOPETRACE_H
+#define ZMOTIONSCOPETRACE_H
+
+#include <QMetaType>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief 一次示波器采集得到的轴运动数据
+ *
+ * 每个轴采集 DPOS/MPOS/MSPEED/FE 四个通道，按通道顺序连续存放，
+ * 与控制器TABLE中的布局一致，下载时可以直接整块写入。
+ * 支持保存为紧凑的二进制文件和导出CSV。
+ */
+class ZMotionScopeTrace
+{
+public:
+    enum Channel { Dpos, Mpos, Speed, FollowingError, ChannelsPerAxis };
+
+    ZMotionScopeTrace();
+
+    /**
+     * @brief 按轴列表和采样点数分配数据区，清除原有数据
+     * @param axes 采集的轴
+     * @param samples 每通道采样点数
+     * @param samplePeriodNs 采样周期(ns)
+     */
+    void reset(const QVector<int>& axes, int samples, qint64 samplePeriodNs);
+
+    bool isEmpty() const { return m_data.isEmpty(); }
+    const QVector<int>& axes() const { return m_axes; }
+    int sampleCount() const { return m_samples; }
+    int channelCount() const { return m_axes.size() * ChannelsPerAxis; }
+    qint64 samplePeriodNs() const { return m_samplePeriodNs; }
+    qint64 timestamp() const { return m_timestamp; }
+    void setTimestamp(qint64 msecsSinceEpoch) { m_timestamp = msecsSinceEpoch; }
+
+    /**
+     * @brief 返回指定轴、通道、采样点的值
+     * @param axisIndex 轴在 axes() 中的下标
+     */
+    float value(int axisIndex, Channel channel, int sample) const;
+
+    /**
+     * @brief 全部通道数据，按通道顺序存放，每个通道 sampleCount() 个点
+     */
+    float* data() { return m_data.data(); }
+    const float* data() const { return m_data.constData(); }
+
+    /**
+     * @brief 返回通道的控制器参数名，用于生成SCOPE命令
+     */
+    static const char* parameterName(Channel channel);
+
+    /**
+     * @brief 保存为二进制文件
+     * @param path 文件路径
+     * @param error 失败时返回错误信息，可为空
+     */
+    bool save(const QString& path, QString* error = nullptr) const;
+
+    /**
+     * @brief 从 save() 生成的二进制文件读取
+     */
+    bool load(const QString& path, QString* error = nullptr);
+
+    /**
+     * @brief 导出为CSV，第一列为时间(ms)，之后每个通道一列
+     */
+    bool exportCsv(const QString& path, QString* error = nullptr) const;
+
+private:
+    QVector<int> m_axes;
+    int m_samples;
+    qint64 m_samplePeriodNs;
+    qint64 m_timestamp;
+    QVector<float> m_data;
+};
+Q_DECLARE_METATYPE(ZMotionScopeTrace)
+
+#endif // ZMOTIONSCOPETRACE_H
@@ -0,0 +1,1057 @@
+/**
+ * @file ZMotionSimBackend.cpp
+ * @brief ZMotionSimBackend类的实现
+ */
+#include "ZMotionSimBackend.h"
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QtMath>
+#include <cstring>
+
+namespace {
+const double kStepSeconds = 0.001;   // 仿真积分步长 1ms
+const int kMaxStepsPerAdvance = 10000; // 单次推进的最大步数，长时间无调用时放大步长
+const double kEpsilon = 1e-9;
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+const auto kSkipEmptyParts = Qt::SkipEmptyParts;
+#else
+const auto kSkipEmptyParts = QString::SkipEmptyParts;
+#endif
+}
+
+ZMotionSimBackend::ZMotionSimBackend(const QJsonObject& config)
+    : m_lastNs(0)
+    , m_open(false)
+    , m_requestCount(0)
+{
+    m_reachable = config["reachable"].toBool(true);
+    m_bufferDepth = config["bufferDepth"].toInt(64);
+    m_latencyMs = config["latencyMs"].toDouble(1.0);
+    m_latencyJitterMs = config["latencyJitterMs"].toDouble(0.0);
+    m_connectLatencyMs = config["connectLatencyMs"].toDouble(0.0);
+
+    m_axes.resize(config["axisCount"].toInt(8));
+    m_stepBefore.resize(m_axes.size());
+    m_inputs.resize(config["inputCount"].toInt(32));
+    m_invertIn.resize(m_inputs.size());
+    m_outputs.resize(config["outputCount"].toInt(32));
+    m_table.resize(config["tableSize"].toInt(320000));
+
+    m_clock.start();
+}
+
+ZMotionSimBackend::~ZMotionSimBackend()
+{
+}
+
+QString ZMotionSimBackend::name() const
+{
+    return "sim";
+}
+
+void ZMotionSimBackend::simulateLatency()
+{
+    m_requestCount.fetch_add(1, std::memory_order_relaxed);
+    double delayMs = m_latencyMs;
+    if (m_latencyJitterMs > 0) {
+        delayMs += QRandomGenerator::global()->bounded(m_latencyJitterMs);
+    }
+    if (delayMs > 0) {
+        QThread::usleep(static_cast<unsigned long>(delayMs * 1000.0));
+    }
+}
+
+int ZMotionSimBackend::openEth(const QString& ipAddress, int timeoutMs)
+{
+    Q_UNUSED(ipAddress);
+    // 连接耗时超过超时时间时，与 FastOpen 一样等到超时后返回失败
+    if (timeoutMs > 0 && m_connectLatencyMs > timeoutMs) {
+        QThread::usleep(static_cast<unsigned long>(timeoutMs) * 1000);
+        return ErrTimeout;
+    }
+    if (m_connectLatencyMs > 0) {
+        QThread::usleep(static_cast<unsigned long>(m_connectLatencyMs * 1000.0));
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!m_reachable) {
+        return ErrComm;
+    }
+    m_open = true;
+    m_lastNs = m_clock.nsecsElapsed();
+    return ErrOk;
+}
+
+void ZMotionSimBackend::close()
+{
+    QMutexLocker locker(&m_mutex);
+    m_open = false;
+    m_cycleUps.clear();
+}
+
+bool ZMotionSimBackend::isOpen() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_open;
+}
+
+// ---------------------------------------------------------------------------
+// 仿真时间推进
+// ---------------------------------------------------------------------------
+
+void ZMotionSimBackend::advance()
+{
+    qint64 now = m_clock.nsecsElapsed();
+    double elapsed = (now - m_lastNs) / 1e9;
+    m_lastNs = now;
+    if (elapsed <= 0) {
+        return;
+    }
+
+    int steps = qMin(kMaxStepsPerAdvance, qMax(1, qCeil(elapsed / kStepSeconds)));
+    double dt = elapsed / steps;
+    for (int i = 0; i < steps; ++i) {
+        step(dt);
+    }
+}
+
+void ZMotionSimBackend::step(double dt)
+{
+    double* before = m_stepBefore.data();
+    for (int i = 0; i < m_axes.size(); ++i) {
+        before[i] = m_axes[i].dpos;
+    }
+
+    for (auto it = m_channels.begin(); it != m_channels.end(); ++it) {
+        stepChannel(it.value(), dt);
+    }
+    for (Axis& axis : m_axes) {
+        if (axis.vmoveDir != 0) {
+            stepVmove(axis, dt);
+        }
+    }
+
+    for (int i = 0; i < m_axes.size(); ++i) {
+        m_axes[i].mspeed = qAbs(m_axes[i].dpos - before[i]) / dt;
+    }
+
+    if (m_scope.running) {
+        recordScope();
+    }
+}
+
+void ZMotionSimBackend::recordScope()
+{
+    if (++m_scope.tick % m_scope.interval != 0) {
+        return;
+    }
+    for (int c = 0; c < m_scope.params.size(); ++c) {
+        double value = 0.0;
+        axisParam(m_scope.params[c].constData(), m_scope.axes[c], &value);
+        m_table[m_scope.start + c * m_scope.depth + m_scope.captured] = static_cast<float>(value);
+    }
+    if (++m_scope.captured >= m_scope.depth) {
+        m_scope.running = false;
+    }
+}
+
+void ZMotionSimBackend::stepVmove(Axis& axis, double dt)
+{
+    double target = axis.vmoveStopping ? 0.0 : axis.vmoveDir * static_cast<double>(axis.speed);
+    // 远离0方向加速，靠近0方向减速
+    double rate = (qAbs(target) > qAbs(axis.vel)) ? axis.accel : axis.decel;
+    if (axis.vel < target) {
+        axis.vel = qMin(target, axis.vel + rate * dt);
+    } else {
+        axis.vel = qMax(target, axis.vel - rate * dt);
+    }
+    axis.dpos += axis.vel * dt;
+
+    if (axis.vmoveStopping && qAbs(axis.vel) < kEpsilon) {
+        axis.vel = 0.0;
+        axis.vmoveDir = 0;
+        axis.vmoveStopping = false;
+    }
+}
+
+void ZMotionSimBackend::startNextMove(Channel& ch)
+{
+    while (!ch.queue.isEmpty()) {
+        ch.current = ch.queue.dequeue();
+        if (ch.current.type == Move::Op) {
+            // 缓冲输出在轮到它时立即执行，不占用运动时间
+            if (ch.current.ioNum >= 0 && ch.current.ioNum < m_outputs.size()) {
+                m_outputs[ch.current.ioNum] = (ch.current.ioValue != 0);
+            }
+            continue;
+        }
+
+        ch.active = true;
+        ch.s = 0.0;
+        ch.start.resize(ch.current.axes.size());
+        for (int i = 0; i < ch.current.axes.size(); ++i) {
+            ch.start[i] = m_axes[ch.current.axes[i]].dpos;
+        }
+
+        if (ch.current.type == Move::Arc) {
+            double dx = ch.start[0] - ch.current.center[0];
+            double dy = ch.start[1] - ch.current.center[1];
+            double ex = ch.current.end[0] - ch.current.center[0];
+            double ey = ch.current.end[1] - ch.current.center[1];
+            ch.radius = qSqrt(dx * dx + dy * dy);
+            ch.startAngle = qAtan2(dy, dx);
+            double sweep = qAtan2(ey, ex) - ch.startAngle;
+            if (ch.current.direction == 0) {        // 逆时针，角度递增
+                while (sweep < 0) sweep += 2 * M_PI;
+            } else {                                // 顺时针，角度递减
+                while (sweep > 0) sweep -= 2 * M_PI;
+            }
+            ch.sweep = sweep;
+            ch.length = ch.radius * qAbs(sweep);
+        } else {
+            double sum = 0.0;
+            for (int i = 0; i < ch.current.axes.size(); ++i) {
+                double d = ch.current.end[i] - ch.start[i];
+                sum += d * d;
+            }
+            ch.length = qSqrt(sum);
+        }
+        return;
+    }
+    ch.active = false;
+}
+
+void ZMotionSimBackend::finishMove(Channel& ch)
+{
+    for (int i = 0; i < ch.current.axes.size(); ++i) {
+        Axis& axis = m_axes[ch.current.axes[i]];
+        axis.dpos = ch.current.resetDpos ? 0.0 : ch.current.end[i];
+    }
+    ch.active = false;
+    ch.s = 0.0;
+    startNextMove(ch);
+    if (!ch.active) {
+        ch.v = 0.0;
+        ch.a = 0.0;
+    }
+}
+
+void ZMotionSimBackend::stepChannel(Channel& ch, double dt)
+{
+    if (!ch.active) {
+        if (ch.queue.isEmpty()) {
+            return;
+        }
+        startNextMove(ch);
+        if (!ch.active) {
+            return;
+        }
+    }
+
+    if (ch.length < kEpsilon) {
+        finishMove(ch);
+        return;
+    }
+
+    const Axis& base = m_axes[ch.current.axes.first()];
+    const double vmax = (ch.current.speed > 0) ? ch.current.speed : base.speed;
+    const double accel = qMax(1e-6, static_cast<double>(base.accel));
+    const double decel = qMax(1e-6, static_cast<double>(base.decel));
+    const double remaining = ch.length - ch.s;
+
+    // 连续插补且后面还有运动时，段末不减速
+    double targetV = vmax;
+    if (ch.stopping) {
+        targetV = 0.0;
+    } else if (!(base.merge && !ch.queue.isEmpty())) {
+        double stopDistance = ch.v * ch.v / (2.0 * decel);
+        if (remaining <= stopDistance) {
+            targetV = 0.0;
+        }
+    }
+
+    double desiredA = 0.0;
+    if (targetV > ch.v) {
+        desiredA = accel;
+    } else if (targetV < ch.v) {
+        desiredA = -decel;
+    }
+
+    // S曲线：加速度以有限的加加速度(accel/sramp)变化
+    if (base.sramp > 0) {
+        double jerk = accel / (base.sramp / 1000.0);
+        if (ch.a < desiredA) {
+            ch.a = qMin(desiredA, ch.a + jerk * dt);
+        } else {
+            ch.a = qMax(desiredA, ch.a - jerk * dt);
+        }
+    } else {
+        ch.a = desiredA;
+    }
+
+    ch.v += ch.a * dt;
+    if ((desiredA > 0 && ch.v > targetV) || (desiredA < 0 && ch.v < targetV)) {
+        ch.v = targetV;
+        ch.a = 0.0;
+    }
+
+    if (ch.v <= 0.0) {
+        ch.v = 0.0;
+        if (ch.stopping) {
+            // 减速停止完成，剩余部分被取消
+            ch.stopping = false;
+            ch.active = false;
+            ch.a = 0.0;
+            return;
+        }
+        if (desiredA <= 0.0) {
+            // 离散积分误差导致在终点前停住时，直接走完剩余距离
+            ch.v = qMin(vmax, remaining / dt);
+        }
+    }
+
+    ch.s += ch.v * dt;
+    if (ch.s >= ch.length) {
+        finishMove(ch);
+        return;
+    }
+
+    if (ch.current.type == Move::Arc) {
+        double angle = ch.startAngle + (ch.sweep >= 0 ? 1.0 : -1.0) * ch.s / ch.radius;
+        m_axes[ch.current.axes[0]].dpos = ch.current.center[0] + ch.radius * qCos(angle);
+        m_axes[ch.current.axes[1]].dpos = ch.current.center[1] + ch.radius * qSin(angle);
+    } else {
+        double ratio = ch.s / ch.length;
+        for (int i = 0; i < ch.current.axes.size(); ++i) {
+            m_axes[ch.current.axes[i]].dpos = ch.start[i] + (ch.current.end[i] - ch.start[i]) * ratio;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 辅助函数
+// ---------------------------------------------------------------------------
+
+bool ZMotionSimBackend::validAxis(int axis) const
+{
+    return axis >= 0 && axis < m_axes.size();
+}
+
+bool ZMotionSimBackend::axisBusy(int axis) const
+{
+    if (m_axes[axis].vmoveDir != 0) {
+        return true;
+    }
+    for (const Channel& ch : m_channels) {
+        if (ch.active && ch.current.axes.contains(axis)) {
+            return true;
+        }
+        for (const Move& move : ch.queue) {
+            if (move.axes.contains(axis)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool ZMotionSimBackend::inputState(int ioNum) const
+{
+    return m_inputs[ioNum] != m_invertIn[ioNum];
+}
+
+double ZMotionSimBackend::lastQueuedPosition(int axis) const
+{
+    // 相对运动以缓冲区中最后一条运动的终点为起点
+    auto it = m_channels.constFind(axis);
+    if (it != m_channels.constEnd()) {
+        for (int i = it.value().queue.size() - 1; i >= 0; --i) {
+            const Move& move = it.value().queue.at(i);
+            if (move.type != Move::Op) {
+                return move.end.first();
+            }
+        }
+        if (it.value().active) {
+            return it.value().current.end.first();
+        }
+    }
+    return m_axes[axis].dpos;
+}
+
+int ZMotionSimBackend::queueMove(int baseAxis, const Move& move)
+{
+    Channel& ch = m_channels[baseAxis];
+    if (ch.queue.size() >= m_bufferDepth) {
+        return ErrBusy;
+    }
+    ch.queue.enqueue(move);
+    return ErrOk;
+}
+
+bool ZMotionSimBackend::axisParam(const char* name, int axis, double* value) const
+{
+    const Axis& a = m_axes[axis];
+    if (qstrcmp(name, "DPOS") == 0 || qstrcmp(name, "MPOS") == 0) {
+        *value = a.dpos;
+    } else if (qstrcmp(name, "IDLE") == 0) {
+        *value = axisBusy(axis) ? 0 : -1;
+    } else if (qstrcmp(name, "MSPEED") == 0 || qstrcmp(name, "VP_SPEED") == 0) {
+        *value = a.mspeed;
+    } else if (qstrcmp(name, "SPEED") == 0) {
+        *value = a.speed;
+    } else if (qstrcmp(name, "ACCEL") == 0) {
+        *value = a.accel;
+    } else if (qstrcmp(name, "DECEL") == 0) {
+        *value = a.decel;
+    } else if (qstrcmp(name, "SRAMP") == 0) {
+        *value = a.sramp;
+    } else if (qstrcmp(name, "UNITS") == 0) {
+        *value = a.units;
+    } else if (qstrcmp(name, "AXISSTATUS") == 0 || qstrcmp(name, "FE") == 0) {
+        *value = 0;         // 仿真中反馈完全跟随指令，没有跟随误差
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// BASIC命令：仅支持参数赋值子集，NAME(index)=value 和 INVERT_IN/OP(io,value)
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::execute(const QString& command, QString* response)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    advance();
+
+    if (response) {
+        response->clear();
+    }
+    const QStringList statements = command.split(QRegularExpression("[:\\n]"), kSkipEmptyParts);
+    for (const QString& statement : statements) {
+        int result = executeStatement(statement.trimmed().toUpper(), response);
+        if (result != ErrOk) {
+            return result;
+        }
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::executeStatement(const QString& statement, QString* response)
+{
+    static const QRegularExpression assignPattern("^([A-Z_]+)\\((\\d+)\\)\\s*=\\s*(-?[0-9.eE+-]+)$");
+    static const QRegularExpression callPattern("^(INVERT_IN|OP)\\((\\d+)\\s*,\\s*(-?\\d+)\\)$");
+    if (statement.isEmpty()) {
+        return ErrOk;
+    }
+
+    // 查询: ?SCOPE_POS 返回已写入的TABLE位置, ?SERVO_PERIOD 返回伺服周期(us)
+    if (statement.startsWith('?')) {
+        QString result;
+        if (statement == "?SCOPE_POS") {
+            result = QString::number(m_scope.start + m_scope.captured);
+        } else if (statement == "?SERVO_PERIOD") {
+            result = QString::number(qRound(kStepSeconds * 1e6));
+        } else {
+            return ErrParam;
+        }
+        if (response) {
+            *response += result + '\n';
+        }
+        return ErrOk;
+    }
+    if (statement == "TRIGGER") {
+        if (!m_scope.armed) return ErrParam;
+        m_scope.running = true;
+        m_scope.captured = 0;
+        m_scope.tick = 0;
+        return ErrOk;
+    }
+    if (statement.startsWith("SCOPE(") && statement.endsWith(')')) {
+        return configureScope(statement.mid(6, statement.size() - 7));
+    }
+
+    QRegularExpressionMatch match = callPattern.match(statement);
+    if (match.hasMatch()) {
+        int ioNum = match.captured(2).toInt();
+        bool on = match.captured(3).toInt() != 0;
+        QVector<bool>& target = (match.captured(1) == "OP") ? m_outputs : m_invertIn;
+        if (ioNum >= target.size()) return ErrParam;
+        target[ioNum] = on;
+        return ErrOk;
+    }
+
+    match = assignPattern.match(statement);
+    if (!match.hasMatch()) {
+        return ErrParam;
+    }
+    const QString name = match.captured(1);
+    const int axis = match.captured(2).toInt();
+    const float value = match.captured(3).toFloat();
+    if (!validAxis(axis)) return ErrAxis;
+
+    Axis& a = m_axes[axis];
+    if (name == "UNITS") a.units = value;
+    else if (name == "SPEED") a.speed = value;
+    else if (name == "ACCEL") a.accel = value;
+    else if (name == "DECEL") a.decel = value;
+    else if (name == "SRAMP") a.sramp = value;
+    else if (name == "CREEP") a.creep = value;
+    else if (name == "DATUM_IN") a.datumIn = static_cast<int>(value);
+    else if (name == "MERGE") a.merge = (value != 0);
+    else if (name == "DPOS") a.dpos = value;
+    else return ErrParam;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::configureScope(const QString& arguments)
+{
+    // SCOPE(ON, 间隔, TABLE起始, TABLE结束, 参数1(轴), 参数2(轴), ...) 或 SCOPE(OFF)
+    static const QRegularExpression channelPattern("^([A-Z_]+)\\((\\d+)\\)$");
+    const QStringList args = arguments.split(',');
+    if (args.first().trimmed() == "OFF") {
+        m_scope = Scope();
+        return ErrOk;
+    }
+    if (args.size() < 5 || args.first().trimmed() != "ON") {
+        return ErrParam;
+    }
+
+    Scope scope;
+    scope.interval = qMax(1, args[1].trimmed().toInt());
+    scope.start = args[2].trimmed().toInt();
+    int end = args[3].trimmed().toInt();
+    for (int i = 4; i < args.size(); ++i) {
+        QRegularExpressionMatch match = channelPattern.match(args[i].trimmed());
+        if (!match.hasMatch() || !validAxis(match.captured(2).toInt())) {
+            return ErrParam;
+        }
+        scope.params.append(match.captured(1).toLatin1());
+        scope.axes.append(match.captured(2).toInt());
+    }
+    if (scope.start < 0 || end >= m_table.size() || end < scope.start) {
+        return ErrParam;
+    }
+    scope.depth = (end - scope.start + 1) / scope.params.size();
+    if (scope.depth <= 0) {
+        return ErrParam;
+    }
+    scope.armed = true;
+    m_scope = scope;
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// 轴参数
+// ---------------------------------------------------------------------------
+
+#define SIM_BEGIN_AXIS_CALL(axis) \
+    simulateLatency(); \
+    QMutexLocker locker(&m_mutex); \
+    if (!m_open) return ErrComm; \
+    if (!validAxis(axis)) return ErrAxis; \
+    advance();
+
+int ZMotionSimBackend::setUnits(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].units = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setSpeed(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].speed = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setAccel(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].accel = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setDecel(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].decel = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setSramp(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].sramp = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setCreep(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].creep = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setDatumIn(int axis, int ioNum)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].datumIn = ioNum;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setInvertIn(int ioNum, int invert)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (ioNum < 0 || ioNum >= m_invertIn.size()) return ErrParam;
+    m_invertIn[ioNum] = (invert != 0);
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setDpos(int axis, float value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].dpos = value;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setMerge(int axis, int value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    m_axes[axis].merge = (value != 0);
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// 轴状态
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::getDpos(int axis, float* value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    *value = static_cast<float>(m_axes[axis].dpos);
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getIfIdle(int axis, int* value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    *value = axisBusy(axis) ? 0 : -1;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getAllAxisInfo(int maxAxis, int* idle, float* dpos, float* mpos, int* axisStatus)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (maxAxis < 0 || maxAxis > m_axes.size()) return ErrParam;
+    advance();
+    for (int i = 0; i < maxAxis; ++i) {
+        idle[i] = axisBusy(i) ? 0 : -1;
+        dpos[i] = static_cast<float>(m_axes[i].dpos);
+        mpos[i] = static_cast<float>(m_axes[i].dpos);
+        axisStatus[i] = 0;
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getAllAxisPara(const char* param, int maxAxis, float* values)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (maxAxis < 0 || maxAxis > m_axes.size()) return ErrParam;
+    advance();
+    for (int i = 0; i < maxAxis; ++i) {
+        double value = 0.0;
+        if (!axisParam(param, i, &value)) {
+            return ErrParam;
+        }
+        values[i] = static_cast<float>(value);
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getModbusDpos(int maxAxis, float* values)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (maxAxis < 0 || maxAxis > m_axes.size()) return ErrParam;
+    advance();
+    for (int i = 0; i < maxAxis; ++i) {
+        values[i] = static_cast<float>(m_axes[i].dpos);
+    }
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// IO
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::getIn(int ioNum, quint32* value)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (ioNum < 0 || ioNum >= m_inputs.size()) return ErrParam;
+    *value = inputState(ioNum) ? 1 : 0;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getInMulti(int startIo, int endIo, qint32* words)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (startIo < 0 || endIo < startIo || endIo >= m_inputs.size()) return ErrParam;
+    const int count = endIo - startIo + 1;
+    std::memset(words, 0, sizeof(qint32) * ((count + 31) / 32));
+    for (int i = 0; i < count; ++i) {
+        if (inputState(startIo + i)) {
+            words[i / 32] |= static_cast<qint32>(1u << (i % 32));
+        }
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getModbusIn(int startIo, int endIo, quint8* values)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (startIo < 0 || endIo < startIo || endIo >= m_inputs.size()) return ErrParam;
+    // 与ZAux_GetModbusIn一致：按位打包，每个字节8个输入口，低位在前
+    const int count = endIo - startIo + 1;
+    std::memset(values, 0, (count + 7) / 8);
+    for (int i = 0; i < count; ++i) {
+        if (inputState(startIo + i)) {
+            values[i >> 3] |= static_cast<quint8>(1u << (i & 7));
+        }
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getOutMulti(int startIo, int endIo, qint32* words)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (startIo < 0 || endIo < startIo || endIo >= m_outputs.size()) return ErrParam;
+    // 缓冲输出(MoveOp)在运动执行到时才生效，先推进仿真时间
+    advance();
+    const int count = endIo - startIo + 1;
+    std::memset(words, 0, sizeof(qint32) * ((count + 31) / 32));
+    for (int i = 0; i < count; ++i) {
+        if (m_outputs[startIo + i]) {
+            words[i / 32] |= static_cast<qint32>(1u << (i % 32));
+        }
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::setOp(int ioNum, quint32 value)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (ioNum < 0 || ioNum >= m_outputs.size()) return ErrParam;
+    m_outputs[ioNum] = (value != 0);
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// 单轴运动
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::singleVmove(int axis, int direction)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    Axis& a = m_axes[axis];
+    a.vmoveDir = (direction > 0) ? 1 : -1;
+    a.vmoveStopping = false;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::singleMove(int axis, float distance)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    Move move;
+    move.axes.append(axis);
+    move.end.append(lastQueuedPosition(axis) + distance);
+    return queueMove(axis, move);
+}
+
+int ZMotionSimBackend::singleDatum(int axis, int mode)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    Q_UNUSED(mode);
+    // 简化的回零：以爬行速度回到0点后清零位置
+    Move move;
+    move.axes.append(axis);
+    move.end.append(0.0);
+    move.speed = m_axes[axis].creep;
+    move.resetDpos = true;
+    return queueMove(axis, move);
+}
+
+int ZMotionSimBackend::singleCancel(int axis, int mode)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+
+    // 0-取消当前运动 1-取消缓冲运动 2-取消当前和缓冲运动 3-立即中断
+    for (auto it = m_channels.begin(); it != m_channels.end(); ++it) {
+        Channel& ch = it.value();
+        bool involved = (ch.active && ch.current.axes.contains(axis));
+        for (const Move& move : ch.queue) {
+            involved = involved || move.axes.contains(axis);
+        }
+        if (!involved) {
+            continue;
+        }
+        if (mode != 0) {
+            ch.queue.clear();
+        }
+        if (mode == 3) {
+            ch.active = false;
+            ch.v = 0.0;
+            ch.a = 0.0;
+        } else if (mode != 1 && ch.active) {
+            ch.stopping = true;
+        }
+    }
+
+    Axis& a = m_axes[axis];
+    if (a.vmoveDir != 0) {
+        if (mode == 3) {
+            a.vel = 0.0;
+            a.vmoveDir = 0;
+            a.vmoveStopping = false;
+        } else if (mode != 1) {
+            a.vmoveStopping = true;
+        }
+    }
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// 插补运动与运动缓冲
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::multiMoveAbs(int moveCount, int axisCount, int* axisList, float* positions)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (moveCount <= 0 || axisCount <= 0) return ErrParam;
+    for (int i = 0; i < axisCount; ++i) {
+        if (!validAxis(axisList[i])) return ErrAxis;
+    }
+    advance();
+
+    const int base = axisList[0];
+    if (m_channels[base].queue.size() + moveCount > m_bufferDepth) {
+        return ErrBusy;
+    }
+    for (int m = 0; m < moveCount; ++m) {
+        Move move;
+        for (int i = 0; i < axisCount; ++i) {
+            move.axes.append(axisList[i]);
+            move.end.append(positions[m * axisCount + i]);
+        }
+        queueMove(base, move);
+    }
+    return ErrOk;
+}
+
+int ZMotionSimBackend::moveCircAbs(int axisCount, int* axisList, float end1, float end2,
+                                   float center1, float center2, int direction)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (axisCount < 2) return ErrParam;
+    if (!validAxis(axisList[0]) || !validAxis(axisList[1])) return ErrAxis;
+    advance();
+
+    Move move;
+    move.type = Move::Arc;
+    move.axes << axisList[0] << axisList[1];
+    move.end << end1 << end2;
+    move.center[0] = center1;
+    move.center[1] = center2;
+    move.direction = direction;
+    return queueMove(axisList[0], move);
+}
+
+int ZMotionSimBackend::moveSmooth(int axisCount, int* axisList, float end1, float end2, float end3,
+                                  float next1, float next2, float next3, float radius)
+{
+    Q_UNUSED(next1);
+    Q_UNUSED(next2);
+    Q_UNUSED(next3);
+    Q_UNUSED(radius);
+
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (axisCount <= 0 || axisCount > 3) return ErrParam;
+    for (int i = 0; i < axisCount; ++i) {
+        if (!validAxis(axisList[i])) return ErrAxis;
+    }
+    advance();
+
+    // 仿真中不插入拐角圆弧，按直线走到终点；连续插补保证拐角处不停顿
+    const float ends[3] = {end1, end2, end3};
+    Move move;
+    for (int i = 0; i < axisCount; ++i) {
+        move.axes.append(axisList[i]);
+        move.end.append(ends[i]);
+    }
+    return queueMove(axisList[0], move);
+}
+
+int ZMotionSimBackend::moveOp(int axis, int ioNum, int value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    if (ioNum < 0 || ioNum >= m_outputs.size()) return ErrParam;
+    Move move;
+    move.type = Move::Op;
+    move.ioNum = ioNum;
+    move.ioValue = value;
+    return queueMove(axis, move);
+}
+
+int ZMotionSimBackend::getRemainBuffer(int axis, int* value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    auto it = m_channels.constFind(axis);
+    int used = (it != m_channels.constEnd()) ? it.value().queue.size() : 0;
+    *value = m_bufferDepth - used;
+    return ErrOk;
+}
+
+int ZMotionSimBackend::getMovesBuffered(int axis, int* value)
+{
+    SIM_BEGIN_AXIS_CALL(axis)
+    auto it = m_channels.constFind(axis);
+    *value = (it != m_channels.constEnd()) ? it.value().queue.size() : 0;
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// TABLE与示波器
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::getTable(int start, int count, float* values)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (start < 0 || count <= 0 || start + count > m_table.size()) return ErrParam;
+    advance();
+    std::memcpy(values, m_table.constData() + start, sizeof(float) * count);
+    return ErrOk;
+}
+
+int ZMotionSimBackend::trigger()
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    advance();
+    return executeStatement("TRIGGER", nullptr);
+}
+
+// ---------------------------------------------------------------------------
+// 周期上报：数据由控制器推送到本地缓冲，读取不产生通信延时
+// ---------------------------------------------------------------------------
+
+int ZMotionSimBackend::cycleUpEnable(quint32 channel, float intervalMs, const char* sets)
+{
+    Q_UNUSED(sets);
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    if (intervalMs <= 0) return ErrParam;
+    CycleUp cycleUp;
+    cycleUp.intervalMs = intervalMs;
+    cycleUp.startNs = m_clock.nsecsElapsed();
+    m_cycleUps.insert(channel, cycleUp);
+    return ErrOk;
+}
+
+int ZMotionSimBackend::cycleUpDisable(quint32 channel)
+{
+    simulateLatency();
+    QMutexLocker locker(&m_mutex);
+    if (!m_open) return ErrComm;
+    m_cycleUps.remove(channel);
+    return ErrOk;
+}
+
+quint32 ZMotionSimBackend::cycleUpGetRecvTimes(quint32 channel)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_cycleUps.constFind(channel);
+    if (!m_open || it == m_cycleUps.constEnd()) {
+        return 0;
+    }
+    double elapsedMs = (m_clock.nsecsElapsed() - it.value().startNs) / 1e6;
+    return static_cast<quint32>(elapsedMs / it.value().intervalMs);
+}
+
+int ZMotionSimBackend::cycleUpReadBuff(quint32 channel, const char* name, quint32 index, double* value)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_open || !m_cycleUps.contains(channel)) return ErrComm;
+    advance();
+
+    const int i = static_cast<int>(index);
+    if (qstrcmp(name, "IN") == 0) {
+        if (i >= m_inputs.size()) return ErrParam;
+        *value = inputState(i) ? 1 : 0;
+        return ErrOk;
+    }
+    if (qstrcmp(name, "OP") == 0) {
+        if (i >= m_outputs.size()) return ErrParam;
+        *value = m_outputs[i] ? 1 : 0;
+        return ErrOk;
+    }
+    if (!validAxis(i) || !axisParam(name, i, value)) {
+        return ErrParam;
+    }
+    return ErrOk;
+}
+
+// ---------------------------------------------------------------------------
+// 仿真专用接口
+// ---------------------------------------------------------------------------
+
+void ZMotionSimBackend::setInput(int ioNum, bool state)
+{
+    QMutexLocker locker(&m_mutex);
+    if (ioNum >= 0 && ioNum < m_inputs.size()) {
+        m_inputs[ioNum] = state;
+    }
+}
+
+bool ZMotionSimBackend::output(int ioNum) const
+{
+    QMutexLocker locker(&m_mutex);
+    return ioNum >= 0 && ioNum < m_outputs.size() && m_outputs[ioNum];
+}
+
+quint64 ZMotionSimBackend::requestCount() const
+{
+    return m_requestCount.load(std::memory_order_relaxed);
+}
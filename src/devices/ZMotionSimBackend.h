@@ -0,0 +1,213 @@
+#ifndef ZMOTIONSIMBACKEND_H
+#define ZMOTIONSIMBACKEND_H
+
+#include "ZMotionBackend.h"
+#include <QElapsedTimer>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QVector>
+#include <atomic>
+
+/**
+ * @brief 进程内仿真ZMotion控制器
+ *
+ * 在不连接真实硬件的情况下模拟控制器行为，用于Linux下的开发、调试和性能测试：
+ * - 轴运动学：速度、加减速度、S曲线(sramp)，单轴运动和多轴插补
+ * - 每个主轴一个运动缓冲区，缓冲深度可配置，支持连续插补(MERGE)和缓冲输出(MoveOp)
+ * - 输入/输出口，周期上报
+ * - TABLE存储和示波器(SCOPE/TRIGGER)，每个伺服周期(1ms)采样一次
+ * - 每次调用可配置的通信延时，用于评估批量读取等优化的效果
+ *
+ * 仿真时间在每次调用时按真实流逝时间推进，无需额外线程。
+ */
+class ZMotionSimBackend : public ZMotionBackend
+{
+public:
+    /**
+     * @brief 构造仿真控制器
+     * @param config 仿真参数，见 zmotion_device.json 中的 backend.sim
+     */
+    explicit ZMotionSimBackend(const QJsonObject& config = QJsonObject());
+    ~ZMotionSimBackend() override;
+
+    QString name() const override;
+
+    int openEth(const QString& ipAddress, int timeoutMs) override;
+    void close() override;
+    bool isOpen() const override;
+    int execute(const QString& command, QString* response = nullptr) override;
+
+    int setUnits(int axis, float value) override;
+    int setSpeed(int axis, float value) override;
+    int setAccel(int axis, float value) override;
+    int setDecel(int axis, float value) override;
+    int setSramp(int axis, float value) override;
+    int setCreep(int axis, float value) override;
+    int setDatumIn(int axis, int ioNum) override;
+    int setInvertIn(int ioNum, int invert) override;
+    int setDpos(int axis, float value) override;
+    int setMerge(int axis, int value) override;
+
+    int getDpos(int axis, float* value) override;
+    int getIfIdle(int axis, int* value) override;
+    int getAllAxisInfo(int maxAxis, int* idle, float* dpos, float* mpos, int* axisStatus) override;
+    int getAllAxisPara(const char* param, int maxAxis, float* values) override;
+    int getModbusDpos(int maxAxis, float* values) override;
+
+    int getIn(int ioNum, quint32* value) override;
+    int getInMulti(int startIo, int endIo, qint32* words) override;
+    int getModbusIn(int startIo, int endIo, quint8* values) override;
+    int getOutMulti(int startIo, int endIo, qint32* words) override;
+    int setOp(int ioNum, quint32 value) override;
+
+    int singleVmove(int axis, int direction) override;
+    int singleMove(int axis, float distance) override;
+    int singleDatum(int axis, int mode) override;
+    int singleCancel(int axis, int mode) override;
+
+    int multiMoveAbs(int moveCount, int axisCount, int* axisList, float* positions) override;
+    int moveCircAbs(int axisCount, int* axisList, float end1, float end2,
+                    float center1, float center2, int direction) override;
+    int moveSmooth(int axisCount, int* axisList, float end1, float end2, float end3,
+                   float next1, float next2, float next3, float radius) override;
+    int moveOp(int axis, int ioNum, int value) override;
+    int getRemainBuffer(int axis, int* value) override;
+    int getMovesBuffered(int axis, int* value) override;
+    int getTable(int start, int count, float* values) override;
+    int trigger() override;
+
+    int cycleUpEnable(quint32 channel, float intervalMs, const char* sets) override;
+    int cycleUpDisable(quint32 channel) override;
+    quint32 cycleUpGetRecvTimes(quint32 channel) override;
+    int cycleUpReadBuff(quint32 channel, const char* name, quint32 index, double* value) override;
+
+    /**
+     * @brief 仿真专用：设置输入口的物理状态(未反转)
+     */
+    void setInput(int ioNum, bool state);
+
+    /**
+     * @brief 仿真专用：读取输出口状态
+     */
+    bool output(int ioNum) const;
+
+    /**
+     * @brief 仿真专用：返回自创建以来模拟的通信请求次数
+     */
+    quint64 requestCount() const;
+
+private:
+    // 与 ZMotionDevice::getZMotionErrorString 对应的错误码
+    enum Error {
+        ErrOk = 0,
+        ErrComm = -1,
+        ErrParam = -2,
+        ErrBusy = -4,
+        ErrTimeout = -5,
+        ErrAxis = -6
+    };
+
+    struct Axis {
+        float units = 1.0f;
+        float speed = 10.0f;
+        float accel = 100.0f;
+        float decel = 100.0f;
+        float sramp = 0.0f;     // S曲线时间(ms)
+        float creep = 1.0f;
+        int datumIn = -1;
+        bool merge = false;
+        double dpos = 0.0;
+        double mspeed = 0.0;    // 实测速度(由位置差分得到)
+        double vel = 0.0;       // 持续运动(Vmove)的带符号速度
+        int vmoveDir = 0;       // 持续运动方向，0表示没有持续运动
+        bool vmoveStopping = false;
+    };
+
+    struct Move {
+        enum Type { Line, Arc, Op };
+        Type type = Line;
+        QVector<int> axes;
+        QVector<double> end;
+        double center[2] = {0.0, 0.0};
+        int direction = 0;      // 圆弧方向 0-逆时针 1-顺时针
+        double speed = 0.0;     // >0 时覆盖主轴速度(回零爬行)
+        bool resetDpos = false; // 完成后将位置清零(回零)
+        int ioNum = -1;         // Op: 输出口
+        int ioValue = 0;        // Op: 输出值
+    };
+
+    // 一个主轴(BASE)对应的运动缓冲区和当前插补状态
+    struct Channel {
+        QQueue<Move> queue;
+        bool active = false;
+        Move current;
+        QVector<double> start;
+        double length = 0.0;
+        double startAngle = 0.0;
+        double sweep = 0.0;
+        double radius = 0.0;
+        double s = 0.0;         // 当前段已走过的路径长度
+        double v = 0.0;         // 路径速度
+        double a = 0.0;         // 路径加速度
+        bool stopping = false;
+    };
+
+    void simulateLatency();
+    void advance();
+    void step(double dt);
+    void stepChannel(Channel& ch, double dt);
+    void startNextMove(Channel& ch);
+    void finishMove(Channel& ch);
+    void stepVmove(Axis& axis, double dt);
+    bool validAxis(int axis) const;
+    bool axisBusy(int axis) const;
+    bool inputState(int ioNum) const;
+    double lastQueuedPosition(int axis) const;
+    int queueMove(int baseAxis, const Move& move);
+    bool axisParam(const char* name, int axis, double* value) const;
+    int executeStatement(const QString& statement, QString* response);
+    int configureScope(const QString& arguments);
+    void recordScope();
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_clock;
+    qint64 m_lastNs;
+    bool m_open;
+    bool m_reachable;
+    int m_bufferDepth;
+    double m_latencyMs;
+    double m_latencyJitterMs;
+    double m_connectLatencyMs;
+    std::atomic<quint64> m_requestCount;   ///< 在加锁前的延时中累加，读取不加锁
+
+    QVector<Axis> m_axes;
+    QVector<double> m_stepBefore;   ///< step() 中各轴推进前的指令位置，与 m_axes 等长，避免每个伺服周期分配
+    QMap<int, Channel> m_channels;  ///< 主轴号 -> 运动缓冲区
+    QVector<bool> m_inputs;
+    QVector<bool> m_invertIn;
+    QVector<bool> m_outputs;
+
+    struct CycleUp {
+        double intervalMs = 0.0;
+        qint64 startNs = 0;
+    };
+    QMap<quint32, CycleUp> m_cycleUps;
+
+    // 示波器：各通道数据在TABLE中按通道依次存放
+    struct Scope {
+        bool armed = false;
+        bool running = false;
+        int interval = 1;       // 采样间隔(伺服周期数)
+        int start = 0;          // TABLE起始位置
+        int depth = 0;          // 每通道采样点数
+        int captured = 0;       // 已采样点数
+        qint64 tick = 0;
+        QVector<QByteArray> params; // 通道参数名
+        QVector<int> axes;          // 通道对应的轴号
+    };
+    Scope m_scope;
+    QVector<float> m_table;
+};
+
+#endif // ZMOTIONSIMBACKEND_H
@@ -5,8 +5,14 @@
 #include "core/ThreadManager.h"
 #include "core/DataManager.h"
 #include "core/Device.h"
+#include "core/IoBank.h"
+#include "core/DriverRegistry.h"
+#include "core/AlarmEngine.h"
+#include "core/InterlockEngine.h"
 #include "devices/ZMotionDevice.h"
+#include "DataTableModel.h"
 #include <QFile>
+#include <QSaveFile>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDebug>
@@ -18,9 +24,17 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
 #include <QTime>
 #include <QTextCursor>
+#include <QTimer>
+#include <QMenu>
+#include <QStatusBar>
+#include <QFutureWatcher>
+#include <QFileSystemWatcher>
+#include <QFileInfo>
+#include <QtConcurrent/QtConcurrentMap>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -28,7 +42,13 @@ MainWindow::MainWindow(QWidget *parent)
     , m_deviceManager(new DeviceManager(this))
     , m_threadManager(new ThreadManager(m_deviceManager, this))
     , m_dataManager(new DataManager(this))
-    , m_isInternalChange(false)
+    , m_dataModel(new DataTableModel(m_dataManager, this))
+    , m_alarmEngine(new AlarmEngine(m_dataManager, this))
+    , m_interlocks(new InterlockEngine(this))
+    , m_logFlushTimer(new QTimer(this))
+    , m_metricsTimer(new QTimer(this))
+    , m_configWatcher(new QFileSystemWatcher(this))
+    , m_reloadTimer(new QTimer(this))
 {
     ui->setupUi(this);
 //    showMaximized();
@@ -40,20 +60,35 @@ MainWindow::MainWindow(QWidget *parent)
     initDeivceTableUI();
     initModbusTableUI();
     initZMotionUI();
+    initLogView();
 
     // 连接信号和槽
-    connect(ui->dataTableWidget, &QTableWidget::cellChanged, this, &MainWindow::onTableCellChanged);
+    connect(m_dataModel, &DataTableModel::writeRequested, this, &MainWindow::onDataWriteRequested);
     connect(ui->deviceTableWidget, &QTableWidget::itemSelectionChanged, this, &MainWindow::onDeviceSelectionChanged);
     connect(m_dataManager, &DataManager::dataUpdated, this, &MainWindow::onDeviceDataUpdated);
+    connect(m_dataManager, &DataManager::dataUpdated, m_dataModel, &DataTableModel::onDataUpdated);
+    connect(m_dataManager, &DataManager::deviceStaleChanged, m_dataModel, &DataTableModel::onDeviceStaleChanged);
+    connect(m_dataManager, &DataManager::dataUpdated, m_alarmEngine, &AlarmEngine::onDataUpdated);
+    connect(m_alarmEngine, &AlarmEngine::alarmEvent, this, &MainWindow::onAlarmEvent);
+    connect(m_alarmEngine, &AlarmEngine::activeAlarmsChanged, this, &MainWindow::onActiveAlarmsChanged);
+    connect(m_interlocks, &InterlockEngine::interlockFired, this, &MainWindow::onInterlockFired, Qt::QueuedConnection);
+
+    // 配置热加载：文件修改后稍等片刻，编辑器分几次写入的文件只加载一次
+    qRegisterMetaType<QSharedPointer<const ConfigImage>>("QSharedPointer<const ConfigImage>");
+    m_reloadTimer->setSingleShot(true);
+    m_reloadTimer->setInterval(kReloadDelay);
+    connect(m_reloadTimer, &QTimer::timeout, this, &MainWindow::reloadChangedConfigs);
+    connect(m_configWatcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::onConfigFileChanged);
+    connect(m_configWatcher, &QFileSystemWatcher::directoryChanged, this, &MainWindow::onConfigDirChanged);
 
     ui->stackedWidget->setCurrentIndex(0);
 
-    // 自动加载默认设备
-    QString configPath = QCoreApplication::applicationDirPath() + "/config/";
-    loadDevice(QDir::toNativeSeparators(configPath + "lsj_device.json"));
-    loadDevice(QDir::toNativeSeparators(configPath + "jgq_device.json"));
-    loadDevice(QDir::toNativeSeparators(configPath + "jgt_device.json"));
-    loadDevice(QDir::toNativeSeparators(configPath + "zmotion_device.json"));
+    // 外部驱动插件只注册元数据，配置用到时才加载
+    const int pluginDrivers = DriverRegistry::instance().loadPlugins(QCoreApplication::applicationDirPath() + "/drivers/");
+    qDebug() << "Device drivers:" << DriverRegistry::instance().drivers() << "(" << pluginDrivers << "from plugins)";
+
+    // 自动加载配置目录下的全部设备。配置在线程池中并行解析，窗口先显示，设备解析完成后逐个加入
+    loadDevicesFromDir(QCoreApplication::applicationDirPath() + "/config/");
 }
 
 MainWindow::~MainWindow()
@@ -62,17 +97,80 @@ MainWindow::~MainWindow()
 }
 
 
-void MainWindow::loadDevice(const QString& filePath)
+MainWindow::DeviceConfigFile MainWindow::parseDeviceConfig(const QString& filePath)
 {
+    DeviceConfigFile result;
+    result.filePath = filePath;
+
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Couldn't open device config file:" << filePath;
+        result.error = "Couldn't open device config file";
+        return result;
+    }
+    const QByteArray source = file.readAll();
+
+    // 源文件未修改时直接映射已编译的镜像，不再解析寄存器表
+    const QString imagePath = ConfigImage::imagePath(filePath);
+    if (QFile::exists(imagePath)) {
+        QSharedPointer<const ConfigImage> image = ConfigImage::open(imagePath);
+        if (image && image->matchesSource(source)) {
+            result.image = image;
+            result.config = image->settings();
+            return result;
+        }
+    }
+
+    QJsonParseError parseError;
+    QJsonDocument doc = QJsonDocument::fromJson(source, &parseError);
+    if (parseError.error != QJsonParseError::NoError) {
+        result.error = parseError.errorString();
+        return result;
+    }
+    result.config = doc.object();
+
+    QStringList errors;
+    const QByteArray compiled = ConfigImage::compile(result.config, source, &errors);
+    if (compiled.isEmpty()) {
+        result.error = "Invalid device config: " + errors.join("; ");
+        return result;
+    }
+    // 写入镜像供下次启动使用，写入失败(如目录只读)只影响下次的加载速度
+    QSaveFile imageFile(imagePath);
+    if (!imageFile.open(QIODevice::WriteOnly) || imageFile.write(compiled) != compiled.size() || !imageFile.commit()) {
+        qWarning() << "Couldn't write config image" << imagePath << ":" << imageFile.errorString();
+    }
+    result.image = ConfigImage::fromData(compiled);
+    return result;
+}
+
+void MainWindow::loadDevicesFromDir(const QString& dirPath)
+{
+    QDir dir(dirPath);
+    QStringList paths;
+    for (const QString& fileName : dir.entryList(QStringList() << "*.json", QDir::Files, QDir::Name)) {
+        paths << QDir::toNativeSeparators(dir.absoluteFilePath(fileName));
+    }
+    if (paths.isEmpty()) {
+        qWarning() << "No device config found in:" << dirPath;
         return;
     }
 
-    QByteArray data = file.readAll();
-    QJsonDocument doc(QJsonDocument::fromJson(data));
-    QJsonObject config = doc.object();
+    // 解析结果按完成顺序回到界面线程，每个设备解析完即创建并启动其线程，连接在各自线程中并发进行
+    auto watcher = new QFutureWatcher<DeviceConfigFile>(this);
+    connect(watcher, &QFutureWatcherBase::resultReadyAt, this, [this, watcher](int index) {
+        DeviceConfigFile file = watcher->resultAt(index);
+        if (!file.error.isEmpty()) {
+            qWarning() << file.error << ":" << file.filePath;
+            return;
+        }
+        startDevice(file.config, file.image, file.filePath);
+    });
+    connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(QtConcurrent::mapped(paths, &MainWindow::parseDeviceConfig));
+}
+
+void MainWindow::startDevice(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image, const QString& filePath)
+{
     QString deviceId = config["device_id"].toString();
 
     if (deviceId.isEmpty()) {
@@ -86,9 +184,12 @@ void MainWindow::loadDevice(const QString& filePath)
         return;
     }
 
-    if (m_deviceManager->addDevice(config)) {
+    if (m_deviceManager->addDevice(config, image)) {
         Device* device = m_deviceManager->getDevice(deviceId);
         if (device) {
+            // 联锁在设备线程中评估，先接入再启动线程
+            m_interlocks->attach(device);
+            loadDeviceRules(deviceId, config);
             m_threadManager->startDeviceThread(device);
             
             int newRow = ui->deviceTableWidget->rowCount();
@@ -98,6 +199,7 @@ void MainWindow::loadDevice(const QString& filePath)
             auto statusItem = new QTableWidgetItem("连接中...");
             ui->deviceTableWidget->setItem(newRow, 0, nameItem);
             ui->deviceTableWidget->setItem(newRow, 1, statusItem);
+            ui->deviceTableWidget->setItem(newRow, 3, new QTableWidgetItem("-"));
 
             auto reconnectButton = new QPushButton("重连");
             ui->deviceTableWidget->setCellWidget(newRow, 2, reconnectButton);
@@ -107,13 +209,32 @@ void MainWindow::loadDevice(const QString& filePath)
 
             connect(device, &Device::dataUpdated, m_dataManager, &DataManager::updateDeviceData);
             connect(device, &Device::connectedChanged, this, &MainWindow::onDeviceConnectionChanged);
-            connect(device, &Device::sig_printLog, this, &MainWindow::onPrintLog);
+            connect(device, &Device::reconnectScheduled, this, &MainWindow::onDeviceReconnectScheduled);
+            connect(device, &Device::configReloaded, this, &MainWindow::onDeviceConfigReloaded);
+            // 断开期间该设备的数据标记为过期
+            m_dataManager->setDeviceStale(deviceId, true);
+            connect(device, &Device::connectedChanged, m_dataManager, [this](const QString& id, bool connected) {
+                m_dataManager->setDeviceStale(id, !connected);
+            });
+            // 日志在设备线程中直接写入环形缓冲区，由界面定时批量显示
+            connect(device, &Device::sig_printLog, this, [this, deviceId](const QByteArray &bytes, bool isWrite) {
+                pushLog(deviceId, bytes, isWrite ? LogEntry::Send : LogEntry::Recv);
+            }, Qt::DirectConnection);
 
             // 如果这是第一个设备，则立即显示其数据
             if (ui->deviceTableWidget->rowCount() == 1) {
                 ui->deviceTableWidget->selectRow(0);
             }
 
+            // 监视配置文件，修改后热加载
+            const QFileInfo configInfo(filePath);
+            const QString configPath = configInfo.absoluteFilePath();
+            m_deviceByConfigFile.insert(configPath, deviceId);
+            m_configWatcher->addPath(configPath);
+            if (!m_configWatcher->directories().contains(configInfo.absolutePath())) {
+                m_configWatcher->addPath(configInfo.absolutePath());
+            }
+
             // 如果是ZMotion设备，则在设备加载后设置信号槽连接
             if (deviceId == "zmotion_001") {
                 setupZmotionDeviceConnections();
@@ -122,12 +243,83 @@ void MainWindow::loadDevice(const QString& filePath)
     }
 }
 
+void MainWindow::onConfigFileChanged(const QString& path)
+{
+    if (!m_deviceByConfigFile.contains(path)) {
+        return;
+    }
+    // 文件被替换时监视会自动移除，新文件已存在则重新监视
+    if (!m_configWatcher->files().contains(path) && QFile::exists(path)) {
+        m_configWatcher->addPath(path);
+    }
+    m_pendingReloads.insert(path);
+    m_reloadTimer->start();
+}
+
+void MainWindow::onConfigDirChanged(const QString& path)
+{
+    const QStringList watched = m_configWatcher->files();
+    for (auto it = m_deviceByConfigFile.constBegin(); it != m_deviceByConfigFile.constEnd(); ++it) {
+        const QString& configPath = it.key();
+        if (QFileInfo(configPath).absolutePath() == path && !watched.contains(configPath) && QFile::exists(configPath)) {
+            onConfigFileChanged(configPath);
+        }
+    }
+}
+
+void MainWindow::reloadChangedConfigs()
+{
+    const QStringList paths = m_pendingReloads.toList();
+    m_pendingReloads.clear();
+    if (paths.isEmpty()) {
+        return;
+    }
+
+    // 与启动时一样在线程池中解析和编译。新镜像写回 .dcimg 失败(如Windows上旧镜像仍被映射)
+    // 只影响下次启动，本次使用内存中的镜像
+    auto watcher = new QFutureWatcher<DeviceConfigFile>(this);
+    connect(watcher, &QFutureWatcherBase::resultReadyAt, this, [this, watcher](int index) {
+        DeviceConfigFile file = watcher->resultAt(index);
+        const QString deviceId = m_deviceByConfigFile.value(file.filePath);
+        if (!file.error.isEmpty()) {
+            // 设备继续按原配置运行，修正文件后会再次触发加载
+            qWarning() << "Config reload failed:" << file.error << ":" << file.filePath;
+            pushLog(deviceId, QString("Config reload failed: %1").arg(file.error).toUtf8(), LogEntry::Recv);
+            return;
+        }
+        Device* device = m_deviceManager->getDevice(deviceId);
+        if (!device) {
+            return;
+        }
+        // 报警和联锁规则在设备接受新配置后再替换，配置被拒绝时保留原规则
+        m_pendingRuleConfigs.insert(deviceId, file.config);
+        // 在设备线程中应用，与轮询和收发串行执行，线程和连接都不重启
+        QMetaObject::invokeMethod(device, "reloadConfig", Qt::QueuedConnection,
+                                  Q_ARG(QJsonObject, file.config),
+                                  Q_ARG(QSharedPointer<const ConfigImage>, file.image));
+    });
+    connect(watcher, &QFutureWatcherBase::finished, watcher, &QObject::deleteLater);
+    watcher->setFuture(QtConcurrent::mapped(paths, &MainWindow::parseDeviceConfig));
+}
+
+void MainWindow::onDeviceConfigReloaded(const QString& deviceId)
+{
+    if (m_pendingRuleConfigs.contains(deviceId)) {
+        loadDeviceRules(deviceId, m_pendingRuleConfigs.take(deviceId));
+    }
+    // 寄存器表按新镜像重建，当前值从数据管理器取回
+    if (deviceId == m_currentDeviceId && ui->stackedWidget->currentIndex() == 0) {
+        updateDataTable(deviceId);
+    }
+}
+
 void MainWindow::onDeviceSelectionChanged()
 {
     QList<QTableWidgetItem*> selectedItems = ui->deviceTableWidget->selectedItems();
     if (!selectedItems.isEmpty()) {
         QTableWidgetItem* item = selectedItems.first();
         QString deviceId = item->data(Qt::UserRole).toString();
+        m_currentDeviceId = deviceId;
         if(deviceId == "jgq_001" || deviceId == "lsj_001" )
         {
             ui->stackedWidget->setCurrentIndex(0);
@@ -149,62 +341,92 @@ void MainWindow::updateDataTable(const QString& deviceId)
     Device* device = m_deviceManager->getDevice(deviceId);
     if (!device) return;
 
-    m_isInternalChange = true;
-    ui->dataTableWidget->clearContents();
-    ui->dataTableWidget->setRowCount(0);
-    m_dataRowMap.clear();
-
-    const QJsonObject& config = device->getConfig();
-    QJsonArray registers = config["registers"].toArray();
-    for (const QJsonValue &val : registers) {
-        QJsonObject obj = val.toObject();
-        int address = obj["address"].toInt();
-        QString key = obj["key"].toString();
-        QString name = obj["name"].toString();
-        QString access = obj["access"].toString();
-        int bitpos = obj["bitpos"].toInt();
-        int length = obj["length"].toInt();
-
-        int newRow = ui->dataTableWidget->rowCount();
-        ui->dataTableWidget->insertRow(newRow);
-
-        auto addressItem = new QTableWidgetItem(QString::number(address));
-        auto bitposItem = new QTableWidgetItem(QString::number(bitpos));
-        auto lengthItem = new QTableWidgetItem(QString::number(length));
-        auto keyItem = new QTableWidgetItem(key);
-        auto nameItem = new QTableWidgetItem(name);
-        auto accessItem = new QTableWidgetItem(access);
-        auto valueItem = new QTableWidgetItem("0"); // 初始值
-
-        // 设置只读属性
-        addressItem->setFlags(addressItem->flags() & ~Qt::ItemIsEditable);
-        bitposItem->setFlags(bitposItem->flags() & ~Qt::ItemIsEditable);
-        lengthItem->setFlags(lengthItem->flags() & ~Qt::ItemIsEditable);
-        keyItem->setFlags(keyItem->flags() & ~Qt::ItemIsEditable);
-        nameItem->setFlags(nameItem->flags() & ~Qt::ItemIsEditable);
-        accessItem->setFlags(accessItem->flags() & ~Qt::ItemIsEditable);
-        if (!access.contains("write")) {
-            valueItem->setFlags(valueItem->flags() & ~Qt::ItemIsEditable);
-        }
+    m_dataModel->setDevice(deviceId, device->configImage());
+    m_dataModel->setAlarmedKeys(m_alarmEngine->alarmedTags(deviceId));
+}
 
-        ui->dataTableWidget->setItem(newRow, 0, addressItem);
-        ui->dataTableWidget->setItem(newRow, 1, bitposItem);
-        ui->dataTableWidget->setItem(newRow, 2, lengthItem);
-        ui->dataTableWidget->setItem(newRow, 3, keyItem);
-        ui->dataTableWidget->setItem(newRow, 4, nameItem);
-        ui->dataTableWidget->setItem(newRow, 5, accessItem);
-        ui->dataTableWidget->setItem(newRow, 6, valueItem);
-        m_dataRowMap[key] = newRow;
+void MainWindow::loadDeviceRules(const QString& deviceId, const QJsonObject& config)
+{
+    const QJsonArray alarms = config["alarms"].toArray();
+    const QJsonArray interlocks = config["interlocks"].toArray();
+    QStringList errors;
+    const int alarmCount = m_alarmEngine->setDeviceRules(deviceId, alarms, &errors);
+    const int interlockCount = m_interlocks->setDeviceRules(deviceId, interlocks, &errors);
+    for (const QString& error : errors) {
+        qWarning() << "Device" << deviceId << "rule ignored:" << error;
+        pushLog(deviceId, QString("Rule ignored: %1").arg(error).toUtf8(), LogEntry::Data);
+    }
+    if (!alarms.isEmpty() || !interlocks.isEmpty()) {
+        qDebug() << "Device" << deviceId << "alarm rules:" << alarmCount << "interlocks:" << interlockCount;
+    }
+}
+
+void MainWindow::onAlarmEvent(const AlarmEvent& event)
+{
+    const QString text = QString("Alarm %1 [%2] %3: %4 (value %5)")
+            .arg(AlarmEvent::typeName(event.type)).arg(event.severity)
+            .arg(event.ruleId).arg(event.name).arg(event.value.toString());
+    qWarning() << "Device" << event.deviceId << text;
+    pushLog(event.deviceId, text.toUtf8(), LogEntry::Data);
+
+    if (event.type == AlarmEvent::Raised || event.type == AlarmEvent::Triggered) {
+        Device* device = m_deviceManager->getDevice(event.deviceId);
+        const QString deviceName = device ? device->deviceName() : event.deviceId;
+        statusBar()->showMessage(QString("%1: %2 (%3)").arg(deviceName).arg(event.name).arg(event.severity),
+                                 kAlarmMessageTimeout);
+    }
+}
+
+void MainWindow::onInterlockFired(const QString& deviceId, const QString& ruleId, const QString& name)
+{
+    // 动作已在设备线程中投递，这里只记录
+    const QString text = QString("Interlock %1: %2").arg(ruleId).arg(name);
+    qWarning() << "Device" << deviceId << text;
+    pushLog(deviceId, text.toUtf8(), LogEntry::Data);
+    statusBar()->showMessage(text, kAlarmMessageTimeout);
+}
+
+void MainWindow::onActiveAlarmsChanged()
+{
+    if (m_dataModel->deviceId() == m_currentDeviceId) {
+        m_dataModel->setAlarmedKeys(m_alarmEngine->alarmedTags(m_currentDeviceId));
+    }
+}
+
+void MainWindow::onDataTableContextMenu(const QPoint& pos)
+{
+    // 列出当前设备未确认的报警，可逐条或全部确认
+    QMenu menu(this);
+    const QList<AlarmEvent> alarms = m_alarmEngine->activeAlarms();
+    for (const AlarmEvent& alarm : alarms) {
+        if (alarm.deviceId != m_currentDeviceId || alarm.type == AlarmEvent::Acknowledged) {
+            continue;
+        }
+        const QString deviceId = alarm.deviceId;
+        const QString ruleId = alarm.ruleId;
+        menu.addAction(QString("确认报警: %1").arg(alarm.name), this, [this, deviceId, ruleId]() {
+            m_alarmEngine->acknowledge(deviceId, ruleId);
+        });
+    }
+    if (menu.isEmpty()) {
+        return;
     }
-    m_isInternalChange = false;
+    menu.addSeparator();
+    menu.addAction("确认全部报警", m_alarmEngine, &AlarmEngine::acknowledgeAll);
+    menu.exec(ui->dataTableWidget->viewport()->mapToGlobal(pos));
 }
 
 QByteArray MainWindow::toHex(const QByteArray &bytes)
 {
-    QByteArray hexBytes;
-    const char *pBytes = bytes.data();
+    // 查表转换，结果缓冲区一次分配: 每字节两个十六进制字符加一个空格
+    static const char digits[] = "0123456789ABCDEF";
+    QByteArray hexBytes(bytes.size() * 3, Qt::Uninitialized);
+    const uchar *pBytes = reinterpret_cast<const uchar*>(bytes.constData());
+    char *out = hexBytes.data();
     for(int i = 0;i < bytes.size();i++) {
-        hexBytes += QByteArray(1,(uchar)pBytes[i]).toHex().toUpper() + " ";
+        *out++ = digits[pBytes[i] >> 4];
+        *out++ = digits[pBytes[i] & 0x0F];
+        *out++ = ' ';
     }
     return hexBytes;
 }
@@ -212,24 +434,68 @@ QByteArray MainWindow::toHex(const QByteArray &bytes)
 void MainWindow::initDeivceTableUI()
 {
     // 配置新的设备列表表格
-    ui->deviceTableWidget->setColumnCount(3);
-    ui->deviceTableWidget->setHorizontalHeaderLabels({"设备名称", "状态", "重连"});
+    ui->deviceTableWidget->setColumnCount(4);
+    ui->deviceTableWidget->setHorizontalHeaderLabels({"设备名称", "状态", "重连", "性能"});
     ui->deviceTableWidget->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
     ui->deviceTableWidget->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
     ui->deviceTableWidget->horizontalHeader()->setSectionResizeMode(2, QHeaderView::Stretch);
+    ui->deviceTableWidget->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
     ui->deviceTableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
     ui->deviceTableWidget->setSelectionMode(QAbstractItemView::SingleSelection);
     ui->deviceTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
 
 //    ui->splitter->setStretchFactor(0, 2); // 左侧比例为1
 //    ui->splitter->setStretchFactor(1, 5); // 右侧宽度是左侧的3倍
+
+    // 设备线程只做原子计数，界面按固定间隔读取快照
+    m_metricsTimer->setInterval(kMetricsInterval);
+    connect(m_metricsTimer, &QTimer::timeout, this, &MainWindow::updateDeviceMetrics);
+    m_metricsTimer->start();
+}
+
+void MainWindow::updateDeviceMetrics()
+{
+    auto ms = [](qint64 us) { return QString::number(us / 1000.0, 'f', 1); };
+
+    for (int row = 0; row < ui->deviceTableWidget->rowCount(); ++row) {
+        QTableWidgetItem* nameItem = ui->deviceTableWidget->item(row, 0);
+        QTableWidgetItem* metricsItem = ui->deviceTableWidget->item(row, 3);
+        if (!nameItem || !metricsItem) {
+            continue;
+        }
+        const QString deviceId = nameItem->data(Qt::UserRole).toString();
+        Device* device = m_deviceManager->getDevice(deviceId);
+        if (!device) {
+            continue;
+        }
+
+        const DeviceMetrics::Snapshot s = device->metrics().snapshot();
+        const quint64 lastReplies = m_lastReplies.value(deviceId, s.replies);
+        const double txPerSec = (s.replies - lastReplies) * 1000.0 / kMetricsInterval;
+        m_lastReplies.insert(deviceId, s.replies);
+
+        QString text = QString("p50 %1 ms p99 %2 ms | %3 tx/s | err %4 | q %5")
+                           .arg(ms(s.latency.p50Us)).arg(ms(s.latency.p99Us))
+                           .arg(txPerSec, 0, 'f', 0).arg(s.errors()).arg(s.queueDepth);
+        // 轮询设备额外显示数据年龄，反映排队造成的数据滞后
+        if (s.tagAge.count > 0) {
+            text += QString(" | age p99 %1 ms").arg(ms(s.tagAge.p99Us));
+        }
+        // 联锁目标设备显示触发到下发的最坏延迟
+        if (s.reaction.count > 0) {
+            text += QString(" | react max %1 ms").arg(ms(s.reaction.maxUs));
+        }
+        metricsItem->setText(text);
+        metricsItem->setToolTip(s.toString());
+    }
 }
 
 void MainWindow::initModbusTableUI()
 {
-    // 设置数据表格
-    ui->dataTableWidget->setColumnCount(7);
-    ui->dataTableWidget->setHorizontalHeaderLabels({"Address", "Bitpos", "Length", "Key", "Name", "Access", "Value"});
+    // 设置数据表格，数值刷新由模型按固定帧率合并
+    ui->dataTableWidget->setModel(m_dataModel);
+    m_dataModel->setView(ui->dataTableWidget);
+    ui->dataTableWidget->setEditTriggers(QAbstractItemView::DoubleClicked | QAbstractItemView::EditKeyPressed);
     QHeaderView* header = ui->dataTableWidget->horizontalHeader();
     header->setSectionResizeMode(0, QHeaderView::ResizeToContents); // Address
     header->setSectionResizeMode(1, QHeaderView::ResizeToContents); // Bitpos
@@ -238,18 +504,17 @@ void MainWindow::initModbusTableUI()
     header->setSectionResizeMode(4, QHeaderView::Stretch);          // Name
     header->setSectionResizeMode(5, QHeaderView::ResizeToContents); // Access
     header->setSectionResizeMode(6, QHeaderView::Stretch);          // Value
+
+    // 右键确认报警
+    ui->dataTableWidget->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(ui->dataTableWidget, &QWidget::customContextMenuRequested, this, &MainWindow::onDataTableContextMenu);
 }
 
 
 void MainWindow::onDeviceDataUpdated(const QString& deviceId, const QString& key, const QVariant& value)
 {
-    // 仅当数据显示的是当前活动设备时才更新
-    QList<QTableWidgetItem*> selectedItems = ui->deviceTableWidget->selectedItems();
-    if (selectedItems.isEmpty()) {
-        return;
-    }
-    QString currentDeviceId = selectedItems.first()->data(Qt::UserRole).toString();
-    if (currentDeviceId != deviceId) {
+    // 仅当数据显示的是当前活动设备时才更新；寄存器数据表格由 DataTableModel 直接接收更新
+    if (m_currentDeviceId != deviceId) {
         return;
     }
 
@@ -257,9 +522,9 @@ void MainWindow::onDeviceDataUpdated(const QString& deviceId, const QString& key
     if (deviceId == "zmotion_001" && ui->stackedWidget->currentIndex() == 2) {
         int keyAxis = -1;
 
-        // 解析 key 中的轴号
+        // 解析 key 中的轴号 (axis<N>_xxx，N可能为多位数)
         if (key.startsWith("axis")) {
-            keyAxis = key.mid(4, 1).toInt();
+            keyAxis = key.mid(4, key.indexOf('_') - 4).toInt();
         }
 
         // --- 以下是全局状态更新，不受选中轴影响 ---
@@ -269,34 +534,44 @@ void MainWindow::onDeviceDataUpdated(const QString& deviceId, const QString& key
             if (keyAxis >= 0 && keyAxis < ui->axisStatusTable->rowCount()) {
                 ui->axisStatusTable->item(keyAxis, 1)->setText(QString::number(value.toDouble(), 'f', 3));
             }
-        } else if (key.contains("_status_code")) { // 假设状态码以 _status_code 结尾
+        } else if (key.endsWith("_speed")) {
+            if (keyAxis >= 0 && keyAxis < ui->axisStatusTable->rowCount()) {
+                ui->axisStatusTable->item(keyAxis, 2)->setText(QString::number(value.toDouble(), 'f', 3));
+            }
+        } else if (key.endsWith("_status")) {
             if (keyAxis >= 0 && keyAxis < ui->axisStatusTable->rowCount()) {
                 int status = value.toInt();
-                // 这里可以添加更复杂的状态解析逻辑
-                QString statusText = (status == 0) ? "空闲" : "运动中";
+                // ZMotionDevice 发布的状态: 1-停止(空闲), 0-运动中
+                QString statusText = (status == 1) ? "空闲" : "运动中";
                 ui->axisStatusTable->item(keyAxis, 3)->setText(statusText);
             }
         }
 
-        // 2. 更新IO输入指示灯
-        if (key.startsWith("input")) {
-            int inputId = key.mid(5).toInt();
-            if (inputId >= 0 && inputId < 8) {
+        // 2. 更新IO输入指示灯 (整组IO打包发布，只解包变化的点)
+        if (key == "input_bank") {
+            IoBank bank = value.value<IoBank>();
+            for (int inputId = 0; inputId < 8; ++inputId) {
+                if (!bank.isChanged(inputId)) {
+                    continue;
+                }
                 QLabel* inputLed = findChild<QLabel*>(QString("input%1Led").arg(inputId));
                 if (inputLed) {
-                    bool state = value.toBool();
+                    bool state = bank.test(inputId);
                     inputLed->setStyleSheet(state ? "background-color: #4CAF50; color: white;" : "background-color: #E0E0E0;");
                 }
             }
         }
  
         // 3. 更新IO输出按钮状态 (反馈)
-        if (key.startsWith("output")) {
-            int outputId = key.mid(6).toInt();
-            if (outputId >= 0 && outputId < 8) { // 假设有8个输出按钮
+        if (key == "output_bank") {
+            IoBank bank = value.value<IoBank>();
+            for (int outputId = 0; outputId < 8; ++outputId) { // 假设有8个输出按钮
+                if (!bank.isChanged(outputId)) {
+                    continue;
+                }
                 QPushButton* outputBtn = findChild<QPushButton*>(QString("output%1Btn").arg(outputId));
                 if (outputBtn) {
-                    bool state = value.toBool();
+                    bool state = bank.test(outputId);
                     // 避免触发 toggled 信号的无限循环
                     if (outputBtn->isChecked() != state) {
                         outputBtn->setChecked(state);
@@ -306,43 +581,14 @@ void MainWindow::onDeviceDataUpdated(const QString& deviceId, const QString& key
         }
 
         // 4. 在日志区域显示所有原始数据更新
-        QString logMsg = QString("[%1] %2 = %3").arg(QTime::currentTime().toString("hh:mm:ss.zzz")).arg(key).arg(value.toString());
-        ui->zmotionLogEdit->appendPlainText(logMsg);
-        if (ui->autoScrollCheckBox->isChecked()) {
-            ui->zmotionLogEdit->moveCursor(QTextCursor::End);
-        }
-    }
-    // 处理其他设备的数据表格更新
-    else if (m_dataRowMap.contains(key)) {
-        int dataRow = m_dataRowMap[key];
-        m_isInternalChange = true;
-        if(ui->dataTableWidget->item(dataRow, 6))
-             ui->dataTableWidget->item(dataRow, 6)->setText(value.toString());
-        m_isInternalChange = false;
+        QString valueText = (value.userType() == qMetaTypeId<IoBank>()) ? value.value<IoBank>().toString() : value.toString();
+        pushLog(deviceId, QString("%1 = %2").arg(key).arg(valueText).toUtf8(), LogEntry::Data);
     }
 }
 
-void MainWindow::onTableCellChanged(int row, int column)
+void MainWindow::onDataWriteRequested(const QString& deviceId, const QString& key, const QString& value)
 {
-    if (m_isInternalChange || column != 6)
-        return;
-
-    QList<QTableWidgetItem*> selectedItems = ui->deviceTableWidget->selectedItems();
-    if (selectedItems.isEmpty())
-        return;
-
-    QString currentDeviceId = selectedItems.first()->data(Qt::UserRole).toString();
-
-    QTableWidgetItem* keyItem = ui->dataTableWidget->item(row, 3);
-    QTableWidgetItem* valueItem = ui->dataTableWidget->item(row, 6);
-
-    if (!keyItem || !valueItem)
-        return;
-
-    QString key = keyItem->text();
-    QString value = valueItem->text();
-
-    Device* device = m_deviceManager->getDevice(currentDeviceId);
+    Device* device = m_deviceManager->getDevice(deviceId);
     if (device) {
         QMetaObject::invokeMethod(device, "writeData2Device", Qt::QueuedConnection,
                                   Q_ARG(QString, key), Q_ARG(QString, value));
@@ -364,6 +610,23 @@ void MainWindow::onDeviceConnectionChanged(const QString& deviceId, bool connect
     }
 }
 
+void MainWindow::onDeviceReconnectScheduled(const QString& deviceId, int attempt, int delayMs, bool breakerOpen)
+{
+    for (int row = 0; row < ui->deviceTableWidget->rowCount(); ++row) {
+        QTableWidgetItem* item = ui->deviceTableWidget->item(row, 0);
+        if (item && item->data(Qt::UserRole).toString() == deviceId) {
+            QTableWidgetItem* statusItem = ui->deviceTableWidget->item(row, 1);
+            if (statusItem) {
+                double seconds = delayMs / 1000.0;
+                statusItem->setText(breakerOpen ? QString("断路保护，%1s后重试").arg(seconds, 0, 'f', 0)
+                                                : QString("%1s后第%2次重连").arg(seconds, 0, 'f', 1).arg(attempt));
+                statusItem->setForeground(breakerOpen ? Qt::red : Qt::darkYellow);
+            }
+            return;
+        }
+    }
+}
+
 void MainWindow::on_sendBtn_clicked()
 {
     QList<QTableWidgetItem*> selectedItems = ui->deviceTableWidget->selectedItems();
@@ -378,64 +641,99 @@ void MainWindow::on_sendBtn_clicked()
     }
 }
 
-void MainWindow::onPrintLog(const QByteArray &bytes, bool isWrite)
+void MainWindow::pushLog(const QString &deviceId, const QByteArray &bytes, LogEntry::Kind kind)
 {
     if(bytes.isEmpty())
         return;
 
-    Device* senderDevice = qobject_cast<Device*>(sender());
-    if (!senderDevice) {
-        return; // 无法确定发送者
-    }
-    QString senderDeviceId = senderDevice->deviceId();
-
-    QPlainTextEdit* logEdit = nullptr;
-    bool hexDisplay = false;
-    bool autoScroll = false;
-
-    // 根据设备ID选择UI控件和配置
-    if (senderDeviceId == "zmotion_001") {
-        logEdit = ui->zmotionLogEdit;
-        hexDisplay = ui->zmotionHexDisplayCheckBox->isChecked();
-        autoScroll = ui->autoScrollCheckBox->isChecked();
-    } else if (senderDeviceId == "jgt_001") {
-        logEdit = ui->logEdit;
-        hexDisplay = ui->jgtHexDisplayCheckBox->isChecked();
-        autoScroll = ui->jgtAutoScrollCheckBox->isChecked();
-    } else {
-        return; // 没有对应的日志界面
-    }
+    LogEntry entry;
+    entry.deviceId = deviceId;
+    entry.payload = bytes;
+    entry.timeMs = QTime::currentTime().msecsSinceStartOfDay();
+    entry.kind = kind;
+    m_logRing.push(std::move(entry)); // 缓冲区满时丢弃，由 flushLogs 报告丢弃条数
+}
 
-    if (!logEdit) return;
+void MainWindow::initLogView()
+{
+    ui->logEdit->setMaximumBlockCount(kMaxLogLines);
+    ui->zmotionLogEdit->setMaximumBlockCount(kMaxLogLines);
 
-    // 准备日志内容
-    QString timeStr = QTime::currentTime().toString("hh:mm:ss.zzz");
-    QString direction = isWrite ? "Send" : "Recv";
-    
-    // 始终显示文本内容
-    QString textContent = QString::fromUtf8(bytes);
-    QString logMessage = QString("[%1] %2(text): %3").arg(timeStr).arg(direction).arg(textContent);
-    logEdit->appendPlainText(logMessage);
+    m_logFlushTimer->setInterval(kLogFlushInterval);
+    connect(m_logFlushTimer, &QTimer::timeout, this, &MainWindow::flushLogs);
+    m_logFlushTimer->start();
+}
 
-    // 如果勾选了Hex，则额外显示Hex内容
-    if (hexDisplay) {
-        QString hexContent = toHex(bytes);
-        QString hexLogMessage = QString("[%1] %2(hex): %3").arg(timeStr).arg(direction).arg(hexContent);
-        logEdit->appendPlainText(hexLogMessage);
+void MainWindow::flushLogs()
+{
+    // 每个日志控件本轮的文本合并为一次 appendPlainText
+    QString zmotionText;
+    QString jgtText;
+    const bool zmotionHex = ui->zmotionHexDisplayCheckBox->isChecked();
+    const bool jgtHex = ui->jgtHexDisplayCheckBox->isChecked();
+
+    LogEntry entry;
+    int count = 0;
+    while (count < kMaxLogBatch && m_logRing.pop(entry)) {
+        ++count;
+        QString* text = nullptr;
+        bool hexDisplay = false;
+
+        // 根据设备ID选择UI控件和配置
+        if (entry.deviceId == "zmotion_001") {
+            text = &zmotionText;
+            hexDisplay = zmotionHex;
+        } else if (entry.deviceId == "jgt_001") {
+            text = &jgtText;
+            hexDisplay = jgtHex;
+        } else {
+            continue; // 没有对应的日志界面
+        }
+
+        QString timeStr = QTime::fromMSecsSinceStartOfDay(int(entry.timeMs)).toString("hh:mm:ss.zzz");
+        if (!text->isEmpty()) {
+            text->append('\n');
+        }
+
+        if (entry.kind == LogEntry::Data) {
+            text->append(QString("[%1] %2").arg(timeStr).arg(QString::fromUtf8(entry.payload)));
+            continue;
+        }
+
+        // 始终显示文本内容，勾选了Hex时额外显示Hex内容，之后追加一个空行以分隔日志条目
+        QString direction = (entry.kind == LogEntry::Send) ? "Send" : "Recv";
+        text->append(QString("[%1] %2(text): %3\n").arg(timeStr).arg(direction).arg(QString::fromUtf8(entry.payload)));
+        if (hexDisplay) {
+            text->append(QString("[%1] %2(hex): %3\n").arg(timeStr).arg(direction).arg(QString::fromLatin1(toHex(entry.payload))));
+        }
     }
 
-    // 追加一个空行以分隔日志条目
-    logEdit->appendPlainText("");
+    quint64 dropped = m_logRing.takeDropped();
+    if (dropped > 0) {
+        QString note = QString("... %1 log lines dropped").arg(dropped);
+        zmotionText += zmotionText.isEmpty() ? note : "\n" + note;
+        jgtText += jgtText.isEmpty() ? note : "\n" + note;
+    }
 
-    // 滚动
-    if (autoScroll) {
-        logEdit->moveCursor(QTextCursor::End);
+    if (!zmotionText.isEmpty()) {
+        ui->zmotionLogEdit->appendPlainText(zmotionText);
+        if (ui->autoScrollCheckBox->isChecked()) {
+            ui->zmotionLogEdit->moveCursor(QTextCursor::End);
+        }
+    }
+    if (!jgtText.isEmpty()) {
+        ui->logEdit->appendPlainText(jgtText);
+        if (ui->jgtAutoScrollCheckBox->isChecked()) {
+            ui->logEdit->moveCursor(QTextCursor::End);
+        }
     }
 }
 
 
 void MainWindow::closeEvent(QCloseEvent *event)
 {
+    // 先停止联锁评估，之后设备线程不再向其它设备投递写入
+    m_interlocks->clear();
     m_deviceManager->cleanup();
     event->accept();
 }
@@ -456,8 +754,8 @@ void MainWindow::onReconnectButtonClicked(const QString &deviceId)
                 break; // Found and updated
             }
         }
-        // 使用invokeMethod安全地调用工作线程中的连接方法
-        QMetaObject::invokeMethod(device, "connectDevice", Qt::QueuedConnection);
+        // 使用invokeMethod安全地调用工作线程中的连接方法，手动重连同时复位退避和断路器
+        QMetaObject::invokeMethod(device, "reconnectNow", Qt::QueuedConnection);
     }
 }
 
@@ -3,7 +3,13 @@
 
 #include <QMainWindow>
 #include <QMap>
+#include <QHash>
+#include <QSet>
 #include <QCloseEvent>
+#include <QJsonObject>
+#include <QSharedPointer>
+#include "core/LogRing.h"
+#include "core/ConfigImage.h"
 
 
 QT_BEGIN_NAMESPACE
@@ -13,6 +19,12 @@ QT_END_NAMESPACE
 class DeviceManager;
 class ThreadManager;
 class DataManager;
+class DataTableModel;
+class AlarmEngine;
+class InterlockEngine;
+struct AlarmEvent;
+class QTimer;
+class QFileSystemWatcher;
 
 /**
  * @brief 主窗口类，应用程序的主窗口
@@ -35,28 +47,81 @@ private slots:
      * @param data 接收到的数据
      */
     void onDeviceDataUpdated(const QString& deviceId, const QString& key, const QVariant& value);
-    void onTableCellChanged(int row, int column);
+    void onDataWriteRequested(const QString& deviceId, const QString& key, const QString& value);
     void onDeviceSelectionChanged();
     void onDeviceConnectionChanged(const QString& deviceId, bool connected);
+    void onDeviceReconnectScheduled(const QString& deviceId, int attempt, int delayMs, bool breakerOpen);
     void on_sendBtn_clicked();
-    void onPrintLog(const QByteArray &bytes, bool isWrite);
+    void flushLogs();
+    /**
+     * @brief 定时刷新设备列表中的运行统计列
+     */
+    void updateDeviceMetrics();
     void onReconnectButtonClicked(const QString& deviceId);
     void on_jgtClearLogBtn_clicked();
+    /**
+     * @brief 已加载的设备配置文件被修改，合并短时间内的多次修改后热加载
+     */
+    void onConfigFileChanged(const QString& path);
+    /**
+     * @brief 配置目录变化：编辑器以"写临时文件再改名"方式保存时原文件的监视会失效，在此恢复
+     */
+    void onConfigDirChanged(const QString& path);
+    /**
+     * @brief 重新解析已修改的配置文件，交给对应设备在其线程中热加载
+     */
+    void reloadChangedConfigs();
+    void onDeviceConfigReloaded(const QString& deviceId);
+    /**
+     * @brief 报警事件写入日志，产生的报警在状态栏提示
+     */
+    void onAlarmEvent(const AlarmEvent& event);
+    /**
+     * @brief 报警集合变化时更新寄存器表格中的报警行
+     */
+    void onActiveAlarmsChanged();
+    void onDataTableContextMenu(const QPoint& pos);
+    void onInterlockFired(const QString& deviceId, const QString& ruleId, const QString& name);
 
 protected:
     void closeEvent(QCloseEvent *event) override;
 
 private:
+    // 设备配置文件的解析结果，在线程池中生成
+    struct DeviceConfigFile {
+        QString filePath;
+        QJsonObject config;
+        QSharedPointer<const ConfigImage> image;    ///< 编译后的配置镜像
+        QString error;      ///< 非空表示读取、解析或校验失败
+    };
+    static DeviceConfigFile parseDeviceConfig(const QString& filePath);
+
+    /**
+     * @brief 并行解析目录下全部 *.json 设备配置，解析完成的设备逐个创建并启动
+     * @param dirPath 配置目录
+     */
+    void loadDevicesFromDir(const QString& dirPath);
+
     /**
-     * @brief 从配置文件加载设备
+     * @brief 按已解析的配置创建设备、启动设备线程并加入设备列表
      */
-    void loadDevice(const QString& filePath);
+    void startDevice(const QJsonObject& config, const QSharedPointer<const ConfigImage>& image, const QString& filePath);
     void updateDataTable(const QString& deviceId);
+    /**
+     * @brief 按设备配置中的 "alarms" 和 "interlocks" 数组设置报警和联锁规则
+     */
+    void loadDeviceRules(const QString& deviceId, const QJsonObject& config);
     QByteArray toHex(const QByteArray &bytes);
+
+    /**
+     * @brief 写入一条日志，可在设备线程中调用
+     */
+    void pushLog(const QString &deviceId, const QByteArray &bytes, LogEntry::Kind kind);
     
     void initDeivceTableUI();
     void initModbusTableUI();
     void initZMotionUI();
+    void initLogView();
     void setupZmotionDeviceConnections();
     void loadStyleSheet();
 
@@ -65,7 +130,25 @@ private:
     DeviceManager* m_deviceManager;     ///< 设备管理器
     ThreadManager* m_threadManager;     ///< 线程管理器
     DataManager* m_dataManager;         ///< 数据管理器
-    QMap<QString, int> m_dataRowMap;    ///< 用于跟踪数据显示在哪一行
-    bool m_isInternalChange;            ///< 用于防止cellChanged信号重入
+    DataTableModel* m_dataModel;        ///< 寄存器数据表格模型
+    AlarmEngine* m_alarmEngine;         ///< 报警规则引擎
+    InterlockEngine* m_interlocks;      ///< 跨设备联锁引擎，在设备线程中评估
+    QString m_currentDeviceId;          ///< 当前选中的设备ID
+    LogRing m_logRing;                  ///< 设备线程写入、界面线程批量显示的日志缓冲区
+    QTimer* m_logFlushTimer;            ///< 日志批量显示定时器
+    QTimer* m_metricsTimer;             ///< 运行统计刷新定时器
+    QHash<QString, quint64> m_lastReplies; ///< 上次刷新时各设备的成功事务数，用于计算吞吐率
+    QFileSystemWatcher* m_configWatcher;    ///< 监视已加载的设备配置文件
+    QTimer* m_reloadTimer;                  ///< 热加载合并定时器
+    QSet<QString> m_pendingReloads;         ///< 等待热加载的配置文件
+    QHash<QString, QString> m_deviceByConfigFile; ///< 配置文件路径 -> 设备ID
+    QHash<QString, QJsonObject> m_pendingRuleConfigs; ///< 热加载中的设备 -> 新配置，设备应用配置后替换报警和联锁规则
+
+    static const int kMaxLogLines = 5000;       ///< 日志控件最多保留的行数
+    static const int kLogFlushInterval = 100;   ///< 日志刷新间隔(ms)
+    static const int kMaxLogBatch = 2000;       ///< 每次刷新最多显示的日志条数
+    static const int kMetricsInterval = 1000;   ///< 运行统计刷新间隔(ms)
+    static const int kReloadDelay = 500;        ///< 配置文件最后一次修改后等待多久再热加载(ms)
+    static const int kAlarmMessageTimeout = 10000; ///< 状态栏报警提示的显示时间(ms)
 };
 #endif // MAINWINDOW_H